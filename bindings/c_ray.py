@@ -50,6 +50,14 @@ class _cr_rparam(IntEnum):
 	output_filetype = 14
 	node_list = 15
 	blender_mode = 16
+	denoise = 17
+	integrator = 18
+	flush_interval = 19
+	tile_autotune = 20
+	pin_threads = 21
+	numa_replicate = 22
+	half_textures = 23
+	texture_cache_size = 24
 
 def _r_set_num(ptr, param, value):
 	return _lib.renderer_set_num_pref(ptr, param, value)
@@ -178,6 +186,54 @@ class _pref:
 		_r_set_num(self.r_ptr, _cr_rparam.is_iterative, value)
 	is_iterative = property(_get_is_iterative, _set_is_iterative, None, "")
 
+	def _get_denoise(self):
+		return _r_get_num(self.r_ptr, _cr_rparam.denoise)
+	def _set_denoise(self, value):
+		_r_set_num(self.r_ptr, _cr_rparam.denoise, value)
+	denoise = property(_get_denoise, _set_denoise, None, "Run the AOV-guided denoiser after rendering")
+
+	def _get_integrator(self):
+		return _r_get_str(self.r_ptr, _cr_rparam.integrator)
+	def _set_integrator(self, value):
+		_r_set_str(self.r_ptr, _cr_rparam.integrator, value)
+	integrator = property(_get_integrator, _set_integrator, None, "\"pathtrace\" or \"wavefront\"")
+
+	def _get_flush_interval(self):
+		return _r_get_num(self.r_ptr, _cr_rparam.flush_interval)
+	def _set_flush_interval(self, value):
+		_r_set_num(self.r_ptr, _cr_rparam.flush_interval, value)
+	flush_interval = property(_get_flush_interval, _set_flush_interval, None, "Samples a thread sums up locally before writing them to the image, 0 = on tile completion")
+
+	def _get_tile_autotune(self):
+		return _r_get_num(self.r_ptr, _cr_rparam.tile_autotune)
+	def _set_tile_autotune(self, value):
+		_r_set_num(self.r_ptr, _cr_rparam.tile_autotune, value)
+	tile_autotune = property(_get_tile_autotune, _set_tile_autotune, None, "Pick the tile size with a quick pre-pass before rendering")
+
+	def _get_pin_threads(self):
+		return _r_get_str(self.r_ptr, _cr_rparam.pin_threads)
+	def _set_pin_threads(self, value):
+		_r_set_str(self.r_ptr, _cr_rparam.pin_threads, value)
+	pin_threads = property(_get_pin_threads, _set_pin_threads, None, "\"none\", \"cores\" or \"compact\"")
+
+	def _get_numa_replicate(self):
+		return _r_get_num(self.r_ptr, _cr_rparam.numa_replicate)
+	def _set_numa_replicate(self, value):
+		_r_set_num(self.r_ptr, _cr_rparam.numa_replicate, value)
+	numa_replicate = property(_get_numa_replicate, _set_numa_replicate, None, "Copy acceleration structures to each NUMA node, implies pinning")
+
+	def _get_half_textures(self):
+		return _r_get_num(self.r_ptr, _cr_rparam.half_textures)
+	def _set_half_textures(self, value):
+		_r_set_num(self.r_ptr, _cr_rparam.half_textures, value)
+	half_textures = property(_get_half_textures, _set_half_textures, None, "Store float textures as half floats, to save memory")
+
+	def _get_texture_cache_size(self):
+		return _r_get_num(self.r_ptr, _cr_rparam.texture_cache_size)
+	def _set_texture_cache_size(self, value):
+		_r_set_num(self.r_ptr, _cr_rparam.texture_cache_size, value)
+	texture_cache_size = property(_get_texture_cache_size, _set_texture_cache_size, None, "Texture cache budget in megabytes, textures are loaded on demand. 0 loads them all up front")
+
 	def _get_output_path(self):
 		return _r_get_str(self.r_ptr, _cr_rparam.output_path)
 	def _set_output_path(self, value):
@@ -369,6 +425,7 @@ class camera:
 def inst_type(IntEnum):
 	mesh = 0
 	sphere = 1
+	sphere_set = 2
 
 class cr_matrix(ct.Structure):
 	_fields_ = [
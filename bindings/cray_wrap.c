@@ -291,9 +291,10 @@ static PyObject *py_cr_scene_totals(PyObject *self, PyObject *args) {
 	struct cr_scene *s = PyCapsule_GetPointer(s_ext, "cray.cr_scene");
 	struct cr_scene_totals totals = cr_scene_totals(s);
 	return Py_BuildValue(
-		"{s:i, s:i, s:i, s:i}",
+		"{s:i, s:i, s:i, s:i, s:i}",
 		"meshes", totals.meshes,
 		"spheres", totals.spheres,
+		"sphere_sets", totals.sphere_sets,
 		"instances", totals.instances,
 		"cameras", totals.cameras);
 }
@@ -555,7 +556,7 @@ static PyObject *py_cr_instance_new(PyObject *self, PyObject *args) {
 	if (!PyArg_ParseTuple(args, "OlI", &s_ext, &object, &type)) {
 		return NULL;
 	}
-	if (type != cr_object_mesh && type != cr_object_sphere) {
+	if (type != cr_object_mesh && type != cr_object_sphere && type != cr_object_sphere_set) {
 		PyErr_SetString(PyExc_ValueError, "Unknown cr_object_type");
 		return NULL;
 	}
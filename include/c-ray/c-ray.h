@@ -63,6 +63,14 @@ enum cr_renderer_param {
 	cr_renderer_output_filetype,
 	cr_renderer_node_list,
 	cr_renderer_blender_mode,
+	cr_renderer_denoise,
+	cr_renderer_integrator,
+	cr_renderer_flush_interval,
+	cr_renderer_tile_autotune,
+	cr_renderer_pin_threads,
+	cr_renderer_numa_replicate,
+	cr_renderer_half_textures,
+	cr_renderer_texture_cache_size, // In megabytes, 0 disables the cache
 };
 
 enum cr_tile_state {
@@ -158,6 +166,7 @@ CR_EXPORT struct cr_scene *cr_renderer_scene_get(struct cr_renderer *r);
 struct cr_scene_totals {
 	size_t meshes;
 	size_t spheres;
+	size_t sphere_sets;
 	size_t instances;
 	size_t cameras;
 };
@@ -174,6 +183,17 @@ typedef int64_t cr_object;
 
 typedef cr_object cr_sphere;
 CR_EXPORT cr_sphere cr_scene_add_sphere(struct cr_scene *s_ext, float radius);
+
+// Many spheres as one object, e.g. particles. Needs just one instance for all of them.
+struct cr_sphere_set_param {
+	struct cr_vector *centers;
+	float *radii;
+	unsigned int *mat_idx; // Optional, indices into the material set bound to the instance
+	size_t count;
+};
+
+typedef cr_object cr_sphere_set;
+CR_EXPORT cr_sphere_set cr_scene_add_sphere_set(struct cr_scene *s_ext, struct cr_sphere_set_param in);
 typedef cr_object cr_mesh;
 
 struct cr_vertex_buf_param {
@@ -242,7 +262,8 @@ CR_EXPORT void cr_material_set_add(struct cr_scene *s_ext, cr_material_set set,
 typedef int64_t cr_instance;
 enum cr_object_type {
 	cr_object_mesh = 0,
-	cr_object_sphere
+	cr_object_sphere,
+	cr_object_sphere_set
 };
 
 CR_EXPORT cr_instance cr_instance_new(struct cr_scene *s_ext, cr_object object, enum cr_object_type type);
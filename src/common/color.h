@@ -10,6 +10,7 @@
 #include <math.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include "simd.h"
 
 //Color
 struct color {
@@ -39,14 +40,26 @@ extern const struct color g_background_color;
 extern const struct color g_frame_color;
 extern const struct color g_prog_color;
 
+// Colors are four floats, so the basic arithmetic works on all channels at once.
+// Colors are usually in registers already, loading them through memory would stall.
+static inline f32x4 color_load(struct color c) {
+	return f32x4_set(c.red, c.green, c.blue, c.alpha);
+}
+
+static inline struct color color_store(f32x4 v) {
+	struct color c;
+	f32x4_store(&c.red, v);
+	return c;
+}
+
 //Multiply two colors
 static inline struct color colorMul(struct color c1, struct color c2) {
-	return (struct color){c1.red * c2.red, c1.green * c2.green, c1.blue * c2.blue, c1.alpha * c2.alpha};
+	return color_store(f32x4_mul(color_load(c1), color_load(c2)));
 }
 
 //Add two colors
 static inline struct color colorAdd(struct color c1, struct color c2) {
-	return (struct color){c1.red + c2.red, c1.green + c2.green, c1.blue + c2.blue, c1.alpha + c2.alpha};
+	return color_store(f32x4_add(color_load(c1), color_load(c2)));
 }
 
 // Formula from http://alienryderflex.com/hsp.html
@@ -57,12 +70,14 @@ static inline struct color colorToGrayscale(struct color c) {
 
 //Multiply a color with a coefficient value
 static inline struct color colorCoef(float coef, struct color c) {
-	return (struct color){c.red * coef, c.green * coef, c.blue * coef, c.alpha * coef};
+	return color_store(f32x4_mul(color_load(c), f32x4_set1(coef)));
 }
 
 //Linear interpolation mix
 static inline struct color colorMix(struct color c1, struct color c2, float coeff) {
-	return colorAdd(colorCoef(1.0f - coeff, c1), colorCoef(coeff, c2));
+	const f32x4 a = f32x4_mul(color_load(c1), f32x4_set1(1.0f - coeff));
+	const f32x4 b = f32x4_mul(color_load(c2), f32x4_set1(coeff));
+	return color_store(f32x4_add(a, b));
 }
 
 //TODO: Move to own file
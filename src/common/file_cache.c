@@ -0,0 +1,195 @@
+//
+//  file_cache.c
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "../includes.h"
+
+#include "file_cache.h"
+#include "hashtable.h"
+#include "logging.h"
+#include "string.h"
+
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+struct asset_slot {
+	void *asset;
+	void (*asset_free)(void *);
+};
+
+// One per distinct file content
+struct cached_file {
+	file_data bytes;
+	struct asset_slot assets[file_cache_asset_count]; // Only the content scoped ones are used
+	struct cached_file *next;
+};
+
+struct file_stamp {
+	size_t size;
+	time_t modified;
+};
+
+struct cached_path {
+	char *path;
+	struct file_stamp stamp;
+	size_t checked; // Generation the stamp was last checked in
+	struct cached_file *file; // NULL until something asks for the bytes
+	struct asset_slot assets[file_cache_asset_count]; // Only the path scoped ones are used
+	struct cached_path *next;
+};
+
+struct file_cache {
+	struct hashtable *paths; // Of struct cached_path *
+	struct hashtable *files; // Of struct cached_file *, by content
+	struct cached_path *path_list;
+	struct cached_file *file_list;
+	size_t generation;
+};
+
+static const bool path_scoped[file_cache_asset_count] = {
+	[file_cache_mesh] = true,
+};
+
+static bool compare_path(const void *path, const void *entry) {
+	return stringEquals(path, (*(struct cached_path *const *)entry)->path);
+}
+
+static bool compare_content(const void *bytes, const void *entry) {
+	const file_data *a = bytes;
+	const file_data *b = &(*(struct cached_file *const *)entry)->bytes;
+	return a->count == b->count && !memcmp(a->items, b->items, a->count);
+}
+
+struct file_cache *file_cache_new(void) {
+	struct file_cache *cache = calloc(1, sizeof(*cache));
+	cache->paths = newHashtable(compare_path, NULL);
+	cache->files = newHashtable(compare_content, NULL);
+	cache->generation = 1;
+	return cache;
+}
+
+static void slot_clear(struct asset_slot *slot) {
+	if (slot->asset && slot->asset_free) slot->asset_free(slot->asset);
+	*slot = (struct asset_slot){ 0 };
+}
+
+void file_cache_destroy(struct file_cache *cache) {
+	if (!cache) return;
+	struct cached_path *p = cache->path_list;
+	while (p) {
+		struct cached_path *next = p->next;
+		for (size_t i = 0; i < file_cache_asset_count; ++i) slot_clear(&p->assets[i]);
+		free(p->path);
+		free(p);
+		p = next;
+	}
+	struct cached_file *f = cache->file_list;
+	while (f) {
+		struct cached_file *next = f->next;
+		for (size_t i = 0; i < file_cache_asset_count; ++i) slot_clear(&f->assets[i]);
+		file_free(&f->bytes);
+		free(f);
+		f = next;
+	}
+	destroyHashtable(cache->paths);
+	destroyHashtable(cache->files);
+	free(cache);
+}
+
+static bool get_stamp(const char *path, struct file_stamp *stamp) {
+	struct stat path_stat = { 0 };
+	if (stat(path, &path_stat) < 0) {
+		logr(warning, "Couldn't stat '%s': %s\n", path, strerror(errno));
+		return false;
+	}
+	*stamp = (struct file_stamp){ .size = path_stat.st_size, .modified = path_stat.st_mtime };
+	return true;
+}
+
+// Find the entry for these bytes, or take ownership of them as a new one
+static struct cached_file *intern_content(struct file_cache *cache, file_data bytes) {
+	const uint32_t hash = hashBytes(hashInit(), bytes.items, bytes.count);
+	struct cached_file **found = findInHashtable(cache->files, &bytes, hash);
+	if (found) {
+		file_free(&bytes);
+		return *found;
+	}
+	struct cached_file *f = calloc(1, sizeof(*f));
+	f->bytes = bytes;
+	f->next = cache->file_list;
+	cache->file_list = f;
+	forceInsertInHashtable(cache->files, &f, sizeof(f), hash);
+	return f;
+}
+
+void file_cache_revalidate(struct file_cache *cache) {
+	if (cache) cache->generation++;
+}
+
+// Only stats the file, bytes are loaded by load_bytes() if they're needed
+static struct cached_path *lookup(struct file_cache *cache, const char *path) {
+	const uint32_t hash = hashString(hashInit(), path);
+	struct cached_path **found = findInHashtable(cache->paths, path, hash);
+	struct cached_path *p = found ? *found : NULL;
+	if (p && p->checked == cache->generation) return p;
+
+	struct file_stamp stamp;
+	if (!get_stamp(path, &stamp)) return NULL;
+	if (p) {
+		p->checked = cache->generation;
+		if (p->stamp.size == stamp.size && p->stamp.modified == stamp.modified) return p;
+		// Changed on disk. Bytes of the old version stay around, something may still point to them.
+		for (size_t i = 0; i < file_cache_asset_count; ++i) slot_clear(&p->assets[i]);
+		p->file = NULL;
+	} else {
+		p = calloc(1, sizeof(*p));
+		p->path = stringCopy(path);
+		p->next = cache->path_list;
+		cache->path_list = p;
+		forceInsertInHashtable(cache->paths, &p, sizeof(p), hash);
+	}
+	p->stamp = stamp;
+	p->checked = cache->generation;
+	return p;
+}
+
+static struct cached_file *load_bytes(struct file_cache *cache, struct cached_path *p) {
+	if (p->file) return p->file;
+	file_data bytes = file_load(p->path);
+	if (!bytes.items) return NULL;
+	p->file = intern_content(cache, bytes);
+	return p->file;
+}
+
+file_data file_cache_load(struct file_cache *cache, const char *path) {
+	struct cached_path *p = lookup(cache, path);
+	return p && load_bytes(cache, p) ? p->file->bytes : (file_data){ 0 };
+}
+
+// Content scoped assets need the bytes to find the content. NULL if they can't be loaded.
+static struct asset_slot *get_slot(struct file_cache *cache, struct cached_path *p, enum file_cache_asset kind) {
+	if (path_scoped[kind]) return &p->assets[kind];
+	return load_bytes(cache, p) ? &p->file->assets[kind] : NULL;
+}
+
+void *file_cache_asset(struct file_cache *cache, const char *path, enum file_cache_asset kind) {
+	struct cached_path *p = lookup(cache, path);
+	struct asset_slot *slot = p ? get_slot(cache, p, kind) : NULL;
+	return slot ? slot->asset : NULL;
+}
+
+void file_cache_set_asset(struct file_cache *cache, const char *path, enum file_cache_asset kind, void *asset, void (*asset_free)(void *)) {
+	struct cached_path *p = lookup(cache, path);
+	struct asset_slot *slot = p ? get_slot(cache, p, kind) : NULL;
+	if (!slot) {
+		if (asset && asset_free) asset_free(asset);
+		return;
+	}
+	slot_clear(slot);
+	*slot = (struct asset_slot){ .asset = asset, .asset_free = asset_free };
+}
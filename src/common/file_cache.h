@@ -0,0 +1,46 @@
+//
+//  file_cache.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#pragma once
+
+#include "fileio.h"
+
+// Files loaded for a scene, kept so that repeated references to a file, and repeated
+// cr_load_json() calls on the same renderer, don't load and decode it again.
+// Bytes are stored once per distinct content, so copies of a file under different paths
+// share them. Loaders attach what they decoded from a file as assets.
+// Bytes are only loaded when something asks for them, so path scoped assets like meshes don't
+// keep their file in memory after it's parsed.
+// A path is loaded again if its size or modification time changed since it was cached. That's
+// checked on the first lookup after file_cache_revalidate(), so a file is stat()ed once per load.
+
+enum file_cache_asset {
+	file_cache_texture, // Depends on the bytes alone, shared by every path with the same content
+	file_cache_mesh,    // Depends on files next to it too, kept per path
+	file_cache_asset_count,
+};
+
+struct file_cache *file_cache_new(void);
+void file_cache_destroy(struct file_cache *cache);
+
+/// Check files for changes on disk again, the next time they're looked up.
+/// Loaders call this once at the start of a load.
+void file_cache_revalidate(struct file_cache *cache);
+
+/// Load path, or reuse the bytes from an earlier load.
+/// The bytes belong to the cache, and stay valid until it's destroyed.
+/// @return Empty file_data if path can't be read
+file_data file_cache_load(struct file_cache *cache, const char *path);
+
+/// The asset of the given kind attached to path, or NULL if there isn't one yet.
+void *file_cache_asset(struct file_cache *cache, const char *path, enum file_cache_asset kind);
+
+/// Attach asset to path, replacing the previous one. The cache calls asset_free on it when
+/// it's destroyed, or when the file changes on disk. asset_free may be NULL if someone else owns it.
+/// If path can't be read, asset is freed right away.
+void file_cache_set_asset(struct file_cache *cache, const char *path, enum file_cache_asset kind, void *asset, void (*asset_free)(void *));
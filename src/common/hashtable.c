@@ -20,11 +20,6 @@
 #define FNV_OFFSET UINT32_C(0x811C9DC5) // Initial value for an empty hash
 #define FNV_PRIME  UINT32_C(0x01000193)
 
-// Default hash map capacity. Must be a power of two.
-#define DEFAULT_CAPACITY 8
-// Maximum load factor (average number of elements per bucket) in percent.
-#define MAX_LOAD_FACTOR_PERCENT 80
-
 uint32_t hashInit(void) {
 	return FNV_OFFSET;
 }
@@ -33,9 +28,23 @@ uint32_t hashCombine(uint32_t h, uint8_t u) {
 	return (h ^ u) * FNV_PRIME;
 }
 
+// Folds in 8 bytes at once. The high half of the product depends on every bit of the word,
+// so unlike a plain FNV step, the low bits used for the bucket index see all of it.
+static inline uint32_t hashWord(uint32_t h, uint64_t word) {
+	const uint64_t x = (word ^ h) * UINT64_C(0x9E3779B97F4A7C15);
+	return (uint32_t)(x >> 32) ^ (uint32_t)x;
+}
+
 uint32_t hashBytes(uint32_t h, const void *bytes, size_t size) {
-	for (size_t i = 0; i < size; ++i)
-		h = hashCombine(h, ((uint8_t *)bytes)[i]);
+	const uint8_t *b = bytes;
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, b + i, sizeof(word));
+		h = hashWord(h, word);
+	}
+	for (; i < size; ++i)
+		h = hashCombine(h, b[i]);
 	return h;
 }
 
@@ -45,128 +54,275 @@ uint32_t hashString(uint32_t h, const char *str) {
 	return h;
 }
 
-struct hashtable* newHashtable(bool (*compare)(const void *, const void *), struct block **pool) {
-	struct hashtable *hashtable = malloc(sizeof(struct hashtable));
-	hashtable->bucketCount = DEFAULT_CAPACITY;
-	hashtable->buckets = calloc(DEFAULT_CAPACITY, sizeof(struct bucket *));
-	hashtable->elemCount = 0;
-	hashtable->compare = compare;
-	hashtable->pool = pool ? pool : NULL;
-	return hashtable;
+#define CTRL_EMPTY   UINT8_C(0x80)
+#define CTRL_DELETED UINT8_C(0xFE)
+#define CTRL_UNUSED  UINT8_C(0xFF) // Padding at the end of each group
+// Full slots have the low 7 bits of the hash, so the high bit tells them apart from the above.
+
+static inline uint8_t hashToCtrl(uint32_t hash) {
+	return hash & 0x7F;
+}
+
+// Control bytes are compared a group at a time. Masks have bit i set if slot i matched.
+typedef uint32_t group_mask;
+#define GROUP_MASK ((group_mask)((1u << HASHTABLE_GROUP_SLOTS) - 1))
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+
+static inline group_mask matchByte(const struct hashtable_group *group, uint8_t byte) {
+	const __m128i ctrl = _mm_loadu_si128((const __m128i *)group->ctrl);
+	return (group_mask)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)byte))) & GROUP_MASK;
+}
+
+static inline group_mask matchEmptyOrDeleted(const struct hashtable_group *group) {
+	return (group_mask)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group->ctrl)) & GROUP_MASK;
+}
+#else
+static inline group_mask matchByte(const struct hashtable_group *group, uint8_t byte) {
+	group_mask mask = 0;
+	for (unsigned i = 0; i < HASHTABLE_GROUP_SLOTS; ++i)
+		mask |= (group_mask)(group->ctrl[i] == byte) << i;
+	return mask;
+}
+
+static inline group_mask matchEmptyOrDeleted(const struct hashtable_group *group) {
+	group_mask mask = 0;
+	for (unsigned i = 0; i < HASHTABLE_GROUP_SLOTS; ++i)
+		mask |= (group_mask)(group->ctrl[i] >> 7) << i;
+	return mask;
+}
+#endif
+
+static inline unsigned lowestBit(group_mask mask) {
+#if defined(__GNUC__) || defined(__clang__)
+	return (unsigned)__builtin_ctz(mask);
+#else
+	unsigned i = 0;
+	while (!(mask & 1)) {
+		mask >>= 1;
+		++i;
+	}
+	return i;
+#endif
 }
 
+// Groups in a new table. Must be a power of two.
+#define DEFAULT_GROUPS 1
+// Maximum share of slots, in eighths, that may be full or deleted.
+#define MAX_LOAD_EIGHTHS 7
+// Groups moved from the old slots on each insert while the table is growing. Has to be enough
+// to be done before the new slots fill up, see growTable()
+#define MIGRATE_GROUPS 2
+// Groups start on a cache line, so the control bytes and the first slots share one
+#define GROUP_ALIGN 64
+
 #ifdef CRAY_DEBUG_ENABLED
 static inline bool isPowerOfTwo(size_t i) {
 	return (i & (i - 1)) == 0;
 }
 #endif
 
-static inline size_t hashToIndex(struct hashtable *hashtable, uint32_t hash) {
-	ASSERT(isPowerOfTwo(hashtable->bucketCount));
-	return hash & (hashtable->bucketCount - 1);
+static void initSlots(struct hashtable_slots *slots, size_t groupCount) {
+	ASSERT(isPowerOfTwo(groupCount));
+	slots->memory = malloc(groupCount * sizeof(struct hashtable_group) + GROUP_ALIGN);
+	slots->groups = (struct hashtable_group *)(((uintptr_t)slots->memory + GROUP_ALIGN - 1) & ~(uintptr_t)(GROUP_ALIGN - 1));
+	for (size_t i = 0; i < groupCount; ++i) {
+		memset(slots->groups[i].ctrl, CTRL_EMPTY, HASHTABLE_GROUP_SLOTS);
+		memset(slots->groups[i].ctrl + HASHTABLE_GROUP_SLOTS, CTRL_UNUSED, sizeof(slots->groups[i].ctrl) - HASHTABLE_GROUP_SLOTS);
+	}
+	slots->groupCount = groupCount;
+	slots->growthLeft = groupCount * HASHTABLE_GROUP_SLOTS * MAX_LOAD_EIGHTHS / 8;
 }
 
-void *findInHashtable(struct hashtable *hashtable, const void *element, uint32_t hash) {
-	struct bucket *bucket = hashtable->buckets[hashToIndex(hashtable, hash)];
-	while (bucket) {
-		if (bucket->hash == hash && hashtable->compare(element, &bucket->data))
-			return &bucket->data;
-		bucket = bucket->next;
+static void freeSlots(struct hashtable_slots *slots) {
+	free(slots->memory);
+	*slots = (struct hashtable_slots){ 0 };
+}
+
+struct hashtable* newHashtable(bool (*compare)(const void *, const void *), struct block **pool) {
+	struct hashtable *hashtable = calloc(1, sizeof(struct hashtable));
+	initSlots(&hashtable->slots, DEFAULT_GROUPS);
+	hashtable->compare = compare;
+	hashtable->pool = pool;
+	return hashtable;
+}
+
+struct slot {
+	struct hashtable_group *group;
+	unsigned index;
+};
+
+// Groups are probed quadratically, starting from one picked by the bits of the hash not in the control byte
+struct probe {
+	size_t group;
+	size_t mask;
+	size_t stride;
+};
+
+static inline struct probe probeStart(const struct hashtable_slots *slots, uint32_t hash) {
+	const size_t mask = slots->groupCount - 1;
+	return (struct probe){ .group = (hash >> 7) & mask, .mask = mask };
+}
+
+static inline void probeNext(struct probe *p) {
+	p->group = (p->group + ++p->stride) & p->mask;
+}
+
+// The slot with the given element, group is NULL if there isn't one.
+// If firstFree is given, it's set to where the element would go if it were to be inserted.
+static struct slot findSlot(const struct hashtable *hashtable, const struct hashtable_slots *slots, const void *element, uint32_t hash, struct slot *firstFree) {
+	if (!slots->groups) return (struct slot){ 0 };
+	const uint8_t h2 = hashToCtrl(hash);
+	struct probe p = probeStart(slots, hash);
+	for (size_t i = 0; i <= p.mask; ++i, probeNext(&p)) {
+		struct hashtable_group *group = &slots->groups[p.group];
+		for (group_mask m = matchByte(group, h2); m; m &= m - 1) {
+			const unsigned idx = lowestBit(m);
+			const struct bucket *bucket = group->buckets[idx];
+			if (bucket->hash == hash && hashtable->compare(element, &bucket->data))
+				return (struct slot){ group, idx };
+		}
+		if (firstFree && !firstFree->group) {
+			const group_mask free = matchEmptyOrDeleted(group);
+			if (free) *firstFree = (struct slot){ group, lowestBit(free) };
+		}
+		if (matchByte(group, CTRL_EMPTY)) break;
 	}
-	return NULL;
-}
-
-static inline bool needsRehash(struct hashtable *hashtable) {
-	return hashtable->elemCount * MAX_LOAD_FACTOR_PERCENT / hashtable->bucketCount > 100;
-}
-
-static inline void rehash(struct hashtable *hashtable) {
-	size_t newBucketCount = 2 * hashtable->bucketCount;
-	struct bucket **newBuckets = calloc(newBucketCount, sizeof(struct bucket *));
-	struct hashtable newHashtable = {
-		.bucketCount = newBucketCount,
-		.buckets = newBuckets
-	};
-	for (size_t i = 0, n = hashtable->bucketCount; i < n; ++i) {
-		struct bucket *bucket = hashtable->buckets[i];
-		while (bucket) {
-			struct bucket *next = bucket->next;
-			struct bucket **newBucket = &newBuckets[hashToIndex(&newHashtable, bucket->hash)];
-			bucket->next = *newBucket;
-			*newBucket = bucket;
-			bucket = next;
+	return (struct slot){ 0 };
+}
+
+static void fillSlot(struct hashtable_slots *slots, struct slot slot, struct bucket *bucket) {
+	if (slot.group->ctrl[slot.index] == CTRL_EMPTY) slots->growthLeft--;
+	slot.group->ctrl[slot.index] = hashToCtrl(bucket->hash);
+	slot.group->buckets[slot.index] = bucket;
+}
+
+// Put bucket in the first free slot, there must be one
+static void placeBucket(struct hashtable_slots *slots, struct bucket *bucket) {
+	struct probe p = probeStart(slots, bucket->hash);
+	group_mask m;
+	while (!(m = matchEmptyOrDeleted(&slots->groups[p.group])))
+		probeNext(&p);
+	fillSlot(slots, (struct slot){ &slots->groups[p.group], lowestBit(m) }, bucket);
+}
+
+static void migrate(struct hashtable *hashtable, size_t groups) {
+	struct hashtable_slots *old = &hashtable->old;
+	if (!old->groups) return;
+	for (; groups && hashtable->migrated < old->groupCount; --groups, ++hashtable->migrated) {
+		struct hashtable_group *group = &old->groups[hashtable->migrated];
+		for (group_mask m = ~matchEmptyOrDeleted(group) & GROUP_MASK; m; m &= m - 1) {
+			const unsigned idx = lowestBit(m);
+			placeBucket(&hashtable->slots, group->buckets[idx]);
+			// Deleted, not empty, so elements further along the probe sequence can still be found
+			group->ctrl[idx] = CTRL_DELETED;
 		}
 	}
-	free(hashtable->buckets);
-	hashtable->buckets = newBuckets;
-	hashtable->bucketCount = newBucketCount;
+	if (hashtable->migrated == old->groupCount) freeSlots(old);
+}
+
+// New slots are twice the size if at least half of the current ones are in use, otherwise
+// they're the same size, and we just get rid of deleted ones. Either way, at most half of the
+// new slots are needed for what's already in the table, leaving 3/8 of them for new inserts
+// while MIGRATE_GROUPS groups per insert are moved over.
+static void growTable(struct hashtable *hashtable) {
+	migrate(hashtable, SIZE_MAX); // Finish the previous one first
+	const size_t groupCount = hashtable->slots.groupCount;
+	const bool halfFull = hashtable->elemCount * 2 >= groupCount * HASHTABLE_GROUP_SLOTS;
+	hashtable->old = hashtable->slots;
+	hashtable->migrated = 0;
+	initSlots(&hashtable->slots, halfFull ? groupCount * 2 : groupCount);
 }
 
-static inline void insertElement(struct hashtable *hashtable, const void *element, size_t elementSize, uint32_t hash) {
-	if (needsRehash(hashtable))
-		rehash(hashtable);
-	struct bucket **prev = &hashtable->buckets[hashToIndex(hashtable, hash)];
+void *findInHashtable(struct hashtable *hashtable, const void *element, uint32_t hash) {
+	struct slot slot = findSlot(hashtable, &hashtable->slots, element, hash, NULL);
+	if (!slot.group) slot = findSlot(hashtable, &hashtable->old, element, hash, NULL);
+	return slot.group ? &slot.group->buckets[slot.index]->data : NULL;
+}
+
+static struct bucket *newBucket(struct hashtable *hashtable, const void *element, size_t elementSize, uint32_t hash) {
 	size_t size = sizeof(struct bucket) + elementSize;
-	struct bucket *next = hashtable->pool ? allocBlock(hashtable->pool, size) : malloc(size);
-	memcpy(&next->data, element, elementSize);
-	next->hash = hash;
-	next->next = *prev;
-	*prev = next;
+	struct bucket *bucket = hashtable->pool ? allocBlock(hashtable->pool, size) : malloc(size);
+	memcpy(&bucket->data, element, elementSize);
+	bucket->hash = hash;
 	hashtable->elemCount++;
+	return bucket;
 }
 
-static inline bool insertOrReplaceInHashtable(struct hashtable *hashtable, bool isInsert, const void *element, size_t elementSize, uint32_t hash) {
-	struct bucket *bucket = hashtable->buckets[hashToIndex(hashtable, hash)];
-	while (bucket) {
-		if (bucket->hash == hash && hashtable->compare(&element, &bucket->data)) {
-			if (isInsert)
-				return false;
-			memcpy(&bucket->data, element, elementSize);
-			return true;
-		}
-		bucket = bucket->next;
-	}
-	insertElement(hashtable, element, elementSize, hash);
-	return true;
+// Make sure there's room for one more, and move some of the old slots over if the table is growing
+static inline void prepareInsert(struct hashtable *hashtable) {
+	if (!hashtable->slots.growthLeft)
+		growTable(hashtable);
+	migrate(hashtable, MIGRATE_GROUPS);
+}
+
+// Find the element, or insert it. Either way, there's just one probe of the current slots.
+static void *findOrInsert(struct hashtable *hashtable, const void *element, size_t elementSize, uint32_t hash, bool *inserted) {
+	prepareInsert(hashtable);
+	struct slot free = { 0 };
+	struct slot slot = findSlot(hashtable, &hashtable->slots, element, hash, &free);
+	if (!slot.group) slot = findSlot(hashtable, &hashtable->old, element, hash, NULL);
+	*inserted = !slot.group;
+	if (slot.group) return &slot.group->buckets[slot.index]->data;
+	struct bucket *bucket = newBucket(hashtable, element, elementSize, hash);
+	fillSlot(&hashtable->slots, free, bucket);
+	return &bucket->data;
 }
 
 bool insertInHashtable(struct hashtable *hashtable, const void *element, size_t elementSize, uint32_t hash) {
-	return insertOrReplaceInHashtable(hashtable, true, element, elementSize, hash);
+	bool inserted;
+	findOrInsert(hashtable, element, elementSize, hash, &inserted);
+	return inserted;
 }
 
 void replaceInHashtable(struct hashtable *hashtable, const void *element, size_t elementSize, uint32_t hash) {
-	insertOrReplaceInHashtable(hashtable, false, element, elementSize, hash);
+	bool inserted;
+	void *data = findOrInsert(hashtable, element, elementSize, hash, &inserted);
+	if (!inserted) memcpy(data, element, elementSize);
+}
+
+void *internInHashtable(struct hashtable *hashtable, const void *element, size_t elementSize, uint32_t hash, bool *inserted) {
+	bool ignored;
+	return findOrInsert(hashtable, element, elementSize, hash, inserted ? inserted : &ignored);
 }
 
 void forceInsertInHashtable(struct hashtable *hashtable, const void *element, size_t elementSize, uint32_t hash) {
-	insertElement(hashtable, element, elementSize, hash);
+	prepareInsert(hashtable);
+	placeBucket(&hashtable->slots, newBucket(hashtable, element, elementSize, hash));
 }
 
 bool removeFromHashtable(struct hashtable *hashtable, const void *element, uint32_t hash) {
-	struct bucket **prev = &hashtable->buckets[hashToIndex(hashtable, hash)];
-	struct bucket *bucket = *prev;
-	while (bucket) {
-		if (bucket->hash == hash && hashtable->compare(element, &bucket->data)) {
-			*prev = bucket->next;
-			if (!hashtable->pool) free(bucket);
-			return true;
+	struct slot slot = findSlot(hashtable, &hashtable->slots, element, hash, NULL);
+	if (!slot.group) slot = findSlot(hashtable, &hashtable->old, element, hash, NULL);
+	if (!slot.group) return false;
+	if (!hashtable->pool) free(slot.group->buckets[slot.index]);
+	slot.group->buckets[slot.index] = NULL;
+	slot.group->ctrl[slot.index] = CTRL_DELETED;
+	hashtable->elemCount--;
+	return true;
+}
+
+// Calls fn on the data of every element
+static void forEachInHashtable(struct hashtable *hashtable, void (*fn)(void *)) {
+	const struct hashtable_slots *tables[] = { &hashtable->slots, &hashtable->old };
+	for (size_t t = 0; t < 2; ++t) {
+		for (size_t g = 0; g < tables[t]->groupCount; ++g) {
+			struct hashtable_group *group = &tables[t]->groups[g];
+			for (group_mask m = ~matchEmptyOrDeleted(group) & GROUP_MASK; m; m &= m - 1)
+				fn(&group->buckets[lowestBit(m)]->data);
 		}
-		prev = &bucket->next;
-		bucket = bucket->next;
 	}
-	return false;
+}
+
+static void freeBucketData(void *data) {
+	free((char *)data - offsetof(struct bucket, data));
 }
 
 void destroyHashtable(struct hashtable *hashtable) {
-	for (size_t i = 0, n = hashtable->bucketCount; i < n; ++i) {
-		struct bucket *bucket = hashtable->buckets[i];
-		while (bucket) {
-			struct bucket *next = bucket->next;
-			if (!hashtable->pool) free(bucket);
-			bucket = next;
-		}
-	}
-	free(hashtable->buckets);
+	if (!hashtable->pool) forEachInHashtable(hashtable, freeBucketData);
+	freeSlots(&hashtable->slots);
+	freeSlots(&hashtable->old);
 	free(hashtable);
 }
 
@@ -242,15 +398,13 @@ void setDatabaseTag(struct driver_args *database, const char *key) {
 	}
 }
 
+static void freeDatabaseEntry(void *data) {
+	struct databaseEntry *entry = data;
+	free(entry->key);
+	free(entry->toFree);
+}
+
 void freeConstantsDatabase(struct driver_args *database) {
-	for (size_t i = 0, n = database->hashtable.bucketCount; i < n; ++i) {
-		struct bucket *bucket = database->hashtable.buckets[i];
-		while (bucket) {
-			struct databaseEntry *entry = (struct databaseEntry *)&bucket->data;
-			free(entry->key);
-			free(entry->toFree);
-			bucket = bucket->next;
-		}
-	}
+	forEachInHashtable(&database->hashtable, freeDatabaseEntry);
 	destroyHashtable(&database->hashtable);
 }
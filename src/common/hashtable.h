@@ -15,23 +15,43 @@
 
 struct vector;
 
+// Elements are allocated separately, so pointers to them stay valid as the table grows.
 struct bucket {
-	struct bucket *next;
 	uint32_t hash;
 	// Since C99 does not have max_align_t, we have to create a type
 	// that has the largest alignment requirement.
 	cray_max_align_t data[];
 };
 
+// Open addressing, with a control byte per slot that's either empty, deleted or 7 bits of the hash.
+// Lookups compare a group of control bytes at once, and only look at elements where those match.
+// A group keeps its control bytes next to its slots, so a probe is usually a single cache miss.
+#define HASHTABLE_GROUP_SLOTS 14
+
+struct hashtable_group {
+	uint8_t ctrl[16]; // Last two are unused, they just pad this to a vector
+	struct bucket *buckets[HASHTABLE_GROUP_SLOTS];
+};
+
+struct hashtable_slots {
+	struct hashtable_group *groups;
+	void *memory; // What groups was allocated from, before aligning
+	size_t groupCount; // Power of two
+	size_t growthLeft; // Slots that may still be taken before the table has to grow
+};
+
 struct hashtable {
-	struct bucket **buckets;
+	struct hashtable_slots slots;
+	// When the table grows, elements are moved over a few groups per insert, instead of all at once.
+	// Until that's done, the previous slots are searched too.
+	struct hashtable_slots old;
+	size_t migrated; // Groups moved out of old so far
 	struct block **pool;
-	size_t bucketCount;
 	size_t elemCount;
 	bool (*compare)(const void *, const void *);
 };
 
-// Hash functions (using FNV)
+// Hash functions (FNV, hashBytes takes 8 bytes at a time where it can)
 uint32_t hashInit(void);
 uint32_t hashCombine(uint32_t, uint8_t);
 uint32_t hashBytes(uint32_t, const void *, size_t);
@@ -46,9 +66,13 @@ void *findInHashtable(struct hashtable *hashtable, const void *element, uint32_t
 bool insertInHashtable(struct hashtable *hashtable, const void *element, size_t elementSize, uint32_t hash);
 // Inserts or replaces the given element in the hash table, using the hash value `hash`.
 void replaceInHashtable(struct hashtable *hashtable, const void *element, size_t elementSize, uint32_t hash);
+// Returns the element equal to the given one, inserting a copy of it first if there isn't one.
+// `inserted` is optional, and tells which one happened.
+void *internInHashtable(struct hashtable *hashtable, const void *element, size_t elementSize, uint32_t hash, bool *inserted);
 // Always inserts the element in the hash table, not caring for duplicates.
 void forceInsertInHashtable(struct hashtable *hashtable, const void *element, size_t elementSize, uint32_t hash);
 // Removes the given element from the hash table, using the hash value `hash`.
+// It's freed right away, unless the table allocates from a pool.
 // Returns `true` if the removal is a success, `false` otherwise.
 bool removeFromHashtable(struct hashtable *hashtable, const void *element, uint32_t hash);
 void destroyHashtable(struct hashtable *hashtable);
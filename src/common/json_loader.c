@@ -23,6 +23,7 @@
 #include "../common/platform/capabilities.h"
 #include "../common/logging.h"
 #include "../common/fileio.h"
+#include "../common/file_cache.h"
 #include "../common/timer.h"
 
 static struct transform parse_tform(const cJSON *data) {
@@ -101,6 +102,11 @@ void parse_prefs(struct cr_renderer *ext, const cJSON *data) {
 	if (cJSON_IsNumber(tile_height) && tile_height->valueint > 0)
 		cr_renderer_set_num_pref(ext, cr_renderer_tile_height, tile_height->valueint);
 
+	const cJSON *tile_autotune = cJSON_GetObjectItem(data, "autotuneTiles");
+	if (cJSON_IsBool(tile_autotune)) {
+		cr_renderer_set_num_pref(ext, cr_renderer_tile_autotune, cJSON_IsTrue(tile_autotune));
+	}
+
 	const cJSON *tile_order = cJSON_GetObjectItem(data, "tileOrder");
 	if (cJSON_IsString(tile_order)) {
 		cr_renderer_set_str_pref(ext, cr_renderer_tile_order, tile_order->valuestring);
@@ -136,6 +142,43 @@ void parse_prefs(struct cr_renderer *ext, const cJSON *data) {
 		cr_renderer_set_str_pref(ext, cr_renderer_output_filetype, fileType->valuestring);
 	}
 
+	const cJSON *integrator = cJSON_GetObjectItem(data, "integrator");
+	if (cJSON_IsString(integrator)) {
+		if (!cr_renderer_set_str_pref(ext, cr_renderer_integrator, integrator->valuestring))
+			logr(warning, "Unknown integrator \"%s\", expected \"pathtrace\" or \"wavefront\"\n", integrator->valuestring);
+	}
+
+	const cJSON *denoise = cJSON_GetObjectItem(data, "denoise");
+	if (cJSON_IsBool(denoise)) {
+		cr_renderer_set_num_pref(ext, cr_renderer_denoise, cJSON_IsTrue(denoise));
+	}
+
+	const cJSON *pin_threads = cJSON_GetObjectItem(data, "pinThreads");
+	if (cJSON_IsString(pin_threads)) {
+		if (!cr_renderer_set_str_pref(ext, cr_renderer_pin_threads, pin_threads->valuestring))
+			logr(warning, "Unknown pinThreads policy \"%s\", expected \"none\", \"cores\" or \"compact\"\n", pin_threads->valuestring);
+	}
+
+	const cJSON *numa_replicate = cJSON_GetObjectItem(data, "numaReplicate");
+	if (cJSON_IsBool(numa_replicate)) {
+		cr_renderer_set_num_pref(ext, cr_renderer_numa_replicate, cJSON_IsTrue(numa_replicate));
+	}
+
+	const cJSON *half_textures = cJSON_GetObjectItem(data, "halfFloatTextures");
+	if (cJSON_IsBool(half_textures)) {
+		cr_renderer_set_num_pref(ext, cr_renderer_half_textures, cJSON_IsTrue(half_textures));
+	}
+
+	const cJSON *texture_cache_size = cJSON_GetObjectItem(data, "textureCacheSize");
+	if (cJSON_IsNumber(texture_cache_size) && texture_cache_size->valueint >= 0) {
+		cr_renderer_set_num_pref(ext, cr_renderer_texture_cache_size, texture_cache_size->valueint);
+	}
+
+	const cJSON *flush_interval = cJSON_GetObjectItem(data, "flushInterval");
+	if (cJSON_IsNumber(flush_interval) && flush_interval->valueint >= 0) {
+		cr_renderer_set_num_pref(ext, cr_renderer_flush_interval, flush_interval->valueint);
+	}
+
 }
 
 float getRadians(const cJSON *object) {
@@ -295,7 +338,73 @@ void mesh_material_free(struct mesh_material *m) {
 	if (m->mat) cr_shader_node_free(m->mat);
 }
 
-static void parse_mesh(struct cr_renderer *r, const cJSON *data, int idx, int mesh_file_count) {
+// What a mesh file turned into in the scene. Kept in the file cache, so later references
+// to the same file share the vertex buffer and meshes instead of loading them again.
+struct mesh_file {
+	struct mesh_parse_result result;
+	cr_vertex_buf vbuf;
+	cr_mesh *meshes; // Parallel to result.meshes, -1 until added to the scene
+};
+
+static void mesh_file_free(void *ptr) {
+	struct mesh_file *file = ptr;
+	file->result.meshes.elem_free = ext_mesh_free;
+	ext_mesh_arr_free(&file->result.meshes);
+	file->result.materials.elem_free = mesh_material_free;
+	mesh_material_arr_free(&file->result.materials);
+	free(file->meshes);
+	free(file);
+}
+
+static struct mesh_file *load_mesh_file(struct cr_scene *scene, struct file_cache *cache, const char *full_path, const char *file_name) {
+	struct mesh_file *file = file_cache_asset(cache, full_path, file_cache_mesh);
+	if (file) {
+		logr(debug, "Reusing parsed %s\n", file_name);
+		return file;
+	}
+	struct timeval timer;
+	timer_start(&timer);
+	file = calloc(1, sizeof(*file));
+	file->result = load_meshes_from_file(full_path);
+	long us = timer_get_us(timer);
+	long ms = us / 1000;
+	logr(debug, "Parsing file %-35s took %zu %s\n", file_name, ms > 0 ? ms : us, ms > 0 ? "ms" : "μs");
+
+	struct mesh_parse_result *result = &file->result;
+	file->vbuf = -1;
+	if (result->meshes.count) {
+		file->vbuf = cr_scene_vertex_buf_new(scene, (struct cr_vertex_buf_param){
+			.vertices = (struct cr_vector *)result->geometry.vertices.items,
+			.vertex_count = result->geometry.vertices.count,
+			.normals = (struct cr_vector *)result->geometry.normals.items,
+			.normal_count = result->geometry.normals.count,
+			.tex_coords = (struct cr_coord *)result->geometry.texture_coords.items,
+			.tex_coord_count = result->geometry.texture_coords.count,
+		});
+	}
+	// The scene has its own copy now
+	vector_arr_free(&result->geometry.vertices);
+	vector_arr_free(&result->geometry.normals);
+	coord_arr_free(&result->geometry.texture_coords);
+
+	file->meshes = malloc((result->meshes.count ? result->meshes.count : 1) * sizeof(*file->meshes));
+	for (size_t i = 0; i < result->meshes.count; ++i) file->meshes[i] = -1;
+	file_cache_set_asset(cache, full_path, file_cache_mesh, file, mesh_file_free);
+	return file;
+}
+
+// Add a mesh from file to the scene, unless an earlier reference to the file did already
+static cr_mesh mesh_file_get(struct cr_scene *scene, struct mesh_file *file, size_t idx) {
+	if (file->meshes[idx] < 0) {
+		const struct ext_mesh *m = &file->result.meshes.items[idx];
+		file->meshes[idx] = cr_scene_mesh_new(scene, m->name);
+		cr_mesh_bind_vertex_buf(scene, file->meshes[idx], file->vbuf);
+		cr_mesh_bind_faces(scene, file->meshes[idx], m->faces.items, m->faces.count);
+	}
+	return file->meshes[idx];
+}
+
+static void parse_mesh(struct cr_renderer *r, struct file_cache *cache, const cJSON *data, int idx, int mesh_file_count) {
 	const char *file_name = cJSON_GetStringValue(cJSON_GetObjectItem(data, "fileName"));
 	if (!file_name) return;
 
@@ -308,33 +417,19 @@ static void parse_mesh(struct cr_renderer *r, const cJSON *data, int idx, int me
 
 	logr(plain, "\r");
 	logr(info, "Loading mesh file %i/%i%s", idx + 1, mesh_file_count, (idx + 1) == mesh_file_count ? "\n" : "\r");
-	struct timeval timer;
-	timer_start(&timer);
-	struct mesh_parse_result result = load_meshes_from_file(full_path);
-	long us = timer_get_us(timer);
+	struct mesh_file *file = load_mesh_file(scene, cache, full_path, file_name);
 	free(full_path);
-	long ms = us / 1000;
-	logr(debug, "Parsing file %-35s took %zu %s\n", file_name, ms > 0 ? ms : us, ms > 0 ? "ms" : "μs");
-
-	if (!result.meshes.count) return;
-
-	cr_vertex_buf vbuf = cr_scene_vertex_buf_new(scene, (struct cr_vertex_buf_param){
-		.vertices = (struct cr_vector *)result.geometry.vertices.items,
-		.vertex_count = result.geometry.vertices.count,
-		.normals = (struct cr_vector *)result.geometry.normals.items,
-		.normal_count = result.geometry.normals.count,
-		.tex_coords = (struct cr_coord *)result.geometry.texture_coords.items,
-		.tex_coord_count = result.geometry.texture_coords.count,
-	});
+	if (!file || !file->result.meshes.count) return;
+	const struct mesh_parse_result *result = &file->result;
 
 	// Per JSON 'meshes' array element, these apply to materials before we assign them to instances
 	const struct cJSON *global_overrides = cJSON_GetObjectItem(data, "materials");
 
 	// Copy mesh materials to set
 	cr_material_set file_set = cr_scene_new_material_set(scene);
-	for (size_t i = 0; i < result.materials.count; ++i) {
-		struct cr_shader_node *maybe_override = check_overrides(result.materials, i, global_overrides);
-		cr_material_set_add(scene, file_set, maybe_override ? maybe_override : result.materials.items[i].mat);
+	for (size_t i = 0; i < result->materials.count; ++i) {
+		struct cr_shader_node *maybe_override = check_overrides(result->materials, i, global_overrides);
+		cr_material_set_add(scene, file_set, maybe_override ? maybe_override : result->materials.items[i].mat);
 		if (maybe_override) cr_shader_node_free(maybe_override);
 	}
 
@@ -350,21 +445,19 @@ static void parse_mesh(struct cr_renderer *r, const cJSON *data, int idx, int me
 
 	if (pick_instances && add_instances) {
 		logr(warning, "Can't combine pick_instances and add_instances (%s)\n", file_name);
-		goto done;
+		return;
 	}
 
 	const cJSON *instances = pick_instances ? pick_instances : add_instances;
 	if (!cJSON_IsArray(pick_instances)) {
 		// Generate one instance for every mesh, identity transform.
-		for (size_t i = 0; i < result.meshes.count; ++i) {
-			cr_mesh mesh = cr_scene_mesh_new(scene, result.meshes.items[i].name);
-			cr_mesh_bind_vertex_buf(scene, mesh, vbuf);
-			cr_mesh_bind_faces(scene, mesh, result.meshes.items[i].faces.items, result.meshes.items[i].faces.count);
+		for (size_t i = 0; i < result->meshes.count; ++i) {
+			cr_mesh mesh = mesh_file_get(scene, file, i);
 			cr_instance m_instance = cr_instance_new(scene, mesh, cr_object_mesh);
 			cr_instance_bind_material_set(scene, m_instance, file_set);
 			cr_instance_set_transform(scene, m_instance, parse_composite_transform(cJSON_GetObjectItem(data, "transforms")).A.mtx);
 		}
-		goto done;
+		return;
 	}
 
 	const cJSON *instance = NULL;
@@ -373,14 +466,9 @@ static void parse_mesh(struct cr_renderer *r, const cJSON *data, int idx, int me
 		if (!mesh_name) continue;
 		// Find this mesh in parse result, and add it to the scene if it isn't there yet.
 		cr_mesh mesh = -1;
-		for (size_t i = 0; i < result.meshes.count; ++i) {
-			if (stringEquals(result.meshes.items[i].name, mesh_name)) {
-				mesh = cr_scene_get_mesh(scene, result.meshes.items[i].name);
-				if (mesh < 0) {
-					mesh = cr_scene_mesh_new(scene, result.meshes.items[i].name);
-					cr_mesh_bind_vertex_buf(scene, mesh, vbuf);
-					cr_mesh_bind_faces(scene, mesh, result.meshes.items[i].faces.items, result.meshes.items[i].faces.count);
-				}
+		for (size_t i = 0; i < result->meshes.count; ++i) {
+			if (stringEquals(result->meshes.items[i].name, mesh_name)) {
+				mesh = mesh_file_get(scene, file, i);
 			}
 		}
 		if (mesh < 0) continue;
@@ -390,36 +478,26 @@ static void parse_mesh(struct cr_renderer *r, const cJSON *data, int idx, int me
 		// For the instance materials, we iterate the mesh materials, check if a "replace" exists with that name,
 		// if one does, use that, otherwise grab the mesh material.
 		const cJSON *instance_overrides = cJSON_GetObjectItem(instance, "materials");
-		for (size_t i = 0; i < result.materials.count; ++i) {
+		for (size_t i = 0; i < result->materials.count; ++i) {
 			struct cr_shader_node *material = NULL;
 			// Find the material we want to use. Check if instance overrides it, otherwise use mesh global one
-			material = check_overrides(result.materials, i, instance_overrides);
+			material = check_overrides(result->materials, i, instance_overrides);
 			// If material is NULL here, it gets set to an obnoxious material internally.
-			cr_material_set_add(scene, instance_set, material ? material : result.materials.items[i].mat);
+			cr_material_set_add(scene, instance_set, material ? material : result->materials.items[i].mat);
 			cr_shader_node_free(material);
 		}
 		cr_instance_set_transform(scene, new, parse_composite_transform(cJSON_GetObjectItem(instance, "transforms")).A.mtx);
 		cr_instance_bind_material_set(scene, new, instance_set);
 	}
-	
-done:
-
-	result.meshes.elem_free = ext_mesh_free;
-	ext_mesh_arr_free(&result.meshes);
-	result.materials.elem_free = mesh_material_free;
-	mesh_material_arr_free(&result.materials);
-	vector_arr_free(&result.geometry.vertices);
-	vector_arr_free(&result.geometry.normals);
-	coord_arr_free(&result.geometry.texture_coords);
 }
 
-static void parse_meshes(struct cr_renderer *r, const cJSON *data) {
+static void parse_meshes(struct cr_renderer *r, struct file_cache *cache, const cJSON *data) {
 	if (!cJSON_IsArray(data)) return;
 	int idx = 0;
 	int mesh_file_count = cJSON_GetArraySize(data);
 	const cJSON *mesh = NULL;
 	cJSON_ArrayForEach(mesh, data) {
-		parse_mesh(r, mesh, idx++, mesh_file_count);
+		parse_mesh(r, cache, mesh, idx++, mesh_file_count);
 	}
 }
 
@@ -476,11 +554,114 @@ static void parse_sphere(struct cr_renderer *r, const cJSON *data) {
 	}
 }
 
+// Next item of a JSON array, when walking several in step. NULL once one runs out.
+static inline const cJSON *next_item(const cJSON *item) {
+	return item ? item->next : NULL;
+}
+
+static inline float item_number(const cJSON *item, float fallback) {
+	return cJSON_IsNumber(item) ? item->valuedouble : fallback;
+}
+
+// Lots of spheres as one object, for particles and such. Spheres are given by "centers",
+// with either a "radii" array or a "radius" for all of them. "material" can be an array,
+// and "material_indices" then picks one for each sphere.
+static void parse_sphere_set(struct cr_renderer *r, const cJSON *data) {
+	struct cr_scene *scene = cr_renderer_scene_get(r);
+
+	const cJSON *centers = cJSON_GetObjectItem(data, "centers");
+	if (!cJSON_IsArray(centers) || !cJSON_GetArraySize(centers)) {
+		logr(warning, "No centers specified for sphere set, skipping\n");
+		return;
+	}
+	const size_t count = cJSON_GetArraySize(centers);
+
+	const cJSON *radii = cJSON_GetObjectItem(data, "radii");
+	const cJSON *radius = cJSON_GetObjectItem(data, "radius");
+	const float default_radius = item_number(radius, 1.0f);
+	if (!cJSON_IsArray(radii) && !cJSON_IsNumber(radius)) {
+		logr(warning, "No radius specified for sphere set, setting to %.0f\n", (double)default_radius);
+	}
+
+	const cJSON *set_materials = cJSON_GetObjectItem(data, "material");
+	const size_t material_count = cJSON_IsArray(set_materials) ? (size_t)cJSON_GetArraySize(set_materials) : 1;
+	const cJSON *indices = cJSON_GetObjectItem(data, "material_indices");
+
+	struct cr_vector *c = calloc(count, sizeof(*c));
+	float *rad = calloc(count, sizeof(*rad));
+	unsigned int *mat_idx = cJSON_IsArray(indices) ? calloc(count, sizeof(*mat_idx)) : NULL;
+	// Arrays can have millions of items, so walk them instead of indexing them
+	const cJSON *rad_item = cJSON_IsArray(radii) ? radii->child : NULL;
+	const cJSON *idx_item = mat_idx ? indices->child : NULL;
+	size_t i = 0;
+	const cJSON *center = NULL;
+	cJSON_ArrayForEach(center, centers) {
+		const cJSON *x = cJSON_IsArray(center) ? center->child : NULL;
+		const cJSON *y = next_item(x);
+		const cJSON *z = next_item(y);
+		c[i] = (struct cr_vector){ item_number(x, 0.0f), item_number(y, 0.0f), item_number(z, 0.0f) };
+		rad[i] = item_number(rad_item, default_radius);
+		rad_item = next_item(rad_item);
+		if (mat_idx) {
+			const float m = item_number(idx_item, 0.0f);
+			mat_idx[i] = m >= 0.0f && m < material_count ? (unsigned int)m : 0;
+			idx_item = next_item(idx_item);
+		}
+		i++;
+	}
+
+	cr_sphere_set new_set = cr_scene_add_sphere_set(scene, (struct cr_sphere_set_param){
+		.centers = c,
+		.radii = rad,
+		.mat_idx = mat_idx,
+		.count = count
+	});
+	free(c);
+	free(rad);
+	const bool mat_idx_given = mat_idx;
+	free(mat_idx);
+
+	const cJSON *instances = cJSON_GetObjectItem(data, "instances");
+	if (!cJSON_IsArray(instances)) return;
+	const cJSON *instance = NULL;
+	cJSON_ArrayForEach(instance, instances) {
+		cr_instance new_instance = cr_instance_new(scene, new_set, cr_object_sphere_set);
+		cr_material_set instance_set = cr_scene_new_material_set(scene);
+
+		// Instances can override the materials, but should keep the same amount
+		const cJSON *instance_materials = cJSON_GetObjectItem(instance, "materials");
+		const cJSON *materials = instance_materials ? instance_materials : set_materials;
+		const size_t instance_count = cJSON_IsArray(materials) ? (size_t)cJSON_GetArraySize(materials) : 1;
+		if (mat_idx_given && instance_count < material_count) {
+			logr(warning, "Sphere set instance has %zu materials, expected %zu. Spheres indexing past that use the first one\n", instance_count, material_count);
+		}
+		if (cJSON_IsArray(materials)) {
+			const cJSON *material = NULL;
+			cJSON_ArrayForEach(material, materials) {
+				struct cr_shader_node *desc = cr_shader_node_build(material);
+				cr_material_set_add(scene, instance_set, desc);
+				cr_shader_node_free(desc);
+			}
+		} else if (materials) {
+			struct cr_shader_node *desc = cr_shader_node_build(materials);
+			cr_material_set_add(scene, instance_set, desc);
+			cr_shader_node_free(desc);
+		} else {
+			cr_material_set_add(scene, instance_set, NULL);
+		}
+
+		cr_instance_set_transform(scene, new_instance, parse_composite_transform(cJSON_GetObjectItem(instance, "transforms")).A.mtx);
+		cr_instance_bind_material_set(scene, new_instance, instance_set);
+	}
+}
+
 static void parse_primitive(struct cr_renderer *r, const cJSON *data, int idx) {
 	const cJSON *type = NULL;
 	type = cJSON_GetObjectItem(data, "type");
 	if (stringEquals(type->valuestring, "sphere")) {
 		parse_sphere(r, data);
+	} else if (stringEquals(type->valuestring, "sphere_set")) {
+		parse_sphere_set(r, data);
 	} else {
 		logr(warning, "Unknown primitive type \"%s\" at index %i\n", type->valuestring, idx);
 	}
@@ -497,7 +678,7 @@ static void parse_primitives(struct cr_renderer *r, const cJSON *data) {
 	}
 }
 
-static void parseScene(struct cr_renderer *r, const cJSON *data) {
+static void parseScene(struct cr_renderer *r, struct file_cache *cache, const cJSON *data) {
 	struct cr_scene *scene = cr_renderer_scene_get(r);
 
 	struct cr_shader_node *background = cr_shader_node_build(cJSON_GetObjectItem(data, "ambientColor"));
@@ -505,10 +686,10 @@ static void parseScene(struct cr_renderer *r, const cJSON *data) {
 	cr_shader_node_free(background);
 
 	parse_primitives(r, cJSON_GetObjectItem(data, "primitives"));
-	parse_meshes(r, cJSON_GetObjectItem(data, "meshes"));
+	parse_meshes(r, cache, cJSON_GetObjectItem(data, "meshes"));
 }
 
-int parse_json(struct cr_renderer *r, struct cJSON *json) {
+int parse_json(struct cr_renderer *r, struct cJSON *json, struct file_cache *cache) {
 	struct cr_scene *scene = cr_renderer_scene_get(r);
 	parse_prefs(r, cJSON_GetObjectItem(json, "renderer"));
 	parse_cameras(scene, cJSON_GetObjectItem(json, "camera"));
@@ -516,13 +697,18 @@ int parse_json(struct cr_renderer *r, struct cJSON *json) {
 		logr(warning, "No cameras specified, nothing to render.\n");
 		return -1;
 	}
+	// Without one, files are still only loaded once within this call
+	struct file_cache *local_cache = cache ? NULL : file_cache_new();
+	// Files may have changed since the last call
+	file_cache_revalidate(cache);
 
 	const cJSON *renderer = cJSON_GetObjectItem(json, "renderer");
 	const cJSON *selected_camera = cJSON_GetObjectItem(renderer, "selected_camera");
 	if (cJSON_IsNumber(selected_camera)) {
 		cr_renderer_set_num_pref(r, cr_renderer_override_cam, selected_camera->valueint);
 	}
-	parseScene(r, cJSON_GetObjectItem(json, "scene"));
+	parseScene(r, cache ? cache : local_cache, cJSON_GetObjectItem(json, "scene"));
+	file_cache_destroy(local_cache);
 
 	return 0;
 }
@@ -10,5 +10,7 @@
 
 struct cr_renderer;
 struct cJSON;
+struct file_cache;
 
-int parse_json(struct cr_renderer *r, struct cJSON *json);
+/// @param cache Optional, keeps loaded files around for later calls. Should belong to the same scene.
+int parse_json(struct cr_renderer *r, struct cJSON *json, struct file_cache *cache);
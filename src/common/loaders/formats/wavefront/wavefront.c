@@ -53,6 +53,8 @@ static inline size_t parse_polys(lineBuffer *line, struct cr_face *buf) {
 	for (size_t i = 0; i < polycount; ++i) {
 		firstToken(line);
 		struct cr_face *p = &buf[i];
+		// Indices that aren't in the file stay 0, which fixIndices() turns into -1
+		*p = (struct cr_face){ 0 };
 		for (int j = 0; j < MAX_CRAY_VERTEX_COUNT; ++j) {
 			fillLineBuffer(&batch, nextToken(line), '/');
 			if (batch.amountOf.tokens >= 1) p->vertex_idx[j] = atoi(firstToken(&batch));
@@ -11,6 +11,7 @@
 #include "../texture.h"
 #include "../assert.h"
 #include "../mempool.h"
+#include "../platform/thread_pool.h"
 
 #define STBI_NO_PSD
 #define STBI_NO_GIF
@@ -36,7 +37,6 @@ void copy_to_pool(struct block **pool, struct texture *tex) {
 }
 
 static struct texture *load_env_map(const file_data data) {
-	logr(info, "Loading HDR...");
 	struct texture *tex = newTexture(none, 0, 0, 0);
 	tex->data.float_p = stbi_loadf_from_memory(data.items, (int)data.count, (int *)&tex->width, (int *)&tex->height, (int *)&tex->channels, 0);
 	tex->precision = float_p;
@@ -46,7 +46,162 @@ static struct texture *load_env_map(const file_data data) {
 		return NULL;
 	}
 	char sbuf[64];
-	printf(" %s\n", human_file_size(data.count, sbuf));
+	logr(debug, "Decoded %zux%zu HDR from %s\n", tex->width, tex->height, human_file_size(data.count, sbuf));
+	return tex;
+}
+
+// Radiance HDR files are mostly RLE scanlines, which stb_image decodes one after another.
+// Scanlines start at unpredictable offsets, but finding them just means skipping over runs,
+// which is cheap next to decoding. With the offsets known, bands of scanlines are decoded
+// and converted to float in parallel.
+// Anything other than plain -Y +X RLE files is left to stb_image.
+
+#define HDR_PARALLEL_MIN_PIXELS (512 * 512)
+
+struct hdr_bands {
+	const unsigned char *data;
+	const size_t *offsets; // Of each scanline
+	size_t width;
+	float *out;
+	float exponents[256];
+};
+
+struct hdr_band {
+	struct hdr_bands *hdr;
+	size_t row_begin;
+	size_t row_end;
+};
+
+// Line ending at '\n', or NULL if there isn't one
+static const unsigned char *hdr_line(const unsigned char *p, const unsigned char *end, char *buf, size_t buf_size) {
+	size_t len = 0;
+	while (p < end && *p != '\n') {
+		if (len + 1 < buf_size) buf[len++] = (char)*p;
+		p++;
+	}
+	buf[len] = 0;
+	return p < end ? p + 1 : NULL;
+}
+
+// Skip over one scanline. NULL if it's malformed, or not new-style RLE
+static const unsigned char *hdr_skip_scanline(const unsigned char *p, const unsigned char *end, size_t width) {
+	if (end - p < 4 || p[0] != 2 || p[1] != 2 || (p[2] & 0x80) || (size_t)(p[2] << 8 | p[3]) != width) return NULL;
+	p += 4;
+	for (size_t k = 0; k < 4; ++k) {
+		for (size_t i = 0; i < width;) {
+			if (p >= end) return NULL;
+			size_t count = *p++;
+			const bool run = count > 128;
+			if (run) count -= 128;
+			if (!count || i + count > width) return NULL;
+			const size_t bytes = run ? 1 : count;
+			if ((size_t)(end - p) < bytes) return NULL;
+			p += bytes;
+			i += count;
+		}
+	}
+	return p;
+}
+
+static void hdr_decode_band(void *arg) {
+	const struct hdr_band *band = arg;
+	const struct hdr_bands *hdr = band->hdr;
+	const size_t width = hdr->width;
+	unsigned char *scanline = malloc(width * 4);
+	for (size_t y = band->row_begin; y < band->row_end; ++y) {
+		// Already validated by hdr_skip_scanline()
+		const unsigned char *p = hdr->data + hdr->offsets[y] + 4;
+		for (size_t k = 0; k < 4; ++k) {
+			for (size_t i = 0; i < width;) {
+				size_t count = *p++;
+				if (count > 128) {
+					count -= 128;
+					const unsigned char value = *p++;
+					for (size_t c = 0; c < count; ++c) scanline[(i++) * 4 + k] = value;
+				} else {
+					for (size_t c = 0; c < count; ++c) scanline[(i++) * 4 + k] = *p++;
+				}
+			}
+		}
+		float *out = hdr->out + y * width * 3;
+		for (size_t x = 0; x < width; ++x) {
+			const unsigned char *rgbe = scanline + x * 4;
+			// Same as stb_image, including 0 for a zero exponent
+			const float f = rgbe[3] ? hdr->exponents[rgbe[3]] : 0.0f;
+			out[x * 3 + 0] = rgbe[0] * f;
+			out[x * 3 + 1] = rgbe[1] * f;
+			out[x * 3 + 2] = rgbe[2] * f;
+		}
+	}
+	free(scanline);
+}
+
+// NULL and *corrupt set if scanlines are malformed. stb_image would spin forever on truncated ones.
+static struct texture *load_env_map_parallel(struct cr_thread_pool *pool, const file_data data, bool *corrupt) {
+	const unsigned char *p = data.items, *end = data.items + data.count;
+	char line[256];
+	if (!(p = hdr_line(p, end, line, sizeof(line)))) return NULL;
+	if (strcmp(line, "#?RADIANCE") && strcmp(line, "#?RGBE")) return NULL;
+	for (;;) {
+		if (!(p = hdr_line(p, end, line, sizeof(line)))) return NULL;
+		if (!line[0]) break;
+		if (!strncmp(line, "FORMAT=", 7) && strcmp(line, "FORMAT=32-bit_rle_rgbe")) return NULL;
+	}
+	if (!(p = hdr_line(p, end, line, sizeof(line)))) return NULL;
+	int width = 0, height = 0;
+	if (sscanf(line, "-Y %d +X %d", &height, &width) != 2 || width < 8 || width >= 32768 || height < 1) return NULL;
+	if ((size_t)width * (size_t)height < HDR_PARALLEL_MIN_PIXELS) return NULL;
+
+	size_t *offsets = malloc(height * sizeof(*offsets));
+	for (int y = 0; y < height; ++y) {
+		offsets[y] = p - data.items;
+		const unsigned char *next = hdr_skip_scanline(p, end, width);
+		if (!next) {
+			// Scanlines not starting with 2, 2 are old-style, stb_image can have those
+			*corrupt = end - p < 4 || (p[0] == 2 && p[1] == 2);
+			free(offsets);
+			return NULL;
+		}
+		p = next;
+	}
+
+	struct hdr_bands hdr = {
+		.data = data.items,
+		.offsets = offsets,
+		.width = width,
+		.out = malloc((size_t)width * height * 3 * sizeof(float)),
+	};
+	if (!hdr.out) {
+		free(offsets);
+		return NULL;
+	}
+	for (int e = 0; e < 256; ++e) hdr.exponents[e] = ldexpf(1.0f, e - (128 + 8));
+
+	const size_t band_count = thread_pool_size(pool) * 4;
+	const size_t rows_per_band = (height + band_count - 1) / band_count;
+	struct hdr_band *bands = calloc(band_count, sizeof(*bands));
+	struct cr_task_group group = { 0 };
+	for (size_t b = 0; b < band_count; ++b) {
+		bands[b] = (struct hdr_band){
+			.hdr = &hdr,
+			.row_begin = min(b * rows_per_band, (size_t)height),
+			.row_end = min((b + 1) * rows_per_band, (size_t)height),
+		};
+		if (bands[b].row_begin == bands[b].row_end) continue;
+		thread_pool_enqueue_group(pool, &group, hdr_decode_band, &bands[b]);
+	}
+	thread_pool_wait_group(pool, &group);
+	free(bands);
+	free(offsets);
+
+	struct texture *tex = newTexture(none, 0, 0, 0);
+	tex->data.float_p = hdr.out;
+	tex->width = width;
+	tex->height = height;
+	tex->channels = 3;
+	tex->precision = float_p;
+	char sbuf[64];
+	logr(debug, "Decoded %zux%zu HDR from %s in %zu bands\n", tex->width, tex->height, human_file_size(data.count, sbuf), band_count);
 	return tex;
 }
 
@@ -58,7 +213,7 @@ struct texture *load_qoi_from_buffer(const file_data data) {
 	new->data.byte_p = decoded_data;
 	new->width = desc.width;
 	new->height = desc.height;
-	new->channels = desc.channels;
+	new->channels = 3; // We ask qoi_decode() for RGB, regardless of what's in the file
 	new->precision = char_p;
 	return new;
 }
@@ -76,13 +231,20 @@ static struct texture *load_texture_from_buffer(const file_data data) {
 }
 
 struct texture *load_texture(const char *path, const file_data data) {
+	return load_texture_parallel(NULL, path, data);
+}
+
+struct texture *load_texture_parallel(struct cr_thread_pool *pool, const char *path, const file_data data) {
 	if (!data.items) return NULL;
 
 	enum fileType type = guess_file_type(path);
 
 	struct texture *new = NULL;
 	if (stbi_is_hdr_from_memory(data.items, data.count)) {
-		new = load_env_map(data);
+		bool corrupt = false;
+		if (pool) new = load_env_map_parallel(pool, data, &corrupt);
+		if (!new && !corrupt) new = load_env_map(data);
+		if (corrupt) logr(warning, "Corrupt or truncated HDR scanlines\n");
 	} else if (type == qoi) {
 		new = load_qoi_from_buffer(data);
 	} else {
@@ -100,3 +262,36 @@ struct texture *load_texture(const char *path, const file_data data) {
 	logr(debug, "Loaded texture %s, %s => %s\n", path, human_file_size(data.count, b0), human_file_size(raw_bytes, b1));
 	return new;
 }
+
+static uint32_t read_be32(const unsigned char *p) {
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+struct texture *load_texture_header(const char *path, const file_data data) {
+	if (!data.items) return NULL;
+	struct texture *new = newTexture(none, 0, 0, 0);
+	if (guess_file_type(path) == qoi && !stbi_is_hdr_from_memory(data.items, data.count)) {
+		// 4 byte magic, then big-endian width and height
+		if (data.count < 14 || memcmp(data.items, "qoif", 4)) {
+			logr(warning, "Invalid QOI header in \"%s\"\n", path);
+			destroyTexture(new);
+			return NULL;
+		}
+		new->width = read_be32(data.items + 4);
+		new->height = read_be32(data.items + 8);
+		new->channels = 3;
+		new->precision = char_p;
+		return new;
+	}
+	int width, height, channels;
+	if (!stbi_info_from_memory(data.items, (int)data.count, &width, &height, &channels)) {
+		logr(warning, "Failed to read texture header from \"%s\". Reason: \"%s\"\n", path, stbi_failure_reason());
+		destroyTexture(new);
+		return NULL;
+	}
+	new->width = width;
+	new->height = height;
+	new->channels = channels;
+	new->precision = stbi_is_hdr_from_memory(data.items, (int)data.count) ? float_p : char_p;
+	return new;
+}
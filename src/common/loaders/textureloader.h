@@ -12,3 +12,10 @@
 
 // Currently supports: JPEG, PNG, BMP, TGA, PIC, PNM, QOI, HDRI
 struct texture *load_texture(const char *path, const file_data data);
+
+struct cr_thread_pool;
+/// Like load_texture(), but large HDR images are decoded a band of scanlines at a time on pool
+struct texture *load_texture_parallel(struct cr_thread_pool *pool, const char *path, const file_data data);
+
+/// Just the dimensions and format of the texture, without decoding it. The returned texture has no data.
+struct texture *load_texture_header(const char *path, const file_data data);
@@ -6,21 +6,84 @@
 //  Copyright © 2020-2022 Valtteri Koskivuori. All rights reserved.
 //
 
+// For MAP_ANONYMOUS, MAP_HUGETLB and MADV_HUGEPAGE
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include "mempool.h"
 #include "logging.h"
 #include "fileio.h"
 
+#ifndef WINDOWS
+#include <sys/mman.h>
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+// Allocations at least this big get their own pages, on platforms that have them.
+// This is also the huge page size on x86 and most ARM systems.
+#define HUGE_PAGE_SIZE ((size_t)2 * 1024 * 1024)
+// Each block is twice the size of the previous one, up to this
+#define MAX_BLOCK_GROWTH ((size_t)64 * 1024 * 1024)
+
+// Map at least *bytes of zeroed memory, backed by huge pages if we can get them.
+// *bytes is rounded up to what was actually mapped. Returns NULL if mapping isn't available.
+static void *mapPages(size_t *bytes) {
+#if !defined(WINDOWS) && defined(MAP_ANONYMOUS)
+	const size_t size = (*bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+	void *ptr = MAP_FAILED;
+#if defined(CRAY_HUGETLB) && defined(MAP_HUGETLB)
+	// Only works if the system has huge pages reserved, fall back to regular pages otherwise
+	ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+	if (ptr == MAP_FAILED) {
+		ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (ptr == MAP_FAILED) return NULL;
+#ifdef MADV_HUGEPAGE
+		// Transparent huge pages, the kernel backs this with them if it can
+		madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+	}
+	*bytes = size;
+	return ptr;
+#else
+	(void)bytes;
+	return NULL;
+#endif
+}
+
+static void unmapPages(void *ptr, size_t bytes) {
+#if !defined(WINDOWS) && defined(MAP_ANONYMOUS)
+	munmap(ptr, bytes);
+#else
+	(void)ptr;
+	(void)bytes;
+#endif
+}
+
 struct block {
 	size_t size;
 	size_t capacity;
+	size_t mapped; // Bytes mapped for this block, 0 if it came from calloc()
 	struct block *prev;
 	cray_max_align_t data[];
 };
 
 struct block *newBlock(struct block *prev, size_t initialSize) {
-	struct block *newBlock = calloc(1, sizeof(*newBlock) + initialSize);
-	newBlock->capacity = initialSize;
+	size_t bytes = sizeof(struct block) + initialSize;
+	struct block *newBlock = bytes >= HUGE_PAGE_SIZE ? mapPages(&bytes) : NULL;
+	if (newBlock) {
+		newBlock->mapped = bytes;
+		newBlock->capacity = bytes - sizeof(struct block);
+	} else {
+		newBlock = calloc(1, sizeof(*newBlock) + initialSize);
+		newBlock->capacity = initialSize;
+	}
 	newBlock->size = 0;
 	newBlock->prev = prev;
 	return newBlock;
@@ -30,11 +93,14 @@ void *allocBlock(struct block **head, size_t size) {
 	if (size == 0) return NULL;
 	
 	// Round up for alignment
-	size += sizeof(cray_max_align_t) - (size % sizeof(cray_max_align_t));
+	size = (size + sizeof(cray_max_align_t) - 1) / sizeof(cray_max_align_t) * sizeof(cray_max_align_t);
 	
 	if ((*head)->size + size > (*head)->capacity) {
-		// Need to add a new block
-		size_t nextSize = (*head)->capacity > size ? (*head)->capacity : size;
+		// Need to add a new block. Grow geometrically, so a pool that started out small
+		// doesn't end up as thousands of tiny blocks.
+		size_t nextSize = (*head)->capacity * 2;
+		if (nextSize > MAX_BLOCK_GROWTH) nextSize = MAX_BLOCK_GROWTH;
+		if (nextSize < size) nextSize = size;
 		char buf[64];
 		logr(debug, "Appending a new block of size %s. Previous head occupancy: %s\n", human_file_size(nextSize, buf), human_file_size((*head)->size, buf));
 		*head = newBlock(*head, nextSize);
@@ -51,7 +117,11 @@ void destroyBlocks(struct block *head) {
 	while (head) {
 		struct block *prev = head->prev;
 		bytesfreed += head->size;
-		free(head);
+		if (head->mapped) {
+			unmapPages(head, head->mapped);
+		} else {
+			free(head);
+		}
 		numDestroyed++;
 		head = prev;
 	}
@@ -59,3 +129,42 @@ void destroyBlocks(struct block *head) {
 	logr(debug, "Destroyed %lu blocks, %s\n", numDestroyed, size);
 	free(size);
 }
+
+// Sits right before the pointer allocLarge() returns
+struct large_header {
+	void *base;
+	size_t mapped; // 0 if base came from malloc()
+};
+
+#define LARGE_ALIGN 64
+#define LARGE_OFFSET (((sizeof(struct large_header) + LARGE_ALIGN - 1) / LARGE_ALIGN) * LARGE_ALIGN)
+
+void *allocLarge(size_t size) {
+	if (size == 0) return NULL;
+	size_t bytes = LARGE_OFFSET + size;
+	char *base = bytes >= HUGE_PAGE_SIZE ? mapPages(&bytes) : NULL;
+	char *ptr;
+	if (base) {
+		// Pages are aligned already
+		ptr = base + LARGE_OFFSET;
+	} else {
+		bytes = 0;
+		base = malloc(LARGE_OFFSET + size + LARGE_ALIGN - 1);
+		if (!base) return NULL;
+		ptr = (char *)(((uintptr_t)base + LARGE_OFFSET + LARGE_ALIGN - 1) & ~(uintptr_t)(LARGE_ALIGN - 1));
+	}
+	struct large_header *header = (struct large_header *)ptr - 1;
+	header->base = base;
+	header->mapped = bytes;
+	return ptr;
+}
+
+void freeLarge(void *ptr) {
+	if (!ptr) return;
+	const struct large_header header = *((struct large_header *)ptr - 1);
+	if (header.mapped) {
+		unmapPages(header.base, header.mapped);
+	} else {
+		free(header.base);
+	}
+}
@@ -11,8 +11,20 @@
 #include <stddef.h>
 #include "memory.h"
 
+// Pools grow geometrically. Blocks that are big enough are mapped directly, and backed by
+// huge pages where the platform supports it, which cuts down on TLB misses when walking them.
+// Building with CRAY_HUGETLB defined tries explicit huge pages (MAP_HUGETLB) before
+// transparent ones. Those only work if the system has some reserved.
+
 struct block *newBlock(struct block *prev, size_t initialSize);
 
 void *allocBlock(struct block **head, size_t size);
 
 void destroyBlocks(struct block *head);
+
+/// A single allocation for big, long lived data, aligned to a cache line.
+/// Large enough ones get their own huge page backed mapping, like big pool blocks do.
+/// Release with freeLarge(), not free()
+void *allocLarge(size_t size);
+
+void freeLarge(void *ptr);
@@ -0,0 +1,71 @@
+//
+//  atomics.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Platform-agnostic atomic operations on size_t.
+// We're C99, so no <stdatomic.h>. These map to compiler intrinsics instead,
+// and are all sequentially consistent.
+
+#ifdef WINDOWS
+#include <Windows.h>
+
+static inline size_t atomic_add_size(volatile size_t *p, size_t value) {
+#ifdef _WIN64
+	return (size_t)InterlockedExchangeAdd64((volatile LONG64 *)p, (LONG64)value);
+#else
+	return (size_t)InterlockedExchangeAdd((volatile LONG *)p, (LONG)value);
+#endif
+}
+
+static inline bool atomic_cas_size(volatile size_t *p, size_t expected, size_t desired) {
+#ifdef _WIN64
+	return (size_t)InterlockedCompareExchange64((volatile LONG64 *)p, (LONG64)desired, (LONG64)expected) == expected;
+#else
+	return (size_t)InterlockedCompareExchange((volatile LONG *)p, (LONG)desired, (LONG)expected) == expected;
+#endif
+}
+
+static inline size_t atomic_load_size(volatile size_t *p) {
+	return atomic_add_size(p, 0);
+}
+
+static inline void atomic_store_size(volatile size_t *p, size_t value) {
+#ifdef _WIN64
+	InterlockedExchange64((volatile LONG64 *)p, (LONG64)value);
+#else
+	InterlockedExchange((volatile LONG *)p, (LONG)value);
+#endif
+}
+
+#else
+
+/// Atomically add value to *p
+/// @return The value *p had before the addition
+static inline size_t atomic_add_size(volatile size_t *p, size_t value) {
+	return __atomic_fetch_add(p, value, __ATOMIC_SEQ_CST);
+}
+
+/// Atomically replace *p with desired, if *p == expected
+/// @return true if the swap happened
+static inline bool atomic_cas_size(volatile size_t *p, size_t expected, size_t desired) {
+	return __atomic_compare_exchange_n(p, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline size_t atomic_load_size(volatile size_t *p) {
+	return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+}
+
+static inline void atomic_store_size(volatile size_t *p, size_t value) {
+	__atomic_store_n(p, value, __ATOMIC_SEQ_CST);
+}
+
+#endif
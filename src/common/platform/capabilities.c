@@ -8,6 +8,12 @@
 
 #include "capabilities.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+
 #ifdef __APPLE__
 #include <sys/param.h>
 #include <sys/sysctl.h>
@@ -16,6 +22,14 @@
 #elif __linux__ || __COSMOPOLITAN__
 #include <unistd.h>
 #endif
+#ifdef __linux__
+#include <dirent.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
 
 int sys_get_cores() {
 #ifdef __APPLE__
@@ -44,3 +58,215 @@ int sys_get_cores() {
 	return 1;
 #endif
 }
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+static void cpuid(unsigned leaf, unsigned regs[4]) {
+#ifdef _MSC_VER
+	__cpuidex((int *)regs, (int)leaf, 0);
+#else
+	regs[0] = regs[1] = regs[2] = regs[3] = 0;
+	if (leaf <= __get_cpuid_max(0, NULL)) __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Which register states the OS saves on context switches
+static unsigned long long xgetbv(void) {
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned eax, edx;
+	__asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+static unsigned x86_features(void) {
+	unsigned regs[4];
+	cpuid(0, regs);
+	const unsigned max_leaf = regs[0];
+	cpuid(1, regs);
+	const unsigned ecx1 = regs[2];
+	if (!(ecx1 & (1u << 19))) return 0;
+	unsigned features = sys_sse41;
+
+	// AVX needs OS support for the ymm registers, and AVX-512 for the zmm and mask registers
+	const bool osxsave = ecx1 & (1u << 27);
+	const unsigned long long xcr0 = osxsave ? xgetbv() : 0;
+	const bool avx = (ecx1 & (1u << 28)) && (xcr0 & 0x6) == 0x6;
+	const bool fma = ecx1 & (1u << 12);
+	if (!avx || !fma || max_leaf < 7) return features;
+	cpuid(7, regs);
+	const unsigned ebx7 = regs[1];
+	if (!(ebx7 & (1u << 5))) return features;
+	features |= sys_avx2;
+
+	const unsigned avx512 = (1u << 16) | (1u << 17) | (1u << 30) | (1u << 31);
+	if ((ebx7 & avx512) == avx512 && (xcr0 & 0xE6) == 0xE6) features |= sys_avx512;
+	return features;
+}
+#endif
+
+unsigned sys_get_cpu_features(void) {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+	return x86_features();
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+	// Always there on 64-bit ARM. On 32-bit, simd.h only uses it if the build targets it anyway.
+	return sys_neon;
+#else
+	return 0;
+#endif
+}
+
+char *sys_cpu_features_string(unsigned features, char *buf, size_t size) {
+	static const char *names[] = { "SSE4.1", "AVX2", "AVX-512", "NEON" };
+	size_t used = 0;
+	buf[0] = '\0';
+	for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+		if (!(features & (1u << i))) continue;
+		const int written = snprintf(buf + used, size - used, "%s%s", used ? " " : "", names[i]);
+		if (written < 0 || (size_t)written >= size - used) break;
+		used += written;
+	}
+	if (!used) snprintf(buf, size, "none");
+	return buf;
+}
+
+#ifdef __linux__
+static int read_int(const char *fmt, int cpu, int fallback) {
+	char path[128];
+	snprintf(path, sizeof(path), fmt, cpu);
+	FILE *f = fopen(path, "r");
+	if (!f) return fallback;
+	int value = fallback;
+	if (fscanf(f, "%d", &value) != 1) value = fallback;
+	fclose(f);
+	return value;
+}
+
+// cpuN/ has a nodeM symlink for the NUMA node it belongs to
+static int read_node(int cpu) {
+	char path[64];
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+	DIR *dir = opendir(path);
+	if (!dir) return 0;
+	int node = 0;
+	struct dirent *entry;
+	while ((entry = readdir(dir))) {
+		if (strncmp(entry->d_name, "node", 4) == 0 && isdigit((unsigned char)entry->d_name[4])) {
+			node = atoi(entry->d_name + 4);
+			break;
+		}
+	}
+	closedir(dir);
+	return node;
+}
+#endif
+
+static int compare_cpus(const void *a, const void *b) {
+	const struct sys_cpu *lhs = a;
+	const struct sys_cpu *rhs = b;
+	if (lhs->node != rhs->node) return lhs->node - rhs->node;
+	if (lhs->core != rhs->core) return lhs->core - rhs->core;
+	return lhs->id - rhs->id;
+}
+
+struct sys_topology sys_get_topology(void) {
+	struct sys_topology topo = { 0 };
+	const int logical = sys_get_cores();
+	topo.cpus = calloc(logical, sizeof(*topo.cpus));
+#ifdef __linux__
+	const int configured = (int)sysconf(_SC_NPROCESSORS_CONF);
+	for (int cpu = 0; cpu < configured && topo.cpu_count < (size_t)logical; ++cpu) {
+		if (!read_int("/sys/devices/system/cpu/cpu%d/online", cpu, 1)) continue;
+		const int core = read_int("/sys/devices/system/cpu/cpu%d/topology/core_id", cpu, cpu);
+		const int package = read_int("/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu, 0);
+		topo.cpus[topo.cpu_count++] = (struct sys_cpu){
+			.id = cpu,
+			// core_id is only unique within a package
+			.core = package * 65536 + core,
+			.package = package,
+			.node = read_node(cpu),
+		};
+	}
+#endif
+	if (!topo.cpu_count) {
+		for (int cpu = 0; cpu < logical; ++cpu) {
+			topo.cpus[topo.cpu_count++] = (struct sys_cpu){ .id = cpu, .core = cpu };
+		}
+	}
+	// Group by node, then by core, so siblings and node-mates are next to each other
+	qsort(topo.cpus, topo.cpu_count, sizeof(*topo.cpus), compare_cpus);
+
+	// Renumber nodes and cores to be dense, starting from 0
+	int prev_node = -1;
+	int prev_core = -1;
+	for (size_t i = 0; i < topo.cpu_count; ++i) {
+		struct sys_cpu *c = &topo.cpus[i];
+		if (c->node != prev_node) {
+			prev_node = c->node;
+			topo.node_count++;
+			prev_core = -1;
+		}
+		if (c->core != prev_core) {
+			prev_core = c->core;
+			topo.core_count++;
+		}
+		c->node = (int)topo.node_count - 1;
+		c->core = (int)topo.core_count - 1;
+	}
+	return topo;
+}
+
+void sys_topology_free(struct sys_topology *topo) {
+	free(topo->cpus);
+	*topo = (struct sys_topology){ 0 };
+}
+
+struct pin_key {
+	size_t smt; // Sibling index within the core
+	size_t rank; // Core index within the node
+	size_t node;
+	size_t cpu;
+};
+
+static int compare_pin_keys(const void *a, const void *b) {
+	const struct pin_key *lhs = a;
+	const struct pin_key *rhs = b;
+	if (lhs->smt != rhs->smt) return lhs->smt < rhs->smt ? -1 : 1;
+	if (lhs->rank != rhs->rank) return lhs->rank < rhs->rank ? -1 : 1;
+	if (lhs->node != rhs->node) return lhs->node < rhs->node ? -1 : 1;
+	return 0;
+}
+
+void sys_pin_order(const struct sys_topology *topo, enum pin_policy policy, size_t *order) {
+	const size_t n = topo->cpu_count;
+	if (policy != pin_cores) {
+		// cpus is already sorted by node and core
+		for (size_t i = 0; i < n; ++i) order[i] = i;
+		return;
+	}
+	// Round-robin across nodes, taking the first sibling of every core before any second ones
+	struct pin_key *keys = calloc(n, sizeof(*keys));
+	for (size_t i = 0; i < n; ++i) {
+		const struct sys_cpu *c = &topo->cpus[i];
+		keys[i] = (struct pin_key){ .node = c->node, .cpu = i };
+		if (!i) continue;
+		const struct sys_cpu *prev = &topo->cpus[i - 1];
+		if (c->core == prev->core) {
+			keys[i].smt = keys[i - 1].smt + 1;
+			keys[i].rank = keys[i - 1].rank;
+		} else if (c->node == prev->node) {
+			keys[i].rank = keys[i - 1].rank + 1;
+		}
+	}
+	qsort(keys, n, sizeof(*keys), compare_pin_keys);
+	for (size_t i = 0; i < n; ++i) order[i] = keys[i].cpu;
+	free(keys);
+}
+
+size_t sys_default_threads(enum pin_policy policy) {
+	struct sys_topology topo = sys_get_topology();
+	const size_t threads = policy == pin_cores ? topo.core_count : topo.cpu_count;
+	sys_topology_free(&topo);
+	return threads ? threads : 1;
+}
@@ -8,7 +8,59 @@
 
 #pragma once
 
+#include <stddef.h>
+
 /// Get amount of logical processing cores on the system
-/// @remark Is unaware of NUMA nodes on high core count systems
+/// @remark Is unaware of NUMA nodes on high core count systems, see sys_get_topology()
 /// @return Amount of logical processing cores
 int sys_get_cores(void);
+
+enum sys_cpu_feature {
+	sys_sse41  = 1 << 0,
+	sys_avx2   = 1 << 1, // Along with FMA
+	sys_avx512 = 1 << 2, // F, DQ, BW and VL
+	sys_neon   = 1 << 3,
+};
+
+/// Instruction set extensions that both the CPU and the OS support, as enum sys_cpu_feature flags
+/// @remark Each x86 level is only reported if the ones below it are supported too
+unsigned sys_get_cpu_features(void);
+
+/// Space separated names of the given features, or "none"
+/// @return buf
+char *sys_cpu_features_string(unsigned features, char *buf, size_t size);
+
+struct sys_cpu {
+	int id; // OS logical CPU number, for pinning
+	int core; // Physical core, unique across packages. SMT siblings share this.
+	int package;
+	int node; // NUMA node
+};
+
+struct sys_topology {
+	struct sys_cpu *cpus;
+	size_t cpu_count;
+	size_t core_count; // Physical cores
+	size_t node_count;
+};
+
+/// Discover logical CPUs, physical cores and NUMA nodes.
+/// @remark Only Linux reports the full topology. Elsewhere every logical core
+/// shows up as a physical core on a single node.
+struct sys_topology sys_get_topology(void);
+void sys_topology_free(struct sys_topology *topo);
+
+enum pin_policy {
+	pin_none = 0,
+	pin_cores, // One thread per physical core first, spread across NUMA nodes, then SMT siblings
+	pin_compact, // Fill one NUMA node before moving on to the next, SMT siblings next to each other
+};
+
+/// Order the CPUs in topo for pinning threads with the given policy.
+/// Thread i should be pinned to topo->cpus[order[i % topo->cpu_count]].
+/// @param order Output, topo->cpu_count indices into topo->cpus
+void sys_pin_order(const struct sys_topology *topo, enum pin_policy policy, size_t *order);
+
+/// Render threads to use if the user doesn't say. Pinning to cores gets one thread per physical
+/// core, so none of them share a core with another. Otherwise SMT siblings get a thread too.
+size_t sys_default_threads(enum pin_policy policy);
@@ -6,6 +6,11 @@
 //  Copyright © 2020-2024 Valtteri Koskivuori. All rights reserved.
 //
 
+// For pthread_setaffinity_np()
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -146,3 +151,51 @@ int thread_cond_broadcast(struct cr_cond *cond) {
 	return pthread_cond_broadcast(&cond->cond);
 #endif
 }
+
+#ifdef WINDOWS
+static BOOL CALLBACK once_trampoline(PINIT_ONCE once, PVOID param, PVOID *ctx) {
+	(void)once; (void)ctx;
+	((void (*)(void))param)();
+	return TRUE;
+}
+#endif
+
+void thread_once(struct cr_once *once, void (*fn)(void)) {
+#ifdef WINDOWS
+	InitOnceExecuteOnce(&once->once, once_trampoline, (PVOID)fn, NULL);
+#else
+	pthread_once(&once->once, fn);
+#endif
+}
+
+bool thread_pin_self(int cpu) {
+	if (cpu < 0) return false;
+#ifdef WINDOWS
+	if (cpu >= (int)(sizeof(DWORD_PTR) * 8)) return false; // Processor groups not supported
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	// macOS only has affinity hints, and no way to pin to a specific core.
+	return false;
+#endif
+}
+
+bool thread_unpin_self(void) {
+#ifdef WINDOWS
+	DWORD_PTR process_mask, system_mask;
+	if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) return false;
+	return SetThreadAffinityMask(GetCurrentThread(), process_mask) != 0;
+#elif defined(__linux__)
+	// The kernel clamps this to the CPUs our cpuset allows
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
@@ -8,8 +8,9 @@
 
 #pragma once
 
+#include <stdbool.h>
+
 #ifdef WINDOWS
-	#include <stdbool.h>
 	#include <Windows.h>
 #else
 	#include <pthread.h>
@@ -42,6 +43,20 @@ struct cr_cond {
 #endif
 };
 
+struct cr_once {
+#ifdef WINDOWS
+	INIT_ONCE once;
+#else
+	pthread_once_t once;
+#endif
+};
+
+#ifdef WINDOWS
+	#define CR_ONCE_INIT { INIT_ONCE_STATIC_INIT }
+#else
+	#define CR_ONCE_INIT { PTHREAD_ONCE_INIT }
+#endif
+
 typedef struct cr_thread cr_thread;
 dyn_array_def(cr_thread)
 
@@ -68,3 +83,14 @@ int thread_cond_timed_wait(struct cr_cond *cond, struct cr_mutex *mutex, const s
 int thread_cond_signal(struct cr_cond *cond);
 
 int thread_cond_broadcast(struct cr_cond *cond);
+
+/// Run fn exactly once, however many threads call this with the same once.
+/// Callers that lose the race block until fn has returned.
+void thread_once(struct cr_once *once, void (*fn)(void));
+
+/// Pin the calling thread to the given logical CPU
+/// @return false if pinning isn't supported on this platform, or it failed
+bool thread_pin_self(int cpu);
+
+/// Let the calling thread run on any CPU again, undoing thread_pin_self()
+bool thread_unpin_self(void);
@@ -6,84 +6,292 @@
 //  Copyright © 2024 Valtteri Koskivuori. All rights reserved.
 //
 
+#include <stdint.h>
+#include <stdlib.h>
 #include "thread_pool.h"
 #include "mutex.h"
 #include "thread.h"
+#include "atomics.h"
 #include "../logging.h"
 
-// Mostly based on John Schember's excellent blog post:
-// https://nachtimwald.com/2019/04/12/thread-pool-in-c/
+// Each worker owns a fixed-size Chase-Lev deque. The owner pushes and pops at the
+// bottom without taking any locks, and idle workers steal from the top of others.
+// Tasks enqueued from outside the pool (the usual case, e.g. compute_accels()) go
+// through a mutex-protected injection queue instead, since only the owner may push
+// onto a deque. That mutex also backs the condition variables workers sleep on.
 //
-// I just added an extra pool->first check to thread_pool_wait()
-// since I discovered a race condition in my torture tests for this
-// implementation. Basically, sometimes we could blow through a
-// call to thread_pool_wait() if we enqueue a small amount of work
-// and call it before threads had a chance to fetch work.
+// See "Dynamic Circular Work-Stealing Deque", Chase & Lev, SPAA '05, and
+// "Correct and Efficient Work-Stealing for Weak Memory Models", Lê et al., PPoPP '13.
+// All of our atomics are sequentially consistent, so the fences from the latter
+// aren't needed here.
+
+#define DEQUE_SIZE 256 // Power of two
+#define TASK_CHUNK 64 // Tasks allocated at once when the free lists run dry
+#define LOCAL_FREE_MAX 256 // Tasks a worker holds on to before handing them back
+
+#ifdef WINDOWS
+	#define thread_local __declspec(thread)
+#else
+	#define thread_local __thread
+#endif
 
 struct cr_task {
 	void (*fn)(void *arg);
 	void *arg;
+	struct cr_task_group *group;
 	struct cr_task *next;
 };
 
+struct task_chunk {
+	struct task_chunk *next;
+	struct cr_task tasks[TASK_CHUNK];
+};
+
+struct deque {
+	volatile size_t top; // Thieves take from here
+	char pad[64 - sizeof(size_t)]; // Keep thieves and the owner off each other's cache line
+	volatile size_t bottom; // Owner pushes and pops here
+	volatile size_t slots[DEQUE_SIZE]; // struct cr_task pointers
+};
+
+struct pool_worker {
+	struct deque deque;
+	struct cr_thread_pool *pool;
+	struct cr_task *free_list; // Only touched by this worker, no locking needed
+	size_t free_count;
+	uint32_t rng; // For picking steal victims
+};
+
 struct cr_thread_pool {
-	struct cr_task *first;
+	struct pool_worker *workers;
+	size_t worker_count;
+
+	struct cr_mutex *mutex; // Guards the fields below, and the condition variables
+	struct cr_task *first; // Injection queue
 	struct cr_task *last;
-	struct cr_mutex *mutex;
+	struct cr_task *free_list;
+	struct task_chunk *chunks;
 	struct cr_cond work_available;
-	struct cr_cond work_ongoing;
-	size_t active_threads;
-	struct cr_thread *threads;
+	struct cr_cond work_done;
 	size_t alive_threads;
 	bool stop_flag;
+
+	volatile size_t injected; // Tasks in the injection queue
+	volatile size_t queued; // Tasks in any queue, not yet picked up by a worker
+	volatile size_t pending; // Tasks enqueued, but not finished yet
+	volatile size_t sleeping; // Workers about to wait, or waiting on work_available
 };
 
-static struct cr_task *task_create(void (*fn)(void *arg), void *arg) {
-	if (!fn) return NULL;
-	struct cr_task *task = malloc(sizeof(*task));
-	*task = (struct cr_task){
-		.fn = fn,
-		.arg = arg,
-		.next = NULL
-	};
+// The worker running on this thread, if any
+static thread_local struct pool_worker *tls_worker = NULL;
+
+static struct pool_worker *current_worker(struct cr_thread_pool *pool) {
+	return tls_worker && tls_worker->pool == pool ? tls_worker : NULL;
+}
+
+// Owner only. Returns false if the deque is full.
+static bool deque_push(struct deque *d, struct cr_task *task) {
+	const size_t b = atomic_load_size(&d->bottom);
+	const size_t t = atomic_load_size(&d->top);
+	if (b - t >= DEQUE_SIZE) return false;
+	atomic_store_size(&d->slots[b & (DEQUE_SIZE - 1)], (size_t)(uintptr_t)task);
+	atomic_store_size(&d->bottom, b + 1);
+	return true;
+}
+
+// Owner only, LIFO so recently pushed subtasks run while their data is still in cache
+static struct cr_task *deque_pop(struct deque *d) {
+	const size_t b = atomic_load_size(&d->bottom) - 1;
+	atomic_store_size(&d->bottom, b);
+	const size_t t = atomic_load_size(&d->top);
+	if ((ptrdiff_t)(b - t) < 0) {
+		atomic_store_size(&d->bottom, b + 1);
+		return NULL;
+	}
+	struct cr_task *task = (struct cr_task *)(uintptr_t)atomic_load_size(&d->slots[b & (DEQUE_SIZE - 1)]);
+	if (b == t) {
+		// Last one, race thieves for it
+		if (!atomic_cas_size(&d->top, t, t + 1)) task = NULL;
+		atomic_store_size(&d->bottom, b + 1);
+	}
 	return task;
 }
 
-static struct cr_task *thread_pool_get_task(struct cr_thread_pool *pool) {
-	if (!pool) return NULL;
-	struct cr_task *task = pool->first;
-	if (!task) return NULL;
-	if (!task->next) {
-		pool->first = NULL;
-		pool->last = NULL;
+// Any thread, FIFO
+static struct cr_task *deque_steal(struct deque *d) {
+	const size_t t = atomic_load_size(&d->top);
+	const size_t b = atomic_load_size(&d->bottom);
+	if ((ptrdiff_t)(b - t) <= 0) return NULL;
+	struct cr_task *task = (struct cr_task *)(uintptr_t)atomic_load_size(&d->slots[t & (DEQUE_SIZE - 1)]);
+	// If this fails, the owner or another thief got there first, and task may be stale.
+	return atomic_cas_size(&d->top, t, t + 1) ? task : NULL;
+}
+
+// Call with pool->mutex held
+static struct cr_task *task_alloc_locked(struct cr_thread_pool *pool) {
+	if (!pool->free_list) {
+		struct task_chunk *chunk = malloc(sizeof(*chunk));
+		chunk->next = pool->chunks;
+		pool->chunks = chunk;
+		for (size_t i = 0; i < TASK_CHUNK; ++i) {
+			chunk->tasks[i].next = i + 1 < TASK_CHUNK ? &chunk->tasks[i + 1] : NULL;
+		}
+		pool->free_list = &chunk->tasks[0];
+	}
+	struct cr_task *task = pool->free_list;
+	pool->free_list = task->next;
+	return task;
+}
+
+static void task_free(struct cr_thread_pool *pool, struct pool_worker *self, struct cr_task *task) {
+	if (self) {
+		task->next = self->free_list;
+		self->free_list = task;
+		if (++self->free_count < LOCAL_FREE_MAX) return;
+		// This worker mostly runs tasks others enqueued, give them back in one go.
+		struct cr_task *tail = task;
+		while (tail->next) tail = tail->next;
+		mutex_lock(pool->mutex);
+		tail->next = pool->free_list;
+		pool->free_list = self->free_list;
+		mutex_release(pool->mutex);
+		self->free_list = NULL;
+		self->free_count = 0;
+		return;
+	}
+	mutex_lock(pool->mutex);
+	task->next = pool->free_list;
+	pool->free_list = task;
+	mutex_release(pool->mutex);
+}
+
+static void wake_one(struct cr_thread_pool *pool) {
+	// Workers bump sleeping before their final check of queued, and we bump queued before
+	// checking sleeping. With sequentially consistent atomics, one of us sees the other.
+	if (!atomic_load_size(&pool->sleeping)) return;
+	mutex_lock(pool->mutex);
+	thread_cond_signal(&pool->work_available);
+	mutex_release(pool->mutex);
+}
+
+static bool enqueue(struct cr_thread_pool *pool, struct cr_task_group *group, void (*fn)(void *arg), void *arg) {
+	if (!pool || !fn) return false;
+	if (group) atomic_add_size(&group->pending, 1);
+	atomic_add_size(&pool->pending, 1);
+	struct pool_worker *self = current_worker(pool);
+	struct cr_task *task = NULL;
+	if (self && self->free_list) {
+		task = self->free_list;
+		self->free_list = task->next;
+		self->free_count--;
+	}
+	if (self) {
+		if (!task) {
+			mutex_lock(pool->mutex);
+			task = task_alloc_locked(pool);
+			mutex_release(pool->mutex);
+		}
+		*task = (struct cr_task){ .fn = fn, .arg = arg, .group = group };
+		if (deque_push(&self->deque, task)) {
+			atomic_add_size(&pool->queued, 1);
+			wake_one(pool);
+			return true;
+		}
+	}
+	// Not a worker of this pool, or our deque is full
+	mutex_lock(pool->mutex);
+	if (!task) task = task_alloc_locked(pool);
+	*task = (struct cr_task){ .fn = fn, .arg = arg, .group = group };
+	if (pool->last) {
+		pool->last->next = task;
 	} else {
+		pool->first = task;
+	}
+	pool->last = task;
+	atomic_add_size(&pool->injected, 1);
+	atomic_add_size(&pool->queued, 1);
+	if (atomic_load_size(&pool->sleeping)) thread_cond_signal(&pool->work_available);
+	mutex_release(pool->mutex);
+	return true;
+}
+
+static struct cr_task *take_injected(struct cr_thread_pool *pool) {
+	if (!atomic_load_size(&pool->injected)) return NULL;
+	mutex_lock(pool->mutex);
+	struct cr_task *task = pool->first;
+	if (task) {
 		pool->first = task->next;
+		if (!pool->first) pool->last = NULL;
+		atomic_add_size(&pool->injected, (size_t)-1);
 	}
+	mutex_release(pool->mutex);
 	return task;
 }
 
-static void *cr_worker(void *arg) {
-	struct cr_thread_pool *pool = arg;
-	while (true) {
+static struct cr_task *find_task(struct cr_thread_pool *pool, struct pool_worker *self) {
+	struct cr_task *task = deque_pop(&self->deque);
+	if (!task) task = take_injected(pool);
+	if (!task && pool->worker_count > 1) {
+		// xorshift, just to spread thieves out
+		self->rng ^= self->rng << 13;
+		self->rng ^= self->rng >> 17;
+		self->rng ^= self->rng << 5;
+		const size_t start = self->rng % pool->worker_count;
+		for (size_t i = 0; i < pool->worker_count && !task; ++i) {
+			struct pool_worker *victim = &pool->workers[(start + i) % pool->worker_count];
+			if (victim != self) task = deque_steal(&victim->deque);
+		}
+	}
+	if (task) atomic_add_size(&pool->queued, (size_t)-1);
+	return task;
+}
+
+static void run_task(struct cr_thread_pool *pool, struct pool_worker *self, struct cr_task *task) {
+	struct cr_task_group *group = task->group;
+	task->fn(task->arg);
+	task_free(pool, self, task);
+	const bool group_done = group && atomic_add_size(&group->pending, (size_t)-1) == 1;
+	const bool pool_done = atomic_add_size(&pool->pending, (size_t)-1) == 1;
+	if (group_done || pool_done) {
 		mutex_lock(pool->mutex);
-		while (!pool->first && !pool->stop_flag)
-			thread_cond_wait(&pool->work_available, pool->mutex);
-		if (pool->stop_flag) break;
-		struct cr_task *task = thread_pool_get_task(pool);
-		pool->active_threads++;
+		thread_cond_broadcast(&pool->work_done);
+		// Workers helping out in thread_pool_wait_group() sleep on this one
+		if (group_done) thread_cond_broadcast(&pool->work_available);
+		mutex_release(pool->mutex);
+	}
+}
+
+// Sleep until there is work, or until group (if any) finishes. Returns false if the pool is stopping.
+static bool idle(struct cr_thread_pool *pool, struct cr_task_group *group) {
+	mutex_lock(pool->mutex);
+	if (pool->stop_flag) {
 		mutex_release(pool->mutex);
+		return false;
+	}
+	atomic_add_size(&pool->sleeping, 1);
+	if (!atomic_load_size(&pool->queued) && (!group || atomic_load_size(&group->pending)))
+		thread_cond_wait(&pool->work_available, pool->mutex);
+	atomic_add_size(&pool->sleeping, (size_t)-1);
+	mutex_release(pool->mutex);
+	return true;
+}
+
+static void *cr_worker(void *arg) {
+	struct pool_worker *self = arg;
+	struct cr_thread_pool *pool = self->pool;
+	tls_worker = self;
+	while (true) {
+		struct cr_task *task = find_task(pool, self);
 		if (task) {
-			task->fn(task->arg);
-			free(task);
+			run_task(pool, self, task);
+		} else if (!idle(pool, NULL)) {
+			break;
 		}
-		mutex_lock(pool->mutex);
-		pool->active_threads--;
-		if (!pool->stop_flag && pool->active_threads == 0 && !pool->first)
-			thread_cond_signal(&pool->work_ongoing);
-		mutex_release(pool->mutex);
 	}
+	tls_worker = NULL;
+	mutex_lock(pool->mutex);
 	pool->alive_threads--;
-	thread_cond_signal(&pool->work_ongoing);
+	thread_cond_broadcast(&pool->work_done);
 	mutex_release(pool->mutex);
 	return NULL;
 }
@@ -92,76 +300,88 @@ struct cr_thread_pool *thread_pool_create(size_t threads) {
 	if (!threads) threads = 2;
 	struct cr_thread_pool *pool = calloc(1, sizeof(*pool));
 	logr(debug, "Spawning thread pool (%lut, %p)\n", threads, (void *)pool);
+	pool->worker_count = threads;
 	pool->alive_threads = threads;
-	pool->threads = calloc(pool->alive_threads, sizeof(*pool->threads));
+	pool->workers = calloc(threads, sizeof(*pool->workers));
 
 	pool->mutex = mutex_create();
 	thread_cond_init(&pool->work_available);
-	thread_cond_init(&pool->work_ongoing);
+	thread_cond_init(&pool->work_done);
 
-	for (size_t i = 0; i < pool->alive_threads; ++i) {
-		pool->threads[i] = (struct cr_thread){
+	for (size_t i = 0; i < threads; ++i) {
+		pool->workers[i].pool = pool;
+		pool->workers[i].rng = (uint32_t)i * 0x9e3779b9 + 1;
+		struct cr_thread thread = {
 			.thread_fn = cr_worker,
-			.user_data = pool
+			.user_data = &pool->workers[i]
 		};
-		thread_create_detach(&pool->threads[i]);
+		thread_create_detach(&thread);
 	}
 	return pool;
 }
 
 void thread_pool_destroy(struct cr_thread_pool *pool) {
 	if (!pool) return;
-	logr(debug, "Closing thread pool (%lut, %p)\n", pool->alive_threads, (void *)pool);
+	logr(debug, "Closing thread pool (%lut, %p)\n", pool->worker_count, (void *)pool);
+	// Tell the workers to stop. They finish whatever is still queued first.
 	mutex_lock(pool->mutex);
-	// Clear work queue
-	struct cr_task *head = pool->first;
-	struct cr_task *next = NULL;
-	while (head) {
-		next = head->next;
-		free(head);
-		head = next;
-	}
-	// Tell the workers to stop
 	pool->stop_flag = true;
 	thread_cond_broadcast(&pool->work_available);
+	// And wait for them to actually stop
+	while (pool->alive_threads)
+		thread_cond_wait(&pool->work_done, pool->mutex);
 	mutex_release(pool->mutex);
 
-	// Wait for them to actually stop
-	thread_pool_wait(pool);
-
 	mutex_destroy(pool->mutex);
 	thread_cond_destroy(&pool->work_available);
-	thread_cond_destroy(&pool->work_ongoing);
-	free(pool->threads);
+	thread_cond_destroy(&pool->work_done);
+	// Every task lives in one of these, wherever it ended up
+	while (pool->chunks) {
+		struct task_chunk *next = pool->chunks->next;
+		free(pool->chunks);
+		pool->chunks = next;
+	}
+	free(pool->workers);
 	free(pool);
 }
 
+size_t thread_pool_size(const struct cr_thread_pool *pool) {
+	return pool ? pool->worker_count : 0;
+}
+
 bool thread_pool_enqueue(struct cr_thread_pool *pool, void (*fn)(void *arg), void *arg) {
-	if (!pool) return false;
-	struct cr_task *task = task_create(fn, arg);
-	if (!task) return false;
-	mutex_lock(pool->mutex);
-	if (!pool->first) {
-		pool->first = task;
-		pool->last = pool->first;
-	} else {
-		pool->last->next = task;
-		pool->last = task;
-	}
-	thread_cond_broadcast(&pool->work_available);
-	mutex_release(pool->mutex);
-	return true;
+	return enqueue(pool, NULL, fn, arg);
+}
+
+bool thread_pool_enqueue_group(struct cr_thread_pool *pool, struct cr_task_group *group, void (*fn)(void *arg), void *arg) {
+	return enqueue(pool, group, fn, arg);
 }
 
 void thread_pool_wait(struct cr_thread_pool *pool) {
 	if (!pool) return;
 	mutex_lock(pool->mutex);
-	while (true) {
-		if (pool->first || (!pool->stop_flag && pool->active_threads != 0) || (pool->stop_flag && pool->alive_threads != 0)) {
-			thread_cond_wait(&pool->work_ongoing, pool->mutex);
-		} else {
-			break;
+	while (atomic_load_size(&pool->pending))
+		thread_cond_wait(&pool->work_done, pool->mutex);
+	mutex_release(pool->mutex);
+}
+
+void thread_pool_wait_group(struct cr_thread_pool *pool, struct cr_task_group *group) {
+	if (!pool || !group) return;
+	struct pool_worker *self = current_worker(pool);
+	if (self) {
+		// Help out instead of blocking a pool thread
+		while (atomic_load_size(&group->pending)) {
+			struct cr_task *task = find_task(pool, self);
+			if (task) {
+				run_task(pool, self, task);
+			} else if (!idle(pool, group)) {
+				break;
+			}
 		}
+		return;
 	}
+	mutex_lock(pool->mutex);
+	while (atomic_load_size(&group->pending))
+		thread_cond_wait(&pool->work_done, pool->mutex);
 	mutex_release(pool->mutex);
 }
@@ -6,13 +6,35 @@
 //  Copyright © 2024 Valtteri Koskivuori. All rights reserved.
 //
 
+#pragma once
+
 #include <stddef.h>
 #include <stdbool.h>
 
 struct cr_thread_pool;
 
+/// A set of tasks that can be waited on separately from the rest of the pool.
+/// Zero-initialize before use, and don't let it go out of scope before waiting on it.
+struct cr_task_group {
+	volatile size_t pending;
+};
+
 struct cr_thread_pool *thread_pool_create(size_t threads);
 void thread_pool_destroy(struct cr_thread_pool *pool);
 
+size_t thread_pool_size(const struct cr_thread_pool *pool);
+
+/// Run fn(arg) on a pool thread. Tasks enqueued from within a task go onto the calling
+/// worker's own queue, and are stolen by other workers when they run out of work.
 bool thread_pool_enqueue(struct cr_thread_pool *pool, void (*fn)(void *arg), void *arg);
+
+/// Wait for every task in the pool to finish.
+/// @remarks Don't call this from within a task, that would wait on itself. Use a group instead.
 void thread_pool_wait(struct cr_thread_pool *pool);
+
+/// Like thread_pool_enqueue(), but the task is also tracked by group
+bool thread_pool_enqueue_group(struct cr_thread_pool *pool, struct cr_task_group *group, void (*fn)(void *arg), void *arg);
+
+/// Wait for every task in group to finish. If called from a pool thread, that thread
+/// runs other queued tasks while it waits, so nested groups don't deadlock the pool.
+void thread_pool_wait_group(struct cr_thread_pool *pool, struct cr_task_group *group);
@@ -0,0 +1,234 @@
+//
+//  simd.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#pragma once
+
+// Four floats at a time, with SSE on x86, NEON on ARM, and plain C everywhere else.
+// Comparisons give an m32x4 mask, with a lane for each float.
+// Building with CRAY_NO_SIMD defined forces the plain C version.
+// Loads and stores don't need to be aligned.
+
+#if !defined(CRAY_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define CRAY_SIMD_SSE
+#include <emmintrin.h>
+typedef __m128 f32x4;
+typedef __m128 m32x4;
+#elif !defined(CRAY_NO_SIMD) && (defined(__ARM_NEON) || defined(_M_ARM64))
+#define CRAY_SIMD_NEON
+#include <arm_neon.h>
+#include <math.h>
+typedef float32x4_t f32x4;
+typedef uint32x4_t m32x4;
+#else
+#include <stdbool.h>
+#include <math.h>
+typedef struct { float v[4]; } f32x4;
+typedef struct { bool v[4]; } m32x4;
+#endif
+
+// With GCC and Clang, hot kernels can also be compiled for AVX2 and picked at runtime,
+// based on sys_get_cpu_features(). Not needed if the whole build targets AVX2 already.
+#if defined(CRAY_SIMD_SSE) && defined(__GNUC__) && !defined(__AVX2__)
+// These have to give the same results as the generic versions, so FMA mustn't fuse multiplies
+// and adds. GCC fuses by default in GNU C modes, Clang ignores this and needs a pragma instead.
+#define CRAY_DISPATCH_AVX2
+#ifdef __clang__
+#define CRAY_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define CRAY_TARGET_AVX2 __attribute__((target("avx2,fma"), optimize("fp-contract=off")))
+#endif
+#endif
+
+#if defined(CRAY_SIMD_SSE)
+#define CRAY_SIMD_NAME "SSE2"
+#elif defined(CRAY_SIMD_NEON)
+#define CRAY_SIMD_NAME "NEON"
+#else
+#define CRAY_SIMD_NAME "none"
+#endif
+
+static inline f32x4 f32x4_load(const float *p) {
+#if defined(CRAY_SIMD_SSE)
+	return _mm_loadu_ps(p);
+#elif defined(CRAY_SIMD_NEON)
+	return vld1q_f32(p);
+#else
+	return (f32x4){ { p[0], p[1], p[2], p[3] } };
+#endif
+}
+
+static inline f32x4 f32x4_set(float a, float b, float c, float d) {
+#if defined(CRAY_SIMD_SSE)
+	return _mm_setr_ps(a, b, c, d);
+#elif defined(CRAY_SIMD_NEON)
+	const float v[4] = { a, b, c, d };
+	return vld1q_f32(v);
+#else
+	return (f32x4){ { a, b, c, d } };
+#endif
+}
+
+static inline void f32x4_store(float *p, f32x4 a) {
+#if defined(CRAY_SIMD_SSE)
+	_mm_storeu_ps(p, a);
+#elif defined(CRAY_SIMD_NEON)
+	vst1q_f32(p, a);
+#else
+	for (int i = 0; i < 4; ++i) p[i] = a.v[i];
+#endif
+}
+
+static inline f32x4 f32x4_set1(float f) {
+#if defined(CRAY_SIMD_SSE)
+	return _mm_set1_ps(f);
+#elif defined(CRAY_SIMD_NEON)
+	return vdupq_n_f32(f);
+#else
+	return (f32x4){ { f, f, f, f } };
+#endif
+}
+
+static inline f32x4 f32x4_add(f32x4 a, f32x4 b) {
+#if defined(CRAY_SIMD_SSE)
+	return _mm_add_ps(a, b);
+#elif defined(CRAY_SIMD_NEON)
+	return vaddq_f32(a, b);
+#else
+	return (f32x4){ { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } };
+#endif
+}
+
+static inline f32x4 f32x4_sub(f32x4 a, f32x4 b) {
+#if defined(CRAY_SIMD_SSE)
+	return _mm_sub_ps(a, b);
+#elif defined(CRAY_SIMD_NEON)
+	return vsubq_f32(a, b);
+#else
+	return (f32x4){ { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } };
+#endif
+}
+
+static inline f32x4 f32x4_mul(f32x4 a, f32x4 b) {
+#if defined(CRAY_SIMD_SSE)
+	return _mm_mul_ps(a, b);
+#elif defined(CRAY_SIMD_NEON)
+	return vmulq_f32(a, b);
+#else
+	return (f32x4){ { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } };
+#endif
+}
+
+// Like the max() macro, b is picked if either one is NaN
+static inline f32x4 f32x4_max(f32x4 a, f32x4 b) {
+#if defined(CRAY_SIMD_SSE)
+	return _mm_max_ps(a, b);
+#elif defined(CRAY_SIMD_NEON)
+	return vbslq_f32(vcgtq_f32(a, b), a, b);
+#else
+	f32x4 r;
+	for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+	return r;
+#endif
+}
+
+static inline f32x4 f32x4_div(f32x4 a, f32x4 b) {
+#if defined(CRAY_SIMD_SSE)
+	return _mm_div_ps(a, b);
+#elif defined(CRAY_SIMD_NEON) && defined(__aarch64__)
+	return vdivq_f32(a, b);
+#elif defined(CRAY_SIMD_NEON)
+	// 32-bit ARM has no vector divide
+	float x[4], y[4];
+	vst1q_f32(x, a);
+	vst1q_f32(y, b);
+	for (int i = 0; i < 4; ++i) x[i] /= y[i];
+	return vld1q_f32(x);
+#else
+	return (f32x4){ { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] } };
+#endif
+}
+
+static inline f32x4 f32x4_sqrt(f32x4 a) {
+#if defined(CRAY_SIMD_SSE)
+	return _mm_sqrt_ps(a);
+#elif defined(CRAY_SIMD_NEON) && defined(__aarch64__)
+	return vsqrtq_f32(a);
+#elif defined(CRAY_SIMD_NEON)
+	float x[4];
+	vst1q_f32(x, a);
+	for (int i = 0; i < 4; ++i) x[i] = sqrtf(x[i]);
+	return vld1q_f32(x);
+#else
+	return (f32x4){ { sqrtf(a.v[0]), sqrtf(a.v[1]), sqrtf(a.v[2]), sqrtf(a.v[3]) } };
+#endif
+}
+
+// Comparisons are false for NaN lanes
+static inline m32x4 f32x4_lt(f32x4 a, f32x4 b) {
+#if defined(CRAY_SIMD_SSE)
+	return _mm_cmplt_ps(a, b);
+#elif defined(CRAY_SIMD_NEON)
+	return vcltq_f32(a, b);
+#else
+	return (m32x4){ { a.v[0] < b.v[0], a.v[1] < b.v[1], a.v[2] < b.v[2], a.v[3] < b.v[3] } };
+#endif
+}
+
+static inline m32x4 f32x4_le(f32x4 a, f32x4 b) {
+#if defined(CRAY_SIMD_SSE)
+	return _mm_cmple_ps(a, b);
+#elif defined(CRAY_SIMD_NEON)
+	return vcleq_f32(a, b);
+#else
+	return (m32x4){ { a.v[0] <= b.v[0], a.v[1] <= b.v[1], a.v[2] <= b.v[2], a.v[3] <= b.v[3] } };
+#endif
+}
+
+static inline m32x4 f32x4_ge(f32x4 a, f32x4 b) {
+#if defined(CRAY_SIMD_SSE)
+	return _mm_cmpge_ps(a, b);
+#elif defined(CRAY_SIMD_NEON)
+	return vcgeq_f32(a, b);
+#else
+	return (m32x4){ { a.v[0] >= b.v[0], a.v[1] >= b.v[1], a.v[2] >= b.v[2], a.v[3] >= b.v[3] } };
+#endif
+}
+
+static inline m32x4 m32x4_and(m32x4 a, m32x4 b) {
+#if defined(CRAY_SIMD_SSE)
+	return _mm_and_ps(a, b);
+#elif defined(CRAY_SIMD_NEON)
+	return vandq_u32(a, b);
+#else
+	return (m32x4){ { a.v[0] && b.v[0], a.v[1] && b.v[1], a.v[2] && b.v[2], a.v[3] && b.v[3] } };
+#endif
+}
+
+/// Lanes of a where m is set, b elsewhere
+static inline f32x4 f32x4_select(m32x4 m, f32x4 a, f32x4 b) {
+#if defined(CRAY_SIMD_SSE)
+	return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+#elif defined(CRAY_SIMD_NEON)
+	return vbslq_f32(m, a, b);
+#else
+	f32x4 r;
+	for (int i = 0; i < 4; ++i) r.v[i] = m.v[i] ? a.v[i] : b.v[i];
+	return r;
+#endif
+}
+
+/// Lane i of the mask as bit i of the result
+static inline unsigned m32x4_bits(m32x4 m) {
+#if defined(CRAY_SIMD_SSE)
+	return (unsigned)_mm_movemask_ps(m);
+#elif defined(CRAY_SIMD_NEON)
+	return (vgetq_lane_u32(m, 0) & 1) | (vgetq_lane_u32(m, 1) & 2) | (vgetq_lane_u32(m, 2) & 4) | (vgetq_lane_u32(m, 3) & 8);
+#else
+	return (unsigned)m.v[0] | (unsigned)m.v[1] << 1 | (unsigned)m.v[2] << 2 | (unsigned)m.v[3] << 3;
+#endif
+}
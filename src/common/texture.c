@@ -16,6 +16,14 @@
 //General-purpose setPixel function
 void setPixel(struct texture *t, struct color c, size_t x, size_t y) {
 	ASSERT(x < t->width); ASSERT(y < t->height);
+	if (t->channels == 1) {
+		if (t->precision == char_p) {
+			t->data.byte_p[x + (t->height - (y + 1)) * t->width] = (unsigned char)min(c.red * 255.0f, 255.0f);
+		} else if (t->precision == float_p) {
+			t->data.float_p[x + (t->height - (y + 1)) * t->width] = c.red;
+		}
+		return;
+	}
 	if (t->precision == char_p) {
 		t->data.byte_p[(x + (t->height - (y + 1)) * t->width) * t->channels + 0] = (unsigned char)min(c.red * 255.0f, 255.0f);
 		t->data.byte_p[(x + (t->height - (y + 1)) * t->width) * t->channels + 1] = (unsigned char)min(c.green * 255.0f, 255.0f);
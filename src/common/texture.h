@@ -36,9 +36,12 @@ struct texture {
 	size_t height;
 };
 
+struct tiled_texture;
+
 struct texture_asset {
 	char *path;
 	struct texture *t;
+	struct tiled_texture *tiled; // Built in render prep, see scene_build_textures()
 };
 
 typedef struct texture_asset texture_asset;
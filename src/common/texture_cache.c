@@ -0,0 +1,231 @@
+//
+//  texture_cache.c
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "../includes.h"
+
+#include "texture_cache.h"
+#include "tiled_texture.h"
+#include "logging.h"
+#include "platform/atomics.h"
+#include "platform/mutex.h"
+#include "platform/thread.h"
+
+#ifdef WINDOWS
+	#define thread_local __declspec(thread)
+#else
+	#define thread_local __thread
+#endif
+
+#define THREAD_SLOTS 16 // Power of two
+
+struct texture_cache_entry {
+	const struct tiled_texture *t;
+	size_t level;
+	struct tiled_level data; // data is NULL if the level couldn't be built
+	size_t bytes;
+	size_t pins; // Threads that have this in their slots
+	bool loading;
+	struct texture_cache_entry *prev; // More recently used
+	struct texture_cache_entry *next; // Less recently used
+};
+
+struct texture_cache {
+	struct cr_mutex *lock;
+	struct cr_cond loaded;
+	size_t id;
+	struct texture_cache_entry *head; // Most recently used
+	struct texture_cache_entry *tail;
+	struct texture_cache_stats stats;
+};
+
+struct thread_slot {
+	const struct tiled_texture *t;
+	size_t level;
+	struct texture_cache_entry *entry;
+};
+
+struct thread_cache {
+	size_t cache_id; // Slots belong to this cache, 0 = none
+	struct thread_slot slots[THREAD_SLOTS];
+	uint64_t hits;
+};
+
+static thread_local struct thread_cache tls_cache = { 0 };
+
+// Ids tell thread-local slots apart from ones left over from a cache that's gone
+static size_t next_cache_id = 1;
+
+struct texture_cache *texture_cache_new(size_t budget_bytes) {
+	struct texture_cache *cache = calloc(1, sizeof(*cache));
+	cache->lock = mutex_create();
+	thread_cond_init(&cache->loaded);
+	cache->id = atomic_add_size(&next_cache_id, 1);
+	cache->stats.budget_bytes = budget_bytes;
+	return cache;
+}
+
+static void lru_unlink(struct texture_cache *cache, struct texture_cache_entry *e) {
+	if (e->prev) e->prev->next = e->next; else cache->head = e->next;
+	if (e->next) e->next->prev = e->prev; else cache->tail = e->prev;
+	e->prev = e->next = NULL;
+}
+
+static void lru_push_front(struct texture_cache *cache, struct texture_cache_entry *e) {
+	e->prev = NULL;
+	e->next = cache->head;
+	if (cache->head) cache->head->prev = e;
+	cache->head = e;
+	if (!cache->tail) cache->tail = e;
+}
+
+static void lru_push_back(struct texture_cache *cache, struct texture_cache_entry *e) {
+	e->next = NULL;
+	e->prev = cache->tail;
+	if (cache->tail) cache->tail->next = e;
+	cache->tail = e;
+	if (!cache->head) cache->head = e;
+}
+
+static void entry_free(struct texture_cache_entry *e) {
+	free(e->data.data.rgba8);
+	free(e);
+}
+
+// Walk up from the least recently used end, skipping levels threads still have pinned
+static void evict(struct texture_cache *cache) {
+	struct texture_cache_entry *e = cache->tail;
+	while (e && cache->stats.used_bytes > cache->stats.budget_bytes) {
+		struct texture_cache_entry *prev = e->prev;
+		if (!e->pins) {
+			lru_unlink(cache, e);
+			((struct tiled_texture *)e->t)->cached[e->level] = NULL;
+			cache->stats.used_bytes -= e->bytes;
+			cache->stats.evictions++;
+			entry_free(e);
+		}
+		e = prev;
+	}
+}
+
+static void unpin(struct texture_cache_entry *e) {
+	if (e) e->pins--;
+}
+
+// Find or build the level, and pin it for the calling thread
+static struct texture_cache_entry *acquire(struct texture_cache *cache, const struct tiled_texture *t, size_t level, struct texture_cache_entry *release) {
+	mutex_lock(cache->lock);
+	unpin(release);
+	struct texture_cache_entry *e = t->cached[level];
+	if (e) {
+		e->pins++;
+		while (e->loading) thread_cond_wait(&cache->loaded, cache->lock);
+		lru_unlink(cache, e);
+		lru_push_front(cache, e);
+		cache->stats.hits++;
+		mutex_release(cache->lock);
+		return e;
+	}
+
+	// A miss costs a full decode of the source, so build every level that isn't resident from it.
+	// Claiming all of them before letting go of the lock means only one thread decodes t at a time,
+	// the others wait for us on whichever level they wanted.
+	struct texture_cache_entry *claimed[TILED_MAX_LEVELS] = { 0 };
+	size_t count = 0;
+	for (size_t i = 0; i < t->level_count; ++i) {
+		if (t->cached[i]) continue;
+		claimed[i] = calloc(1, sizeof(*claimed[i]));
+		claimed[i]->t = t;
+		claimed[i]->level = i;
+		claimed[i]->loading = true;
+		((struct tiled_texture *)t)->cached[i] = claimed[i];
+		count = i + 1;
+	}
+	e = claimed[level];
+	e->pins = 1;
+	cache->stats.misses++;
+	mutex_release(cache->lock);
+
+	// Levels finer than the coarsest one we need are built either way, to filter it down
+	struct tiled_level data[TILED_MAX_LEVELS];
+	const bool loaded = tiled_texture_load_levels(t, count, data);
+
+	mutex_lock(cache->lock);
+	for (size_t i = 0; i < count; ++i) {
+		if (!claimed[i]) {
+			if (loaded) free(data[i].data.rgba8);
+			continue;
+		}
+		if (loaded) {
+			claimed[i]->data = data[i];
+			claimed[i]->bytes = tiled_level_bytes(t, i);
+		}
+		claimed[i]->loading = false;
+		cache->stats.used_bytes += claimed[i]->bytes;
+	}
+	// Nobody asked for the other levels yet, so they're the first to go if they don't fit
+	lru_push_front(cache, e);
+	for (size_t d = 1; d < count; ++d) {
+		if (level >= d && claimed[level - d]) lru_push_back(cache, claimed[level - d]);
+		if (level + d < count && claimed[level + d]) lru_push_back(cache, claimed[level + d]);
+	}
+	cache->stats.peak_bytes = max(cache->stats.peak_bytes, cache->stats.used_bytes);
+	evict(cache);
+	thread_cond_broadcast(&cache->loaded);
+	mutex_release(cache->lock);
+	return e;
+}
+
+const struct tiled_level *texture_cache_level(struct texture_cache *cache, const struct tiled_texture *t, size_t level) {
+	struct thread_cache *tls = &tls_cache;
+	// Whatever was in the slots belonged to some other cache, which may be gone by now
+	if (tls->cache_id != cache->id) *tls = (struct thread_cache){ .cache_id = cache->id };
+	// Consecutive levels of a texture map to different slots, so trilinear fetches don't thrash
+	struct thread_slot *slot = &tls->slots[(((uintptr_t)t >> 4) + level) & (THREAD_SLOTS - 1)];
+	if (slot->t == t && slot->level == level) {
+		tls->hits++;
+	} else {
+		slot->entry = acquire(cache, t, level, slot->entry);
+		slot->t = t;
+		slot->level = level;
+	}
+	return slot->entry->data.data.rgba8 ? &slot->entry->data : NULL;
+}
+
+void texture_cache_thread_flush(struct texture_cache *cache) {
+	if (!cache) return;
+	struct thread_cache *tls = &tls_cache;
+	if (tls->cache_id == cache->id) {
+		mutex_lock(cache->lock);
+		for (size_t i = 0; i < THREAD_SLOTS; ++i) unpin(tls->slots[i].entry);
+		cache->stats.hits += tls->hits;
+		evict(cache);
+		mutex_release(cache->lock);
+	}
+	*tls = (struct thread_cache){ 0 };
+}
+
+struct texture_cache_stats texture_cache_stats(struct texture_cache *cache) {
+	mutex_lock(cache->lock);
+	const struct texture_cache_stats stats = cache->stats;
+	mutex_release(cache->lock);
+	return stats;
+}
+
+void texture_cache_destroy(struct texture_cache *cache) {
+	if (!cache) return;
+	struct texture_cache_entry *e = cache->head;
+	while (e) {
+		struct texture_cache_entry *next = e->next;
+		// Textures may already be gone, so don't touch e->t
+		entry_free(e);
+		e = next;
+	}
+	thread_cond_destroy(&cache->loaded);
+	mutex_destroy(cache->lock);
+	free(cache);
+}
@@ -0,0 +1,46 @@
+//
+//  texture_cache.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bounded memory for tiled texture levels. Levels are built on first access, and the least
+// recently used ones are evicted once the cache goes over budget.
+// A miss decodes the whole source, so every level that isn't resident is built from that one
+// decode. The ones that weren't asked for are least recently used, and go first if they don't fit.
+// Each thread keeps the levels it looked up last pinned in a small table of its own, so repeat
+// lookups don't touch the shared cache at all. Pinned levels are never evicted, which means
+// the cache can go over budget by up to that many levels per thread.
+
+struct tiled_texture;
+struct tiled_level;
+
+struct texture_cache_stats {
+	uint64_t hits;
+	uint64_t misses; // Times a texture had to be decoded
+	uint64_t evictions;
+	size_t used_bytes;
+	size_t peak_bytes;
+	size_t budget_bytes;
+};
+
+struct texture_cache *texture_cache_new(size_t budget_bytes);
+void texture_cache_destroy(struct texture_cache *cache);
+
+/// Get a level of t, building it if it's not resident.
+/// The level stays valid on this thread until it looks up a few other levels, or calls texture_cache_thread_flush().
+/// @return NULL if the level couldn't be built
+const struct tiled_level *texture_cache_level(struct texture_cache *cache, const struct tiled_texture *t, size_t level);
+
+/// Release the levels this thread has pinned, and fold its statistics into the cache.
+/// Render threads call this between tiles, and when they're done.
+void texture_cache_thread_flush(struct texture_cache *cache);
+
+struct texture_cache_stats texture_cache_stats(struct texture_cache *cache);
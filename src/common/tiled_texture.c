@@ -0,0 +1,511 @@
+//
+//  tiled_texture.c
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+// The AVX2 fetchers must round like the generic ones, see CRAY_TARGET_AVX2.
+// This has to come first, so it covers the inline helpers from headers too.
+#ifdef __clang__
+#pragma clang fp contract(off)
+#endif
+
+#include "../includes.h"
+
+#include "tiled_texture.h"
+#include "texture.h"
+#include "fileio.h"
+#include "logging.h"
+#include "assert.h"
+#include "platform/thread.h"
+#include "platform/thread_pool.h"
+#include "platform/capabilities.h"
+#include "texture_cache.h"
+#include "string.h"
+#include "loaders/textureloader.h"
+
+// Bits of a 3 bit coordinate spread out to every other bit
+static const uint8_t morton_spread[TILE_SIZE] = { 0, 1, 4, 5, 16, 17, 20, 21 };
+
+static inline size_t texel_index(const struct tiled_level *l, size_t x, size_t y) {
+	const size_t tile = (y >> TILE_SHIFT) * l->tiles_x + (x >> TILE_SHIFT);
+	return tile * TILE_TEXELS + (morton_spread[x & (TILE_SIZE - 1)] | (morton_spread[y & (TILE_SIZE - 1)] << 1));
+}
+
+// sRGB to linear for every 8 bit value, filled in once when the first tiled texture is created
+static float srgb_lut[256];
+static struct cr_once srgb_lut_once = CR_ONCE_INIT;
+
+static void build_srgb_lut(void) {
+	for (size_t i = 0; i < 256; ++i) srgb_lut[i] = SRGBToLinear(i / 255.0f);
+}
+
+static inline float half_to_float(uint16_t h) {
+	union { uint32_t u; float f; } o = { .u = (uint32_t)(h & 0x7fff) << 13 };
+	const uint32_t exponent = o.u & 0x0f800000;
+	o.u += (127 - 15) << 23;
+	if (exponent == 0x0f800000) {
+		o.u += (128 - 16) << 23; // Inf, NaN
+	} else if (exponent == 0) {
+		// Subnormal, renormalize
+		o.u += 1 << 23;
+		o.f -= 6.10351562e-05f;
+	}
+	o.u |= (uint32_t)(h & 0x8000) << 16;
+	return o.f;
+}
+
+// Rounds to nearest even, overflows to infinity
+static inline uint16_t float_to_half(float value) {
+	union { uint32_t u; float f; } f = { .f = value };
+	const union { uint32_t u; float f; } denorm_magic = { .u = ((127 - 15) + (23 - 10) + 1) << 23 };
+	const uint32_t sign = f.u & 0x80000000;
+	f.u ^= sign;
+	uint16_t o;
+	if (f.u >= (127 + 16) << 23) {
+		o = f.u > 0x7f800000 ? 0x7e00 : 0x7c00;
+	} else if (f.u < (113 << 23)) {
+		f.f += denorm_magic.f;
+		o = (uint16_t)(f.u - denorm_magic.u);
+	} else {
+		const uint32_t mant_odd = (f.u >> 13) & 1;
+		f.u += ((uint32_t)(15 - 127) << 23) + 0xfff;
+		f.u += mant_odd;
+		o = (uint16_t)(f.u >> 13);
+	}
+	return o | (uint16_t)(sign >> 16);
+}
+
+static inline struct color rgba8_texel(const struct tiled_level *l, size_t x, size_t y) {
+	const uint8_t *p = &l->data.rgba8[texel_index(l, x, y) * 4];
+	return (struct color){ p[0] / 255.0f, p[1] / 255.0f, p[2] / 255.0f, p[3] / 255.0f };
+}
+
+static inline struct color rgba8_srgb_texel(const struct tiled_level *l, size_t x, size_t y) {
+	const uint8_t *p = &l->data.rgba8[texel_index(l, x, y) * 4];
+	return (struct color){ srgb_lut[p[0]], srgb_lut[p[1]], srgb_lut[p[2]], p[3] / 255.0f };
+}
+
+static inline struct color rgba16f_texel(const struct tiled_level *l, size_t x, size_t y) {
+	const uint16_t *p = &l->data.rgba16f[texel_index(l, x, y) * 4];
+	return (struct color){ half_to_float(p[0]), half_to_float(p[1]), half_to_float(p[2]), half_to_float(p[3]) };
+}
+
+static inline struct color rgba32f_texel(const struct tiled_level *l, size_t x, size_t y) {
+	const float *p = &l->data.rgba32f[texel_index(l, x, y) * 4];
+	return (struct color){ p[0], p[1], p[2], p[3] };
+}
+
+struct color tiled_texture_texel(const struct tiled_texture *t, size_t level, size_t x, size_t y) {
+	ASSERT(level < t->level_count);
+	const struct tiled_level *l = &t->levels[level];
+	ASSERT(x < l->width); ASSERT(y < l->height);
+	switch (t->format) {
+		case tiled_rgba8: return rgba8_texel(l, x, y);
+		case tiled_rgba16f: return rgba16f_texel(l, x, y);
+		case tiled_rgba32f: return rgba32f_texel(l, x, y);
+	}
+	ASSERT_NOT_REACHED();
+	return g_black_color;
+}
+
+// Wrap the same way textureGetPixel() does, but skip the modulo when we can
+static inline void wrap(size_t size, int i, size_t out[2]) {
+	if (i >= 0 && (size_t)i + 1 < size) {
+		out[0] = (size_t)i;
+		out[1] = (size_t)i + 1;
+		return;
+	}
+	out[0] = (size_t)i % size;
+	out[1] = (size_t)(i + 1) % size;
+}
+
+typedef struct color (*texel_fn)(const struct tiled_level *, size_t, size_t);
+
+// The texel function is a constant in each instance, so these get specialised per format.
+static inline struct color bilinear(const struct tiled_level *l, float u, float v, texel_fn texel) {
+	const float x = u * l->width - 0.5f;
+	const float y = v * l->height - 0.5f;
+	const int xint = (int)x;
+	const int yint = (int)y;
+	size_t xs[2], ys[2];
+	wrap(l->width, xint, xs);
+	wrap(l->height, yint, ys);
+	const struct color topleft = texel(l, xs[0], ys[0]);
+	const struct color topright = texel(l, xs[1], ys[0]);
+	const struct color botleft = texel(l, xs[0], ys[1]);
+	const struct color botright = texel(l, xs[1], ys[1]);
+	return colorLerp(colorLerp(topleft, topright, x - xint), colorLerp(botleft, botright, x - xint), y - yint);
+}
+
+static inline struct color nearest(const struct tiled_level *l, float u, float v, texel_fn texel) {
+	const size_t x = (size_t)(u * l->width) % l->width;
+	const size_t y = (size_t)(v * l->height) % l->height;
+	return texel(l, x, y);
+}
+
+// Level of detail, in fractional mip levels. Anything at or below 0 is level 0.
+static inline float lod(const struct tiled_texture *t, float footprint) {
+	return footprint > 0.0f ? log2f(footprint * t->lod_scale) : 0.0f;
+}
+
+// Levels of textures in a cache may not be resident, so those are looked up through it.
+// NULL if the level couldn't be loaded.
+static inline const struct tiled_level *get_level(const struct tiled_texture *t, size_t level, bool cached) {
+	return cached ? texture_cache_level(t->cache, t, level) : &t->levels[level];
+}
+
+// Blend the two levels around the footprint
+static inline struct color trilinear(const struct tiled_texture *t, float u, float v, float footprint, texel_fn texel, bool cached) {
+	const float level = lod(t, footprint);
+	const size_t last = t->level_count - 1;
+	if (level <= 0.0f || level >= (float)last) {
+		const struct tiled_level *l = get_level(t, level <= 0.0f ? 0 : last, cached);
+		return l ? bilinear(l, u, v, texel) : g_pink_color;
+	}
+	const size_t l = (size_t)level;
+	const struct tiled_level *fine = get_level(t, l, cached);
+	const struct tiled_level *coarse = get_level(t, l + 1, cached);
+	if (!fine || !coarse) return g_pink_color;
+	return colorLerp(bilinear(fine, u, v, texel), bilinear(coarse, u, v, texel), level - (float)l);
+}
+
+static inline struct color nearest_level(const struct tiled_texture *t, float u, float v, float footprint, texel_fn texel, bool cached) {
+	const float level = lod(t, footprint) + 0.5f;
+	const struct tiled_level *l = get_level(t, level <= 0.0f ? 0 : min((size_t)level, t->level_count - 1), cached);
+	return l ? nearest(l, u, v, texel) : g_pink_color;
+}
+
+#define DEFINE_FETCHERS(name, texel, target) \
+	target static struct color name##_trilinear(const struct tiled_texture *t, float u, float v, float footprint) { \
+		return trilinear(t, u, v, footprint, texel, false); \
+	} \
+	target static struct color name##_nearest(const struct tiled_texture *t, float u, float v, float footprint) { \
+		return nearest_level(t, u, v, footprint, texel, false); \
+	} \
+	target static struct color name##_trilinear_cached(const struct tiled_texture *t, float u, float v, float footprint) { \
+		return trilinear(t, u, v, footprint, texel, true); \
+	} \
+	target static struct color name##_nearest_cached(const struct tiled_texture *t, float u, float v, float footprint) { \
+		return nearest_level(t, u, v, footprint, texel, true); \
+	}
+
+// 8 bit texels go through the lookup table before filtering. Float textures are rarely sRGB,
+// so they just convert the filtered result, like image nodes used to.
+#define DEFINE_SRGB_FETCHER(name, target) \
+	target static struct color name##_srgb(const struct tiled_texture *t, float u, float v, float footprint) { \
+		return colorFromSRGB(name(t, u, v, footprint)); \
+	}
+
+// Fetchers for each format, with the given prefix and target attributes
+#define DEFINE_ALL_FETCHERS(prefix, target) \
+	DEFINE_FETCHERS(prefix##rgba8, rgba8_texel, target) \
+	DEFINE_FETCHERS(prefix##rgba8_srgb, rgba8_srgb_texel, target) \
+	DEFINE_FETCHERS(prefix##rgba16f, rgba16f_texel, target) \
+	DEFINE_FETCHERS(prefix##rgba32f, rgba32f_texel, target) \
+	DEFINE_SRGB_FETCHER(prefix##rgba16f_nearest, target) \
+	DEFINE_SRGB_FETCHER(prefix##rgba16f_trilinear, target) \
+	DEFINE_SRGB_FETCHER(prefix##rgba32f_nearest, target) \
+	DEFINE_SRGB_FETCHER(prefix##rgba32f_trilinear, target) \
+	DEFINE_SRGB_FETCHER(prefix##rgba16f_nearest_cached, target) \
+	DEFINE_SRGB_FETCHER(prefix##rgba16f_trilinear_cached, target) \
+	DEFINE_SRGB_FETCHER(prefix##rgba32f_nearest_cached, target) \
+	DEFINE_SRGB_FETCHER(prefix##rgba32f_trilinear_cached, target)
+
+// Indexed by whether levels are cached, format, then enum tiled_fetch_flags
+#define FETCHER_TABLE(prefix) { \
+	{ \
+		[tiled_rgba8]   = { prefix##rgba8_nearest, prefix##rgba8_trilinear, prefix##rgba8_srgb_nearest, prefix##rgba8_srgb_trilinear }, \
+		[tiled_rgba16f] = { prefix##rgba16f_nearest, prefix##rgba16f_trilinear, prefix##rgba16f_nearest_srgb, prefix##rgba16f_trilinear_srgb }, \
+		[tiled_rgba32f] = { prefix##rgba32f_nearest, prefix##rgba32f_trilinear, prefix##rgba32f_nearest_srgb, prefix##rgba32f_trilinear_srgb }, \
+	}, \
+	{ \
+		[tiled_rgba8]   = { prefix##rgba8_nearest_cached, prefix##rgba8_trilinear_cached, prefix##rgba8_srgb_nearest_cached, prefix##rgba8_srgb_trilinear_cached }, \
+		[tiled_rgba16f] = { prefix##rgba16f_nearest_cached, prefix##rgba16f_trilinear_cached, prefix##rgba16f_nearest_cached_srgb, prefix##rgba16f_trilinear_cached_srgb }, \
+		[tiled_rgba32f] = { prefix##rgba32f_nearest_cached, prefix##rgba32f_trilinear_cached, prefix##rgba32f_nearest_cached_srgb, prefix##rgba32f_trilinear_cached_srgb }, \
+	}, \
+}
+
+DEFINE_ALL_FETCHERS(, )
+static const tiled_fetch fetchers_generic[2][3][TILED_FETCH_MODES] = FETCHER_TABLE();
+
+#ifdef CRAY_DISPATCH_AVX2
+DEFINE_ALL_FETCHERS(avx2_, CRAY_TARGET_AVX2)
+static const tiled_fetch fetchers_avx2[2][3][TILED_FETCH_MODES] = FETCHER_TABLE(avx2_);
+#endif
+
+// Picked by tiled_texture_select_kernels()
+static const tiled_fetch (*fetchers)[3][TILED_FETCH_MODES] = fetchers_generic;
+
+void tiled_texture_select_kernels(unsigned cpu_features) {
+	fetchers = fetchers_generic;
+#ifdef CRAY_DISPATCH_AVX2
+	if (cpu_features & sys_avx2) fetchers = fetchers_avx2;
+#else
+	(void)cpu_features;
+#endif
+}
+
+// Source texel in RGBA order, flipped like textureGetPixel()
+static void source_texel(const struct texture *src, size_t x, size_t y, float out[4]) {
+	const size_t idx = (x + ((src->height - 1) - y) * src->width) * src->channels;
+	const float opaque = src->precision == char_p ? 255.0f : 1.0f;
+	float in[4];
+	for (size_t c = 0; c < src->channels && c < 4; ++c) {
+		in[c] = src->precision == char_p ? src->data.byte_p[idx + c] : src->data.float_p[idx + c];
+	}
+	switch (src->channels) {
+		case 1:
+		case 2: // Grayscale, with alpha. textureGetPixel() reads these as RGB, running into the next texel
+			out[0] = out[1] = out[2] = in[0];
+			out[3] = src->channels == 2 ? in[1] : opaque;
+			break;
+		case 3:
+			out[0] = in[0]; out[1] = in[1]; out[2] = in[2];
+			out[3] = opaque;
+			break;
+		default:
+			out[0] = in[0]; out[1] = in[1]; out[2] = in[2]; out[3] = in[3];
+			break;
+	}
+}
+
+// Raw texel components, in the same units as the source
+static inline void get_raw(const struct tiled_texture *t, const struct tiled_level *l, size_t x, size_t y, float out[4]) {
+	const size_t idx = texel_index(l, x, y) * 4;
+	for (size_t c = 0; c < 4; ++c) {
+		switch (t->format) {
+			case tiled_rgba8: out[c] = l->data.rgba8[idx + c]; break;
+			case tiled_rgba16f: out[c] = half_to_float(l->data.rgba16f[idx + c]); break;
+			case tiled_rgba32f: out[c] = l->data.rgba32f[idx + c]; break;
+		}
+	}
+}
+
+static inline void set_raw(const struct tiled_texture *t, struct tiled_level *l, size_t x, size_t y, const float in[4]) {
+	const size_t idx = texel_index(l, x, y) * 4;
+	for (size_t c = 0; c < 4; ++c) {
+		switch (t->format) {
+			case tiled_rgba8: l->data.rgba8[idx + c] = (uint8_t)in[c]; break;
+			case tiled_rgba16f: l->data.rgba16f[idx + c] = float_to_half(in[c]); break;
+			case tiled_rgba32f: l->data.rgba32f[idx + c] = in[c]; break;
+		}
+	}
+}
+
+struct level_rows {
+	const struct tiled_texture *t;
+	const struct texture *src;
+	struct tiled_level *levels;
+	size_t level;
+	size_t row_begin;
+	size_t row_end;
+};
+
+// Level 0 comes from the source texture, the others are a 2x2 box filter of the level above
+static void build_rows(void *arg) {
+	const struct level_rows *job = arg;
+	const struct tiled_texture *t = job->t;
+	struct tiled_level *l = &job->levels[job->level];
+	const struct tiled_level *prev = job->level ? &job->levels[job->level - 1] : NULL;
+	// Round 8 bit levels, so they don't drift darker every level
+	const float bias = t->format == tiled_rgba8 ? 0.5f : 0.0f;
+	for (size_t y = job->row_begin; y < job->row_end; ++y) {
+		for (size_t x = 0; x < l->width; ++x) {
+			float texel[4];
+			if (!prev) {
+				source_texel(job->src, x, y, texel);
+				set_raw(t, l, x, y, texel);
+				continue;
+			}
+			const size_t x0 = min(2 * x, prev->width - 1), x1 = min(2 * x + 1, prev->width - 1);
+			const size_t y0 = min(2 * y, prev->height - 1), y1 = min(2 * y + 1, prev->height - 1);
+			float a[4], b[4], c[4], d[4];
+			get_raw(t, prev, x0, y0, a);
+			get_raw(t, prev, x1, y0, b);
+			get_raw(t, prev, x0, y1, c);
+			get_raw(t, prev, x1, y1, d);
+			for (size_t i = 0; i < 4; ++i) texel[i] = 0.25f * (a[i] + b[i] + c[i] + d[i]) + bias;
+			set_raw(t, l, x, y, texel);
+		}
+	}
+}
+
+// Fill in levels[0..count), their data pointers must be set up already.
+// Each level depends on the previous one, so levels are built in order, with rows in parallel.
+// Bands are whole tile rows, so no two tasks write to the same tile.
+static void build_levels(struct cr_thread_pool *pool, const struct tiled_texture *t, const struct texture *src, struct tiled_level *levels, size_t count) {
+	const size_t band_count = pool ? thread_pool_size(pool) * 4 : 1;
+	struct level_rows *bands = calloc(band_count, sizeof(*bands));
+	struct cr_task_group group = { 0 };
+	for (size_t i = 0; i < count; ++i) {
+		const size_t tile_rows = (levels[i].height + TILE_SIZE - 1) >> TILE_SHIFT;
+		const size_t rows_per_band = ((tile_rows + band_count - 1) / band_count) << TILE_SHIFT;
+		for (size_t b = 0; b < band_count; ++b) {
+			bands[b] = (struct level_rows){
+				.t = t,
+				.src = src,
+				.levels = levels,
+				.level = i,
+				.row_begin = min(b * rows_per_band, levels[i].height),
+				.row_end = min((b + 1) * rows_per_band, levels[i].height),
+			};
+			if (bands[b].row_begin == bands[b].row_end) continue;
+			if (pool) {
+				thread_pool_enqueue_group(pool, &group, build_rows, &bands[b]);
+			} else {
+				build_rows(&bands[b]);
+			}
+		}
+		if (pool) thread_pool_wait_group(pool, &group);
+	}
+	free(bands);
+}
+
+static const size_t component_sizes[] = {
+	[tiled_rgba8] = sizeof(uint8_t),
+	[tiled_rgba16f] = sizeof(uint16_t),
+	[tiled_rgba32f] = sizeof(float),
+};
+
+static const char *format_names[] = {
+	[tiled_rgba8] = "RGBA8",
+	[tiled_rgba16f] = "RGBA16F",
+	[tiled_rgba32f] = "RGBA32F",
+};
+
+size_t tiled_level_bytes(const struct tiled_texture *t, size_t level) {
+	const struct tiled_level *l = &t->levels[level];
+	const size_t tiles_y = (l->height + TILE_SIZE - 1) >> TILE_SHIFT;
+	return l->tiles_x * tiles_y * TILE_TEXELS * 4 * component_sizes[t->format];
+}
+
+static struct tiled_texture *new_tiled(const struct texture *header) {
+	if (!header || !header->width || !header->height || !header->channels || header->precision == none) return NULL;
+	// Textures are loaded from several threads at once
+	thread_once(&srgb_lut_once, build_srgb_lut);
+	struct tiled_texture *t = calloc(1, sizeof(*t));
+	t->format = header->precision == char_p ? tiled_rgba8 : tiled_rgba32f;
+	t->src = header;
+	t->lod_scale = sqrtf((float)header->width * (float)header->height);
+	// Level sizes are known up front, data is filled in later
+	size_t width = header->width, height = header->height;
+	while (t->level_count < TILED_MAX_LEVELS) {
+		struct tiled_level *l = &t->levels[t->level_count++];
+		l->width = width;
+		l->height = height;
+		l->tiles_x = (width + TILE_SIZE - 1) >> TILE_SHIFT;
+		if (width == 1 && height == 1) break;
+		width = max(width / 2, (size_t)1);
+		height = max(height / 2, (size_t)1);
+	}
+	return t;
+}
+
+struct tiled_texture *tiled_texture_new(const struct texture *src) {
+	return new_tiled(src);
+}
+
+struct tiled_texture *tiled_texture_new_deferred(const struct texture *header, const char *path, file_data encoded) {
+	struct tiled_texture *t = new_tiled(header);
+	if (!t) return NULL;
+	t->path = stringCopy(path);
+	t->encoded = encoded;
+	return t;
+}
+
+struct texture *tiled_texture_decode(struct cr_thread_pool *pool, const struct tiled_texture *t) {
+	if (!t->encoded.items) return NULL;
+	struct texture *decoded = load_texture_parallel(pool, t->path, t->encoded);
+	if (!decoded) return NULL;
+	const struct texture *h = t->src;
+	if (decoded->width != h->width || decoded->height != h->height || decoded->channels != h->channels || decoded->precision != h->precision) {
+		logr(warning, "Texture \"%s\" decoded as %zux%zu, %zu channels, expected %zux%zu, %zu channels\n", t->path,
+			decoded->width, decoded->height, decoded->channels, h->width, h->height, h->channels);
+		destroyTexture(decoded);
+		return NULL;
+	}
+	return decoded;
+}
+
+// The source pixels, decoded into *decoded if needed. Destroy that when done.
+static const struct texture *get_source(struct cr_thread_pool *pool, const struct tiled_texture *t, struct texture **decoded) {
+	*decoded = NULL;
+	if (t->src->data.byte_p) return t->src;
+	*decoded = tiled_texture_decode(pool, t);
+	return *decoded;
+}
+
+static void set_format(struct tiled_texture *t, bool half) {
+	if (half && t->format == tiled_rgba32f) t->format = tiled_rgba16f;
+}
+
+void tiled_texture_build(struct cr_thread_pool *pool, struct tiled_texture *t, bool half) {
+	if (!t || t->fetch[0]) return;
+	set_format(t, half);
+
+	// Lay out all levels in one allocation
+	size_t bytes = 0;
+	for (size_t i = 0; i < t->level_count; ++i) bytes += tiled_level_bytes(t, i);
+	t->data = malloc(bytes);
+	if (!t->data) {
+		logr(warning, "Failed to allocate tiles for %zux%zu texture\n", t->src->width, t->src->height);
+		return;
+	}
+	for (size_t i = 0, offset = 0; i < t->level_count; offset += tiled_level_bytes(t, i++)) {
+		t->levels[i].data.rgba8 = (uint8_t *)t->data + offset;
+	}
+
+	struct texture *decoded = NULL;
+	const struct texture *src = get_source(pool, t, &decoded);
+	if (!src) {
+		free(t->data);
+		t->data = NULL;
+		return;
+	}
+	build_levels(pool, t, src, t->levels, t->level_count);
+	if (decoded) destroyTexture(decoded);
+	memcpy(t->fetch, fetchers[0][t->format], sizeof(t->fetch));
+
+	char buf[64];
+	logr(debug, "Tiled %zux%zu texture as %s, %zu levels, %s\n", t->src->width, t->src->height,
+		format_names[t->format], t->level_count, human_file_size(bytes, buf));
+}
+
+void tiled_texture_use_cache(struct tiled_texture *t, struct texture_cache *cache, bool half) {
+	if (!t || t->fetch[0]) return;
+	set_format(t, half);
+	t->cache = cache;
+	memcpy(t->fetch, fetchers[1][t->format], sizeof(t->fetch));
+}
+
+bool tiled_texture_load_levels(const struct tiled_texture *t, size_t count, struct tiled_level *out) {
+	ASSERT(count && count <= t->level_count);
+	// Each level gets its own allocation, so the cache can evict them one by one
+	memcpy(out, t->levels, count * sizeof(*out));
+	for (size_t i = 0; i < count; ++i) {
+		out[i].data.rgba8 = malloc(tiled_level_bytes(t, i));
+		if (!out[i].data.rgba8) {
+			while (i--) free(out[i].data.rgba8);
+			return false;
+		}
+	}
+	struct texture *decoded = NULL;
+	const struct texture *src = get_source(NULL, t, &decoded);
+	if (!src) {
+		for (size_t i = 0; i < count; ++i) free(out[i].data.rgba8);
+		return false;
+	}
+	build_levels(NULL, t, src, out, count);
+	if (decoded) destroyTexture(decoded);
+	return true;
+}
+
+void tiled_texture_destroy(struct tiled_texture *t) {
+	if (!t) return;
+	free(t->data);
+	free(t->path);
+	free(t);
+}
@@ -0,0 +1,117 @@
+//
+//  tiled_texture.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "color.h"
+#include "fileio.h"
+
+// Read-only copy of a texture for shading. Texels are expanded to one of a few canonical
+// formats and stored in 8x8 tiles, Morton ordered within each tile, so the four
+// texels of a bilinear fetch are usually on the same cache line.
+// Each texture also gets a mip chain, fetches pick levels based on the ray footprint.
+// Levels are either all built up front, or loaded on demand through a texture_cache.
+
+struct texture;
+struct cr_thread_pool;
+struct texture_cache;
+struct texture_cache_entry;
+
+#define TILE_SHIFT 3
+#define TILE_SIZE (1 << TILE_SHIFT)
+#define TILE_TEXELS (TILE_SIZE * TILE_SIZE)
+
+#define TILED_MAX_LEVELS 32
+
+enum tiled_format {
+	tiled_rgba8,
+	tiled_rgba16f, // Half floats, for float textures when asked to save memory
+	tiled_rgba32f,
+};
+
+enum tiled_fetch_flags {
+	tiled_filtered = 1 << 0, // Trilinear, instead of the nearest texel of the nearest level
+	tiled_srgb     = 1 << 1, // Convert sRGB texels to linear
+};
+#define TILED_FETCH_MODES 4
+
+struct tiled_texture;
+
+/// Fetch the color at u, v. Wrapping matches textureGetPixel()
+/// @param footprint Width of the ray footprint in uv units, 0 samples level 0
+typedef struct color (*tiled_fetch)(const struct tiled_texture *t, float u, float v, float footprint);
+
+struct tiled_level {
+	size_t width;
+	size_t height;
+	size_t tiles_x;
+	union {
+		uint8_t *rgba8;
+		uint16_t *rgba16f;
+		float *rgba32f;
+	} data;
+};
+
+struct tiled_texture {
+	enum tiled_format format;
+	const struct texture *src; // May be just the header, see tiled_texture_new_deferred()
+	size_t level_count;
+	float lod_scale; // Converts uv footprints to level 0 texels
+	// Indexed by enum tiled_fetch_flags, NULL until tiled_texture_build() or tiled_texture_use_cache()
+	tiled_fetch fetch[TILED_FETCH_MODES];
+	struct tiled_level levels[TILED_MAX_LEVELS]; // Level data is only set if built up front
+	void *data;
+	char *path;
+	file_data encoded; // Decoded when pixels are first needed, if src has no data. Not owned.
+	struct texture_cache *cache; // Optional
+	struct texture_cache_entry *cached[TILED_MAX_LEVELS]; // Resident levels, guarded by the cache
+};
+
+/// Set up an empty tiled texture for src. Call tiled_texture_build() before fetching from it.
+struct tiled_texture *tiled_texture_new(const struct texture *src);
+
+/// Like tiled_texture_new(), but header only has the dimensions and format. Pixels are
+/// decoded from encoded when they're first needed. encoded must outlive t, it normally
+/// belongs to the scene's file_cache.
+struct tiled_texture *tiled_texture_new_deferred(const struct texture *header, const char *path, file_data encoded);
+
+/// Decode a deferred texture in full. NULL if it's not deferred, or decoding failed.
+/// @param pool Optional, large images are decoded in parallel on it
+struct texture *tiled_texture_decode(struct cr_thread_pool *pool, const struct tiled_texture *t);
+
+/// Convert src into tiles and build the mip chain. Does nothing if it's already set up.
+/// @param pool Optional, if given, rows are converted in parallel on it
+/// @param half Store float textures as half floats
+void tiled_texture_build(struct cr_thread_pool *pool, struct tiled_texture *t, bool half);
+
+/// Instead of building all levels up front, load them on demand through cache.
+/// Does nothing if it's already set up.
+void tiled_texture_use_cache(struct tiled_texture *t, struct texture_cache *cache, bool half);
+
+/// For the cache, decode the source once and build levels [0, count) into out.
+/// Each level is allocated separately, and the caller owns their data.
+bool tiled_texture_load_levels(const struct tiled_texture *t, size_t count, struct tiled_level *out);
+
+size_t tiled_level_bytes(const struct tiled_texture *t, size_t level);
+
+/// The fetch function for this texture's format and the given enum tiled_fetch_flags.
+/// NULL if the texture isn't set up yet.
+static inline tiled_fetch tiled_texture_fetcher(const struct tiled_texture *t, unsigned flags) {
+	return t->fetch[flags & (TILED_FETCH_MODES - 1)];
+}
+
+/// Pick the fetch functions for textures set up after this, based on sys_get_cpu_features()
+void tiled_texture_select_kernels(unsigned cpu_features);
+
+/// Get a single texel, x and y must be within bounds of that level. Only for textures built up front.
+struct color tiled_texture_texel(const struct tiled_texture *t, size_t level, size_t x, size_t y);
+
+void tiled_texture_destroy(struct tiled_texture *t);
@@ -13,6 +13,9 @@
 #include "assert.h"
 #include "../includes.h"
 
+// Vector math stays scalar. With three lanes, moving these in and out of SIMD registers
+// costs more than it saves, and vertex buffers depend on this being three floats.
+// For four lanes of something at once, see simd.h
 struct vector {
 	float x, y, z;
 };
@@ -125,7 +125,7 @@ int main(int argc, char *argv[]) {
 		cr_renderer_set_str_pref(renderer, cr_renderer_node_list, args_string(opts, "nodes_list"));
 	}
 
-	if (parse_json(renderer, input_json) < 0) {
+	if (parse_json(renderer, input_json, NULL) < 0) {
 		logr(warning, "Scene parse failed, exiting.\n");
 		ret = -1;
 		goto done;
@@ -213,13 +213,11 @@ int main(int argc, char *argv[]) {
 	uint64_t bounces = cr_renderer_get_num_pref(renderer, cr_renderer_bounces);
 
 	logr(info, "Starting c-ray renderer for frame %zu\n", out_num);
-	bool sys_thread = threads == (size_t)sys_get_cores() + 2;
 	logr(info, "Rendering at %s%lu%s x %s%lu%s\n", KWHT, width, KNRM, KWHT, height, KNRM);
 	logr(info, "Rendering %s%zu%s samples with %s%zu%s bounces.\n", KBLU, samples, KNRM, KGRN, bounces, KNRM);
-	logr(info, "Rendering with %s%zu%s%s local thread%s.\n",
+	logr(info, "Rendering with %s%zu%s local thread%s.\n",
 		KRED,
-		sys_thread ? threads - 2 : threads,
-		sys_thread ? "+2" : "",
+		threads,
 		KNRM,
 		PLURAL(threads));
 
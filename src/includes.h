@@ -16,7 +16,7 @@
 #define RAY_OFFSET_MULTIPLIER 0.0001f
 
 //FIXME: Should be configurable at runtime
-#define SAMPLING_STRATEGY Halton
+#define SAMPLING_STRATEGY Sobol
 
 #ifdef __GNUC__
 #define CR_UNUSED __attribute__((unused))
@@ -14,8 +14,11 @@
 #include "../datatypes/bbox.h"
 #include "../datatypes/mesh.h"
 #include "../datatypes/poly.h"
+#include "../datatypes/sphere_set.h"
 #include "../renderer/instance.h"
 #include "../../common/vector.h"
+#include "../../common/mempool.h"
+#include "../../common/simd.h"
 #include "../../common/platform/thread.h"
 #include "../../common/platform/thread_pool.h"
 #include "../../common/platform/capabilities.h"
@@ -26,6 +29,7 @@
 #include <assert.h>
 #include <float.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 /*
@@ -63,10 +67,28 @@ struct bvh_node {
 	struct bvh_index index; // Indices pointing to primitives and children (if any)
 };
 
+// Triangles of a mesh BVH, in the same order as prim_indices. Block i holds positions
+// 4i to 4i + 3, with each lane of each array belonging to one triangle.
+// Edges and normals are precomputed the same way rayIntersectsWithPolygon() computes them.
+struct tri_block {
+	float v0[3][4];
+	float e1[3][4];
+	float e2[3][4];
+	float n[3][4];
+};
+
+// Spheres of a sphere set BVH, packed the same way
+struct sphere_block {
+	float center[3][4];
+	float radius_sq[4];
+};
+
 struct bvh {
 	struct bvh_node *nodes;
 	size_t *prim_indices;
 	size_t node_count;
+	struct tri_block *tris; // Only for mesh BVHs
+	struct sphere_block *spheres; // Only for sphere set BVHs
 };
 
 // Bin used to approximate the SAH.
@@ -81,6 +103,20 @@ struct split {
 	size_t pos;
 };
 
+struct bottom_level_data {
+	const struct mesh *mesh;
+	f32x4 start[3];
+	f32x4 dir[3];
+};
+
+struct sphere_set_data {
+	f32x4 start[3];
+	f32x4 dir[3];
+	f32x4 dir_sq;
+	f32x4 inv_dir_sq;
+	size_t *closest; // Position of the closest sphere so far, in BVH order
+};
+
 struct top_level_data {
 	const struct instance *instances;
 	sampler *sampler;
@@ -397,7 +433,8 @@ static inline struct bvh *build_bvh_generic(
 
 	struct vector *centers = malloc(sizeof(struct vector) * count);
 	struct boundingBox *bboxes = malloc(sizeof(struct boundingBox) * count);
-	size_t *prim_indices = malloc(sizeof(size_t) * count);
+	// Nodes and indices are what traversal reads, so they go in allocLarge() memory
+	size_t *prim_indices = allocLarge(sizeof(size_t) * count);
 
 	for (unsigned i = 0; i < count; ++i) {
 		get_bbox_and_center(user_data, i, &bboxes[i], &centers[i]);
@@ -412,12 +449,17 @@ static inline struct bvh *build_bvh_generic(
 	bvh->node_count = 1; // For the root
 	bvh->nodes = malloc(sizeof(struct bvh_node) * max_nodes);
 	bvh->prim_indices = prim_indices;
+	bvh->tris = NULL;
+	bvh->spheres = NULL;
 	store_bbox_to_node(&bvh->nodes[0], &root_bbox);
 
 	build_bvh_recursive(0, bvh, bboxes, centers, 0, count, 0);
 
 	// Shrink array of nodes (since some leaves may contain more than 1 primitive)
-	bvh->nodes = realloc(bvh->nodes, sizeof(struct bvh_node) * bvh->node_count);
+	struct bvh_node *nodes = allocLarge(sizeof(struct bvh_node) * bvh->node_count);
+	memcpy(nodes, bvh->nodes, sizeof(struct bvh_node) * bvh->node_count);
+	free(bvh->nodes);
+	bvh->nodes = nodes;
 	free(centers);
 	free(bboxes);
 	return bvh;
@@ -570,6 +612,71 @@ static void get_instance_bbox_and_center(const void *userData, unsigned i, struc
 	instances[i].getBBoxAndCenterFn(&instances[i], bbox, center);
 }
 
+static void get_sphere_bbox_and_center(const void *userData, unsigned i, struct boundingBox *bbox, struct vector *center) {
+	const struct sphere_set *set = userData;
+	const float r = set->radii.items[i];
+	*center = set->centers.items[i];
+	bbox->min = vec_sub(*center, (struct vector){ r, r, r });
+	bbox->max = vec_add(*center, (struct vector){ r, r, r });
+}
+
+static inline size_t block_count(size_t prim_count) {
+	return (prim_count + 3) / 4;
+}
+
+static struct tri_block *pack_triangles(const struct mesh *mesh, const struct bvh *bvh) {
+	const size_t prim_count = mesh->polygons.count;
+	struct tri_block *blocks = allocLarge(sizeof(*blocks) * block_count(prim_count));
+	// Unused lanes at the end are zeros, which never hit
+	memset(blocks, 0, sizeof(*blocks) * block_count(prim_count));
+	for (size_t i = 0; i < prim_count; ++i) {
+		const struct poly *p = &mesh->polygons.items[bvh->prim_indices[i]];
+		const struct vector v0 = mesh->vbuf->vertices.items[p->vertexIndex[0]];
+		const struct vector e1 = vec_sub(v0, mesh->vbuf->vertices.items[p->vertexIndex[1]]);
+		const struct vector e2 = vec_sub(mesh->vbuf->vertices.items[p->vertexIndex[2]], v0);
+		const struct vector n = vec_cross(e1, e2);
+		struct tri_block *block = &blocks[i / 4];
+		const size_t lane = i % 4;
+		for (unsigned axis = 0; axis < 3; ++axis) {
+			block->v0[axis][lane] = vec_component(&v0, axis);
+			block->e1[axis][lane] = vec_component(&e1, axis);
+			block->e2[axis][lane] = vec_component(&e2, axis);
+			block->n[axis][lane] = vec_component(&n, axis);
+		}
+	}
+	return blocks;
+}
+
+static struct sphere_block *pack_spheres(const struct sphere_set *set, const struct bvh *bvh) {
+	const size_t prim_count = set->centers.count;
+	struct sphere_block *blocks = allocLarge(sizeof(*blocks) * block_count(prim_count));
+	memset(blocks, 0, sizeof(*blocks) * block_count(prim_count));
+	for (size_t i = 0; i < prim_count; ++i) {
+		const size_t idx = bvh->prim_indices[i];
+		const struct vector center = set->centers.items[idx];
+		struct sphere_block *block = &blocks[i / 4];
+		const size_t lane = i % 4;
+		for (unsigned axis = 0; axis < 3; ++axis) {
+			block->center[axis][lane] = vec_component(&center, axis);
+		}
+		block->radius_sq[lane] = set->radii.items[idx] * set->radii.items[idx];
+	}
+	return blocks;
+}
+
+static inline f32x4 dot4(const f32x4 *a, const f32x4 *b) {
+	return f32x4_add(f32x4_add(f32x4_mul(a[0], b[0]), f32x4_mul(a[1], b[1])), f32x4_mul(a[2], b[2]));
+}
+
+static inline void cross4(const f32x4 *a, const f32x4 *b, f32x4 *out) {
+	out[0] = f32x4_sub(f32x4_mul(a[1], b[2]), f32x4_mul(a[2], b[1]));
+	out[1] = f32x4_sub(f32x4_mul(a[2], b[0]), f32x4_mul(a[0], b[2]));
+	out[2] = f32x4_sub(f32x4_mul(a[0], b[1]), f32x4_mul(a[1], b[0]));
+}
+
+// Tests four triangles at a time, with the same Möller-Trumbore math as rayIntersectsWithPolygon().
+// Only the distance, uv and polygon are stored here, the rest of the hit is filled in by
+// finishPolygonHit() once traversal has found the closest one.
 static inline bool intersect_bottom_level_leaf(
 	const void *user_data,
 	const struct bvh *bvh,
@@ -577,12 +684,109 @@ static inline bool intersect_bottom_level_leaf(
 	size_t begin, size_t end,
 	struct hitRecord *isect)
 {
-	const struct mesh *mesh = user_data;
+	(void)ray;
+	const struct bottom_level_data *data = user_data;
+	const f32x4 zero = f32x4_set1(0.0f);
+	const f32x4 one = f32x4_set1(1.0f);
+	size_t best = SIZE_MAX;
+	for (size_t first = begin & ~(size_t)3; first < end; first += 4) {
+		const struct tri_block *block = &bvh->tris[first / 4];
+		// Lanes that belong to this leaf
+		unsigned lanes = 0xF;
+		if (first < begin) lanes &= 0xF << (begin - first);
+		if (first + 4 > end) lanes &= 0xF >> (first + 4 - end);
+
+		const f32x4 e1[] = { f32x4_load(block->e1[0]), f32x4_load(block->e1[1]), f32x4_load(block->e1[2]) };
+		const f32x4 e2[] = { f32x4_load(block->e2[0]), f32x4_load(block->e2[1]), f32x4_load(block->e2[2]) };
+		const f32x4 n[] = { f32x4_load(block->n[0]), f32x4_load(block->n[1]), f32x4_load(block->n[2]) };
+		const f32x4 c[] = {
+			f32x4_sub(f32x4_load(block->v0[0]), data->start[0]),
+			f32x4_sub(f32x4_load(block->v0[1]), data->start[1]),
+			f32x4_sub(f32x4_load(block->v0[2]), data->start[2]),
+		};
+		f32x4 r[3];
+		cross4(data->dir, c, r);
+		const f32x4 inv_det = f32x4_div(one, dot4(n, data->dir));
+
+		const f32x4 u = f32x4_mul(dot4(r, e2), inv_det);
+		const f32x4 v = f32x4_mul(dot4(r, e1), inv_det);
+		const f32x4 t = f32x4_mul(dot4(n, c), inv_det);
+		// As in the scalar version, NaN lanes fail these
+		m32x4 hit = m32x4_and(f32x4_ge(u, zero), f32x4_ge(v, zero));
+		hit = m32x4_and(hit, f32x4_le(f32x4_add(u, v), one));
+		hit = m32x4_and(hit, f32x4_ge(t, zero));
+		hit = m32x4_and(hit, f32x4_lt(t, f32x4_set1(isect->distance)));
+		lanes &= m32x4_bits(hit);
+		if (likely(!lanes)) continue;
+
+		// Closest of the lanes that hit. Ties go to the first one, like testing them in order would.
+		float ts[4], us[4], vs[4];
+		f32x4_store(ts, t);
+		f32x4_store(us, u);
+		f32x4_store(vs, v);
+		for (unsigned lane = 0; lane < 4; ++lane) {
+			if (!(lanes & (1u << lane)) || ts[lane] >= isect->distance) continue;
+			isect->distance = ts[lane];
+			isect->uv = (struct coord){ us[lane], vs[lane] };
+			best = first + lane;
+		}
+	}
+	if (best == SIZE_MAX) return false;
+	isect->polygon = &data->mesh->polygons.items[bvh->prim_indices[best]];
+	return true;
+}
+
+// Tests four spheres at a time. Only the distance is stored here, traverse_sphere_set_bvh()
+// fills in the rest once the closest one is found.
+static inline bool intersect_sphere_set_leaf(
+	const void *user_data,
+	const struct bvh *bvh,
+	const struct lightRay *ray,
+	size_t begin, size_t end,
+	struct hitRecord *isect)
+{
+	(void)ray;
+	const struct sphere_set_data *data = user_data;
+	const f32x4 zero = f32x4_set1(0.0f);
 	bool found = false;
-	for (size_t i = begin; i < end; ++i) {
-		struct poly *p = &mesh->polygons.items[bvh->prim_indices[i]];
-		if (rayIntersectsWithPolygon(mesh, ray, p, isect)) {
-			isect->polygon = p;
+	for (size_t first = begin & ~(size_t)3; first < end; first += 4) {
+		const struct sphere_block *block = &bvh->spheres[first / 4];
+		unsigned lanes = 0xF;
+		if (first < begin) lanes &= 0xF << (begin - first);
+		if (first + 4 > end) lanes &= 0xF >> (first + 4 - end);
+
+		const f32x4 oc[] = {
+			f32x4_sub(data->start[0], f32x4_load(block->center[0])),
+			f32x4_sub(data->start[1], f32x4_load(block->center[1])),
+			f32x4_sub(data->start[2], f32x4_load(block->center[2])),
+		};
+		// Half of the usual b, and the discriminant from the distance between the center and the
+		// closest point on the ray, instead of b² - ac. That one loses all precision for small spheres far away.
+		const f32x4 b = dot4(oc, data->dir);
+		const f32x4 s = f32x4_mul(b, data->inv_dir_sq);
+		const f32x4 l[] = {
+			f32x4_sub(oc[0], f32x4_mul(s, data->dir[0])),
+			f32x4_sub(oc[1], f32x4_mul(s, data->dir[1])),
+			f32x4_sub(oc[2], f32x4_mul(s, data->dir[2])),
+		};
+		const f32x4 disc = f32x4_mul(data->dir_sq, f32x4_sub(f32x4_load(block->radius_sq), dot4(l, l)));
+		m32x4 hit = f32x4_ge(disc, zero);
+		const f32x4 root = f32x4_sqrt(f32x4_max(disc, zero));
+		const f32x4 near = f32x4_mul(f32x4_sub(f32x4_sub(zero, b), root), data->inv_dir_sq);
+		const f32x4 far = f32x4_mul(f32x4_add(f32x4_sub(zero, b), root), data->inv_dir_sq);
+		// Like rayIntersectsWithSphere(), take the far side if the ray starts inside, with the same cutoff
+		const f32x4 t = f32x4_select(f32x4_lt(zero, near), near, far);
+		hit = m32x4_and(hit, f32x4_ge(t, f32x4_set1(0.00001f)));
+		hit = m32x4_and(hit, f32x4_lt(t, f32x4_set1(isect->distance)));
+		lanes &= m32x4_bits(hit);
+		if (likely(!lanes)) continue;
+
+		float ts[4];
+		f32x4_store(ts, t);
+		for (unsigned lane = 0; lane < 4; ++lane) {
+			if (!(lanes & (1u << lane)) || ts[lane] >= isect->distance) continue;
+			isect->distance = ts[lane];
+			*data->closest = first + lane;
 			found = true;
 		}
 	}
@@ -653,7 +857,15 @@ struct boundingBox get_transformed_root_bbox(const struct bvh *bvh, const struct
 }
 
 struct bvh *build_mesh_bvh(const struct mesh *mesh) {
-	return build_bvh_generic(mesh, get_poly_bbox_and_center, mesh->polygons.count);
+	struct bvh *bvh = build_bvh_generic(mesh, get_poly_bbox_and_center, mesh->polygons.count);
+	if (bvh) bvh->tris = pack_triangles(mesh, bvh);
+	return bvh;
+}
+
+struct bvh *build_sphere_set_bvh(const struct sphere_set *set) {
+	struct bvh *bvh = build_bvh_generic(set, get_sphere_bbox_and_center, set->centers.count);
+	if (bvh) bvh->spheres = pack_spheres(set, bvh);
+	return bvh;
 }
 
 struct bvh *build_top_level_bvh(const struct instance_arr instances) {
@@ -667,7 +879,37 @@ bool traverse_bottom_level_bvh(
 	sampler *sampler)
 {
 	(void)sampler;
-	return traverse_bvh_generic(mesh, mesh->bvh, intersect_bottom_level_leaf, ray, isect);
+	struct bottom_level_data data = {
+		.mesh = mesh,
+		.start = { f32x4_set1(ray->start.x), f32x4_set1(ray->start.y), f32x4_set1(ray->start.z) },
+		.dir = { f32x4_set1(ray->direction.x), f32x4_set1(ray->direction.y), f32x4_set1(ray->direction.z) },
+	};
+	if (!traverse_bvh_generic(&data, mesh->bvh, intersect_bottom_level_leaf, ray, isect)) return false;
+	finishPolygonHit(mesh, ray, isect->polygon, isect);
+	return true;
+}
+
+bool traverse_sphere_set_bvh(
+	const struct sphere_set *set,
+	const struct lightRay *ray,
+	struct hitRecord *isect,
+	size_t *sphere_idx)
+{
+	size_t closest = 0;
+	const float dir_sq = vec_dot(ray->direction, ray->direction);
+	struct sphere_set_data data = {
+		.start = { f32x4_set1(ray->start.x), f32x4_set1(ray->start.y), f32x4_set1(ray->start.z) },
+		.dir = { f32x4_set1(ray->direction.x), f32x4_set1(ray->direction.y), f32x4_set1(ray->direction.z) },
+		.dir_sq = f32x4_set1(dir_sq),
+		.inv_dir_sq = f32x4_set1(1.0f / dir_sq),
+		.closest = &closest,
+	};
+	if (!traverse_bvh_generic(&data, set->bvh, intersect_sphere_set_leaf, ray, isect)) return false;
+	*sphere_idx = set->bvh->prim_indices[closest];
+	isect->hitPoint = alongRay(ray, isect->distance);
+	isect->surfaceNormal = vec_normalize(vec_sub(isect->hitPoint, set->centers.items[*sphere_idx]));
+	isect->polygon = NULL;
+	return true;
 }
 
 bool traverse_top_level_bvh(
@@ -682,10 +924,39 @@ bool traverse_top_level_bvh(
 		bvh, intersect_top_level_leaf, ray, isect);
 }
 
+struct bvh *bvh_clone(const struct bvh *bvh) {
+	if (!bvh) return NULL;
+	struct bvh *copy = malloc(sizeof(*copy));
+	copy->node_count = bvh->node_count;
+	copy->nodes = allocLarge(sizeof(*copy->nodes) * bvh->node_count);
+	memcpy(copy->nodes, bvh->nodes, sizeof(*copy->nodes) * bvh->node_count);
+	// The primitive count isn't stored, but the leaves cover all of them
+	size_t prim_count = 0;
+	for (size_t i = 0; i < bvh->node_count; ++i) {
+		const struct bvh_index index = bvh->nodes[i].index;
+		if (index.prim_count) prim_count = max(prim_count, index.first_child_or_prim + index.prim_count);
+	}
+	copy->prim_indices = allocLarge(sizeof(*copy->prim_indices) * prim_count);
+	memcpy(copy->prim_indices, bvh->prim_indices, sizeof(*copy->prim_indices) * prim_count);
+	copy->tris = NULL;
+	if (bvh->tris) {
+		copy->tris = allocLarge(sizeof(*copy->tris) * block_count(prim_count));
+		memcpy(copy->tris, bvh->tris, sizeof(*copy->tris) * block_count(prim_count));
+	}
+	copy->spheres = NULL;
+	if (bvh->spheres) {
+		copy->spheres = allocLarge(sizeof(*copy->spheres) * block_count(prim_count));
+		memcpy(copy->spheres, bvh->spheres, sizeof(*copy->spheres) * block_count(prim_count));
+	}
+	return copy;
+}
+
 void destroy_bvh(struct bvh *bvh) {
 	if (bvh) {
-		if (bvh->nodes) free(bvh->nodes);
-		if (bvh->prim_indices) free(bvh->prim_indices);
+		freeLarge(bvh->nodes);
+		freeLarge(bvh->prim_indices);
+		freeLarge(bvh->tris);
+		freeLarge(bvh->spheres);
 		free(bvh);
 	}
 }
@@ -703,19 +974,30 @@ void bvh_build_task(void *arg) {
 	}
 }
 
+void sphere_set_bvh_build_task(void *arg) {
+	block_signals();
+	struct sphere_set *set = arg;
+	struct timeval timer = { 0 };
+	timer_start(&timer);
+	set->bvh = build_sphere_set_bvh(set);
+	logr(debug, "Built BVH for %zu spheres, took %lums\n", set->centers.count, timer_get_ms(timer));
+}
+
 // FIXME: Add pthread_cancel() support
-void compute_accels(struct mesh_arr meshes) {
-	struct cr_thread_pool *pool = thread_pool_create(sys_get_cores());
-	logr(info, "Updating %zu BVHs: ", meshes.count);
+void compute_accels(struct cr_thread_pool *pool, struct mesh_arr meshes, struct sphere_set_arr sphere_sets) {
+	logr(info, "Updating %zu BVHs: ", meshes.count + sphere_sets.count);
 	struct timeval timer = { 0 };
 	timer_start(&timer);
+	struct cr_task_group group = { 0 };
 	for (size_t i = 0; i < meshes.count; ++i) {
-		if (!meshes.items[i].bvh) thread_pool_enqueue(pool, bvh_build_task, &meshes.items[i]);
+		if (!meshes.items[i].bvh) thread_pool_enqueue_group(pool, &group, bvh_build_task, &meshes.items[i]);
+	}
+	for (size_t i = 0; i < sphere_sets.count; ++i) {
+		if (!sphere_sets.items[i].bvh) thread_pool_enqueue_group(pool, &group, sphere_set_bvh_build_task, &sphere_sets.items[i]);
 	}
-	thread_pool_wait(pool);
+	thread_pool_wait_group(pool, &group);
 
 	printSmartTime(timer_get_ms(timer));
 	logr(plain, "\n");
-	thread_pool_destroy(pool);
 }
 
@@ -18,7 +18,9 @@ struct lightRay;
 struct hitRecord;
 struct mesh;
 struct poly;
+struct sphere_set;
 struct boundingBox;
+struct cr_thread_pool;
 
 struct bvh;
 
@@ -34,6 +36,9 @@ struct boundingBox get_transformed_root_bbox(const struct bvh *bvh, const struct
 /// @param count Amount of polygons given
 struct bvh *build_mesh_bvh(const struct mesh *mesh);
 
+/// Builds a BVH for the spheres of a sphere set
+struct bvh *build_sphere_set_bvh(const struct sphere_set *set);
+
 /// Builds a top-level BVH for a given set of instances
 /// @param instances Instances to build a top-level BVH for
 /// @param instanceCount Amount of instances
@@ -53,7 +58,19 @@ bool traverse_bottom_level_bvh(
 	struct hitRecord *isect,
 	sampler *sampler);
 
+/// Intersect a ray with the spheres of a sphere set, in object space.
+/// Sets the distance, hit point and normal of isect, and the index of the sphere that was hit.
+bool traverse_sphere_set_bvh(
+	const struct sphere_set *set,
+	const struct lightRay *ray,
+	struct hitRecord *isect,
+	size_t *sphere_idx);
+
+/// Deep copy of a BVH. The copy is allocated (and first touched) by the calling thread.
+struct bvh *bvh_clone(const struct bvh *bvh);
+
 /// Frees the memory allocated by the given BVH
 void destroy_bvh(struct bvh *);
 
-void compute_accels(struct mesh_arr meshes);
+/// Build BVHs for all meshes and sphere sets that don't have one yet, in parallel on pool
+void compute_accels(struct cr_thread_pool *pool, struct mesh_arr meshes, struct sphere_set_arr sphere_sets);
@@ -74,6 +74,7 @@ bool cr_renderer_set_num_pref(struct cr_renderer *ext, enum cr_renderer_param p,
 	switch (p) {
 		case cr_renderer_threads: {
 			r->prefs.threads = num;
+			r->prefs.threads_default = false;
 			return true;
 		}
 		case cr_renderer_samples: {
@@ -119,6 +120,30 @@ bool cr_renderer_set_num_pref(struct cr_renderer *ext, enum cr_renderer_param p,
 			r->prefs.blender_mode = num;
 			return true;
 		}
+		case cr_renderer_denoise: {
+			r->prefs.denoise = num;
+			return true;
+		}
+		case cr_renderer_flush_interval: {
+			r->prefs.flush_interval = num;
+			return true;
+		}
+		case cr_renderer_tile_autotune: {
+			r->prefs.tile_autotune = num;
+			return true;
+		}
+		case cr_renderer_numa_replicate: {
+			r->prefs.numa_replicate = num;
+			return true;
+		}
+		case cr_renderer_half_textures: {
+			r->prefs.half_textures = num;
+			return true;
+		}
+		case cr_renderer_texture_cache_size: {
+			r->prefs.texture_cache_mb = num;
+			return true;
+		}
 		default: return false;
 	}
 	return false;
@@ -137,6 +162,8 @@ bool cr_renderer_set_str_pref(struct cr_renderer *ext, enum cr_renderer_param p,
 				r->prefs.tileOrder = ro_from_middle;
 			} else if (stringEquals(str, "toMiddle")) {
 				r->prefs.tileOrder = ro_to_middle;
+			} else if (stringEquals(str, "hilbert")) {
+				r->prefs.tileOrder = ro_hilbert;
 			} else {
 				r->prefs.tileOrder = ro_normal;
 			}
@@ -163,6 +190,29 @@ bool cr_renderer_set_str_pref(struct cr_renderer *ext, enum cr_renderer_param p,
 			r->prefs.node_list = stringCopy(str);
 			return true;
 		}
+		case cr_renderer_integrator: {
+			if (stringEquals(str, "wavefront")) {
+				r->prefs.integrator = integrator_wavefront;
+			} else if (stringEquals(str, "pathtrace")) {
+				r->prefs.integrator = integrator_pathtrace;
+			} else {
+				return false;
+			}
+			return true;
+		}
+		case cr_renderer_pin_threads: {
+			if (stringEquals(str, "none")) {
+				r->prefs.pin_policy = pin_none;
+			} else if (stringEquals(str, "cores")) {
+				r->prefs.pin_policy = pin_cores;
+			} else if (stringEquals(str, "compact")) {
+				r->prefs.pin_policy = pin_compact;
+			} else {
+				return false;
+			}
+			if (r->prefs.threads_default) r->prefs.threads = sys_default_threads(r->prefs.pin_policy);
+			return true;
+		}
 		default: return false;
 	}
 	return false;
@@ -172,6 +222,7 @@ void cr_renderer_stop(struct cr_renderer *ext) {
 	if (!ext) return;
 	struct renderer *r = (struct renderer *)ext;
 	r->state.render_aborted = true;
+	tile_set_wake(r->state.current_set);
 	while (r->prefs.iterative && !r->state.exit_done) {
 		timer_sleep_ms(10);
 	}
@@ -185,6 +236,7 @@ void cr_renderer_toggle_pause(struct cr_renderer *ext) {
 		// FIXME: What about network renderers?
 		r->state.workers.items[i].paused = !r->state.workers.items[i].paused;
 	}
+	tile_set_wake(r->state.current_set);
 }
 
 const char *cr_renderer_get_str_pref(struct cr_renderer *ext, enum cr_renderer_param p) {
@@ -194,6 +246,14 @@ const char *cr_renderer_get_str_pref(struct cr_renderer *ext, enum cr_renderer_p
 		case cr_renderer_output_path: return r->prefs.imgFilePath;
 		case cr_renderer_output_name: return r->prefs.imgFileName;
 		case cr_renderer_asset_path: return r->scene->asset_path;
+		case cr_renderer_integrator: return r->prefs.integrator == integrator_wavefront ? "wavefront" : "pathtrace";
+		case cr_renderer_pin_threads: {
+			switch (r->prefs.pin_policy) {
+				case pin_cores: return "cores";
+				case pin_compact: return "compact";
+				default: return "none";
+			}
+		}
 		default: return NULL;
 	}
 	return NULL;
@@ -211,6 +271,12 @@ uint64_t cr_renderer_get_num_pref(struct cr_renderer *ext, enum cr_renderer_para
 		case cr_renderer_output_num: return r->prefs.imgCount;
 		case cr_renderer_override_width: return r->prefs.override_width;
 		case cr_renderer_override_height: return r->prefs.override_height;
+		case cr_renderer_denoise: return r->prefs.denoise;
+		case cr_renderer_flush_interval: return r->prefs.flush_interval;
+		case cr_renderer_tile_autotune: return r->prefs.tile_autotune;
+		case cr_renderer_numa_replicate: return r->prefs.numa_replicate;
+		case cr_renderer_half_textures: return r->prefs.half_textures;
+		case cr_renderer_texture_cache_size: return r->prefs.texture_cache_mb;
 		default: return 0; // TODO
 	}
 	return 0;
@@ -243,6 +309,7 @@ struct cr_scene_totals cr_scene_totals(struct cr_scene *s_ext) {
 	return (struct cr_scene_totals){
 		.meshes = s->meshes.count,
 		.spheres = s->spheres.count,
+		.sphere_sets = s->sphere_sets.count,
 		.instances = s->instances.count,
 		.cameras = s->cameras.count
 	};
@@ -254,6 +321,18 @@ cr_sphere cr_scene_add_sphere(struct cr_scene *s_ext, float radius) {
 	return sphere_arr_add(&scene->spheres, (struct sphere){ .radius = radius });
 }
 
+cr_sphere_set cr_scene_add_sphere_set(struct cr_scene *s_ext, struct cr_sphere_set_param in) {
+	if (!s_ext || !in.centers || !in.radii) return -1;
+	struct world *scene = (struct world *)s_ext;
+	struct sphere_set new = { 0 };
+	for (size_t i = 0; i < in.count; ++i) {
+		vector_arr_add(&new.centers, *(struct vector *)&in.centers[i]);
+		float_arr_add(&new.radii, in.radii[i]);
+		if (in.mat_idx) int_arr_add(&new.materials, in.mat_idx[i]);
+	}
+	return sphere_set_arr_add(&scene->sphere_sets, new);
+}
+
 cr_vertex_buf cr_scene_vertex_buf_new(struct cr_scene *s_ext, struct cr_vertex_buf_param in) {
 	if (!s_ext) return -1;
 	struct world *scene = (struct world *)s_ext;
@@ -327,6 +406,9 @@ cr_instance cr_instance_new(struct cr_scene *s_ext, cr_object object, enum cr_ob
 		case cr_object_sphere:
 			new = new_sphere_instance(&scene->spheres, object, NULL, NULL);
 			break;
+		case cr_object_sphere_set:
+			new = new_sphere_set_instance(&scene->sphere_sets, object);
+			break;
 		default:
 			return -1;
 	}
@@ -828,15 +910,13 @@ void cr_renderer_restart_interactive(struct cr_renderer *ext) {
 	}
 	// sus
 	r->state.finishedPasses = 1;
-	mutex_lock(r->state.current_set->tile_mutex);
 	tex_clear(r->state.result_buf);
-	r->state.current_set->finished = 0;
 	for (size_t i = 0; i < r->prefs.threads; ++i) {
 		// FIXME: Use array for workers
 		// FIXME: What about network renderers?
 		r->state.workers.items[i].totalSamples = 0;
 	}
-	mutex_release(r->state.current_set->tile_mutex);
+	tile_set_restart(r->state.current_set);
 }
 
 struct cr_bitmap *cr_renderer_get_result(struct cr_renderer *ext) {
@@ -861,10 +941,12 @@ bool cr_load_json(struct cr_renderer *r_ext, const char *file_path) {
 	cr_renderer_set_str_pref(r_ext, cr_renderer_asset_path, asset_path);
 	free(asset_path);
 	cJSON *input = cJSON_ParseWithLength((const char *)input_bytes.items, input_bytes.count);
-	if (parse_json(r_ext, input) < 0) {
-		return false;
-	}
-	return true;
+	file_free(&input_bytes);
+	// Files that earlier calls already loaded are reused
+	struct renderer *r = (struct renderer *)r_ext;
+	const bool ok = parse_json(r_ext, input, r->scene->cache) >= 0;
+	cJSON_Delete(input);
+	return ok;
 }
 
 void cr_log_level_set(enum cr_log_level level) {
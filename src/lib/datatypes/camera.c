@@ -24,6 +24,14 @@ void cam_recompute_optics(struct camera *cam) {
 	const float sensor_width_35mm = 0.036f;
 	cam->focal_length = 0.5f * sensor_width_35mm / deg_to_rad(0.5f * cam->FOV);
 	if (cam->fstops != 0.0f) cam->aperture = 0.5f * (cam->focal_length / cam->fstops);
+
+	cam->pix_x = vec_scale(cam->is_blender ? cam->right : vec_negate(cam->right), (cam->sensor_size.x / cam->width));
+	cam->pix_y = vec_scale(cam->up, (cam->sensor_size.y / cam->height));
+	// Offset by half a pixel, so we sample pixel centers before jitter
+	cam->corner = vec_add(cam->forward, vec_add(
+		vec_scale(cam->pix_x, 0.5f - cam->width * 0.5f),
+		vec_scale(cam->pix_y, 0.5f - cam->height * 0.5f)
+	));
 }
 
 void recomputeComposite(struct camera *cam) {
@@ -65,35 +73,112 @@ static inline float triangleDistribution(float v) {
 	return v;
 }
 
-struct lightRay cam_get_ray(const struct camera *cam, int x, int y, struct sampler *sampler) {
-	struct lightRay new_ray = { .type = rt_camera };
-	
-	const float jitter_x = triangleDistribution(getDimension(sampler));
-	const float jitter_y = triangleDistribution(getDimension(sampler));
-	
-	const struct vector pix_x = vec_scale(cam->is_blender ? cam->right : vec_negate(cam->right), (cam->sensor_size.x / cam->width));
-	const struct vector pix_y = vec_scale(cam->up, (cam->sensor_size.y / cam->height));
-	const struct vector pix_v = vec_add(
-							cam->forward,
-							vec_add(
-								vec_scale(pix_x, x - cam->width  * 0.5f + jitter_x + 0.5f),
-								vec_scale(pix_y, y - cam->height * 0.5f + jitter_y + 0.5f)
-							)
-						);
-	new_ray.direction = vec_normalize(pix_v);
-	
-	// Unused if aperture == 0.0, but still computed to maintain the same
-	// prng sequence for both codepaths
-	struct coord random = coord_on_unit_disc(sampler);
-
-	if (cam->aperture > 0.0f) {
-		const float ft = cam->focus_distance / vec_dot(new_ray.direction, cam->forward);
-		const struct vector focus_point = alongRay(&new_ray, ft);
-		const struct coord lens_point = coord_scale(cam->aperture, random);
-		new_ray.start = vec_add(new_ray.start, vec_add(vec_scale(cam->right, lens_point.x), vec_scale(cam->up, lens_point.y)));
-		new_ray.direction = vec_normalize(vec_sub(focus_point, new_ray.start));
+// Point the SoA arrays into a block of 10 * capacity floats
+static void cam_rays_bind(struct camera_rays *rays, float *block, size_t capacity) {
+	float **arrays[] = { &rays->ox, &rays->oy, &rays->oz, &rays->dx, &rays->dy, &rays->dz, &rays->u[0], &rays->u[1], &rays->u[2], &rays->u[3] };
+	for (size_t i = 0; i < sizeof(arrays) / sizeof(*arrays); ++i) {
+		*arrays[i] = block + i * capacity;
+	}
+	rays->block = block;
+	rays->capacity = capacity;
+}
+
+static void cam_rays_reserve(struct camera_rays *rays, size_t count) {
+	if (count <= rays->capacity) return;
+	free(rays->block);
+	cam_rays_bind(rays, malloc(10 * count * sizeof(float)), count);
+}
+
+void cam_rays_free(struct camera_rays *rays) {
+	free(rays->block);
+	*rays = (struct camera_rays){ 0 };
+}
+
+// Primary ray directions on the film plane, in camera space
+static void film_rays(const struct camera *cam, int x, int y, size_t count, const float *restrict u0, const float *restrict u1,
+		float *restrict ox, float *restrict oy, float *restrict oz, float *restrict dx, float *restrict dy, float *restrict dz) {
+	const struct vector px = cam->pix_x;
+	const struct vector py = cam->pix_y;
+	const struct vector c = cam->corner;
+	const float fy = (float)y;
+	for (size_t i = 0; i < count; ++i) {
+		const float jx = (float)(x + (int)i) + triangleDistribution(u0[i]);
+		const float jy = fy + triangleDistribution(u1[i]);
+		const float vx = c.x + px.x * jx + py.x * jy;
+		const float vy = c.y + px.y * jx + py.y * jy;
+		const float vz = c.z + px.z * jx + py.z * jy;
+		const float inv_length = 1.0f / sqrtf(vx * vx + vy * vy + vz * vz);
+		dx[i] = vx * inv_length;
+		dy[i] = vy * inv_length;
+		dz[i] = vz * inv_length;
+		ox[i] = 0.0f;
+		oy[i] = 0.0f;
+		oz[i] = 0.0f;
+	}
+}
+
+// Depth of field, move ray origins onto the lens and point them at the focal plane
+static void lens_rays(const struct camera *cam, size_t count, const float *restrict u2, const float *restrict u3,
+		float *restrict ox, float *restrict oy, float *restrict oz, float *restrict dx, float *restrict dy, float *restrict dz) {
+	const struct vector f = cam->forward;
+	for (size_t i = 0; i < count; ++i) {
+		const float ft = cam->focus_distance / (dx[i] * f.x + dy[i] * f.y + dz[i] * f.z);
+		const struct vector focus_point = { dx[i] * ft, dy[i] * ft, dz[i] * ft };
+		const struct coord lens_point = coord_scale(cam->aperture, coord_on_unit_disc_2d((const float[2]){ u2[i], u3[i] }));
+		const struct vector start = vec_add(vec_scale(cam->right, lens_point.x), vec_scale(cam->up, lens_point.y));
+		const struct vector dir = vec_normalize(vec_sub(focus_point, start));
+		ox[i] = start.x;
+		oy[i] = start.y;
+		oz[i] = start.z;
+		dx[i] = dir.x;
+		dy[i] = dir.y;
+		dz[i] = dir.z;
 	}
-	//To world space
-	tform_ray(&new_ray, cam->composite.A);
-	return new_ray;
+}
+
+static void to_world(const struct matrix4x4 *mat, size_t count,
+		float *restrict ox, float *restrict oy, float *restrict oz, float *restrict dx, float *restrict dy, float *restrict dz) {
+	const struct matrix4x4 m = *mat;
+	for (size_t i = 0; i < count; ++i) {
+		const float sx = ox[i], sy = oy[i], sz = oz[i];
+		ox[i] = m.mtx[0][0] * sx + m.mtx[0][1] * sy + m.mtx[0][2] * sz + m.mtx[0][3];
+		oy[i] = m.mtx[1][0] * sx + m.mtx[1][1] * sy + m.mtx[1][2] * sz + m.mtx[1][3];
+		oz[i] = m.mtx[2][0] * sx + m.mtx[2][1] * sy + m.mtx[2][2] * sz + m.mtx[2][3];
+		const float vx = dx[i], vy = dy[i], vz = dz[i];
+		dx[i] = m.mtx[0][0] * vx + m.mtx[0][1] * vy + m.mtx[0][2] * vz;
+		dy[i] = m.mtx[1][0] * vx + m.mtx[1][1] * vy + m.mtx[1][2] * vz;
+		dz[i] = m.mtx[2][0] * vx + m.mtx[2][1] * vy + m.mtx[2][2] * vz;
+	}
+}
+
+// The stages below are straight-line SoA loops, which the compiler can vectorize
+static void generate(const struct camera *cam, int x, int y, size_t count, struct sampler **samplers, struct camera_rays *r) {
+	r->count = count;
+	r->spread = atanf(cam->sensor_size.y / cam->height);
+	// Pixel jitter and lens position come from the same 4D point, so they're stratified against each other
+	for (size_t i = 0; i < count; ++i) {
+		float u[4];
+		getDimensions4D(samplers[i], u);
+		r->u[0][i] = u[0];
+		r->u[1][i] = u[1];
+		r->u[2][i] = u[2];
+		r->u[3][i] = u[3];
+	}
+	film_rays(cam, x, y, count, r->u[0], r->u[1], r->ox, r->oy, r->oz, r->dx, r->dy, r->dz);
+	if (cam->aperture > 0.0f) lens_rays(cam, count, r->u[2], r->u[3], r->ox, r->oy, r->oz, r->dx, r->dy, r->dz);
+	to_world(&cam->composite.A, count, r->ox, r->oy, r->oz, r->dx, r->dy, r->dz);
+}
+
+void cam_get_rays(const struct camera *cam, int x, int y, size_t count, struct sampler **samplers, struct camera_rays *rays) {
+	cam_rays_reserve(rays, count);
+	generate(cam, x, y, count, samplers, rays);
+}
+
+struct lightRay cam_get_ray(const struct camera *cam, int x, int y, struct sampler *sampler) {
+	// Same code path as the batched version, so both give identical rays
+	float block[10];
+	struct camera_rays one = { 0 };
+	cam_rays_bind(&one, block, 1);
+	generate(cam, x, y, 1, &sampler, &one);
+	return cam_rays_get(&one, 0);
 }
@@ -28,6 +28,11 @@ struct camera {
 	struct vector right;
 	struct vector look_at;
 	struct vector forward;
+
+	// Film plane, derived in cam_recompute_optics(). Pixel (x, y) maps to corner + x * pix_x + y * pix_y
+	struct vector pix_x;
+	struct vector pix_y;
+	struct vector corner;
 	
 	struct transform composite;
 	struct euler_angles orientation;
@@ -48,6 +53,34 @@ dyn_array_def(camera)
 
 struct sampler;
 
+// A batch of world space camera rays in SoA layout, see cam_get_rays()
+struct camera_rays {
+	float *ox, *oy, *oz;
+	float *dx, *dy, *dz;
+	float *u[4]; // Scratch, camera sample dimensions
+	float *block;
+	float spread; // Ray cone spread angle of a single pixel
+	size_t count;
+	size_t capacity;
+};
+
 void cam_recompute_optics(struct camera *cam);
 void cam_update_pose(struct camera *cam, const struct euler_angles *orientation, const struct vector *pos);
 struct lightRay cam_get_ray(const struct camera *cam, int x, int y, struct sampler *sampler);
+
+/// Generate camera rays for count consecutive pixels in a row, starting at (x, y)
+/// @param samplers One sampler per pixel, already initialized. They're advanced past the camera dimensions,
+/// so they can be handed straight to the integrator afterwards.
+/// @param rays Output, grown as needed
+void cam_get_rays(const struct camera *cam, int x, int y, size_t count, struct sampler **samplers, struct camera_rays *rays);
+
+static inline struct lightRay cam_rays_get(const struct camera_rays *rays, size_t i) {
+	return (struct lightRay){
+		.start = { rays->ox[i], rays->oy[i], rays->oz[i] },
+		.direction = { rays->dx[i], rays->dy[i], rays->dz[i] },
+		.type = rt_camera,
+		.cone_spread = rays->spread
+	};
+}
+
+void cam_rays_free(struct camera_rays *rays);
@@ -19,5 +19,6 @@ struct hitRecord {
 	const struct bsdfNode *bsdf;	//Surface properties of the intersected object
 	struct poly *polygon;			//ptr to polygon that was encountered
 	float distance;					//Distance to intersection point
+	float footprint;				//Ray cone width at the hit in uv units, 0 if unknown
 	int instIndex;					//Instance index, negative if no intersection
 };
@@ -26,8 +26,22 @@ struct lightRay {
 	struct vector start;
 	struct vector direction;
 	enum ray_type type : 8;
+	// Ray cone, for texture filtering. Width at the start, and how fast it grows per unit of distance.
+	float cone_width;
+	float cone_spread;
 };
 
+// Scattering off a rough surface widens the cone by some fixed amount. Deriving it from
+// the lobe would be more accurate, but this is only used to pick mip levels.
+#define CONE_SCATTER_SPREAD 0.1f
+
+/// Carry the ray cone of incident over to out, a ray scattered t units along incident
+static inline struct lightRay ray_cone_continue(struct lightRay out, const struct lightRay *incident, float t) {
+	out.cone_width = incident->cone_width + incident->cone_spread * t;
+	out.cone_spread = incident->cone_spread + (out.type & rt_singular ? 0.0f : CONE_SCATTER_SPREAD);
+	return out;
+}
+
 static inline struct vector alongRay(const struct lightRay *ray, float t) {
 	return vec_add(ray->start, vec_scale(ray->direction, t));
 }
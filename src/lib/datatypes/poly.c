@@ -27,7 +27,6 @@ bool rayIntersectsWithPolygon(const struct mesh *mesh, const struct lightRay *ra
 
 	float u = vec_dot(r, e2) * invDet;
 	float v = vec_dot(r, e1) * invDet;
-	float w = 1.0f - u - v;
 
 	// This order of comparisons guarantees that none of u, v, or t, are NaNs:
 	// IEEE-754 mandates that they compare to false if the left hand side is a NaN.
@@ -36,20 +35,29 @@ bool rayIntersectsWithPolygon(const struct mesh *mesh, const struct lightRay *ra
 		if (t >= 0.0f && t < isect->distance) {
 			isect->uv = (struct coord) { u, v };
 			isect->distance = t;
-			if (likely(poly->hasNormals)) {
-				struct vector upcomp = vec_scale(mesh->vbuf->normals.items[poly->normalIndex[1]], u);
-				struct vector vpcomp = vec_scale(mesh->vbuf->normals.items[poly->normalIndex[2]], v);
-				struct vector wpcomp = vec_scale(mesh->vbuf->normals.items[poly->normalIndex[0]], w);
-				
-				isect->surfaceNormal = vec_add(vec_add(upcomp, vpcomp), wpcomp);
-			} else {
-				isect->surfaceNormal = n;
-			}
-			// Support two-sided materials by flipping the normal if needed
-			if (vec_dot(ray->direction, isect->surfaceNormal) >= 0.0f) isect->surfaceNormal = vec_negate(isect->surfaceNormal);
-			isect->hitPoint = alongRay(ray, t);
+			finishPolygonHit(mesh, ray, poly, isect);
 			return true;
 		}
 	}
 	return false;
 }
+
+void finishPolygonHit(const struct mesh *mesh, const struct lightRay *ray, const struct poly *poly, struct hitRecord *isect) {
+	const float u = isect->uv.x;
+	const float v = isect->uv.y;
+	const float w = 1.0f - u - v;
+	if (likely(poly->hasNormals)) {
+		struct vector upcomp = vec_scale(mesh->vbuf->normals.items[poly->normalIndex[1]], u);
+		struct vector vpcomp = vec_scale(mesh->vbuf->normals.items[poly->normalIndex[2]], v);
+		struct vector wpcomp = vec_scale(mesh->vbuf->normals.items[poly->normalIndex[0]], w);
+		
+		isect->surfaceNormal = vec_add(vec_add(upcomp, vpcomp), wpcomp);
+	} else {
+		struct vector e1 = vec_sub(mesh->vbuf->vertices.items[poly->vertexIndex[0]], mesh->vbuf->vertices.items[poly->vertexIndex[1]]);
+		struct vector e2 = vec_sub(mesh->vbuf->vertices.items[poly->vertexIndex[2]], mesh->vbuf->vertices.items[poly->vertexIndex[0]]);
+		isect->surfaceNormal = vec_cross(e1, e2);
+	}
+	// Support two-sided materials by flipping the normal if needed
+	if (vec_dot(ray->direction, isect->surfaceNormal) >= 0.0f) isect->surfaceNormal = vec_negate(isect->surfaceNormal);
+	isect->hitPoint = alongRay(ray, isect->distance);
+}
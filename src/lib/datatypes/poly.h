@@ -29,3 +29,6 @@ struct mesh;
 
 //Calculates intersection between a light ray and a polygon object. Returns true if intersection has happened.
 bool rayIntersectsWithPolygon(const struct mesh *mesh, const struct lightRay *ray, const struct poly *poly, struct hitRecord *isect);
+
+//Fills in the surface normal and hit point of isect, from the uv and distance found by an intersection test against poly.
+void finishPolygonHit(const struct mesh *mesh, const struct lightRay *ray, const struct poly *poly, struct hitRecord *isect);
@@ -15,6 +15,12 @@
 #include "../../common/dyn_array.h"
 #include "../../common/node_parse.h"
 #include "../../common/texture.h"
+#include "../../common/tiled_texture.h"
+#include "../../common/texture_cache.h"
+#include "../../common/file_cache.h"
+#include "../../common/logging.h"
+#include "../../common/timer.h"
+#include "../../common/platform/thread_pool.h"
 #include "camera.h"
 #include "tile.h"
 #include "../datatypes/mesh.h"
@@ -22,11 +28,115 @@
 
 void tex_asset_free(struct texture_asset *a) {
 	if (a->path) free(a->path);
+	tiled_texture_destroy(a->tiled);
 	if (a->t) destroyTexture(a->t);
 }
 
+struct texture_job {
+	struct cr_thread_pool *pool;
+	struct tiled_texture *t;
+	bool half;
+};
+
+static void build_texture(void *arg) {
+	struct texture_job *job = arg;
+	// Rows are converted on the pool too, waiting on that from in here is fine
+	tiled_texture_build(job->pool, job->t, job->half);
+}
+
+// Biggest first, so a huge environment map doesn't start last and hold everything up
+static int cmp_texture_jobs(const void *a, const void *b) {
+	const struct texture *sa = ((const struct texture_job *)a)->t->src;
+	const struct texture *sb = ((const struct texture_job *)b)->t->src;
+	const size_t pa = sa->width * sa->height, pb = sb->width * sb->height;
+	return (pa < pb) - (pa > pb);
+}
+
+void scene_build_textures(struct cr_thread_pool *pool, struct world *scene, bool half, size_t cache_bytes) {
+	if (cache_bytes && !scene->texture_cache) scene->texture_cache = texture_cache_new(cache_bytes);
+	struct texture_job *jobs = calloc(scene->textures.count ? scene->textures.count : 1, sizeof(*jobs));
+	size_t job_count = 0;
+	for (size_t i = 0; i < scene->textures.count; ++i) {
+		struct tiled_texture *t = scene->textures.items[i].tiled;
+		if (!t || t->fetch[0]) continue;
+		if (scene->texture_cache) {
+			tiled_texture_use_cache(t, scene->texture_cache, half);
+		} else {
+			jobs[job_count++] = (struct texture_job){ .pool = pool, .t = t, .half = half };
+		}
+	}
+	if (!job_count) {
+		free(jobs);
+		return;
+	}
+
+	// Textures are decoded and tiled independently, so do them all at once
+	logr(info, "Decoding %zu texture%s: ", job_count, PLURAL(job_count));
+	struct timeval timer = { 0 };
+	timer_start(&timer);
+	qsort(jobs, job_count, sizeof(*jobs), cmp_texture_jobs);
+	struct cr_task_group group = { 0 };
+	for (size_t i = 0; i < job_count; ++i) {
+		if (pool) {
+			thread_pool_enqueue_group(pool, &group, build_texture, &jobs[i]);
+		} else {
+			build_texture(&jobs[i]);
+		}
+	}
+	if (pool) thread_pool_wait_group(pool, &group);
+	printSmartTime(timer_get_ms(timer));
+	logr(plain, "\n");
+	free(jobs);
+}
+
+struct world *scene_replicate_accels(const struct world *scene) {
+	struct world *copy = malloc(sizeof(*copy));
+	*copy = *scene;
+	copy->topLevel = bvh_clone(scene->topLevel);
+	copy->meshes = mesh_arr_copy(scene->meshes);
+	copy->meshes.capacity = copy->meshes.count;
+	for (size_t i = 0; i < copy->meshes.count; ++i) {
+		struct mesh *m = &copy->meshes.items[i];
+		m->bvh = bvh_clone(m->bvh);
+		m->polygons = poly_arr_copy(m->polygons);
+		m->polygons.capacity = m->polygons.count;
+	}
+	// Sphere data is only read for the closest hit, so just the BVHs get copied
+	copy->sphere_sets = sphere_set_arr_copy(scene->sphere_sets);
+	copy->sphere_sets.capacity = copy->sphere_sets.count;
+	for (size_t i = 0; i < copy->sphere_sets.count; ++i) {
+		copy->sphere_sets.items[i].bvh = bvh_clone(copy->sphere_sets.items[i].bvh);
+	}
+	// Point mesh and sphere set instances at our copies
+	copy->instances = instance_arr_copy(scene->instances);
+	copy->instances.capacity = copy->instances.count;
+	for (size_t i = 0; i < copy->instances.count; ++i) {
+		struct instance *inst = &copy->instances.items[i];
+		if (inst->object_arr == &scene->meshes) inst->object_arr = &copy->meshes;
+		if (inst->object_arr == &scene->sphere_sets) inst->object_arr = &copy->sphere_sets;
+	}
+	return copy;
+}
+
+void scene_replica_free(struct world *replica) {
+	if (!replica) return;
+	for (size_t i = 0; i < replica->meshes.count; ++i) {
+		destroy_bvh(replica->meshes.items[i].bvh);
+		free(replica->meshes.items[i].polygons.items);
+	}
+	free(replica->meshes.items);
+	for (size_t i = 0; i < replica->sphere_sets.count; ++i) {
+		destroy_bvh(replica->sphere_sets.items[i].bvh);
+	}
+	free(replica->sphere_sets.items);
+	free(replica->instances.items);
+	destroy_bvh(replica->topLevel);
+	free(replica);
+}
+
 void scene_destroy(struct world *scene) {
 	if (scene) {
+		texture_cache_destroy(scene->texture_cache);
 		scene->textures.elem_free = tex_asset_free;
 		texture_asset_arr_free(&scene->textures);
 		camera_arr_free(&scene->cameras);
@@ -46,7 +156,11 @@ void scene_destroy(struct world *scene) {
 		vertex_buffer_arr_free(&scene->v_buffers);
 		instance_arr_free(&scene->instances);
 		sphere_arr_free(&scene->spheres);
+		scene->sphere_sets.elem_free = sphere_set_free;
+		sphere_set_arr_free(&scene->sphere_sets);
 		if (scene->asset_path) free(scene->asset_path);
+		// Last, deferred textures point into this
+		file_cache_destroy(scene->cache);
 		free(scene);
 	}
 }
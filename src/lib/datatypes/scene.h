@@ -24,6 +24,8 @@ struct node_storage {
 	struct block *node_pool;
 	// Used for hash consing. (preventing duplicate nodes)
 	struct hashtable *node_table;
+	// Optional, counts nodes that were folded or pruned away during construction
+	size_t *eliminated;
 };
 
 struct world {
@@ -31,6 +33,7 @@ struct world {
 	const struct bsdfNode *background;
 	struct cr_shader_node *bg_desc;
 	struct texture_asset_arr textures;
+	struct texture_cache *texture_cache; // Optional, set up in scene_build_textures()
 	struct vertex_buffer_arr v_buffers;
 	struct bsdf_buffer_arr shader_buffers;
 	struct mesh_arr meshes;
@@ -40,14 +43,30 @@ struct world {
 	// contains all 3D assets in the scene.
 	struct bvh *topLevel; // FIXME: Move to state?
 	struct sphere_arr spheres;
+	struct sphere_set_arr sphere_sets;
 	struct camera_arr cameras;
 	struct node_storage storage; // FIXME: Move to state?
+	size_t eliminated_nodes; // storage.eliminated points here
 
 	// c-ray is Y up, blender is Z up. This flag toggles
 	// between the two in c-ray.
 	bool use_blender_coordinates;
 
 	char *asset_path;
+	struct file_cache *cache; // Files loaded for this scene, kept across cr_load_json() calls
 };
 
 void scene_destroy(struct world *scene);
+
+struct cr_thread_pool;
+
+/// Tile textures and build their mip chains. Textures that are already set up are skipped.
+/// @param half Store float textures as half floats
+/// @param cache_bytes If nonzero, levels are instead built on demand, into a cache of this size
+void scene_build_textures(struct cr_thread_pool *pool, struct world *scene, bool half, size_t cache_bytes);
+
+/// Shallow copy of scene, with private copies of the read-only acceleration data:
+/// the top-level BVH, instances, meshes, their BVHs and polygons, and sphere set BVHs.
+/// Everything else is shared with scene. Used to keep a copy on each NUMA node.
+struct world *scene_replicate_accels(const struct world *scene);
+void scene_replica_free(struct world *replica);
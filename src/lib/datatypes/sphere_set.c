@@ -0,0 +1,21 @@
+//
+//  sphere_set.c
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "../../includes.h"
+#include "sphere_set.h"
+
+#include "../accelerators/bvh.h"
+
+void sphere_set_free(struct sphere_set *set) {
+	if (set) {
+		vector_arr_free(&set->centers);
+		float_arr_free(&set->radii);
+		int_arr_free(&set->materials);
+		destroy_bvh(set->bvh);
+	}
+}
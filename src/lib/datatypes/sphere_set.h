@@ -0,0 +1,28 @@
+//
+//  sphere_set.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#pragma once
+
+#include "../../common/dyn_array.h"
+#include "../../common/vector.h"
+
+// Lots of spheres in one object, for particles and point clouds. Unlike a sphere, which
+// needs an instance each, a whole set is one instance with its own bottom-level BVH.
+// Spheres are placed by their centers, so there's no per-sphere transform.
+struct sphere_set {
+	struct vector_arr centers;
+	struct float_arr radii;
+	struct int_arr materials; // Indices into the instance material set. Empty if they all use the first one.
+	struct bvh *bvh;
+	float rayOffset;
+};
+
+typedef struct sphere_set sphere_set;
+dyn_array_def(sphere_set)
+
+void sphere_set_free(struct sphere_set *set);
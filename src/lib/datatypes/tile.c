@@ -12,67 +12,141 @@
 
 #include "../../common/logging.h"
 #include "../../common/platform/mutex.h"
+#include "../../common/platform/atomics.h"
 #include "../vendored/pcg_basic.h"
 #include <string.h>
 
-static void tiles_reorder(struct render_tile_arr *tiles, enum render_order tileOrder);
+static void tiles_reorder(struct render_tile_arr *tiles, enum render_order tileOrder, unsigned tiles_x, unsigned tiles_y);
 
-struct render_tile *tile_next(struct tile_set *set) {
+// Slow path, only hit once the set has been fully handed out.
+static struct render_tile *reclaim_network_tile(struct tile_set *set) {
 	struct render_tile *tile = NULL;
 	mutex_lock(set->tile_mutex);
-	if (set->finished < set->tiles.count) {
-		tile = &set->tiles.items[set->finished];
-		tile->state = rendering;
-		tile->index = set->finished++;
-	} else {
-		// If a network worker disappeared during render, finish those tiles locally here at the end
-		for (size_t t = 0; t < set->tiles.count; ++t) {
-			if (set->tiles.items[t].state == rendering && set->tiles.items[t].network_renderer) {
-				set->tiles.items[t].network_renderer = false;
-				tile = &set->tiles.items[t];
-				tile->state = rendering;
-				tile->index = t;
-				break;
-			}
+	// If a network worker disappeared during render, finish those tiles locally here at the end
+	for (size_t t = 0; t < set->tiles.count; ++t) {
+		if (set->tiles.items[t].state == rendering && set->tiles.items[t].network_renderer) {
+			set->tiles.items[t].network_renderer = false;
+			tile = &set->tiles.items[t];
+			tile->state = rendering;
+			tile->index = t;
+			break;
 		}
 	}
 	mutex_release(set->tile_mutex);
 	return tile;
 }
 
-struct render_tile *tile_next_interactive(struct renderer *r, struct tile_set *set) {
-	struct render_tile *tile = NULL;
-	mutex_lock(set->tile_mutex);
-	again:
-	if (r->state.finishedPasses < r->prefs.sampleCount + 1) {
-		if (set->finished < set->tiles.count) {
-			tile = &set->tiles.items[set->finished];
-			tile->state = rendering;
-			tile->index = set->finished++;
-		} else {
-			r->state.finishedPasses++;
-			// FIXME: It's pretty confusing that we're firing this callback here instead of in the
-			// renderer main loop directly.
-			struct cr_renderer_cb_info cb_info = { 0 };
-			cb_info.finished_passes = r->state.finishedPasses - 1;
-			struct callback cb = r->state.callbacks[cr_cb_on_interactive_pass_finished];
-			if (cb.fn) cb.fn(&cb_info, cb.user_data);
-			set->finished = 0;
-			goto again;
+static struct render_tile *tile_claim(struct tile_set *set) {
+	size_t idx = atomic_add_size(&set->finished, 1);
+	if (idx >= set->tiles.count) return NULL;
+	struct render_tile *tile = &set->tiles.items[idx];
+	tile->state = rendering;
+	tile->index = idx;
+	return tile;
+}
+
+struct render_tile *tile_next(struct tile_set *set) {
+	struct render_tile *tile = tile_claim(set);
+	if (tile) return tile;
+	return reclaim_network_tile(set);
+}
+
+struct render_tile *tile_next_or_join(struct tile_set *set) {
+	struct render_tile *tile = tile_claim(set);
+	if (tile) return tile;
+	// Queue has drained. Instead of idling, join the tile with the most samples left to hand out.
+	size_t most_left = 0;
+	for (size_t t = 0; t < set->tiles.count; ++t) {
+		struct render_tile *candidate = &set->tiles.items[t];
+		if (candidate->state != rendering || candidate->network_renderer) continue;
+		const size_t claimed = atomic_load_size(&candidate->claimed_samples);
+		if (claimed >= candidate->total_samples) continue;
+		const size_t left = candidate->total_samples - claimed;
+		if (left > most_left) {
+			most_left = left;
+			tile = candidate;
 		}
 	}
-	if (!tile) {
-		// FIXME: shared state to indicate pause instead of accessing worker state
-		if (r->state.render_aborted || r->state.workers.items[0].paused) {
-			mutex_release(set->tile_mutex);
-			return NULL;
+	if (tile) return tile;
+	return reclaim_network_tile(set);
+}
+
+size_t tile_claim_samples(struct render_tile *tile, size_t count, size_t *first) {
+	const size_t claimed = atomic_add_size(&tile->claimed_samples, count);
+	if (claimed >= tile->total_samples) return 0;
+	*first = claimed;
+	return min(count, tile->total_samples - claimed);
+}
+
+static bool should_idle(struct renderer *r) {
+	// FIXME: shared state to indicate pause instead of accessing worker state
+	return r->state.render_aborted || r->state.workers.items[0].paused;
+}
+
+struct render_tile *tile_next_interactive(struct renderer *r, struct tile_set *set) {
+	while (true) {
+		if (should_idle(r)) return NULL;
+		mutex_lock(set->tile_mutex);
+		const size_t pass = set->pass;
+		const bool samples_left = r->state.finishedPasses < r->prefs.sampleCount + 1;
+		mutex_release(set->tile_mutex);
+
+		if (samples_left) {
+			struct render_tile *tile = tile_claim(set);
+			if (tile) return tile;
+		}
+
+		// Nothing left in this pass. Either we're the last one out, and we kick off the next pass,
+		// or we sleep until someone else does. If we've already reached the sample limit, we wait
+		// for tile_set_restart() instead.
+		mutex_lock(set->tile_mutex);
+		while (set->pass == pass && !should_idle(r)) {
+			if (samples_left && atomic_load_size(&set->completed) >= set->tiles.count) {
+				r->state.finishedPasses++;
+				// FIXME: It's pretty confusing that we're firing this callback here instead of in the
+				// renderer main loop directly.
+				struct cr_renderer_cb_info cb_info = { 0 };
+				cb_info.finished_passes = r->state.finishedPasses - 1;
+				struct callback cb = r->state.callbacks[cr_cb_on_interactive_pass_finished];
+				if (cb.fn) cb.fn(&cb_info, cb.user_data);
+				atomic_store_size(&set->completed, 0);
+				atomic_store_size(&set->finished, 0);
+				set->pass++;
+				thread_cond_broadcast(set->pass_cond);
+				break;
+			}
+			thread_cond_wait(set->pass_cond, set->tile_mutex);
 		}
-		// FIXME: Use an atomic conditional for this, instead of polling here
-		timer_sleep_ms(32);
-		goto again;
+		mutex_release(set->tile_mutex);
+	}
+}
+
+void tile_finish(struct tile_set *set, struct render_tile *tile) {
+	tile->state = finished;
+	if (atomic_add_size(&set->completed, 1) + 1 >= set->tiles.count) {
+		// Last tile of this pass, wake up whoever is waiting to start the next one.
+		tile_set_wake(set);
 	}
+}
+
+size_t tile_set_claimed(struct tile_set *set) {
+	return min(atomic_load_size(&set->finished), set->tiles.count);
+}
+
+void tile_set_restart(struct tile_set *set) {
+	mutex_lock(set->tile_mutex);
+	atomic_store_size(&set->completed, 0);
+	atomic_store_size(&set->finished, 0);
+	set->pass++;
+	thread_cond_broadcast(set->pass_cond);
+	mutex_release(set->tile_mutex);
+}
+
+void tile_set_wake(struct tile_set *set) {
+	if (!set) return;
+	mutex_lock(set->tile_mutex);
+	thread_cond_broadcast(set->pass_cond);
 	mutex_release(set->tile_mutex);
-	return tile;
 }
 
 struct tile_set tile_quantize(unsigned width, unsigned height, unsigned tile_w, unsigned tile_h, enum render_order order) {
@@ -81,6 +155,8 @@ struct tile_set tile_quantize(unsigned width, unsigned height, unsigned tile_w,
 
 	struct tile_set set = { 0 };
 	set.tile_mutex = mutex_create();
+	set.pass_cond = calloc(1, sizeof(*set.pass_cond));
+	thread_cond_init(set.pass_cond);
 
 	//Sanity check on tilesizes
 	if (tile_w >= width) tile_w = width;
@@ -116,20 +192,27 @@ struct tile_set tile_quantize(unsigned width, unsigned height, unsigned tile_w,
 			tile.state = ready_to_render;
 
 			tile.index = tileCount++;
+			tile.merge_lock = mutex_create();
 			render_tile_arr_add(&set.tiles, tile);
 		}
 	}
 	logr(info, "Quantized image into %i tiles. (%ix%i)\n", (tiles_x * tiles_y), tiles_x, tiles_y);
 
-	tiles_reorder(&set.tiles, order);
+	tiles_reorder(&set.tiles, order, tiles_x, tiles_y);
 
 	return set;
 }
 
 void tile_set_free(struct tile_set *set) {
+	for (size_t i = 0; i < set->tiles.count; ++i) {
+		mutex_destroy(set->tiles.items[i].merge_lock);
+	}
 	render_tile_arr_free(&set->tiles);
 	mutex_destroy(set->tile_mutex);
 	set->tile_mutex = NULL;
+	thread_cond_destroy(set->pass_cond);
+	free(set->pass_cond);
+	set->pass_cond = NULL;
 }
 
 static void reorder_top_to_bottom(struct render_tile_arr *tiles) {
@@ -218,7 +301,46 @@ static void reorder_to_middle(struct render_tile_arr *tiles) {
 	*tiles = temp;
 }
 
-static void tiles_reorder(struct render_tile_arr *tiles, enum render_order tileOrder) {
+// Map distance d along a Hilbert curve covering an n*n grid to grid coordinates
+// From https://en.wikipedia.org/wiki/Hilbert_curve
+static void hilbert_d2xy(unsigned n, unsigned d, unsigned *x, unsigned *y) {
+	unsigned rx, ry, t = d;
+	*x = *y = 0;
+	for (unsigned s = 1; s < n; s *= 2) {
+		rx = 1 & (t / 2);
+		ry = 1 & (t ^ rx);
+		if (ry == 0) {
+			if (rx == 1) {
+				*x = s - 1 - *x;
+				*y = s - 1 - *y;
+			}
+			unsigned tmp = *x;
+			*x = *y;
+			*y = tmp;
+		}
+		*x += s * rx;
+		*y += s * ry;
+		t /= 4;
+	}
+}
+
+// Walk a Hilbert curve over the smallest power of two grid that fits, skipping cells outside the image.
+// Consecutive tiles are then always adjacent, so threads working on neighbouring tiles share BVH nodes and texels in cache.
+static void reorder_hilbert(struct render_tile_arr *tiles, unsigned tiles_x, unsigned tiles_y) {
+	unsigned n = 1;
+	while (n < tiles_x || n < tiles_y) n *= 2;
+	struct render_tile_arr temp = { 0 };
+	for (unsigned d = 0; d < n * n; ++d) {
+		unsigned x, y;
+		hilbert_d2xy(n, d, &x, &y);
+		if (x >= tiles_x || y >= tiles_y) continue;
+		render_tile_arr_add(&temp, tiles->items[y * tiles_x + x]);
+	}
+	render_tile_arr_free(tiles);
+	*tiles = temp;
+}
+
+static void tiles_reorder(struct render_tile_arr *tiles, enum render_order tileOrder, unsigned tiles_x, unsigned tiles_y) {
 	switch (tileOrder) {
 		case ro_from_middle:
 			reorder_from_middle(tiles);
@@ -232,6 +354,9 @@ static void tiles_reorder(struct render_tile_arr *tiles, enum render_order tileO
 		case ro_random:
 			reorder_random(tiles);
 			break;
+		case ro_hilbert:
+			reorder_hilbert(tiles, tiles_x, tiles_y);
+			break;
 		default:
 			break;
 	}
@@ -11,6 +11,7 @@
 #include "../../includes.h"
 #include "../../common/dyn_array.h"
 #include "../../common/platform/mutex.h"
+#include "../../common/platform/thread.h"
 
 #include "../../common/vector.h"
 
@@ -19,7 +20,8 @@ enum render_order {
 	ro_from_middle,
 	ro_to_middle,
 	ro_normal,
-	ro_random
+	ro_random,
+	ro_hilbert, // Along a Hilbert curve, consecutive tiles are neighbours
 };
 
 struct renderer;
@@ -39,7 +41,9 @@ struct render_tile {
 	bool network_renderer; //FIXME: client struct ptr
 	int index;
 	size_t total_samples;
-	size_t completed_samples;
+	size_t completed_samples; // Samples merged into the framebuffer
+	size_t claimed_samples; // Samples handed out to render threads, bumped atomically
+	struct cr_mutex *merge_lock; // Held while merging partial results, see accum_flush()
 };
 
 typedef struct render_tile render_tile;
@@ -47,8 +51,11 @@ dyn_array_def(render_tile)
 
 struct tile_set {
 	struct render_tile_arr tiles;
-	size_t finished;
+	size_t finished; // Next tile to hand out, bumped atomically. May overshoot tiles.count
+	size_t completed; // Tiles finished in the current interactive pass, bumped atomically
+	size_t pass; // Incremented on every interactive pass transition, protected by tile_mutex
 	struct cr_mutex *tile_mutex;
+	struct cr_cond *pass_cond; // Idle threads sleep on this at the end of an interactive pass
 };
 
 struct tile_set tile_quantize(unsigned width, unsigned height, unsigned tile_w, unsigned tile_h, enum render_order order);
@@ -56,4 +63,26 @@ void tile_set_free(struct tile_set *set);
 
 struct render_tile *tile_next(struct tile_set *set);
 
+/// Like tile_next(), but once every tile has been handed out, returns an in-flight
+/// tile that still has unclaimed samples left, so idle threads can help finish it.
+/// @remarks Only for local render threads. Results must be merged with accum_flush()
+struct render_tile *tile_next_or_join(struct tile_set *set);
+
+/// Claim up to count samples of tile for rendering.
+/// @param first Receives the index of the first claimed sample
+/// @return Amount of samples claimed, 0 when the tile has been fully handed out
+size_t tile_claim_samples(struct render_tile *tile, size_t count, size_t *first);
+
 struct render_tile *tile_next_interactive(struct renderer *r, struct tile_set *set);
+
+/// Mark a tile as done. Render threads must call this before fetching another tile.
+void tile_finish(struct tile_set *set, struct render_tile *tile);
+
+/// Amount of tiles handed out so far, for progress reporting
+size_t tile_set_claimed(struct tile_set *set);
+
+/// Reset the set for a new round of interactive passes
+void tile_set_restart(struct tile_set *set);
+
+/// Wake threads sleeping in tile_next_interactive() to re-check renderer state (abort, pause)
+void tile_set_wake(struct tile_set *set);
@@ -13,6 +13,7 @@
 #include "../../common/node_parse.h"
 #include "../../common/string.h"
 #include "bsdfnode.h"
+#include "compiler.h"
 #include <c-ray/c-ray.h>
 
 static const struct bsdfNode *warning_bsdf(const struct node_storage *s) {
@@ -34,46 +35,76 @@ void bsdf_buffer_free(struct bsdf_buffer *b) {
 	cr_shader_node_ptr_arr_free(&b->descriptions);
 }
 
-const struct bsdfNode *build_bsdf_node(struct cr_scene *s_ext, const struct cr_shader_node *desc) {
-	if (!s_ext) return NULL;
+// BSDF inputs are compiled into flat programs here, see compiler.h
+static const struct colorNode *color_input(struct cr_scene *s_ext, const struct cr_color_node *desc) {
+	struct world *scene = (struct world *)s_ext;
+	return compile_color_node(&scene->storage, build_color_node(s_ext, desc));
+}
+
+static const struct valueNode *value_input(struct cr_scene *s_ext, const struct cr_value_node *desc) {
+	struct world *scene = (struct world *)s_ext;
+	return compile_value_node(&scene->storage, build_value_node(s_ext, desc));
+}
+
+static const struct vectorNode *vector_input(struct cr_scene *s_ext, const struct cr_vector_node *desc) {
+	struct world *scene = (struct world *)s_ext;
+	return compile_vector_node(&scene->storage, build_vector_node(s_ext, desc));
+}
+
+static const struct bsdfNode *build_bsdf(struct cr_scene *s_ext, const struct cr_shader_node *desc) {
 	struct world *scene = (struct world *)s_ext;
 	struct node_storage s = scene->storage;
 	if (!desc) return warning_bsdf(&s);
 	switch (desc->type) {
 		case cr_bsdf_diffuse:
-			return newDiffuse(&s, build_color_node(s_ext, desc->arg.diffuse.color));
+			return newDiffuse(&s, color_input(s_ext, desc->arg.diffuse.color));
 		case cr_bsdf_metal:
-			return newMetal(&s, build_color_node(s_ext, desc->arg.metal.color), build_value_node(s_ext, desc->arg.metal.roughness));
+			return newMetal(&s, color_input(s_ext, desc->arg.metal.color), value_input(s_ext, desc->arg.metal.roughness));
 		case cr_bsdf_glass:
 			return newGlass(&s,
-				build_color_node(s_ext, desc->arg.glass.color),
-				build_value_node(s_ext, desc->arg.glass.roughness),
-				build_value_node(s_ext, desc->arg.glass.IOR));
+				color_input(s_ext, desc->arg.glass.color),
+				value_input(s_ext, desc->arg.glass.roughness),
+				value_input(s_ext, desc->arg.glass.IOR));
 		case cr_bsdf_plastic:
 			return newPlastic(&s,
-				build_color_node(s_ext, desc->arg.plastic.color),
-				build_value_node(s_ext, desc->arg.plastic.roughness),
-				build_value_node(s_ext, desc->arg.plastic.IOR));
+				color_input(s_ext, desc->arg.plastic.color),
+				value_input(s_ext, desc->arg.plastic.roughness),
+				value_input(s_ext, desc->arg.plastic.IOR));
 		case cr_bsdf_mix:
 			return newMix(&s,
-				build_bsdf_node(s_ext, desc->arg.mix.A),
-				build_bsdf_node(s_ext, desc->arg.mix.B),
-				build_value_node(s_ext, desc->arg.mix.factor));
+				build_bsdf(s_ext, desc->arg.mix.A),
+				build_bsdf(s_ext, desc->arg.mix.B),
+				value_input(s_ext, desc->arg.mix.factor));
 		case cr_bsdf_add:
-			return newAdd(&s, build_bsdf_node(s_ext, desc->arg.add.A), build_bsdf_node(s_ext, desc->arg.add.B));
+			// Both get sampled, so mixes under an add pick their BSDF in a program of their own
+			return newAdd(&s,
+				compile_bsdf_node(&s, build_bsdf(s_ext, desc->arg.add.A)),
+				compile_bsdf_node(&s, build_bsdf(s_ext, desc->arg.add.B)));
 		case cr_bsdf_transparent:
-			return newTransparent(&s, build_color_node(s_ext, desc->arg.transparent.color));
+			return newTransparent(&s, color_input(s_ext, desc->arg.transparent.color));
 		case cr_bsdf_emissive:
-			return newEmission(&s, build_color_node(s_ext, desc->arg.emissive.color), build_value_node(s_ext, desc->arg.emissive.strength));
+			return newEmission(&s, color_input(s_ext, desc->arg.emissive.color), value_input(s_ext, desc->arg.emissive.strength));
 		case cr_bsdf_translucent:
-			return newTranslucent(&s, build_color_node(s_ext, desc->arg.translucent.color));
+			return newTranslucent(&s, color_input(s_ext, desc->arg.translucent.color));
 		case cr_bsdf_background: {
 			return newBackground(&s,
-				build_color_node(s_ext, desc->arg.background.color),
-				build_value_node(s_ext, desc->arg.background.strength),
-				build_vector_node(s_ext, desc->arg.background.pose), scene->use_blender_coordinates);
+				color_input(s_ext, desc->arg.background.color),
+				value_input(s_ext, desc->arg.background.strength),
+				vector_input(s_ext, desc->arg.background.pose), scene->use_blender_coordinates);
 		}
 		default:
 			return warning_bsdf(&s);
 	};
 }
+
+const struct bsdfNode *build_bsdf_node(struct cr_scene *s_ext, const struct cr_shader_node *desc) {
+	if (!s_ext) return NULL;
+	struct world *scene = (struct world *)s_ext;
+	// Constructors fold constant subtrees and prune dead mix branches as the graph is built
+	const size_t eliminated = scene->eliminated_nodes;
+	const struct bsdfNode *node = compile_bsdf_node(&scene->storage, build_bsdf(s_ext, desc));
+	if (scene->eliminated_nodes > eliminated) {
+		logr(debug, "Material simplified, eliminated %zu nodes\n", scene->eliminated_nodes - eliminated);
+	}
+	return node;
+}
@@ -14,6 +14,8 @@
 #include "../../common/string.h"
 #include "../datatypes/scene.h"
 #include "../../common/loaders/textureloader.h"
+#include "../../common/tiled_texture.h"
+#include "../../common/file_cache.h"
 #include "bsdfnode.h"
 
 #include "colornode.h"
@@ -44,23 +46,22 @@ const struct colorNode *build_color_node(struct cr_scene *s_ext, const struct cr
 				windowsFixPath(full);
 			}
 			const char *path = full ? full : desc->arg.image.full_path;
-			file_data data = file_load(path);
-			struct texture *tex = NULL;
-			// Note: We also deduplicate texture loads here, which ideally shouldn't be necessary.
-			for (size_t i = 0; i < scene->textures.count; ++i) {
-				if (stringEquals(scene->textures.items[i].path, path)) {
-					tex = scene->textures.items[i].t;
-				}
-			}
-			if (!tex) {
-				tex = load_texture(path, data);
+			// Textures are shared by every reference to the same file contents
+			file_data data = file_cache_load(scene->cache, path);
+			struct tiled_texture *tiled = data.items ? file_cache_asset(scene->cache, path, file_cache_texture) : NULL;
+			if (!tiled) {
+				// Only the header is read here, pixels are decoded in render prep, or on demand
+				struct texture *header = load_texture_header(path, data);
+				if (header) tiled = tiled_texture_new_deferred(header, path, data);
 				texture_asset_arr_add(&scene->textures, (struct texture_asset){
 					.path = stringCopy(path),
-					.t = tex
+					.t = header,
+					.tiled = tiled
 				});
+				// The scene owns it
+				if (tiled) file_cache_set_asset(scene->cache, path, file_cache_texture, tiled, NULL);
 			}
-			file_free(&data);
-			const struct colorNode *new = newImageTexture(&s, tex, desc->arg.image.options);
+			const struct colorNode *new = newImageTexture(&s, tiled, desc->arg.image.options);
 			if (full) free(full);
 			return new;
 		}
@@ -22,6 +22,7 @@ enum textureType {
 struct colorNode {
 	struct nodeBase base;
 	struct color (*eval)(const struct colorNode *node, sampler *sampler, const struct hitRecord *record);
+	bool constant;
 };
 
 #include "textures/checker.h"
@@ -0,0 +1,444 @@
+//
+//  compiler.c
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include "../../includes.h"
+#include "../../common/hashtable.h"
+#include "../../common/mempool.h"
+#include "../../common/dyn_array.h"
+#include "../datatypes/scene.h"
+#include "../datatypes/hitrecord.h"
+#include "bsdfnode.h"
+
+#include "compiler.h"
+
+typedef union node_reg node_reg;
+dyn_array_def(node_reg)
+typedef struct node_insn node_insn;
+dyn_array_def(node_insn)
+typedef const void * node_ptr;
+dyn_array_def(node_ptr)
+
+struct memo_entry {
+	const void *node;
+	uint16_t reg;
+};
+typedef struct memo_entry memo_entry;
+dyn_array_def(memo_entry)
+
+// Constants get numbered separately while compiling, and are moved in front
+// of the other registers once we know how many there are.
+#define CONSTANT_BIT 0x8000
+
+struct node_compiler {
+	struct node_reg_arr constants;
+	struct node_insn_arr code;
+	struct node_ptr_arr calls;
+	struct memo_entry_arr memo; // Nodes already computed, and where the result is
+	size_t registers;
+	size_t mixes; // Number of stochastic nodes emitted so far
+	bool failed;
+};
+
+// How many of arg[] are registers, the rest are jump targets or call indices
+static const uint8_t register_args[] = {
+	[op_call_value] = 0,
+	[op_call_color] = 0,
+	[op_call_vector] = 0,
+	[op_move] = 1,
+	[op_jump] = 0,
+	[op_mix] = 1,
+	[op_math] = 2,
+	[op_vec_math] = 4,
+	[op_map_range] = 3,
+	[op_lerp] = 3,
+	[op_combine_rgb] = 3,
+	[op_split] = 1,
+	[op_grayscale] = 1,
+	[op_vec_to_color] = 1,
+	[op_vec_to_value] = 1,
+	[op_uv] = 0,
+	[op_normal] = 0,
+	[op_bsdf] = 0,
+};
+
+static uint16_t new_register(struct node_compiler *c) {
+	// Keep counting past the limit, so compile_program() can tell why it failed
+	if (c->registers >= NODE_MAX_REGISTERS) c->failed = true;
+	return (uint16_t)c->registers++;
+}
+
+static size_t emit_raw(struct node_compiler *c, struct node_insn insn) {
+	return node_insn_arr_add(&c->code, insn);
+}
+
+uint16_t node_emit(struct node_compiler *c, struct node_insn insn) {
+	insn.dst = new_register(c);
+	emit_raw(c, insn);
+	return insn.dst;
+}
+
+uint16_t node_emit_constant(struct node_compiler *c, union node_reg value) {
+	return (uint16_t)(node_reg_arr_add(&c->constants, value) | CONSTANT_BIT);
+}
+
+static uint16_t compile_input(struct node_compiler *c, const void *node, enum node_kind kind) {
+	if (!node) {
+		c->failed = true;
+		return 0;
+	}
+	// Nodes are hash-consed, so identical subgraphs are the same pointer.
+	for (size_t i = 0; i < c->memo.count; ++i) {
+		if (c->memo.items[i].node == node) return c->memo.items[i].reg;
+	}
+	const struct nodeBase *base = node;
+	const size_t mixes = c->mixes;
+	uint16_t reg;
+	if (base->compile) {
+		reg = base->compile(node, c);
+	} else {
+		static const enum node_op calls[] = { [node_value] = op_call_value, [node_color] = op_call_color, [node_vector] = op_call_vector, [node_bsdf] = op_bsdf };
+		const size_t idx = node_ptr_arr_add(&c->calls, node);
+		reg = node_emit(c, (struct node_insn){ .op = calls[kind], .arg = { (uint16_t)idx } });
+	}
+	// Stochastic nodes draw samples, reusing their result would change what the tree walk computes
+	if (c->mixes == mixes) memo_entry_arr_add(&c->memo, (struct memo_entry){ node, reg });
+	return reg;
+}
+
+uint16_t compile_value_input(struct node_compiler *c, const struct valueNode *node) {
+	return compile_input(c, node, node_value);
+}
+
+uint16_t compile_color_input(struct node_compiler *c, const struct colorNode *node) {
+	return compile_input(c, node, node_color);
+}
+
+uint16_t compile_vector_input(struct node_compiler *c, const struct vectorNode *node) {
+	return compile_input(c, node, node_vector);
+}
+
+uint16_t node_emit_mix(struct node_compiler *c, enum node_kind kind, const struct valueNode *factor, const void *A, const void *B) {
+	const uint16_t f = compile_value_input(c, factor);
+	c->mixes++;
+	const uint16_t out = new_register(c);
+	const size_t branch = emit_raw(c, (struct node_insn){ .op = op_mix, .arg = { f } });
+	// Results computed within a branch aren't there if the other one ran
+	const size_t memo_mark = c->memo.count;
+	const uint16_t a = compile_input(c, A, kind);
+	emit_raw(c, (struct node_insn){ .op = op_move, .dst = out, .arg = { a } });
+	const size_t jump = emit_raw(c, (struct node_insn){ .op = op_jump });
+	c->memo.count = memo_mark;
+
+	c->code.items[branch].arg[1] = (uint16_t)c->code.count;
+	const uint16_t b = compile_input(c, B, kind);
+	emit_raw(c, (struct node_insn){ .op = op_move, .dst = out, .arg = { b } });
+	c->code.items[jump].arg[0] = (uint16_t)c->code.count;
+	c->memo.count = memo_mark;
+	return out;
+}
+
+static uint16_t remap(const struct node_compiler *c, uint16_t reg) {
+	return reg & CONSTANT_BIT ? reg & ~CONSTANT_BIT : (uint16_t)(reg + c->constants.count);
+}
+
+static const struct node_program *compile_program(const struct node_storage *s, const void *root, enum node_kind kind) {
+	struct node_compiler c = { 0 };
+	const uint16_t result = compile_input(&c, root, kind);
+	const struct node_program *program = NULL;
+	if (c.constants.count + c.registers > NODE_MAX_REGISTERS) {
+		logr(debug, "Node graph needs over %d registers, tree-walking it instead\n", NODE_MAX_REGISTERS);
+		goto done;
+	}
+	if (c.failed || !c.code.count || c.code.count > UINT16_MAX) goto done;
+
+	const size_t constants_size = c.constants.count * sizeof(union node_reg);
+	const size_t calls_size = c.calls.count * sizeof(const void *);
+	const size_t code_size = c.code.count * sizeof(struct node_insn);
+	char *mem = allocBlock(s->node_table->pool, sizeof(struct node_program) + constants_size + calls_size + code_size);
+	struct node_program *p = (struct node_program *)mem;
+	union node_reg *constants = (union node_reg *)(mem + sizeof(*p));
+	const void **calls = (const void **)(mem + sizeof(*p) + constants_size);
+	struct node_insn *code = (struct node_insn *)(mem + sizeof(*p) + constants_size + calls_size);
+	if (constants_size) memcpy(constants, c.constants.items, constants_size);
+	if (calls_size) memcpy(calls, c.calls.items, calls_size);
+	for (size_t i = 0; i < c.code.count; ++i) {
+		struct node_insn insn = c.code.items[i];
+		insn.dst = remap(&c, insn.dst);
+		for (uint8_t a = 0; a < register_args[insn.op]; ++a) insn.arg[a] = remap(&c, insn.arg[a]);
+		code[i] = insn;
+	}
+	*p = (struct node_program){
+		.constants = constants,
+		.code = code,
+		.calls = calls,
+		.constant_count = (uint16_t)c.constants.count,
+		.insn_count = (uint16_t)c.code.count,
+		.register_count = (uint16_t)(c.constants.count + c.registers),
+		.result = remap(&c, result),
+	};
+	program = p;
+done:
+	node_reg_arr_free(&c.constants);
+	node_insn_arr_free(&c.code);
+	node_ptr_arr_free(&c.calls);
+	memo_entry_arr_free(&c.memo);
+	return program;
+}
+
+void node_program_run(const struct node_program *p, union node_reg *regs, sampler *sampler, const struct hitRecord *record) {
+	memcpy(regs, p->constants, p->constant_count * sizeof(*regs));
+	const struct node_insn *code = p->code;
+	size_t pc = 0;
+	while (pc < p->insn_count) {
+		const struct node_insn *i = &code[pc++];
+		union node_reg *d = &regs[i->dst];
+		const union node_reg *a = &regs[i->arg[0]];
+		switch ((enum node_op)i->op) {
+			case op_call_value: {
+				const struct valueNode *n = p->calls[i->arg[0]];
+				d->value = n->eval(n, sampler, record);
+				break;
+			}
+			case op_call_color: {
+				const struct colorNode *n = p->calls[i->arg[0]];
+				d->color = n->eval(n, sampler, record);
+				break;
+			}
+			case op_call_vector: {
+				const struct vectorNode *n = p->calls[i->arg[0]];
+				d->vector = n->eval(n, sampler, record);
+				break;
+			}
+			case op_move:
+				*d = *a;
+				break;
+			case op_jump:
+				pc = i->arg[0];
+				break;
+			case op_mix:
+				if (!(getDimension(sampler) > a->value)) pc = i->arg[1];
+				break;
+			case op_math:
+				d->value = math_apply(i->imm, a->value, regs[i->arg[1]].value);
+				break;
+			case op_vec_math:
+				d->vector = vec_math_apply(i->imm, a->vector.v, regs[i->arg[1]].vector.v, regs[i->arg[2]].vector.v, regs[i->arg[3]].value);
+				break;
+			case op_map_range:
+				d->value = clamp(a->value / (regs[i->arg[2]].value - regs[i->arg[1]].value), 0.0f, 1.0f);
+				break;
+			case op_lerp:
+				d->value = lerp(a->value, regs[i->arg[1]].value, regs[i->arg[2]].value);
+				break;
+			case op_combine_rgb:
+				d->color = (struct color){ a->value, regs[i->arg[1]].value, regs[i->arg[2]].value, 1.0f };
+				break;
+			case op_split:
+				d->color = (struct color){ a->value, a->value, a->value, 1.0f };
+				break;
+			case op_grayscale:
+				d->value = colorToGrayscale(a->color).red;
+				break;
+			case op_vec_to_color: {
+				const struct vector v = vec_max(a->vector.v, vec_zero());
+				d->color = (struct color){ v.x, v.y, v.z, 0.0f };
+				break;
+			}
+			case op_vec_to_value:
+				d->value = vec_to_value_component(a->vector, i->imm);
+				break;
+			case op_uv:
+				d->vector = (union vector_value){ .c = record->uv };
+				break;
+			case op_normal:
+				d->vector = (union vector_value){ .v = record->surfaceNormal };
+				break;
+			case op_bsdf:
+				d->bsdf = p->calls[i->arg[0]];
+				break;
+		}
+	}
+}
+
+// Wrapper nodes, these make compiled programs look like any other node to their users
+
+struct compiledValue {
+	struct valueNode node;
+	const struct valueNode *root;
+	const struct node_program *program;
+};
+
+struct compiledColor {
+	struct colorNode node;
+	const struct colorNode *root;
+	const struct node_program *program;
+};
+
+struct compiledVector {
+	struct vectorNode node;
+	const struct vectorNode *root;
+	const struct node_program *program;
+};
+
+struct compiledBsdf {
+	struct bsdfNode bsdf;
+	const struct bsdfNode *root;
+	const struct node_program *program;
+};
+
+static bool compare_value(const void *A, const void *B) {
+	return ((const struct compiledValue *)A)->root == ((const struct compiledValue *)B)->root;
+}
+
+static bool compare_color(const void *A, const void *B) {
+	return ((const struct compiledColor *)A)->root == ((const struct compiledColor *)B)->root;
+}
+
+static bool compare_vector(const void *A, const void *B) {
+	return ((const struct compiledVector *)A)->root == ((const struct compiledVector *)B)->root;
+}
+
+static bool compare_bsdf(const void *A, const void *B) {
+	return ((const struct compiledBsdf *)A)->root == ((const struct compiledBsdf *)B)->root;
+}
+
+static uint32_t hash_root(const void *root) {
+	return hashBytes(hashInit(), &root, sizeof(root));
+}
+
+static void dump_program(const char *type, const void *root, const struct node_program *p, char *dumpbuf, int bufsize) {
+	const struct nodeBase *base = root;
+	char inner[DUMPBUF_SIZE / 2] = "";
+	if (base->dump) base->dump(root, inner, sizeof(inner));
+	snprintf(dumpbuf, bufsize, "%s { insns: %u, regs: %u, root: %s }", type, p ? p->insn_count : 0, p ? p->register_count : 0, inner);
+}
+
+static void dump_value(const void *node, char *dumpbuf, int bufsize) {
+	const struct compiledValue *self = node;
+	dump_program("compiledValue", self->root, self->program, dumpbuf, bufsize);
+}
+
+static void dump_color(const void *node, char *dumpbuf, int bufsize) {
+	const struct compiledColor *self = node;
+	dump_program("compiledColor", self->root, self->program, dumpbuf, bufsize);
+}
+
+static void dump_vector(const void *node, char *dumpbuf, int bufsize) {
+	const struct compiledVector *self = node;
+	dump_program("compiledVector", self->root, self->program, dumpbuf, bufsize);
+}
+
+static void dump_bsdf(const void *node, char *dumpbuf, int bufsize) {
+	const struct compiledBsdf *self = node;
+	dump_program("compiledBsdf", self->root, self->program, dumpbuf, bufsize);
+}
+
+// When a compiled input ends up in a bigger graph, like the factor of a mix BSDF,
+// its graph is compiled into that program instead of running a program of its own.
+static uint16_t compile_value(const void *node, struct node_compiler *c) {
+	return compile_value_input(c, ((const struct compiledValue *)node)->root);
+}
+
+static uint16_t compile_color(const void *node, struct node_compiler *c) {
+	return compile_color_input(c, ((const struct compiledColor *)node)->root);
+}
+
+static uint16_t compile_vector(const void *node, struct node_compiler *c) {
+	return compile_vector_input(c, ((const struct compiledVector *)node)->root);
+}
+
+static float eval_value(const struct valueNode *node, sampler *sampler, const struct hitRecord *record) {
+	const struct node_program *p = ((const struct compiledValue *)node)->program;
+	union node_reg regs[NODE_MAX_REGISTERS];
+	node_program_run(p, regs, sampler, record);
+	return regs[p->result].value;
+}
+
+static struct color eval_color(const struct colorNode *node, sampler *sampler, const struct hitRecord *record) {
+	const struct node_program *p = ((const struct compiledColor *)node)->program;
+	union node_reg regs[NODE_MAX_REGISTERS];
+	node_program_run(p, regs, sampler, record);
+	return regs[p->result].color;
+}
+
+static union vector_value eval_vector(const struct vectorNode *node, sampler *sampler, const struct hitRecord *record) {
+	const struct node_program *p = ((const struct compiledVector *)node)->program;
+	union node_reg regs[NODE_MAX_REGISTERS];
+	node_program_run(p, regs, sampler, record);
+	return regs[p->result].vector;
+}
+
+static struct bsdfSample sample_bsdf(const struct bsdfNode *node, sampler *sampler, const struct hitRecord *record) {
+	const struct node_program *p = ((const struct compiledBsdf *)node)->program;
+	union node_reg regs[NODE_MAX_REGISTERS];
+	node_program_run(p, regs, sampler, record);
+	const struct bsdfNode *chosen = regs[p->result].bsdf;
+	return chosen->sample(chosen, sampler, record);
+}
+
+// Like HASH_CONS, but only compiles if we haven't seen this root before
+static const void *compile_cons(const struct node_storage *s, const void *candidate, size_t size, const struct node_program **program, const void *root, enum node_kind kind) {
+	const uint32_t h = hash_root(root);
+	const void *existing = findInHashtable(s->node_table, candidate, h);
+	if (existing) return existing;
+	*program = compile_program(s, root, kind);
+	if (!*program) return root;
+	logr(spam, "Compiled node graph into %u instructions, %u registers\n", (*program)->insn_count, (*program)->register_count);
+	return internInHashtable(s->node_table, candidate, size, h, NULL);
+}
+
+const struct valueNode *compile_value_node(const struct node_storage *s, const struct valueNode *root) {
+	if (!root || !root->base.compile || root->constant || root->eval == eval_value) return root;
+	struct compiledValue candidate = {
+		.root = root,
+		.node = {
+			.eval = eval_value,
+			.base = { .compare = compare_value, .dump = dump_value, .compile = compile_value }
+		}
+	};
+	return compile_cons(s, &candidate, sizeof(candidate), &candidate.program, root, node_value);
+}
+
+const struct colorNode *compile_color_node(const struct node_storage *s, const struct colorNode *root) {
+	if (!root || !root->base.compile || root->constant || root->eval == eval_color) return root;
+	struct compiledColor candidate = {
+		.root = root,
+		.node = {
+			.eval = eval_color,
+			.base = { .compare = compare_color, .dump = dump_color, .compile = compile_color }
+		}
+	};
+	return compile_cons(s, &candidate, sizeof(candidate), &candidate.program, root, node_color);
+}
+
+const struct vectorNode *compile_vector_node(const struct node_storage *s, const struct vectorNode *root) {
+	if (!root || !root->base.compile || root->constant || root->eval == eval_vector) return root;
+	struct compiledVector candidate = {
+		.root = root,
+		.node = {
+			.eval = eval_vector,
+			.base = { .compare = compare_vector, .dump = dump_vector, .compile = compile_vector }
+		}
+	};
+	return compile_cons(s, &candidate, sizeof(candidate), &candidate.program, root, node_vector);
+}
+
+const struct bsdfNode *compile_bsdf_node(const struct node_storage *s, const struct bsdfNode *root) {
+	// Only mixes compile, a single BSDF has nothing to pick
+	if (!root || !root->base.compile) return root;
+	struct compiledBsdf candidate = {
+		.root = root,
+		.bsdf = {
+			.sample = sample_bsdf,
+			.base = { .compare = compare_bsdf, .dump = dump_bsdf }
+		}
+	};
+	return compile_cons(s, &candidate, sizeof(candidate), &candidate.program, root, node_bsdf);
+}
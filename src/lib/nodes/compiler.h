@@ -0,0 +1,102 @@
+//
+//  compiler.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include "../../common/color.h"
+#include "vectornode.h"
+
+// Node graphs are compiled into a flat list of instructions operating on a small
+// register file, so shading doesn't have to chase node pointers all over node_pool.
+// Nodes opt in by providing base.compile. Anything else is emitted as a call to
+// its eval(), which walks that subtree like before.
+// Mix BSDFs compile too, the program then picks the BSDF to sample, and that one is
+// sampled like before once the program is done.
+
+#define NODE_MAX_REGISTERS 64
+
+struct node_storage;
+struct node_compiler;
+struct valueNode;
+struct colorNode;
+struct vectorNode;
+struct bsdfNode;
+
+union node_reg {
+	struct color color;
+	union vector_value vector;
+	float value;
+	const struct bsdfNode *bsdf;
+};
+
+enum node_op {
+	op_call_value = 0, // arg[0] indexes node_program.calls
+	op_call_color,
+	op_call_vector,
+	op_move, // dst = arg[0]
+	op_jump, // Continue at instruction arg[0]
+	op_mix, // If a sample < arg[0], continue at instruction arg[1]
+	op_math, // imm = enum cr_math_op
+	op_vec_math, // imm = enum cr_vec_op, arg = A, B, C, f
+	op_map_range, // clamp(arg[0] / (arg[2] - arg[1]), 0, 1)
+	op_lerp, // lerp(arg[0], arg[1], arg[2])
+	op_combine_rgb,
+	op_split,
+	op_grayscale,
+	op_vec_to_color,
+	op_vec_to_value, // imm = enum cr_vec_to_value_component
+	op_uv,
+	op_normal,
+	op_bsdf, // dst = node_program.calls[arg[0]], which is a BSDF to sample
+};
+
+struct node_insn {
+	uint8_t op;
+	uint8_t imm;
+	uint16_t dst;
+	uint16_t arg[4];
+};
+
+struct node_program {
+	const union node_reg *constants; // Loaded into the first constant_count registers
+	const struct node_insn *code;
+	const void **calls; // Nodes for op_call_*
+	uint16_t constant_count;
+	uint16_t insn_count;
+	uint16_t register_count;
+	uint16_t result;
+};
+
+// These are for base.compile implementations. They return the register holding the result.
+uint16_t compile_value_input(struct node_compiler *c, const struct valueNode *node);
+uint16_t compile_color_input(struct node_compiler *c, const struct colorNode *node);
+uint16_t compile_vector_input(struct node_compiler *c, const struct vectorNode *node);
+uint16_t node_emit(struct node_compiler *c, struct node_insn insn);
+uint16_t node_emit_constant(struct node_compiler *c, union node_reg value);
+
+enum node_kind {
+	node_value,
+	node_color,
+	node_vector,
+	node_bsdf,
+};
+
+/// Emit a stochastic choice between A and B, like the mix nodes do. Only the chosen branch runs.
+uint16_t node_emit_mix(struct node_compiler *c, enum node_kind kind, const struct valueNode *factor, const void *A, const void *B);
+
+/// Run a compiled program, the result ends up in regs[program->result]
+void node_program_run(const struct node_program *program, union node_reg *regs, sampler *sampler, const struct hitRecord *record);
+
+/// Compile the graph under root, and return a node that evaluates the compiled program.
+/// @remarks Graphs that don't benefit, such as constants, are returned as-is. So are graphs that
+/// need more than NODE_MAX_REGISTERS registers, those are tree-walked.
+const struct valueNode *compile_value_node(const struct node_storage *s, const struct valueNode *root);
+const struct colorNode *compile_color_node(const struct node_storage *s, const struct colorNode *root);
+const struct vectorNode *compile_vector_node(const struct node_storage *s, const struct vectorNode *root);
+const struct bsdfNode *compile_bsdf_node(const struct node_storage *s, const struct bsdfNode *root);
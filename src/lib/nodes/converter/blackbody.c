@@ -50,8 +50,13 @@ static struct color eval(const struct colorNode *node, sampler *sampler, const s
 }
 
 const struct colorNode *newBlackbody(const struct node_storage *s, const struct valueNode *temperature) {
+	if (!temperature) temperature = newConstantValue(s, 4000.0f);
+	if (temperature->constant) {
+		node_eliminated(s);
+		return newConstantTexture(s, colorForKelvin(temperature->eval(temperature, NULL, NULL)));
+	}
 	HASH_CONS(s->node_table, hash, struct blackbodyNode, {
-		.temperature = temperature ? temperature : newConstantValue(s, 4000.0f),
+		.temperature = temperature,
 		.node = {
 			.eval = eval,
 			.base = { .compare = compare, .dump = dump }
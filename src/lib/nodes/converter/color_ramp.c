@@ -145,9 +145,20 @@ const struct colorNode *new_color_ramp(const struct node_storage *s,
 			if (e->position < 0.0f) e->position = 0.0f;
 		}
 	}
+	if (!input_value) input_value = newConstantValue(s, 0.0f);
+	if (input_value->constant) {
+		const struct color_ramp_node ramp = {
+			.input_value = input_value,
+			.interpolation = interpolation,
+			.elements = element_arr,
+		};
+		const struct color color = eval(&ramp.node, NULL, NULL);
+		ramp_element_arr_free(&element_arr);
+		node_eliminated(s);
+		return newConstantTexture(s, color);
+	}
 	HASH_CONS(s->node_table, hash, struct color_ramp_node, {
-		// TODO: If the input is constant, we can probably evaluate this at setup time, right?
-		.input_value = input_value ? input_value : newConstantValue(s, 0.0f),
+		.input_value = input_value,
 		.color_mode = color_mode,
 		.interpolation = interpolation,
 		.elements = element_arr,
@@ -55,16 +55,20 @@ static struct color eval(const struct colorNode *node, sampler *sampler, const s
 }
 
 const struct colorNode *newCombineHSL(const struct node_storage *s, const struct valueNode *H, const struct valueNode *S, const struct valueNode *L) {
+	if (!H) H = newConstantValue(s, 0.0f);
+	if (!S) S = newConstantValue(s, 0.0f);
+	if (!L) L = newConstantValue(s, 0.0f);
 	if (H->constant && S->constant && L->constant) {
+		node_eliminated(s);
 		float hue = H->eval(H, NULL, NULL);
 		float sat = S->eval(S, NULL, NULL);
 		float lig = L->eval(L, NULL, NULL);
 		return newConstantTexture(s, hsl_to_rgb((struct hsl){ hue, sat, lig }));
 	}
 	HASH_CONS(s->node_table, hash, struct combineHSL, {
-		.H = H ? H : newConstantValue(s, 0.0f),
-		.S = S ? S : newConstantValue(s, 0.0f),
-		.L = L ? L : newConstantValue(s, 0.0f),
+		.H = H,
+		.S = S,
+		.L = L,
 		.node = {
 				.eval = eval,
 				.base = { .compare = compare, .dump = dump }
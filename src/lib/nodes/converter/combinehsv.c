@@ -55,16 +55,20 @@ static struct color eval(const struct colorNode *node, sampler *sampler, const s
 }
 
 const struct colorNode *newCombineHSV(const struct node_storage *s, const struct valueNode *H, const struct valueNode *S, const struct valueNode *V) {
+	if (!H) H = newConstantValue(s, 0.0f);
+	if (!S) S = newConstantValue(s, 0.0f);
+	if (!V) V = newConstantValue(s, 0.0f);
 	if (H->constant && S->constant && V->constant) {
+		node_eliminated(s);
 		float hue = H->eval(H, NULL, NULL);
 		float sat = S->eval(S, NULL, NULL);
 		float val = V->eval(V, NULL, NULL);
 		return newConstantTexture(s, hsv_to_rgb((struct hsv){ hue, sat, val }));
 	}
 	HASH_CONS(s->node_table, hash, struct HSVTransform, {
-		.H = H ? H : newConstantValue(s, 0.0f),
-		.S = S ? S : newConstantValue(s, 0.0f),
-		.V = V ? V : newConstantValue(s, 0.0f),
+		.H = H,
+		.S = S,
+		.V = V,
 		.node = {
 				.eval = eval,
 				.base = { .compare = compare, .dump = dump }
@@ -14,6 +14,7 @@
 #include "../../datatypes/scene.h"
 #include "../valuenode.h"
 
+#include "../compiler.h"
 #include "combinergb.h"
 
 struct combineRGB {
@@ -60,14 +61,29 @@ static struct color eval(const struct colorNode *node, sampler *sampler, const s
 	};
 }
 
+static uint16_t compile(const void *node, struct node_compiler *c) {
+	const struct combineRGB *this = node;
+	const uint16_t r = compile_value_input(c, this->R);
+	const uint16_t g = compile_value_input(c, this->G);
+	const uint16_t b = compile_value_input(c, this->B);
+	return node_emit(c, (struct node_insn){ .op = op_combine_rgb, .arg = { r, g, b } });
+}
+
 const struct colorNode *newCombineRGB(const struct node_storage *s, const struct valueNode *R, const struct valueNode *G, const struct valueNode *B) {
+	if (!R) R = newConstantValue(s, 0.0f);
+	if (!G) G = newConstantValue(s, 0.0f);
+	if (!B) B = newConstantValue(s, 0.0f);
+	if (R->constant && G->constant && B->constant) {
+		node_eliminated(s);
+		return newConstantTexture(s, (struct color){ R->eval(R, NULL, NULL), G->eval(G, NULL, NULL), B->eval(B, NULL, NULL), 1.0f });
+	}
 	HASH_CONS(s->node_table, hash, struct combineRGB, {
-		.R = R ? R : newConstantValue(s, 0.0f),
-		.G = G ? G : newConstantValue(s, 0.0f),
-		.B = B ? B : newConstantValue(s, 0.0f),
+		.R = R,
+		.G = G,
+		.B = B,
 		.node = {
 			.eval = eval,
-			.base = { .compare = compare, .dump = dump }
+			.base = { .compare = compare, .dump = dump, .compile = compile }
 		}
 	});
 }
@@ -16,6 +16,7 @@
 #include "../valuenode.h"
 #include "../colornode.h"
 
+#include "../compiler.h"
 #include "grayscale.h"
 
 struct grayscale {
@@ -48,12 +49,22 @@ static void dump(const void *node, char *dumpbuf, int len) {
 	snprintf(dumpbuf, len, "grayscale { input: %s }", color);
 }
 
+static uint16_t compile(const void *node, struct node_compiler *c) {
+	const struct grayscale *this = node;
+	return node_emit(c, (struct node_insn){ .op = op_grayscale, .arg = { compile_color_input(c, this->input) } });
+}
+
 const struct valueNode *newGrayscaleConverter(const struct node_storage *s, const struct colorNode *node) {
+	if (!node) node = newConstantTexture(s, g_black_color);
+	if (node->constant) {
+		node_eliminated(s);
+		return newConstantValue(s, colorToGrayscale(node->eval(node, NULL, NULL)).red);
+	}
 	HASH_CONS(s->node_table, hash, struct grayscale, {
-		.input = node ? node : newConstantTexture(s, g_black_color),
+		.input = node,
 		.node = {
 			.eval = eval,
-			.base = { .compare = compare, .dump = dump }
+			.base = { .compare = compare, .dump = dump, .compile = compile }
 		}
 	});
 }
@@ -13,6 +13,7 @@
 #include "../../datatypes/scene.h"
 #include "../valuenode.h"
 
+#include "../compiler.h"
 #include "map_range.h"
 
 struct mapRangeNode {
@@ -78,21 +79,43 @@ static float eval(const struct valueNode *node, sampler *sampler, const struct h
 	return lerp(to_min, to_max, t);
 }
 
+static uint16_t compile(const void *node, struct node_compiler *c) {
+	const struct mapRangeNode *this = node;
+	const uint16_t input = compile_value_input(c, this->input_value);
+	const uint16_t from_min = compile_value_input(c, this->from_min);
+	const uint16_t from_max = compile_value_input(c, this->from_max);
+	const uint16_t t = node_emit(c, (struct node_insn){ .op = op_map_range, .arg = { input, from_min, from_max } });
+	const uint16_t to_min = compile_value_input(c, this->to_min);
+	const uint16_t to_max = compile_value_input(c, this->to_max);
+	return node_emit(c, (struct node_insn){ .op = op_lerp, .arg = { to_min, to_max, t } });
+}
+
 const struct valueNode *newMapRange(const struct node_storage *s,
 									const struct valueNode *input_value,
 									const struct valueNode *from_min,
 									const struct valueNode *from_max,
 									const struct valueNode *to_min,
 									const struct valueNode *to_max) {
+	if (!input_value) input_value = newConstantValue(s, 1.0f);
+	if (!from_min) from_min = newConstantValue(s, 0.0f);
+	if (!from_max) from_max = newConstantValue(s, 1.0f);
+	if (!to_min) to_min = newConstantValue(s, 0.0f);
+	if (!to_max) to_max = newConstantValue(s, 1.0f);
+	if (input_value->constant && from_min->constant && from_max->constant && to_min->constant && to_max->constant) {
+		const float delta = from_max->eval(from_max, NULL, NULL) - from_min->eval(from_min, NULL, NULL);
+		const float t = clamp(input_value->eval(input_value, NULL, NULL) / delta, 0.0f, 1.0f);
+		node_eliminated(s);
+		return newConstantValue(s, lerp(to_min->eval(to_min, NULL, NULL), to_max->eval(to_max, NULL, NULL), t));
+	}
 	HASH_CONS(s->node_table, hash, struct mapRangeNode, {
-		.input_value = input_value ? input_value : newConstantValue(s, 1.0f),
-		.from_min = from_min ? from_min : newConstantValue(s, 0.0f),
-		.from_max = from_max ? from_max : newConstantValue(s, 1.0f),
-		.to_min = to_min ? to_min : newConstantValue(s, 0.0f),
-		.to_max = to_max ? to_max : newConstantValue(s, 1.0f),
+		.input_value = input_value,
+		.from_min = from_min,
+		.from_max = from_max,
+		.to_min = to_min,
+		.to_max = to_max,
 		.node = {
 			.eval = eval,
-			.base = { .compare = compare, .dump = dump }
+			.base = { .compare = compare, .dump = dump, .compile = compile }
 		}
 	});
 }
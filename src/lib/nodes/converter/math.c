@@ -14,6 +14,7 @@
 #include "../../datatypes/scene.h"
 #include "../../datatypes/hitrecord.h"
 
+#include "../compiler.h"
 #include "math.h"
 
 struct mathNode {
@@ -138,11 +139,8 @@ float rough_compare(float a, float b) {
 	return true;
 }
 
-static float eval(const struct valueNode *node, sampler *sampler, const struct hitRecord *record) {
-	struct mathNode *this = (struct mathNode *)node;
-	const float a = this->A->eval(this->A, sampler, record);
-	const float b = this->B->eval(this->B, sampler, record);
-	switch (this->op) {
+float math_apply(enum cr_math_op op, float a, float b) {
+	switch (op) {
 		case Add:
 			return a + b;
 		case Subtract:
@@ -203,14 +201,62 @@ static float eval(const struct valueNode *node, sampler *sampler, const struct h
 	return 0.0f;
 }
 
+static float eval(const struct valueNode *node, sampler *sampler, const struct hitRecord *record) {
+	struct mathNode *this = (struct mathNode *)node;
+	const float a = this->A->eval(this->A, sampler, record);
+	const float b = this->B->eval(this->B, sampler, record);
+	return math_apply(this->op, a, b);
+}
+
+static uint16_t compile(const void *node, struct node_compiler *c) {
+	const struct mathNode *this = node;
+	const uint16_t a = compile_value_input(c, this->A);
+	const uint16_t b = compile_value_input(c, this->B);
+	return node_emit(c, (struct node_insn){ .op = op_math, .imm = (uint8_t)this->op, .arg = { a, b } });
+}
+
+static bool is_value(const struct valueNode *node, float value) {
+	return node->constant && node->eval(node, NULL, NULL) == value;
+}
+
+// Returns the input this op passes through unchanged, if any
+static const struct valueNode *identity(const struct valueNode *A, const struct valueNode *B, const enum cr_math_op op) {
+	switch (op) {
+		case Add:
+			if (is_value(A, 0.0f)) return B;
+			return is_value(B, 0.0f) ? A : NULL;
+		case Subtract:
+			return is_value(B, 0.0f) ? A : NULL;
+		case Multiply:
+			if (is_value(A, 1.0f)) return B;
+			return is_value(B, 1.0f) ? A : NULL;
+		case Divide:
+		case Power:
+			return is_value(B, 1.0f) ? A : NULL;
+		default:
+			return NULL;
+	}
+}
+
 const struct valueNode *newMath(const struct node_storage *s, const struct valueNode *A, const struct valueNode *B, const enum cr_math_op op) {
+	if (!A) A = newConstantValue(s, 0.0f);
+	if (!B) B = newConstantValue(s, 0.0f);
+	if (A->constant && B->constant) {
+		node_eliminated(s);
+		return newConstantValue(s, math_apply(op, A->eval(A, NULL, NULL), B->eval(B, NULL, NULL)));
+	}
+	const struct valueNode *same = identity(A, B, op);
+	if (same) {
+		node_eliminated(s);
+		return same;
+	}
 	HASH_CONS(s->node_table, hash, struct mathNode, {
-		.A = A ? A : newConstantValue(s, 0.0f),
-		.B = B ? B : newConstantValue(s, 0.0f),
+		.A = A,
+		.B = B,
 		.op = op,
 		.node = {
 			.eval = eval,
-			.base = { .compare = compare, .dump = dump }
+			.base = { .compare = compare, .dump = dump, .compile = compile }
 		}
 	});
 }
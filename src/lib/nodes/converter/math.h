@@ -10,5 +10,7 @@
 
 #include <c-ray/c-ray.h>
 
+float math_apply(enum cr_math_op op, float a, float b);
+
 const struct valueNode *newMath(const struct node_storage *s, const struct valueNode *A, const struct valueNode *B, const enum cr_math_op op);
 
@@ -14,6 +14,7 @@
 #include "../../datatypes/scene.h"
 #include "../valuenode.h"
 
+#include "../compiler.h"
 #include "split.h"
 
 struct splitValue {
@@ -48,12 +49,23 @@ static struct color eval(const struct colorNode *node, sampler *sampler, const s
 	return (struct color){val, val, val, 1.0f};
 }
 
+static uint16_t compile(const void *node, struct node_compiler *c) {
+	const struct splitValue *this = node;
+	return node_emit(c, (struct node_insn){ .op = op_split, .arg = { compile_value_input(c, this->input) } });
+}
+
 const struct colorNode *newSplitValue(const struct node_storage *s, const struct valueNode *node) {
+	if (!node) node = newConstantValue(s, 0.0f);
+	if (node->constant) {
+		const float val = node->eval(node, NULL, NULL);
+		node_eliminated(s);
+		return newConstantTexture(s, (struct color){ val, val, val, 1.0f });
+	}
 	HASH_CONS(s->node_table, hash, struct splitValue, {
-		.input = node ? node : newConstantValue(s, 0.0f),
+		.input = node,
 		.node = {
 			.eval = eval,
-			.base = { .compare = compare, .dump = dump }
+			.base = { .compare = compare, .dump = dump, .compile = compile }
 		}
 	});
 }
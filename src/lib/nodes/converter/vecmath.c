@@ -16,6 +16,7 @@
 #include "../vectornode.h"
 
 #include "../../../common/vector.h"
+#include "../compiler.h"
 #include "vecmath.h"
 
 struct vecMathNode {
@@ -135,15 +136,8 @@ static inline float wrap(float value, float max, float min) {
 	return (range != 0.0f) ? value - (range * floorf((value - min) / range)) : min;
 }
  
-static union vector_value eval(const struct vectorNode *node, sampler *sampler, const struct hitRecord *record) {
-	struct vecMathNode *this = (struct vecMathNode *)node;
-	
-	const struct vector a = this->A->eval(this->A, sampler, record).v;
-	const struct vector b = this->B->eval(this->B, sampler, record).v;
-	const struct vector c = this->C->eval(this->C, sampler, record).v;
-	const float f = this->f->eval(this->f, sampler, record);
-	
-	switch (this->op) {
+union vector_value vec_math_apply(enum cr_vec_op op, struct vector a, struct vector b, struct vector c, float f) {
+	switch (op) {
 		case VecAdd:
 			return (union vector_value){ .v = vec_add(a, b) };
 		case VecSubtract:
@@ -197,16 +191,90 @@ static union vector_value eval(const struct vectorNode *node, sampler *sampler,
 	return (union vector_value){ 0 };
 }
 
+static union vector_value eval(const struct vectorNode *node, sampler *sampler, const struct hitRecord *record) {
+	struct vecMathNode *this = (struct vecMathNode *)node;
+	
+	const struct vector a = this->A->eval(this->A, sampler, record).v;
+	const struct vector b = this->B->eval(this->B, sampler, record).v;
+	const struct vector c = this->C->eval(this->C, sampler, record).v;
+	const float f = this->f->eval(this->f, sampler, record);
+	return vec_math_apply(this->op, a, b, c, f);
+}
+
+static uint16_t compile(const void *node, struct node_compiler *c) {
+	const struct vecMathNode *this = node;
+	const uint16_t a = compile_vector_input(c, this->A);
+	const uint16_t b = compile_vector_input(c, this->B);
+	const uint16_t v = compile_vector_input(c, this->C);
+	const uint16_t f = compile_value_input(c, this->f);
+	return node_emit(c, (struct node_insn){ .op = op_vec_math, .imm = (uint8_t)this->op, .arg = { a, b, v, f } });
+}
+
+static bool is_vector(const struct vectorNode *node, struct vector vector) {
+	return node->constant && vec_equals(node->eval(node, NULL, NULL).v, vector);
+}
+
+// Returns the input this op passes through unchanged, if any
+static const struct vectorNode *identity(const struct vectorNode *A, const struct vectorNode *B, const struct valueNode *f, const enum cr_vec_op op) {
+	const struct vector one = { 1.0f, 1.0f, 1.0f };
+	switch (op) {
+		case VecAdd:
+			if (is_vector(A, vec_zero())) return B;
+			return is_vector(B, vec_zero()) ? A : NULL;
+		case VecSubtract:
+			return is_vector(B, vec_zero()) ? A : NULL;
+		case VecMultiply:
+			if (is_vector(A, one)) return B;
+			return is_vector(B, one) ? A : NULL;
+		case VecDivide:
+			return is_vector(B, one) ? A : NULL;
+		case VecScale:
+			return f->constant && f->eval(f, NULL, NULL) == 1.0f ? A : NULL;
+		default:
+			return NULL;
+	}
+}
+
+static const struct vectorNode *fold(const struct node_storage *s, const struct vectorNode *A, const struct vectorNode *B, const struct vectorNode *C, const struct valueNode *f, const enum cr_vec_op op) {
+	const union vector_value result = vec_math_apply(op,
+		A->eval(A, NULL, NULL).v,
+		B->eval(B, NULL, NULL).v,
+		C->eval(C, NULL, NULL).v,
+		f->eval(f, NULL, NULL));
+	switch (op) {
+		case VecDot:
+		case VecDistance:
+		case VecLength:
+			// Only .f is set, keep the rest deterministic for hash consing
+			return newConstantVector(s, (struct vector){ result.f, 0.0f, 0.0f });
+		default:
+			return newConstantVector(s, result.v);
+	}
+}
+
 const struct vectorNode *newVecMath(const struct node_storage *s, const struct vectorNode *A, const struct vectorNode *B, const struct vectorNode *C, const struct valueNode *f, const enum cr_vec_op op) {
+	if (!A) A = newConstantVector(s, vec_zero());
+	if (!B) B = newConstantVector(s, vec_zero());
+	if (!C) C = newConstantVector(s, vec_zero());
+	if (!f) f = newConstantValue(s, 0.0f);
+	if (A->constant && B->constant && C->constant && f->constant) {
+		node_eliminated(s);
+		return fold(s, A, B, C, f, op);
+	}
+	const struct vectorNode *same = identity(A, B, f, op);
+	if (same) {
+		node_eliminated(s);
+		return same;
+	}
 	HASH_CONS(s->node_table, hash, struct vecMathNode, {
-		.A = A ? A : newConstantVector(s, vec_zero()),
-		.B = B ? B : newConstantVector(s, vec_zero()),
-		.C = C ? C : newConstantVector(s, vec_zero()),
-		.f = f ? f : newConstantValue(s, 0.0f),
+		.A = A,
+		.B = B,
+		.C = C,
+		.f = f,
 		.op = op,
 		.node = {
 			.eval = eval,
-			.base = { .compare = compare, .dump = dump }
+			.base = { .compare = compare, .dump = dump, .compile = compile }
 		}
 	});
 }
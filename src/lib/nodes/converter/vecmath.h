@@ -10,4 +10,6 @@
 
 #include <c-ray/c-ray.h>
 
+union vector_value vec_math_apply(enum cr_vec_op op, struct vector a, struct vector b, struct vector c, float f);
+
 const struct vectorNode *newVecMath(const struct node_storage *s, const struct vectorNode *A, const struct vectorNode *B, const struct vectorNode *C, const struct valueNode *f, const enum cr_vec_op op);
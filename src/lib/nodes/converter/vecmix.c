@@ -13,6 +13,7 @@
 #include "../valuenode.h"
 #include "../vectornode.h"
 
+#include "../compiler.h"
 #include "vecmix.h"
 
 struct vec_mix {
@@ -60,18 +61,36 @@ static union vector_value eval(const struct vectorNode *node, sampler *sampler,
 	}
 }
 
+static uint16_t compile(const void *node, struct node_compiler *c) {
+	const struct vec_mix *this = node;
+	return node_emit_mix(c, node_vector, this->f, this->A, this->B);
+}
+
 const struct vectorNode *new_vec_mix(const struct node_storage *s, const struct vectorNode *A, const struct vectorNode *B, const struct valueNode *f) {
 	if (A == B) {
 		logr(debug, "A == B, pruning vec_mix node.\n");
+		node_eliminated(s);
 		return A;
 	}
+	if (!A) A = newConstantVector(s, vec_zero());
+	if (!B) B = newConstantVector(s, vec_zero());
+	if (!f) f = newConstantValue(s, 0.0f);
+	if (f->constant) {
+		// A is picked when a sample lands above f, so at 0 or 1 one branch is never taken
+		const float factor = f->eval(f, NULL, NULL);
+		if (factor <= 0.0f || factor >= 1.0f) {
+			logr(debug, "Constant factor %.2f, pruning vec_mix node.\n", (double)factor);
+			node_eliminated(s);
+			return factor <= 0.0f ? A : B;
+		}
+	}
 	HASH_CONS(s->node_table, hash, struct vec_mix, {
-		.A = A ? A : newConstantVector(s, vec_zero()),
-		.B = B ? B : newConstantVector(s, vec_zero()),
-		.f = f ? f : newConstantValue(s, 0.0f),
+		.A = A,
+		.B = B,
+		.f = f,
 		.node = {
 			.eval = eval,
-			.base = { .compare = compare, .dump = dump }
+			.base = { .compare = compare, .dump = dump, .compile = compile }
 		}
 	});
 }
@@ -16,6 +16,7 @@
 #include "../colornode.h"
 #include "../vectornode.h"
 
+#include "../compiler.h"
 #include "vectocolor.h"
 
 struct vecToColorNode {
@@ -51,12 +52,23 @@ static struct color eval(const struct colorNode *node, sampler *sampler, const s
 	return (struct color){ vec.x, vec.y, vec.z, 0.0f };
 }
 
+static uint16_t compile(const void *node, struct node_compiler *c) {
+	const struct vecToColorNode *this = node;
+	return node_emit(c, (struct node_insn){ .op = op_vec_to_color, .arg = { compile_vector_input(c, this->vec) } });
+}
+
 const struct colorNode *newVecToColor(const struct node_storage *s, const struct vectorNode *vec) {
+	if (!vec) vec = newConstantVector(s, vec_zero());
+	if (vec->constant) {
+		const struct vector v = vec_max(vec->eval(vec, NULL, NULL).v, vec_zero());
+		node_eliminated(s);
+		return newConstantTexture(s, (struct color){ v.x, v.y, v.z, 0.0f });
+	}
 	HASH_CONS(s->node_table, hash, struct vecToColorNode, {
-		.vec = vec ? vec : newConstantVector(s, vec_zero()),
+		.vec = vec,
 		.node = {
 			.eval = eval,
-			.base = { .compare = compare, .dump = dump }
+			.base = { .compare = compare, .dump = dump, .compile = compile }
 		}
 	});
 }
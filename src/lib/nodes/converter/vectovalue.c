@@ -14,6 +14,7 @@
 #include "../../datatypes/hitrecord.h"
 #include "../vectornode.h"
 
+#include "../compiler.h"
 #include "vectovalue.h"
 
 struct vecToValueNode {
@@ -55,10 +56,8 @@ static void dump(const void *node, char *dumpbuf, int bufsize) {
 	snprintf(dumpbuf, bufsize, "vecToValueNode { vec: %s, component: %c }", vec, component_to_char(self->component_to_get));
 }
 
-static float eval(const struct valueNode *node, sampler *sampler, const struct hitRecord *record) {
-	struct vecToValueNode *this = (struct vecToValueNode *)node;
-	const union vector_value val = this->vec->eval(this->vec, sampler, record);
-	switch (this->component_to_get) {
+float vec_to_value_component(union vector_value val, enum cr_vec_to_value_component component) {
+	switch (component) {
 		case X: return val.v.x;
 		case Y: return val.v.y;
 		case Z: return val.v.z;
@@ -70,13 +69,29 @@ static float eval(const struct valueNode *node, sampler *sampler, const struct h
 	return 0.0f;
 }
 
+static float eval(const struct valueNode *node, sampler *sampler, const struct hitRecord *record) {
+	struct vecToValueNode *this = (struct vecToValueNode *)node;
+	return vec_to_value_component(this->vec->eval(this->vec, sampler, record), this->component_to_get);
+}
+
+static uint16_t compile(const void *node, struct node_compiler *c) {
+	const struct vecToValueNode *this = node;
+	const uint16_t vec = compile_vector_input(c, this->vec);
+	return node_emit(c, (struct node_insn){ .op = op_vec_to_value, .imm = (uint8_t)this->component_to_get, .arg = { vec } });
+}
+
 const struct valueNode *newVecToValue(const struct node_storage *s, const struct vectorNode *vec, enum cr_vec_to_value_component component) {
+	if (!vec) vec = newConstantVector(s, vec_zero());
+	if (vec->constant) {
+		node_eliminated(s);
+		return newConstantValue(s, vec_to_value_component(vec->eval(vec, NULL, NULL), component));
+	}
 	HASH_CONS(s->node_table, hash, struct vecToValueNode, {
-		.vec = vec ? vec : newConstantVector(s, vec_zero()),
+		.vec = vec,
 		.component_to_get = component,
 		.node = {
 			.eval = eval,
-			.base = { .compare = compare, .dump = dump }
+			.base = { .compare = compare, .dump = dump, .compile = compile }
 		}
 	});
 }
@@ -10,4 +10,8 @@
 
 #include <c-ray/c-ray.h>
 
+union vector_value;
+
+float vec_to_value_component(union vector_value val, enum cr_vec_to_value_component component);
+
 const struct valueNode *newVecToValue(const struct node_storage *s, const struct vectorNode *vec, enum cr_vec_to_value_component component);
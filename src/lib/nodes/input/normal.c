@@ -16,6 +16,7 @@
 #include "../../datatypes/scene.h"
 #include "../bsdfnode.h"
 
+#include "../compiler.h"
 #include "normal.h"
 
 struct normalNode {
@@ -47,11 +48,16 @@ static union vector_value eval(const struct vectorNode *node, sampler *sampler,
 	return (union vector_value){ .v = record->surfaceNormal };
 }
 
+static uint16_t compile(const void *node, struct node_compiler *c) {
+	(void)node;
+	return node_emit(c, (struct node_insn){ .op = op_normal });
+}
+
 const struct vectorNode *newNormal(const struct node_storage *s) {
 	HASH_CONS(s->node_table, hash, struct normalNode, {
 		.node = {
 			.eval = eval,
-			.base = { .compare = compare, .dump = dump }
+			.base = { .compare = compare, .dump = dump, .compile = compile }
 		}
 	});
 }
@@ -16,6 +16,7 @@
 #include "../../datatypes/scene.h"
 #include "../bsdfnode.h"
 
+#include "../compiler.h"
 #include "uv.h"
 
 struct uvNode {
@@ -47,11 +48,16 @@ static union vector_value eval(const struct vectorNode *node, sampler *sampler,
 	return (union vector_value){ .c = record->uv };
 }
 
+static uint16_t compile(const void *node, struct node_compiler *c) {
+	(void)node;
+	return node_emit(c, (struct node_insn){ .op = op_uv });
+}
+
 const struct vectorNode *newUV(const struct node_storage *s) {
 	HASH_CONS(s->node_table, hash, struct uvNode, {
 		.node = {
 			.eval = eval,
-			.base = { .compare = compare, .dump = dump }
+			.base = { .compare = compare, .dump = dump, .compile = compile }
 		}
 	});
 }
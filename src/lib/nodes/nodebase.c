@@ -6,10 +6,27 @@
 //  Copyright © 2020-2022 Valtteri Koskivuori. All rights reserved.
 //
 
+#include "../../includes.h"
 #include "nodebase.h"
+#include "../datatypes/scene.h"
 
 bool compareNodes(const void *A, const void *B) {
 	const struct nodeBase *node1 = (struct nodeBase *)A;
 	const struct nodeBase *node2 = (struct nodeBase *)B;
 	return node1->compare == node2->compare && node1->compare(node1, node2);
 }
+
+void node_eliminated(const struct node_storage *s) {
+	if (s->eliminated) (*s->eliminated)++;
+}
+
+void node_log_interned(const struct nodeBase *node, const char *type_name, bool inserted) {
+	char *dumpbuf = calloc(1, DUMPBUF_SIZE);
+	if (node->dump) node->dump(node, dumpbuf, DUMPBUF_SIZE);
+	if (inserted) {
+		logr(spam, "Inserting new %s%s %s%s%s\n", KRED, type_name, KBLU, dumpbuf, KNRM);
+	} else {
+		logr(spam, "Reusing existing %s%s %s%s%s\n", KGRN, type_name, KBLU, dumpbuf, KNRM);
+	}
+	free(dumpbuf);
+}
@@ -10,33 +10,36 @@
 
 #include "../../common/logging.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 #define DUMPBUF_SIZE 16384
 
 // Magic for comparing two nodes
 
 struct node_storage;
+struct node_compiler;
 
 struct nodeBase {
 	bool (*compare)(const void *, const void *);
 	void (*dump)(const void *, char *, int);
+	// Optional, see compiler.h. Returns the register the result ends up in.
+	uint16_t (*compile)(const void *, struct node_compiler *);
 };
 
 bool compareNodes(const void *A, const void *B);
 
+/// Constructors call this when they fold or prune a node away instead of creating it
+void node_eliminated(const struct node_storage *s);
+
+/// Spam log line for HASH_CONS. Dumping a node walks its whole subgraph, so only call it when
+/// that log level is on.
+void node_log_interned(const struct nodeBase *node, const char *type_name, bool inserted);
+
 #define HASH_CONS(hashtable, hash, T, ...) \
 	{ \
 		const T candidate = __VA_ARGS__; \
-        struct nodeBase *c = (struct nodeBase *)&candidate; \
-		char dumpbuf[DUMPBUF_SIZE] = ""; \
-		if (c->dump) c->dump(c, dumpbuf, sizeof(dumpbuf)); \
-		const uint32_t h = hash(&candidate); \
-		const T *existing = findInHashtable(hashtable, &candidate, h); \
-		if (existing) {\
-			logr(spam, "Reusing existing %s%s %s%s%s\n", KGRN, &#T[7], KBLU, dumpbuf, KNRM);\
-			return (void *)existing; \
-		} \
-		logr(spam, "Inserting new %s%s %s%s%s\n", KRED, &#T[7], KBLU, dumpbuf, KNRM); \
-		insertInHashtable(hashtable, &candidate, sizeof(T), h); \
-		return findInHashtable(hashtable, &candidate, h); \
+		bool inserted = false; \
+		const T *node = internInHashtable(hashtable, &candidate, sizeof(T), hash(&candidate), &inserted); \
+		if (log_level_get() == Spam) node_log_interned((const struct nodeBase *)node, &#T[7], inserted); \
+		return (void *)node; \
 	}
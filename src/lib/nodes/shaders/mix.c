@@ -13,6 +13,7 @@
 #include "../../../common/hashtable.h"
 #include "../../datatypes/scene.h"
 #include "../bsdfnode.h"
+#include "../compiler.h"
 
 #include "mix.h"
 
@@ -59,18 +60,36 @@ static struct bsdfSample sample(const struct bsdfNode *bsdf, sampler *sampler, c
 	}
 }
 
+static uint16_t compile(const void *node, struct node_compiler *c) {
+	const struct mixBsdf *this = node;
+	return node_emit_mix(c, node_bsdf, this->factor, this->A, this->B);
+}
+
 const struct bsdfNode *newMix(const struct node_storage *s, const struct bsdfNode *A, const struct bsdfNode *B, const struct valueNode *factor) {
 	if (A == B) {
 		logr(debug, "A == B, pruning mix node.\n");
+		node_eliminated(s);
 		return A;
 	}
+	if (!A) A = newDiffuse(s, newConstantTexture(s, g_black_color));
+	if (!B) B = newDiffuse(s, newConstantTexture(s, g_black_color));
+	if (!factor) factor = newConstantValue(s, 0.5f);
+	if (factor->constant) {
+		// A is picked when a sample lands above factor, so at 0 or 1 one branch is never taken
+		const float f = factor->eval(factor, NULL, NULL);
+		if (f <= 0.0f || f >= 1.0f) {
+			logr(debug, "Constant factor %.2f, pruning mix node.\n", (double)f);
+			node_eliminated(s);
+			return f <= 0.0f ? A : B;
+		}
+	}
 	HASH_CONS(s->node_table, hash, struct mixBsdf, {
-		.A = A ? A : newDiffuse(s, newConstantTexture(s, g_black_color)),
-		.B = B ? B : newDiffuse(s, newConstantTexture(s, g_black_color)),
-		.factor = factor ? factor : newConstantValue(s, 0.5f),
+		.A = A,
+		.B = B,
+		.factor = factor,
 		.bsdf = {
 			.sample = sample,
-			.base = { .compare = compare, .dump = dump }
+			.base = { .compare = compare, .dump = dump, .compile = compile }
 		}
 	});
 }
@@ -13,6 +13,7 @@
 #include "../valuenode.h"
 #include "../colornode.h"
 
+#include "../compiler.h"
 #include "colormix.h"
 
 struct color_mix {
@@ -60,18 +61,36 @@ static struct color eval(const struct colorNode *node, sampler *sampler, const s
 	}
 }
 
+static uint16_t compile(const void *node, struct node_compiler *c) {
+	const struct color_mix *this = node;
+	return node_emit_mix(c, node_color, this->f, this->A, this->B);
+}
+
 const struct colorNode *new_color_mix(const struct node_storage *s, const struct colorNode *A, const struct colorNode *B, const struct valueNode *f) {
 	if (A == B) {
 		logr(debug, "A == B, pruning color_mix node.\n");
+		node_eliminated(s);
 		return A;
 	}
+	if (!A) A = newConstantTexture(s, g_black_color);
+	if (!B) B = newConstantTexture(s, g_black_color);
+	if (!f) f = newConstantValue(s, 0.0f);
+	if (f->constant) {
+		// A is picked when a sample lands above f, so at 0 or 1 one branch is never taken
+		const float factor = f->eval(f, NULL, NULL);
+		if (factor <= 0.0f || factor >= 1.0f) {
+			logr(debug, "Constant factor %.2f, pruning color_mix node.\n", (double)factor);
+			node_eliminated(s);
+			return factor <= 0.0f ? A : B;
+		}
+	}
 	HASH_CONS(s->node_table, hash, struct color_mix, {
-		.A = A ? A : newConstantTexture(s, g_black_color),
-		.B = B ? B : newConstantTexture(s, g_black_color),
-		.f = f ? f : newConstantValue(s, 0.0f),
+		.A = A,
+		.B = B,
+		.f = f,
 		.node = {
 			.eval = eval,
-			.base = { .compare = compare, .dump = dump }
+			.base = { .compare = compare, .dump = dump, .compile = compile }
 		}
 	});
 }
@@ -15,6 +15,7 @@
 #include "../../datatypes/scene.h"
 #include "../colornode.h"
 
+#include "../compiler.h"
 #include "constant.h"
 
 struct constantTexture {
@@ -48,12 +49,18 @@ static struct color eval(const struct colorNode *node, sampler *sampler, const s
 	return ((struct constantTexture *)node)->color;
 }
 
+static uint16_t compile(const void *node, struct node_compiler *c) {
+	const struct constantTexture *this = node;
+	return node_emit_constant(c, (union node_reg){ .color = this->color });
+}
+
 const struct colorNode *newConstantTexture(const struct node_storage *s, const struct color color) {
 	HASH_CONS(s->node_table, hash, struct constantTexture, {
 		.color = color,
 		.node = {
 			.eval = eval,
-			.base = { .compare = compare, .dump = dump }
+			.constant = true,
+			.base = { .compare = compare, .dump = dump, .compile = compile }
 		}
 	});
 }
@@ -9,6 +9,6 @@
 #pragma once
 
 struct node_storage;
-struct texture;
+struct tiled_texture;
 
-const struct colorNode *newImageTexture(const struct node_storage *s, const struct texture *texture, uint8_t options);
+const struct colorNode *newImageTexture(const struct node_storage *s, const struct tiled_texture *tiles, uint8_t options);
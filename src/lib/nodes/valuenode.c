@@ -17,6 +17,7 @@
 
 #include "vectornode.h"
 #include "valuenode.h"
+#include "compiler.h"
 
 struct constantValue {
 	struct valueNode node;
@@ -48,13 +49,18 @@ static float eval(const struct valueNode *node, sampler *sampler, const struct h
 	return this->value;
 }
 
+static uint16_t compile(const void *node, struct node_compiler *c) {
+	const struct constantValue *this = node;
+	return node_emit_constant(c, (union node_reg){ .value = this->value });
+}
+
 const struct valueNode *newConstantValue(const struct node_storage *s, float value) {
 	HASH_CONS(s->node_table, hash, struct constantValue, {
 		.value = value,
 		.node = {
 			.eval = eval,
 			.constant = true,
-			.base = { .compare = compare, .dump = dump }
+			.base = { .compare = compare, .dump = dump, .compile = compile }
 		}
 	});
 }
@@ -18,6 +18,7 @@
 
 #include "valuenode.h"
 #include "vectornode.h"
+#include "compiler.h"
 
 struct constantVector {
 	struct vectorNode node;
@@ -49,12 +50,18 @@ static union vector_value eval(const struct vectorNode *node, sampler *sampler,
 	return (union vector_value){ .v = this->vector };
 }
 
+static uint16_t compile(const void *node, struct node_compiler *c) {
+	const struct constantVector *this = node;
+	return node_emit_constant(c, (union node_reg){ .vector = { .v = this->vector } });
+}
+
 const struct vectorNode *newConstantVector(const struct node_storage *s, const struct vector vector) {
 	HASH_CONS(s->node_table, hash, struct constantVector, {
 		.vector = vector,
 		.node = {
 			.eval = eval,
-			.base = { .compare = compare, .dump = dump }
+			.constant = true,
+			.base = { .compare = compare, .dump = dump, .compile = compile }
 		}
 	});
 }
@@ -89,12 +96,17 @@ static union vector_value eval_uv(const struct vectorNode *node, sampler *sample
 	return (union vector_value){ .c = this->uv };
 }
 
+static uint16_t compile_uv(const void *node, struct node_compiler *c) {
+	const struct constantUV *this = node;
+	return node_emit_constant(c, (union node_reg){ .vector = { .c = this->uv } });
+}
+
 const struct vectorNode *newConstantUV(const struct node_storage *s, const struct coord c) {
 	HASH_CONS(s->node_table, hash_uv, struct constantUV, {
 		.uv = c,
 		.node = {
 			.eval = eval_uv,
-			.base = { .compare = compare_uv, .dump = dump_uv }
+			.base = { .compare = compare_uv, .dump = dump_uv, .compile = compile_uv }
 		}
 	});
 }
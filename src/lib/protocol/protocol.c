@@ -17,6 +17,8 @@
 #include "../../common/logging.h"
 #include "../../common/vector.h"
 #include "../../common/texture.h"
+#include "../../common/tiled_texture.h"
+#include "../../common/file_cache.h"
 #include "../../common/transforms.h"
 #include "../../common/quaternion.h"
 #include "../../common/hashtable.h"
@@ -106,7 +108,7 @@ struct render_tile decodeTile(const cJSON *json) {
 }
 
 cJSON *serialize_texture(const struct texture *t) {
-	if (!t) return NULL;
+	if (!t || !t->data.byte_p) return NULL;
 	cJSON *json = cJSON_CreateObject();
 	cJSON_AddNumberToObject(json, "width", t->width);
 	cJSON_AddNumberToObject(json, "height", t->height);
@@ -372,12 +374,63 @@ static sphere deserialize_sphere(const cJSON *in) {
 	return out;
 }
 
+static cJSON *serialize_sphere_set(const struct sphere_set in) {
+	cJSON *out = cJSON_CreateObject();
+	cJSON_AddNumberToObject(out, "count", in.centers.count);
+	if (in.centers.count) {
+		char *data = b64encode(in.centers.items, in.centers.count * sizeof(*in.centers.items));
+		cJSON_AddStringToObject(out, "centers", data);
+		free(data);
+		data = b64encode(in.radii.items, in.radii.count * sizeof(*in.radii.items));
+		cJSON_AddStringToObject(out, "radii", data);
+		free(data);
+	}
+	if (in.materials.count) {
+		char *data = b64encode(in.materials.items, in.materials.count * sizeof(*in.materials.items));
+		cJSON_AddStringToObject(out, "materials", data);
+		free(data);
+	}
+	return out;
+}
+
+static struct sphere_set deserialize_sphere_set(const cJSON *in) {
+	struct sphere_set out = { 0 };
+	if (!in) return out;
+	size_t count = cJSON_GetNumberValue(cJSON_GetObjectItem(in, "count"));
+	char *c_b64 = cJSON_GetStringValue(cJSON_GetObjectItem(in, "centers"));
+	char *r_b64 = cJSON_GetStringValue(cJSON_GetObjectItem(in, "radii"));
+	size_t out_bytes = 0;
+	if (c_b64 && r_b64 && count) {
+		struct vector *centers = b64decode(c_b64, strlen(c_b64), &out_bytes);
+		ASSERT(out_bytes == count * sizeof(struct vector));
+		float *radii = b64decode(r_b64, strlen(r_b64), &out_bytes);
+		ASSERT(out_bytes == count * sizeof(float));
+		for (size_t i = 0; i < count; ++i) {
+			vector_arr_add(&out.centers, centers[i]);
+			float_arr_add(&out.radii, radii[i]);
+		}
+		free(centers);
+		free(radii);
+	}
+	char *m_b64 = cJSON_GetStringValue(cJSON_GetObjectItem(in, "materials"));
+	if (m_b64 && count) {
+		int *materials = b64decode(m_b64, strlen(m_b64), &out_bytes);
+		ASSERT(out_bytes == count * sizeof(int));
+		for (size_t i = 0; i < count; ++i) {
+			int_arr_add(&out.materials, materials[i]);
+		}
+		free(materials);
+	}
+	return out;
+}
+
 static cJSON *serialize_instance(const struct instance in) {
 	cJSON *out = cJSON_CreateObject();
 	cJSON_AddItemToObject(out, "composite", serialize_transform(in.composite));
 	cJSON_AddNumberToObject(out, "object_idx", in.object_idx);
 	cJSON_AddNumberToObject(out, "bbuf_idx", in.bbuf_idx);
 	cJSON_AddBoolToObject(out, "is_mesh", isMesh(&in));
+	cJSON_AddBoolToObject(out, "is_sphere_set", isSphereSet(&in));
 	return out;
 }
 
@@ -385,10 +438,13 @@ static struct instance deserialize_instance(const cJSON *in) {
 	if (!in) return (struct instance){ 0 };
 	size_t object_idx = cJSON_GetNumberValue(cJSON_GetObjectItem(in, "object_idx"));
 	bool is_mesh = cJSON_IsTrue(cJSON_GetObjectItem(in, "is_mesh"));
+	bool is_sphere_set = cJSON_IsTrue(cJSON_GetObjectItem(in, "is_sphere_set"));
 
 	struct instance out = { 0 };
 	if (is_mesh) {
 		out = new_mesh_instance(NULL, object_idx, NULL, NULL);
+	} else if (is_sphere_set) {
+		out = new_sphere_set_instance(NULL, object_idx);
 	} else {
 		out = new_sphere_instance(NULL, object_idx, NULL, NULL);
 	}
@@ -710,10 +766,14 @@ static cJSON *serialize_scene(const struct world *in) {
 
 	cJSON *textures = cJSON_CreateArray();
 	for (size_t i = 0; i < in->textures.count; ++i) {
+		const struct texture_asset *a = &in->textures.items[i];
+		// Textures are decoded lazily, but workers get the pixels
+		struct texture *decoded = a->tiled ? tiled_texture_decode(NULL, a->tiled) : NULL;
 		cJSON *asset = cJSON_CreateObject();
-		cJSON_AddItemToObject(asset, "p", cJSON_CreateString(in->textures.items[i].path));
-		cJSON_AddItemToObject(asset, "t", serialize_texture(in->textures.items[i].t));
+		cJSON_AddItemToObject(asset, "p", cJSON_CreateString(a->path));
+		cJSON_AddItemToObject(asset, "t", serialize_texture(decoded ? decoded : a->t));
 		cJSON_AddItemToArray(textures, asset);
+		destroyTexture(decoded);
 	}
 	cJSON_AddItemToObject(out, "textures", textures);
 
@@ -746,6 +806,12 @@ static cJSON *serialize_scene(const struct world *in) {
 	}
 	cJSON_AddItemToObject(out, "spheres", spheres);
 
+	cJSON *sphere_sets = cJSON_CreateArray();
+	for (size_t i = 0; i < in->sphere_sets.count; ++i) {
+		cJSON_AddItemToArray(sphere_sets, serialize_sphere_set(in->sphere_sets.items[i]));
+	}
+	cJSON_AddItemToObject(out, "sphere_sets", sphere_sets);
+
 	cJSON *instances = cJSON_CreateArray();
 	for (size_t i = 0; i < in->instances.count; ++i) {
 		cJSON_AddItemToArray(instances, serialize_instance(in->instances.items[i]));
@@ -766,8 +832,10 @@ struct world *deserialize_scene(const cJSON *in) {
 	struct world *out = calloc(1, sizeof(*out));
 
 	out->asset_path = stringCopy("./");
+	out->cache = file_cache_new();
 	out->storage.node_pool = newBlock(NULL, 1024);
 	out->storage.node_table = newHashtable(compareNodes, &out->storage.node_pool);
+	out->storage.eliminated = &out->eliminated_nodes;
 
 	cJSON *asset_path = cJSON_GetObjectItem(in, "asset_path");
 	if (cJSON_IsString(asset_path)) {
@@ -784,9 +852,11 @@ struct world *deserialize_scene(const cJSON *in) {
 	if (cJSON_IsArray(textures)) {
 		cJSON *texture = NULL;
 		cJSON_ArrayForEach(texture, textures) {
+			struct texture *t = deserialize_texture(cJSON_GetObjectItem(texture, "t"));
 			texture_asset_arr_add(&out->textures, (struct texture_asset){
 				.path = stringCopy(cJSON_GetStringValue(cJSON_GetObjectItem(texture, "p"))),
-				.t = deserialize_texture(cJSON_GetObjectItem(texture, "t"))
+				.t = t,
+				.tiled = tiled_texture_new(t)
 			});
 		}
 	}
@@ -835,6 +905,13 @@ struct world *deserialize_scene(const cJSON *in) {
 			sphere_arr_add(&out->spheres, deserialize_sphere(sphere));
 		}
 	}
+	cJSON *sphere_sets = cJSON_GetObjectItem(in, "sphere_sets");
+	if (cJSON_IsArray(sphere_sets)) {
+		cJSON *sphere_set = NULL;
+		cJSON_ArrayForEach(sphere_set, sphere_sets) {
+			sphere_set_arr_add(&out->sphere_sets, deserialize_sphere_set(sphere_set));
+		}
+	}
 	cJSON *instances = cJSON_GetObjectItem(in, "instances");
 	if (cJSON_IsArray(instances)) {
 		cJSON *instance = NULL;
@@ -849,6 +926,8 @@ struct world *deserialize_scene(const cJSON *in) {
 		inst->bbuf = &out->shader_buffers.items[inst->bbuf_idx];
 		if (isMesh(inst)) {
 			inst->object_arr = &out->meshes;
+		} else if (isSphereSet(inst)) {
+			inst->object_arr = &out->sphere_sets;
 		} else {
 			inst->object_arr = &out->spheres;
 		}
@@ -878,6 +957,14 @@ static cJSON *serialize_prefs(const struct prefs in) {
 	cJSON_AddItemToObject(out, "width", cJSON_CreateNumber(in.override_width));
 	cJSON_AddItemToObject(out, "height", cJSON_CreateNumber(in.override_height));
 	cJSON_AddItemToObject(out, "selected_camera", cJSON_CreateNumber(in.selected_camera));
+	cJSON_AddItemToObject(out, "denoise", cJSON_CreateBool(in.denoise));
+	cJSON_AddItemToObject(out, "integrator", cJSON_CreateNumber(in.integrator));
+	cJSON_AddItemToObject(out, "flushInterval", cJSON_CreateNumber(in.flush_interval));
+	cJSON_AddItemToObject(out, "autotuneTiles", cJSON_CreateBool(in.tile_autotune));
+	cJSON_AddItemToObject(out, "pinThreads", cJSON_CreateNumber(in.pin_policy));
+	cJSON_AddItemToObject(out, "numaReplicate", cJSON_CreateBool(in.numa_replicate));
+	cJSON_AddItemToObject(out, "halfFloatTextures", cJSON_CreateBool(in.half_textures));
+	cJSON_AddItemToObject(out, "textureCacheSize", cJSON_CreateNumber(in.texture_cache_mb));
 	return out;
 }
 
@@ -897,6 +984,14 @@ struct prefs deserialize_prefs(const cJSON *in) {
 	p.override_width = cJSON_GetNumberValue(cJSON_GetObjectItem(in, "width"));
 	p.override_height = cJSON_GetNumberValue(cJSON_GetObjectItem(in, "height"));
 	p.selected_camera = cJSON_GetNumberValue(cJSON_GetObjectItem(in, "selected_camera"));
+	p.denoise = cJSON_IsTrue(cJSON_GetObjectItem(in, "denoise"));
+	p.integrator = cJSON_GetNumberValue(cJSON_GetObjectItem(in, "integrator"));
+	p.flush_interval = cJSON_GetNumberValue(cJSON_GetObjectItem(in, "flushInterval"));
+	p.tile_autotune = cJSON_IsTrue(cJSON_GetObjectItem(in, "autotuneTiles"));
+	p.pin_policy = cJSON_GetNumberValue(cJSON_GetObjectItem(in, "pinThreads"));
+	p.numa_replicate = cJSON_IsTrue(cJSON_GetObjectItem(in, "numaReplicate"));
+	p.half_textures = cJSON_IsTrue(cJSON_GetObjectItem(in, "halfFloatTextures"));
+	p.texture_cache_mb = cJSON_GetNumberValue(cJSON_GetObjectItem(in, "textureCacheSize"));
 	return p;
 }
 
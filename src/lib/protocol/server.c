@@ -151,6 +151,7 @@ static cJSON *handle_submit_work(struct worker *state, const cJSON *json) {
 	struct texture *texture = deserialize_texture(result);
 	cJSON *tile_json = cJSON_GetObjectItem(json, "tile");
 	struct render_tile tile = decodeTile(tile_json);
+	tile.merge_lock = state->tiles->tiles.items[tile.index].merge_lock;
 	state->tiles->tiles.items[tile.index] = tile;
 	state->tiles->tiles.items[tile.index].state = finished; // FIXME: Remove
 	for (int y = tile.end.y - 1; y > tile.begin.y - 1; --y) {
@@ -233,6 +234,7 @@ void *client_connection_thread(void *arg) {
 				cJSON *tile = NULL;
 				cJSON_ArrayForEach(tile, array) {
 					struct render_tile t = decodeTile(tile);
+					t.merge_lock = state->tiles->tiles.items[t.index].merge_lock;
 					state->tiles->tiles.items[t.index] = t;
 					//r->state.renderTiles[t.tileNum].completed_samples = t.completed_samples;
 				}
@@ -102,6 +102,7 @@ static struct render_tile *getWork(int connectionSocket, struct tile_set *tiles)
 	// we can just keep track of indices, and compute the tile dims
 	cJSON *tileJson = cJSON_GetObjectItem(response, "tile");
 	struct render_tile tile = decodeTile(tileJson);
+	tile.merge_lock = tiles->tiles.items[tile.index].merge_lock;
 	tiles->tiles.items[tile.index] = tile;
 	cJSON_Delete(response);
 	return &tiles->tiles.items[tile.index];
@@ -154,7 +155,7 @@ static void *workerThread(void *arg) {
 					int local_x = x - thread->current->begin.x;
 					int local_y = y - thread->current->begin.y;
 					struct color output = textureGetPixel(tileBuffer, local_x, local_y, false);
-					struct color sample = path_trace(cam_get_ray(cam, x, y, sampler), r->scene, r->prefs.bounces, sampler);
+					struct color sample = path_trace(cam_get_ray(cam, x, y, sampler), r->scene, r->prefs.bounces, sampler, NULL);
 
 					nan_clamp(&sample, &output);
 					
@@ -233,7 +234,9 @@ static cJSON *startRender(int connectionSocket, size_t thread_limit) {
 	logr(info, "%u x %u tiles\n", r->prefs.tileWidth, r->prefs.tileHeight);
 	// Do some pre-render preparations
 	// Compute BVH acceleration structures for all meshes in the scene
-	compute_accels(r->scene->meshes);
+	compute_accels(renderer_pool(r), r->scene->meshes, r->scene->sphere_sets);
+	// Tile textures and generate mip chains
+	scene_build_textures(renderer_pool(r), r->scene, r->prefs.half_textures, r->prefs.texture_cache_mb << 20);
 
 	// And then compute a single top-level BVH that contains all the objects
 	logr(info, "Computing top-level BVH: ");
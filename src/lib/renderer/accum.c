@@ -0,0 +1,83 @@
+//
+//  accum.c
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "../../includes.h"
+#include "accum.h"
+
+#include <string.h>
+#include "denoise.h"
+#include "../datatypes/tile.h"
+#include "../../common/texture.h"
+#include "../../common/platform/mutex.h"
+
+void accum_begin(struct tile_accum *acc, struct render_tile *tile, bool aovs) {
+	const size_t pixels = (size_t)tile->width * tile->height;
+	if (pixels > acc->capacity || (aovs && !acc->aov)) {
+		acc->capacity = max(pixels, acc->capacity);
+		acc->color = realloc(acc->color, acc->capacity * sizeof(*acc->color));
+		if (aovs) {
+			acc->aov = realloc(acc->aov, acc->capacity * sizeof(*acc->aov));
+			acc->moment = realloc(acc->moment, acc->capacity * sizeof(*acc->moment));
+		}
+	}
+	acc->tile = tile;
+	acc->pixels = pixels;
+	acc->samples = 0;
+	memset(acc->color, 0, pixels * sizeof(*acc->color));
+	if (acc->aov) {
+		memset(acc->aov, 0, pixels * sizeof(*acc->aov));
+		memset(acc->moment, 0, pixels * sizeof(*acc->moment));
+	}
+}
+
+void accum_add(struct tile_accum *acc, size_t i, struct color sample, const struct path_aov *aov) {
+	// Clamp out NaNs by substituting in what we've got so far
+	if (sample.red != sample.red || sample.green != sample.green || sample.blue != sample.blue || sample.alpha != sample.alpha)
+		sample = acc->samples ? colorCoef(1.0f / acc->samples, acc->color[i]) : g_black_color;
+	acc->color[i] = colorAdd(acc->color[i], sample);
+	if (acc->aov && aov) {
+		acc->aov[i].albedo = colorAdd(acc->aov[i].albedo, aov->albedo);
+		acc->aov[i].normal = vec_add(acc->aov[i].normal, aov->normal);
+		acc->aov[i].depth += aov->depth;
+		acc->moment[i] = colorAdd(acc->moment[i], colorMul(sample, sample));
+	}
+}
+
+bool accum_flush(struct tile_accum *acc, struct texture *buf, struct aov_buffers *aovs) {
+	if (!acc->samples) return false;
+	struct render_tile *tile = acc->tile;
+	mutex_lock(tile->merge_lock);
+	const size_t prev = tile->completed_samples;
+	const size_t count = acc->samples;
+	const float inv_total = 1.0f / (prev + count);
+	size_t i = 0;
+	for (int y = tile->begin.y; y < tile->end.y; ++y) {
+		for (int x = tile->begin.x; x < tile->end.x; ++x, ++i) {
+			struct color output = prev ? colorCoef((float)prev, textureGetPixel(buf, x, y, false)) : g_black_color;
+			setPixel(buf, colorCoef(inv_total, colorAdd(output, acc->color[i])), x, y);
+			if (acc->aov && aovs) aov_merge(aovs, x, y, &acc->aov[i], acc->moment[i], prev, count);
+		}
+	}
+	tile->completed_samples = prev + count;
+	mutex_release(tile->merge_lock);
+
+	memset(acc->color, 0, acc->pixels * sizeof(*acc->color));
+	if (acc->aov) {
+		memset(acc->aov, 0, acc->pixels * sizeof(*acc->aov));
+		memset(acc->moment, 0, acc->pixels * sizeof(*acc->moment));
+	}
+	acc->samples = 0;
+	return prev < tile->total_samples && prev + count >= tile->total_samples;
+}
+
+void accum_free(struct tile_accum *acc) {
+	free(acc->color);
+	free(acc->aov);
+	free(acc->moment);
+	*acc = (struct tile_accum){ 0 };
+}
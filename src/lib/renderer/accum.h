@@ -0,0 +1,44 @@
+//
+//  accum.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "../../common/color.h"
+#include "pathtrace.h"
+
+struct render_tile;
+struct texture;
+struct aov_buffers;
+
+// Thread-local sums for a batch of samples of a single tile.
+// Several threads may be rendering different sample ranges of the same tile,
+// each of them folds their sums into the shared framebuffer with accum_flush()
+struct tile_accum {
+	struct render_tile *tile;
+	struct color *color;
+	struct path_aov *aov; // Only allocated when AOVs are requested
+	struct color *moment;
+	size_t samples; // Samples summed per pixel
+	size_t pixels;
+	size_t capacity;
+};
+
+// Size the buffers for tile and zero them
+void accum_begin(struct tile_accum *acc, struct render_tile *tile, bool aovs);
+
+// Add a sample for the pixel at tile-local index i
+void accum_add(struct tile_accum *acc, size_t i, struct color sample, const struct path_aov *aov);
+
+/// Fold the accumulated sums into buf and aovs, and reset the sums.
+/// Does nothing if there are no samples to flush.
+/// @return true if this flush completed the tile
+bool accum_flush(struct tile_accum *acc, struct texture *buf, struct aov_buffers *aovs);
+
+void accum_free(struct tile_accum *acc);
@@ -0,0 +1,123 @@
+//
+//  autotune.c
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "../../includes.h"
+#include "autotune.h"
+
+#include "renderer.h"
+#include "pathtrace.h"
+#include "../datatypes/camera.h"
+#include "../datatypes/scene.h"
+#include "../../common/logging.h"
+#include "../../common/timer.h"
+#include "../../common/platform/thread_pool.h"
+#include "../../common/platform/atomics.h"
+#include "samplers/sampler.h"
+
+const unsigned tile_autotune_sizes[] = { 8, 16, 32, 64, 128 };
+const size_t tile_autotune_size_count = sizeof(tile_autotune_sizes) / sizeof(*tile_autotune_sizes);
+
+// The pre-pass covers a window in the middle of the frame, at most this big
+#define window_size 256
+
+struct tune_job {
+	const struct renderer *r;
+	const struct camera *cam;
+	struct intCoord origin;
+	unsigned window_w;
+	unsigned window_h;
+	unsigned tile_size;
+	unsigned tiles_x;
+	size_t tile_count;
+	size_t next_tile;
+};
+
+static void tune_thread(void *arg) {
+	struct tune_job *job = arg;
+	const struct renderer *r = job->r;
+	const unsigned size = job->tile_size;
+	struct sampler **samplers = calloc(size, sizeof(*samplers));
+	for (unsigned i = 0; i < size; ++i) samplers[i] = newSampler();
+	struct camera_rays rays = { 0 };
+
+	size_t t;
+	while ((t = atomic_add_size(&job->next_tile, 1)) < job->tile_count) {
+		const unsigned begin_x = job->origin.x + (t % job->tiles_x) * size;
+		const unsigned begin_y = job->origin.y + (t / job->tiles_x) * size;
+		const unsigned end_x = min(begin_x + size, job->origin.x + job->window_w);
+		const unsigned end_y = min(begin_y + size, job->origin.y + job->window_h);
+		for (unsigned y = begin_y; y < end_y; ++y) {
+			for (unsigned x = begin_x; x < end_x; ++x) {
+				initSampler(samplers[x - begin_x], SAMPLING_STRATEGY, 0, 1, (uint32_t)(y * job->cam->width + x));
+			}
+			cam_get_rays(job->cam, begin_x, y, end_x - begin_x, samplers, &rays);
+			for (unsigned i = 0; i < end_x - begin_x; ++i) {
+				(void)path_trace(cam_rays_get(&rays, i), r->scene, r->prefs.bounces, samplers[i], NULL);
+			}
+		}
+	}
+
+	cam_rays_free(&rays);
+	for (unsigned i = 0; i < size; ++i) destroySampler(samplers[i]);
+	free(samplers);
+}
+
+static long time_pass(struct cr_thread_pool *pool, size_t threads, struct tune_job job) {
+	struct cr_task_group group = { 0 };
+	job.tiles_x = (job.window_w + job.tile_size - 1) / job.tile_size;
+	const unsigned tiles_y = (job.window_h + job.tile_size - 1) / job.tile_size;
+	job.tile_count = job.tiles_x * tiles_y;
+	job.next_tile = 0;
+	struct timeval timer = { 0 };
+	timer_start(&timer);
+	for (size_t i = 0; i < threads; ++i) {
+		thread_pool_enqueue_group(pool, &group, tune_thread, &job);
+	}
+	thread_pool_wait_group(pool, &group);
+	return timer_get_us(timer);
+}
+
+void tile_autotune(struct renderer *r, const struct camera *cam, unsigned *tile_w, unsigned *tile_h) {
+	const size_t threads = r->prefs.threads;
+	struct tune_job job = {
+		.r = r,
+		.cam = cam,
+		.window_w = min(cam->width, window_size),
+		.window_h = min(cam->height, window_size),
+	};
+	job.origin = (struct intCoord){ (cam->width - job.window_w) / 2, (cam->height - job.window_h) / 2 };
+
+	struct cr_thread_pool *pool = renderer_pool(r);
+	// Warm up caches and fault in pages, so the first candidate isn't penalized
+	job.tile_size = 32;
+	(void)time_pass(pool, threads, job);
+
+	unsigned best = 0;
+	long best_us = 0;
+	logr(info, "Autotuning tile size:");
+	for (size_t i = 0; i < tile_autotune_size_count; ++i) {
+		const unsigned size = tile_autotune_sizes[i];
+		// Skip sizes that would starve threads in the actual render
+		const size_t tiles = ((cam->width + size - 1) / size) * ((cam->height + size - 1) / size);
+		if (i && tiles < threads) break;
+		if (size > job.window_w && size > job.window_h) break;
+		job.tile_size = size;
+		const long us = time_pass(pool, threads, job);
+		logr(plain, " %ux%u: %.1fms", size, size, us / 1000.0);
+		if (!best || us < best_us) {
+			best = size;
+			best_us = us;
+		}
+	}
+	logr(plain, "\n");
+
+	if (!best) return;
+	logr(info, "Using %ux%u tiles\n", best, best);
+	*tile_w = best;
+	*tile_h = best;
+}
@@ -0,0 +1,25 @@
+//
+//  autotune.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+
+struct renderer;
+struct camera;
+
+/// Tile sizes tile_autotune() picks from, smallest first
+extern const unsigned tile_autotune_sizes[];
+extern const size_t tile_autotune_size_count;
+
+/// Render a 1spp pre-pass over the middle of the frame with a few candidate tile sizes,
+/// and pick the one that finished fastest on this machine, for this scene.
+/// @remarks The scene BVHs must be built before calling this.
+/// @param tile_w Current tile width, replaced with the winner
+/// @param tile_h Current tile height, replaced with the winner
+void tile_autotune(struct renderer *r, const struct camera *cam, unsigned *tile_w, unsigned *tile_h);
@@ -0,0 +1,255 @@
+//
+//  denoise.c
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "../../includes.h"
+#include "denoise.h"
+
+#include <string.h>
+#include "pathtrace.h"
+#include "../../common/texture.h"
+#include "../../common/vector.h"
+#include "../../common/logging.h"
+#include "../../common/platform/thread_pool.h"
+
+// Edge-stopping function tuning, roughly following Dammertz et al. 2010 and
+// the variance-guided luminance term from SVGF (Schied et al. 2017)
+#define SIGMA_LUMINANCE 4.0f
+#define SIGMA_DEPTH 0.1f
+#define ALBEDO_EPSILON 0.001f
+#define SPATIAL_VARIANCE_SAMPLES 4
+
+static struct texture *prepare(struct texture *t, size_t width, size_t height, size_t channels) {
+	if (t && t->width == width && t->height == height) {
+		tex_clear(t);
+		return t;
+	}
+	destroyTexture(t);
+	return newTexture(float_p, width, height, channels);
+}
+
+void aov_buffers_prepare(struct aov_buffers *aovs, size_t width, size_t height) {
+	aovs->albedo   = prepare(aovs->albedo,   width, height, 3);
+	aovs->normal   = prepare(aovs->normal,   width, height, 3);
+	aovs->depth    = prepare(aovs->depth,    width, height, 1);
+	aovs->variance = prepare(aovs->variance, width, height, 3);
+}
+
+void aov_buffers_free(struct aov_buffers *aovs) {
+	destroyTexture(aovs->albedo);
+	destroyTexture(aovs->normal);
+	destroyTexture(aovs->depth);
+	destroyTexture(aovs->variance);
+	*aovs = (struct aov_buffers){ 0 };
+}
+
+static inline struct color merge_avg(struct color prev_avg, struct color sum, size_t prev, size_t count) {
+	return colorCoef(1.0f / (prev + count), colorAdd(colorCoef((float)prev, prev_avg), sum));
+}
+
+void aov_merge(struct aov_buffers *aovs, size_t x, size_t y, const struct path_aov *sum, struct color moment_sum, size_t prev, size_t count) {
+	if (!aovs->albedo) return;
+	const struct color normal = { sum->normal.x, sum->normal.y, sum->normal.z, 0.0f };
+	const struct color depth = { sum->depth, 0.0f, 0.0f, 0.0f };
+	setPixel(aovs->albedo, merge_avg(textureGetPixel(aovs->albedo, x, y, false), sum->albedo, prev, count), x, y);
+	setPixel(aovs->normal, merge_avg(textureGetPixel(aovs->normal, x, y, false), normal, prev, count), x, y);
+	setPixel(aovs->depth, merge_avg(textureGetPixel(aovs->depth, x, y, false), depth, prev, count), x, y);
+	setPixel(aovs->variance, merge_avg(textureGetPixel(aovs->variance, x, y, false), moment_sum, prev, count), x, y);
+}
+
+void aov_accumulate(struct aov_buffers *aovs, const struct path_aov *aov, struct color sample, size_t n, size_t x, size_t y) {
+	aov_merge(aovs, x, y, aov, colorMul(sample, sample), n - 1, 1);
+}
+
+static inline float luminance(const float *rgb) {
+	return 0.2126f * rgb[0] + 0.7152f * rgb[1] + 0.0722f * rgb[2];
+}
+
+struct atrous_pass {
+	const float *in;
+	float *out;
+	const float *var_in;
+	float *var_out;
+	const float *normal;
+	const float *depth;
+	size_t width;
+	size_t height;
+	size_t row_begin;
+	size_t row_end;
+	int step;
+};
+
+static void atrous_rows(void *arg) {
+	const struct atrous_pass *p = arg;
+	static const float kernel[5] = { 1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+	const int w = (int)p->width;
+	const int h = (int)p->height;
+	for (int y = (int)p->row_begin; y < (int)p->row_end; ++y) {
+		for (int x = 0; x < w; ++x) {
+			const size_t pi = (size_t)y * w + x;
+			const float *c_p = &p->in[pi * 4];
+			const float *n_p = &p->normal[pi * 3];
+			const float z_p = p->depth[pi];
+			float *out = &p->out[pi * 4];
+			// Camera rays that missed everything have no features to guide us, leave them be.
+			if (n_p[0] == 0.0f && n_p[1] == 0.0f && n_p[2] == 0.0f) {
+				memcpy(out, c_p, 4 * sizeof(*out));
+				p->var_out[pi] = p->var_in[pi];
+				continue;
+			}
+			const float l_p = luminance(c_p);
+			const float l_denom = SIGMA_LUMINANCE * sqrtf(max(p->var_in[pi], 0.0f)) + 1e-4f;
+			const float z_denom = SIGMA_DEPTH * p->step * max(z_p, 1e-4f);
+
+			float sum_w = 0.0f;
+			float sum_var = 0.0f;
+			float sum[3] = { 0.0f };
+			for (int dy = -2; dy <= 2; ++dy) {
+				const int qy = y + dy * p->step;
+				if (qy < 0 || qy >= h) continue;
+				for (int dx = -2; dx <= 2; ++dx) {
+					const int qx = x + dx * p->step;
+					if (qx < 0 || qx >= w) continue;
+					const size_t qi = (size_t)qy * w + qx;
+					const float *c_q = &p->in[qi * 4];
+					float weight = kernel[dx + 2] * kernel[dy + 2];
+					if (qi != pi) {
+						const float *n_q = &p->normal[qi * 3];
+						// pow(max(0, dot), 128) via repeated squaring
+						float w_n = max(n_p[0] * n_q[0] + n_p[1] * n_q[1] + n_p[2] * n_q[2], 0.0f);
+						for (int i = 0; i < 7; ++i) w_n *= w_n;
+						const float w_z = expf(-fabsf(z_p - p->depth[qi]) / z_denom);
+						const float w_l = expf(-fabsf(l_p - luminance(c_q)) / l_denom);
+						weight *= w_n * w_z * w_l;
+					}
+					sum[0] += weight * c_q[0];
+					sum[1] += weight * c_q[1];
+					sum[2] += weight * c_q[2];
+					sum_var += weight * weight * p->var_in[qi];
+					sum_w += weight;
+				}
+			}
+			// The center tap always contributes, so sum_w > 0 here
+			out[0] = sum[0] / sum_w;
+			out[1] = sum[1] / sum_w;
+			out[2] = sum[2] / sum_w;
+			out[3] = c_p[3];
+			p->var_out[pi] = sum_var / (sum_w * sum_w);
+		}
+	}
+}
+
+void denoise_atrous(struct cr_thread_pool *pool, struct texture *color, const struct aov_buffers *aovs, size_t samples, unsigned passes) {
+	if (!color || !aovs->albedo || !passes) return;
+	if (color->precision != float_p || color->channels != 4) {
+		logr(warning, "Denoiser expects a 4 channel float buffer, skipping\n");
+		return;
+	}
+	const size_t pixels = color->width * color->height;
+	float *buf[2] = {
+		malloc(pixels * 4 * sizeof(float)),
+		malloc(pixels * 4 * sizeof(float))
+	};
+	float *var[2] = {
+		malloc(pixels * sizeof(float)),
+		malloc(pixels * sizeof(float))
+	};
+	// Averaged normals are shorter than unit length, so renormalize them for the dot product test
+	float *normals = malloc(pixels * 3 * sizeof(float));
+	for (size_t i = 0; i < pixels; ++i) {
+		const float *n = &aovs->normal->data.float_p[i * 3];
+		const float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		const float inv = len > 0.0f ? 1.0f / len : 0.0f;
+		normals[i * 3 + 0] = n[0] * inv;
+		normals[i * 3 + 1] = n[1] * inv;
+		normals[i * 3 + 2] = n[2] * inv;
+	}
+	const float *albedo = aovs->albedo->data.float_p;
+	const float *moment = aovs->variance->data.float_p;
+	const float inv_samples = 1.0f / max(samples, 1);
+
+	// Demodulate albedo, so we filter lighting only and keep texture detail intact.
+	for (size_t i = 0; i < pixels; ++i) {
+		const float *c = &color->data.float_p[i * 4];
+		const float *a = &albedo[i * 3];
+		float channel_var[3];
+		for (int ch = 0; ch < 3; ++ch) {
+			const float div = a[ch] > ALBEDO_EPSILON ? a[ch] : 1.0f;
+			buf[0][i * 4 + ch] = c[ch] / div;
+			channel_var[ch] = max(moment[i * 3 + ch] - c[ch] * c[ch], 0.0f);
+		}
+		buf[0][i * 4 + 3] = c[3];
+		const float a_lum = max(luminance(a), ALBEDO_EPSILON);
+		var[0][i] = (luminance(channel_var) * inv_samples) / (a_lum * a_lum);
+	}
+
+	// With only a handful of samples, the per-pixel moments are useless. Estimate variance
+	// spatially instead, like SVGF does for disoccluded pixels.
+	if (samples < SPATIAL_VARIANCE_SAMPLES) {
+		const int w = (int)color->width;
+		const int h = (int)color->height;
+		for (int y = 0; y < h; ++y) {
+			for (int x = 0; x < w; ++x) {
+				float sum = 0.0f, sum_sq = 0.0f;
+				int n = 0;
+				for (int qy = max(y - 2, 0); qy <= min(y + 2, h - 1); ++qy) {
+					for (int qx = max(x - 2, 0); qx <= min(x + 2, w - 1); ++qx) {
+						const float l = luminance(&buf[0][((size_t)qy * w + qx) * 4]);
+						sum += l;
+						sum_sq += l * l;
+						n++;
+					}
+				}
+				const float mean = sum / n;
+				var[0][(size_t)y * w + x] = max(sum_sq / n - mean * mean, 0.0f);
+			}
+		}
+	}
+
+	const size_t band_count = thread_pool_size(pool) * 4;
+	const size_t rows_per_band = (color->height + band_count - 1) / band_count;
+	struct atrous_pass *bands = calloc(band_count, sizeof(*bands));
+
+	struct cr_task_group group = { 0 };
+	size_t current = 0;
+	for (unsigned pass = 0; pass < passes; ++pass) {
+		for (size_t b = 0; b < band_count; ++b) {
+			bands[b] = (struct atrous_pass){
+				.in = buf[current],
+				.out = buf[!current],
+				.var_in = var[current],
+				.var_out = var[!current],
+				.normal = normals,
+				.depth = aovs->depth->data.float_p,
+				.width = color->width,
+				.height = color->height,
+				.row_begin = min(b * rows_per_band, color->height),
+				.row_end = min((b + 1) * rows_per_band, color->height),
+				.step = 1 << pass,
+			};
+			thread_pool_enqueue_group(pool, &group, atrous_rows, &bands[b]);
+		}
+		thread_pool_wait_group(pool, &group);
+		current = !current;
+	}
+	free(bands);
+
+	// And remodulate
+	for (size_t i = 0; i < pixels; ++i) {
+		const float *a = &albedo[i * 3];
+		for (int ch = 0; ch < 3; ++ch) {
+			const float mul = a[ch] > ALBEDO_EPSILON ? a[ch] : 1.0f;
+			color->data.float_p[i * 4 + ch] = buf[current][i * 4 + ch] * mul;
+		}
+	}
+
+	free(buf[0]);
+	free(buf[1]);
+	free(var[0]);
+	free(var[1]);
+	free(normals);
+}
@@ -0,0 +1,46 @@
+//
+//  denoise.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include "../../common/color.h"
+
+struct texture;
+struct cr_thread_pool;
+struct path_aov;
+
+// Auxiliary feature buffers, accumulated alongside the beauty pass.
+// All of these share the layout of result_buf, so they can be indexed
+// with the same pixel offsets.
+struct aov_buffers {
+	struct texture *albedo;
+	struct texture *normal;
+	struct texture *depth;
+	struct texture *variance; // Running second moment, E[x^2]. Variance is derived at denoise time.
+};
+
+// Allocates, resizes or clears the buffers to match the given dimensions
+void aov_buffers_prepare(struct aov_buffers *aovs, size_t width, size_t height);
+void aov_buffers_free(struct aov_buffers *aovs);
+
+// Fold sample number n (1-based) into the running averages at x,y
+void aov_accumulate(struct aov_buffers *aovs, const struct path_aov *aov, struct color sample, size_t n, size_t x, size_t y);
+
+// Fold count samples worth of summed features into x,y, which already holds the average of prev samples.
+// moment_sum is the sum of squared beauty samples.
+void aov_merge(struct aov_buffers *aovs, size_t x, size_t y, const struct path_aov *sum, struct color moment_sum, size_t prev, size_t count);
+
+/// Edge-avoiding à-trous wavelet filter, guided by the AOV buffers.
+/// @remarks The color buffer is modified in place. Lighting is demodulated by albedo before filtering.
+/// @param pool Thread pool to filter on
+/// @param color 4 channel float buffer to denoise
+/// @param aovs Feature buffers matching color
+/// @param samples Samples per pixel that went into color, used to estimate variance of the mean
+/// @param passes Number of filter iterations, each one doubles the filter footprint
+void denoise_atrous(struct cr_thread_pool *pool, struct texture *color, const struct aov_buffers *aovs, size_t samples, unsigned passes);
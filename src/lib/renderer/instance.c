@@ -14,6 +14,7 @@
 #include "../datatypes/bbox.h"
 #include "../datatypes/mesh.h"
 #include "../datatypes/sphere.h"
+#include "../datatypes/sphere_set.h"
 #include "../datatypes/scene.h"
 
 struct sphereVolume {
@@ -38,6 +39,13 @@ static inline struct coord getTexMapSphere(const struct hitRecord *isect) {
 	return (struct coord){ u, v };
 }
 
+// Width of the incident ray cone at the hit, in world units, stretched by how obliquely it lands
+static inline float cone_width_at(const struct lightRay *ray, const struct hitRecord *isect) {
+	const float width = ray->cone_width + ray->cone_spread * isect->distance * vec_length(ray->direction);
+	const float cos_theta = fabsf(vec_dot(vec_normalize(isect->surfaceNormal), vec_normalize(ray->direction)));
+	return width / max(cos_theta, 0.01f);
+}
+
 static bool intersectSphere(const struct instance *instance, const struct lightRay *ray, struct hitRecord *isect, sampler *sampler) {
 	(void)sampler;
 	struct lightRay copy = *ray;
@@ -50,6 +58,11 @@ static bool intersectSphere(const struct instance *instance, const struct lightR
 		isect->bsdf = instance->bbuf->bsdfs.items[0];
 		tform_point(&isect->hitPoint, instance->composite.A);
 		tform_vector_transpose(&isect->surfaceNormal, instance->composite.Ainv);
+		if (ray->cone_spread > 0.0f) {
+			// The uv map covers the surface area 4πr² once
+			const float radius = sphere->radius * vec_length(ray->direction) / vec_length(copy.direction);
+			isect->footprint = cone_width_at(ray, isect) / (2.0f * sqrtf(PI) * radius);
+		}
 		return true;
 	}
 	return false;
@@ -152,6 +165,19 @@ static struct coord getTexMapMesh(const struct mesh *mesh, const struct hitRecor
 	return coord_add(coord_add(ucomponent, vcomponent), wcomponent);
 }
 
+// Texture coordinates per unit of object space distance on this polygon, 0 if it has no uvs
+static float texel_density(const struct mesh *mesh, const struct poly *p) {
+	if (!mesh->vbuf->texture_coords.count || p->textureIndex[0] == -1) return 0.0f;
+	const struct vector *v = mesh->vbuf->vertices.items;
+	const struct coord *t = mesh->vbuf->texture_coords.items;
+	const float area = vec_length(vec_cross(
+		vec_sub(v[p->vertexIndex[1]], v[p->vertexIndex[0]]),
+		vec_sub(v[p->vertexIndex[2]], v[p->vertexIndex[0]])));
+	const struct coord t0 = t[p->textureIndex[0]], t1 = t[p->textureIndex[1]], t2 = t[p->textureIndex[2]];
+	const float uv_area = fabsf((t1.x - t0.x) * (t2.y - t0.y) - (t2.x - t0.x) * (t1.y - t0.y));
+	return area > 0.0f ? sqrtf(uv_area / area) : 0.0f;
+}
+
 static bool intersectMesh(const struct instance *instance, const struct lightRay *ray, struct hitRecord *isect, sampler *sampler) {
 	struct lightRay copy = *ray;
 	tform_ray(&copy, instance->composite.Ainv);
@@ -165,6 +191,11 @@ static bool intersectMesh(const struct instance *instance, const struct lightRay
 		tform_point(&isect->hitPoint, instance->composite.A);
 		tform_vector_transpose(&isect->surfaceNormal, instance->composite.Ainv);
 		isect->surfaceNormal = vec_normalize(isect->surfaceNormal);
+		if (ray->cone_spread > 0.0f) {
+			// Object to world scale, assuming it's uniform
+			const float scale = vec_length(ray->direction) / vec_length(copy.direction);
+			isect->footprint = cone_width_at(ray, isect) * texel_density(mesh, isect->polygon) / scale;
+		}
 		return true;
 	}
 	return false;
@@ -252,3 +283,54 @@ struct instance new_mesh_instance(struct mesh_arr *meshes, size_t idx, float *de
 		};
 	}
 }
+
+// The whole set shares one transform, so the ray only gets transformed once, not per sphere
+static bool intersectSphereSet(const struct instance *instance, const struct lightRay *ray, struct hitRecord *isect, sampler *sampler) {
+	(void)sampler;
+	struct lightRay copy = *ray;
+	tform_ray(&copy, instance->composite.Ainv);
+	struct sphere_set *set = &((struct sphere_set_arr *)instance->object_arr)->items[instance->object_idx];
+	if (!set->bvh) return false;
+	copy.start = vec_add(copy.start, vec_scale(copy.direction, set->rayOffset));
+	size_t idx;
+	if (!traverse_sphere_set_bvh(set, &copy, isect, &idx)) return false;
+	isect->uv = getTexMapSphere(isect);
+	// Indices come from the API unchecked, and the bound material set may be shorter than the set expects
+	const size_t mat_idx = set->materials.count ? (size_t)set->materials.items[idx] : 0;
+	isect->bsdf = instance->bbuf->bsdfs.items[mat_idx < instance->bbuf->bsdfs.count ? mat_idx : 0];
+	tform_point(&isect->hitPoint, instance->composite.A);
+	tform_vector_transpose(&isect->surfaceNormal, instance->composite.Ainv);
+	isect->surfaceNormal = vec_normalize(isect->surfaceNormal);
+	if (ray->cone_spread > 0.0f) {
+		const float radius = set->radii.items[idx] * vec_length(ray->direction) / vec_length(copy.direction);
+		isect->footprint = cone_width_at(ray, isect) / (2.0f * sqrtf(PI) * radius);
+	}
+	return true;
+}
+
+bool isSphereSet(const struct instance *instance) {
+	return instance->intersectFn == intersectSphereSet;
+}
+
+static void getSphereSetBBoxAndCenter(const struct instance *instance, struct boundingBox *bbox, struct vector *center) {
+	struct sphere_set *set = &((struct sphere_set_arr *)instance->object_arr)->items[instance->object_idx];
+	if (!set->bvh) {
+		*bbox = (struct boundingBox){ 0 };
+		*center = vec_zero();
+		set->rayOffset = 0.0f;
+		return;
+	}
+	*bbox = get_transformed_root_bbox(set->bvh, &instance->composite.A);
+	*center = bboxCenter(bbox);
+	set->rayOffset = rayOffset(*bbox);
+}
+
+struct instance new_sphere_set_instance(struct sphere_set_arr *sets, size_t idx) {
+	return (struct instance) {
+		.object_arr = sets,
+		.object_idx = idx,
+		.composite = tform_new(),
+		.intersectFn = intersectSphereSet,
+		.getBBoxAndCenterFn = getSphereSetBBoxAndCenter
+	};
+}
@@ -17,6 +17,7 @@
 #include "../nodes/bsdfnode.h"
 #include "../datatypes/mesh.h"
 #include "../datatypes/sphere.h"
+#include "../datatypes/sphere_set.h"
 
 struct lightRay;
 struct hitRecord;
@@ -37,5 +38,7 @@ dyn_array_def(instance)
 
 struct instance new_sphere_instance(struct sphere_arr *spheres, size_t idx, float *density, struct block **pool);
 struct instance new_mesh_instance(struct mesh_arr *meshes, size_t idx, float *density, struct block **pool);
+struct instance new_sphere_set_instance(struct sphere_set_arr *sets, size_t idx);
 
 bool isMesh(const struct instance *instance);
+bool isSphereSet(const struct instance *instance);
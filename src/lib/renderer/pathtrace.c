@@ -30,7 +30,7 @@ static inline struct hitRecord getClosestIsect(struct lightRay *incidentRay, con
 	return isect;
 }
 
-struct color path_trace(struct lightRay incident, const struct world *scene, int max_bounces, sampler *sampler) {
+struct color path_trace(struct lightRay incident, const struct world *scene, int max_bounces, sampler *sampler, struct path_aov *aov) {
 	struct color path_weight = g_white_color;
 	struct color path_radiance = g_black_color; // Final path contribution "color"
 	struct lightRay currentRay = incident;
@@ -38,11 +38,20 @@ struct color path_trace(struct lightRay incident, const struct world *scene, int
 	for (int bounce = 0; bounce <= max_bounces; ++bounce) {
 		const struct hitRecord isect = getClosestIsect(&currentRay, scene, sampler);
 		if (isect.instIndex < 0) {
-			path_radiance = colorAdd(path_radiance, colorMul(path_weight, scene->background->sample(scene->background, sampler, &isect).weight));
+			const struct color bg = scene->background->sample(scene->background, sampler, &isect).weight;
+			if (aov && bounce == 0) *aov = (struct path_aov){ .albedo = bg };
+			path_radiance = colorAdd(path_radiance, colorMul(path_weight, bg));
 			break;
 		}
 		
 		const struct bsdfSample sample = isect.bsdf->sample(isect.bsdf, sampler, &isect);
+		if (aov && bounce == 0) {
+			*aov = (struct path_aov){
+				.albedo = sample.weight,
+				.normal = isect.surfaceNormal,
+				.depth = isect.distance
+			};
+		}
 		//TODO: emission contribution needs to be adjusted down by probability of randomly hitting it
 		//FIXME: emits_light only gets set if the root node of a shader graph is emissive, so maybe fix that
 		// if (true || scene->instances[isect.instIndex].emits_light) {
@@ -50,7 +59,7 @@ struct color path_trace(struct lightRay incident, const struct world *scene, int
 		// }
 		if (bounce == max_bounces) break;
 
-		currentRay = sample.out;
+		currentRay = ray_cone_continue(sample.out, &currentRay, isect.distance);
 		const struct color attenuation = sample.weight;
 		
 		// Russian Roulette - Abort a path early if it won't contribute much to the final image
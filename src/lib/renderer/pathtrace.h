@@ -13,4 +13,12 @@
 
 struct world;
 
-struct color path_trace(struct lightRay incident, const struct world *scene, int max_bounces, sampler *sampler);
+// Auxiliary outputs captured at the primary hit, consumed by the denoiser.
+struct path_aov {
+	struct color albedo;
+	struct vector normal;
+	float depth;
+};
+
+// aov is optional, pass NULL if you don't need them.
+struct color path_trace(struct lightRay incident, const struct world *scene, int max_bounces, sampler *sampler, struct path_aov *aov);
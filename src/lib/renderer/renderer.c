@@ -14,7 +14,12 @@
 #include "../../common/logging.h"
 #include "../../common/timer.h"
 #include "../../common/texture.h"
+#include "../../common/texture_cache.h"
+#include "../../common/tiled_texture.h"
+#include "../../common/file_cache.h"
+#include "../../common/fileio.h"
 #include "../../common/platform/thread.h"
+#include "../../common/platform/thread_pool.h"
 #include "../../common/platform/mutex.h"
 #include "../../common/platform/capabilities.h"
 #include "../../common/platform/signal.h"
@@ -27,11 +32,18 @@
 #include "../protocol/server.h"
 #include "../accelerators/bvh.h"
 #include "samplers/sampler.h"
+#include "denoise.h"
+#include "stream.h"
+#include "accum.h"
+#include "autotune.h"
 
 //Main thread loop speeds
 #define paused_msec 100
 #define active_msec  16
 
+// Each à-trous pass doubles the filter footprint, 5 gets us to 125x125px
+#define denoise_passes 5
+
 static bool g_aborted = false;
 
 void sigHandler(int sig) {
@@ -54,12 +66,17 @@ static void print_stats(const struct world *scene) {
 			normals += mesh->vbuf->normals.count;
 		}
 	}
+	// Spheres in sphere sets count as spheres too
+	size_t spheres = scene->spheres.count;
+	for (size_t i = 0; i < scene->sphere_sets.count; ++i) {
+		spheres += scene->sphere_sets.items[i].centers.count;
+	}
 	logr(info, "Totals: %liV, %liN, %zuI, %liP, %zuS, %zuM\n",
 		   vertices,
 		   normals,
 		   scene->instances.count,
 		   polys,
-		   scene->spheres.count,
+		   spheres,
 		   scene->meshes.count);
 }
 
@@ -73,7 +90,23 @@ void update_cb_info(struct renderer *r, struct tile_set *set, struct cr_renderer
 	static uint64_t avg_per_sample_us = 0;
 	static uint64_t avg_tile_pass_us = 0;
 	// Notice: Casting away const here
-	memcpy((struct cr_tile *)i->tiles, set->tiles.items, sizeof(*i->tiles) * i->tiles_count);
+	struct cr_tile *tiles = (struct cr_tile *)i->tiles;
+	for (size_t t = 0; t < i->tiles_count; ++t) {
+		const struct render_tile *tile = &set->tiles.items[t];
+		tiles[t] = (struct cr_tile){
+			.w = tile->width,
+			.h = tile->height,
+			.start_x = tile->begin.x,
+			.start_y = tile->begin.y,
+			.end_x = tile->end.x,
+			.end_y = tile->end.y,
+			.state = (enum cr_tile_state)tile->state,
+			.network_renderer = tile->network_renderer,
+			.index = tile->index,
+			.total_samples = tile->total_samples,
+			.completed_samples = tile->completed_samples,
+		};
+	}
 	if (!r->state.workers.count) return;
 	//Gather and maintain this average constantly.
 	size_t remote_threads = 0;
@@ -87,7 +120,7 @@ void update_cb_info(struct renderer *r, struct tile_set *set, struct cr_renderer
 		avg_tile_pass_us += avg_per_sample_us / r->state.workers.count;
 		avg_tile_pass_us /= ctr++;
 	}
-	double avg_per_ray_us = (double)avg_tile_pass_us / (double)(r->prefs.tileHeight * r->prefs.tileWidth);
+	double avg_per_ray_us = (double)avg_tile_pass_us / (double)(r->state.tile_height * r->state.tile_width);
 	uint64_t completed_samples = 0;
 	for (size_t t = 0; t < r->state.workers.count; ++t) {
 		completed_samples += r->state.workers.items[t].totalSamples;
@@ -103,7 +136,7 @@ void update_cb_info(struct renderer *r, struct tile_set *set, struct cr_renderer
 	i->eta_ms = eta_ms_till_done;
 	i->completion = r->prefs.iterative ?
 		((double)r->state.finishedPasses / (double)r->prefs.sampleCount) :
-		((double)set->finished / (double)set->tiles.count);
+		((double)tile_set_claimed(set) / (double)set->tiles.count);
 
 }
 
@@ -122,6 +155,58 @@ void renderer_start_interactive(struct renderer *r) {
 	});
 }
 
+struct replica_job {
+	const struct world *scene;
+	struct world *replica;
+	int cpu;
+};
+
+static void replicate_task(void *arg) {
+	struct replica_job *job = arg;
+	// Pages are placed on the node of the thread that touches them first, so copy from a CPU on the target node
+	thread_pin_self(job->cpu);
+	job->replica = scene_replicate_accels(job->scene);
+	thread_unpin_self();
+}
+
+// Returns an array with a copy of the scene acceleration structures for each NUMA node
+static struct world **replicate_accels(struct cr_thread_pool *pool, const struct world *scene, const struct sys_topology *topo) {
+	struct replica_job *jobs = calloc(topo->node_count, sizeof(*jobs));
+	struct cr_task_group group = { 0 };
+	for (size_t i = 0, node = 0; i < topo->cpu_count && node < topo->node_count; ++i) {
+		if (topo->cpus[i].node != (int)node) continue;
+		jobs[node] = (struct replica_job){ .scene = scene, .cpu = topo->cpus[i].id };
+		thread_pool_enqueue_group(pool, &group, replicate_task, &jobs[node]);
+		node++;
+	}
+	thread_pool_wait_group(pool, &group);
+	struct world **replicas = calloc(topo->node_count, sizeof(*replicas));
+	for (size_t node = 0; node < topo->node_count; ++node) {
+		replicas[node] = jobs[node].replica;
+	}
+	free(jobs);
+	return replicas;
+}
+
+struct cr_thread_pool *renderer_pool(struct renderer *r) {
+	const size_t threads = max((size_t)sys_get_cores(), r->prefs.threads);
+	// Only ever grows, and only between renders, so nothing can be running on it here.
+	if (r->state.pool && thread_pool_size(r->state.pool) < threads) {
+		thread_pool_destroy(r->state.pool);
+		r->state.pool = NULL;
+	}
+	if (!r->state.pool) r->state.pool = thread_pool_create(threads);
+	return r->state.pool;
+}
+
+// Render threads are pool tasks, so they don't get spawned from scratch on every render
+static void render_task(void *arg) {
+	struct worker *w = arg;
+	w->thread.thread_fn(w);
+	// Don't leave the pool thread stuck on one CPU for whatever it runs next
+	if (w->cpu >= 0) thread_unpin_self();
+}
+
 // TODO: Clean this up, it's ugly.
 void renderer_render(struct renderer *r) {
 	//Check for CTRL-C
@@ -147,9 +232,6 @@ void renderer_render(struct renderer *r) {
 		r->scene->background = newBackground(&r->scene->storage, NULL, NULL, NULL, r->scene->use_blender_coordinates);
 	}
 	
-	struct tile_set set = tile_quantize(camera->width, camera->height, r->prefs.tileWidth, r->prefs.tileHeight, r->prefs.tileOrder);
-	r->state.current_set = &set;
-
 	for (size_t i = 0; i < r->scene->shader_buffers.count; ++i) {
 		if (!r->scene->shader_buffers.items[i].bsdfs.count) {
 			logr(warning, "bsdf buffer %zu is empty, patching in placeholder\n", i);
@@ -167,9 +249,13 @@ void renderer_render(struct renderer *r) {
 		m->vbuf = &r->scene->v_buffers.items[m->vbuf_idx];
 	}
 
+	struct cr_thread_pool *pool = renderer_pool(r);
+
 	// Do some pre-render preparations
 	// Compute BVH acceleration structures for all meshes in the scene
-	compute_accels(r->scene->meshes);
+	compute_accels(pool, r->scene->meshes, r->scene->sphere_sets);
+	// Tile textures and generate mip chains
+	scene_build_textures(pool, r->scene, r->prefs.half_textures, r->prefs.texture_cache_mb << 20);
 
 	// And then compute a single top-level BVH that contains all the objects
 	if (r->scene->instances_dirty) {
@@ -185,6 +271,21 @@ void renderer_render(struct renderer *r) {
 
 	print_stats(r->scene);
 
+	// Tuned sizes only apply to this render, prefs keep what the user asked for
+	r->state.tile_width = r->prefs.tileWidth;
+	r->state.tile_height = r->prefs.tileHeight;
+	if (r->prefs.tile_autotune) {
+		// Workers got their prefs in clients_sync() already, and have to agree with us on tile indices
+		if (r->state.clients.count) {
+			logr(info, "Not autotuning tile size with network workers, using %ux%u\n", r->state.tile_width, r->state.tile_height);
+		} else {
+			tile_autotune(r, camera, &r->state.tile_width, &r->state.tile_height);
+		}
+	}
+
+	struct tile_set set = tile_quantize(camera->width, camera->height, r->state.tile_width, r->state.tile_height, r->prefs.tileOrder);
+	r->state.current_set = &set;
+
 	for (size_t i = 0; i < set.tiles.count; ++i)
 		set.tiles.items[i].total_samples = r->prefs.sampleCount;
 
@@ -208,6 +309,12 @@ void renderer_render(struct renderer *r) {
 		tex_clear(r->state.result_buf);
 	}
 
+	if (r->prefs.denoise) {
+		aov_buffers_prepare(&r->state.aovs, camera->width, camera->height);
+	} else {
+		aov_buffers_free(&r->state.aovs);
+	}
+
 	struct texture **result = &r->state.result_buf;
 
 	struct cr_tile *info_tiles = calloc(set.tiles.count, sizeof(*info_tiles));
@@ -223,7 +330,7 @@ void renderer_render(struct renderer *r) {
 		start.fn(&cb_info, start.user_data);
 	}
 
-	logr(info, "Pathtracing%s...\n", r->prefs.iterative ? " iteratively" : "");
+	logr(info, "Pathtracing%s%s...\n", r->prefs.iterative ? " iteratively" : "", r->prefs.integrator == integrator_wavefront ? " (wavefront)" : "");
 	
 	r->state.rendering = true;
 	r->state.render_aborted = false;
@@ -233,13 +340,40 @@ void renderer_render(struct renderer *r) {
 	// Select the appropriate renderer type for local use
 	void *(*local_render_thread)(void *) = render_thread;
 	// Iterative mode is incompatible with network rendering at the moment
-	if (r->prefs.iterative && !r->state.clients.count) local_render_thread = render_thread_interactive;
+	if (r->prefs.iterative && !r->state.clients.count) {
+		local_render_thread = render_thread_interactive;
+		if (r->prefs.integrator == integrator_wavefront) logr(warning, "Wavefront integrator doesn't support iterative mode yet, falling back to pathtrace\n");
+	} else if (r->prefs.integrator == integrator_wavefront) {
+		local_render_thread = render_thread_wavefront;
+	}
 	
+	// Figure out where local render threads should run. Replicas are per NUMA node,
+	// so they only make sense if threads stay put, and imply pinning.
+	struct sys_topology topo = { 0 };
+	size_t *pin_order = NULL;
+	struct world **replicas = NULL;
+	const enum pin_policy policy = r->prefs.numa_replicate && r->prefs.pin_policy == pin_none ? pin_cores : r->prefs.pin_policy;
+	if (policy != pin_none) {
+		topo = sys_get_topology();
+		logr(info, "Pinning threads to %zu logical CPU%s, %zu core%s, %zu NUMA node%s\n",
+			topo.cpu_count, PLURAL(topo.cpu_count), topo.core_count, PLURAL(topo.core_count), topo.node_count, PLURAL(topo.node_count));
+		pin_order = calloc(topo.cpu_count, sizeof(*pin_order));
+		sys_pin_order(&topo, policy, pin_order);
+		if (r->prefs.threads > topo.cpu_count) logr(warning, "More threads than CPUs, some CPUs will be shared\n");
+		if (r->prefs.numa_replicate && topo.node_count > 1) {
+			logr(info, "Replicating acceleration structures for %zu NUMA nodes\n", topo.node_count);
+			replicas = replicate_accels(pool, r->scene, &topo);
+		}
+	}
+
 	// Create & boot workers (Nonblocking)
 	// Local render threads + one thread for every client
 	for (size_t t = 0; t < r->prefs.threads; ++t) {
+		const struct sys_cpu *cpu = pin_order ? &topo.cpus[pin_order[t % topo.cpu_count]] : NULL;
 		worker_arr_add(&r->state.workers, (struct worker){
 			.renderer = r,
+			.scene = replicas ? replicas[cpu->node] : r->scene,
+			.cpu = cpu ? cpu->id : -1,
 			.buf = result,
 			.cam = camera,
 			.thread = (struct cr_thread){
@@ -251,6 +385,8 @@ void renderer_render(struct renderer *r) {
 		worker_arr_add(&r->state.workers, (struct worker){
 			.client = &r->state.clients.items[c],
 			.renderer = r,
+			.scene = r->scene,
+			.cpu = -1,
 			.buf = result,
 			.cam = camera,
 			.thread = (struct cr_thread){
@@ -258,10 +394,13 @@ void renderer_render(struct renderer *r) {
 			}
 		});
 	}
+	// Local threads run on the pool, clients mostly block on the network, so they get their own threads
+	struct cr_task_group local_workers = { 0 };
 	for (size_t w = 0; w < r->state.workers.count; ++w) {
-		r->state.workers.items[w].thread.user_data = &r->state.workers.items[w];
-		r->state.workers.items[w].tiles = &set;
-		if (thread_start(&r->state.workers.items[w].thread))
+		struct worker *worker = &r->state.workers.items[w];
+		worker->thread.user_data = worker;
+		worker->tiles = &set;
+		if (worker->client ? thread_start(&worker->thread) : !thread_pool_enqueue_group(pool, &local_workers, render_task, worker))
 			logr(error, "Failed to start worker %zu\n", w);
 	}
 
@@ -281,16 +420,49 @@ void renderer_render(struct renderer *r) {
 		for (size_t w = 0; w < r->state.workers.count; ++w) {
 			if (r->state.workers.items[w].thread_complete) inactive++;
 		}
-		if (r->state.render_aborted || inactive == r->state.workers.count)
+		if (r->state.render_aborted || inactive == r->state.workers.count) {
 			r->state.rendering = false;
+			tile_set_wake(&set);
+		}
 		timer_sleep_ms(r->state.workers.items[0].paused ? paused_msec : active_msec);
 	}
 
 	r->state.current_set = NULL;
 	
 	//Make sure render threads are terminated before continuing (This blocks)
+	thread_pool_wait_group(pool, &local_workers);
 	for (size_t w = 0; w < r->state.workers.count; ++w) {
-		thread_wait(&r->state.workers.items[w].thread);
+		if (r->state.workers.items[w].client) thread_wait(&r->state.workers.items[w].thread);
+	}
+	if (replicas) {
+		for (size_t i = 0; i < topo.node_count; ++i) scene_replica_free(replicas[i]);
+		free(replicas);
+	}
+	if (pin_order) free(pin_order);
+	sys_topology_free(&topo);
+
+	if (r->scene->texture_cache) {
+		const struct texture_cache_stats stats = texture_cache_stats(r->scene->texture_cache);
+		const uint64_t lookups = stats.hits + stats.misses;
+		char peak[64], budget[64];
+		logr(info, "Texture cache: %llu hits, %llu misses (%.2f%% hit rate), %llu evictions, peak %s of %s\n",
+			(unsigned long long)stats.hits, (unsigned long long)stats.misses,
+			lookups ? 100.0 * (double)stats.hits / (double)lookups : 0.0, (unsigned long long)stats.evictions,
+			human_file_size(stats.peak_bytes, peak), human_file_size(stats.budget_bytes, budget));
+	}
+
+	if (r->prefs.denoise && !r->state.render_aborted) {
+		if (r->state.clients.count) {
+			logr(warning, "Network render workers don't produce AOVs yet, skipping denoise\n");
+		} else {
+			logr(info, "Denoising: ");
+			struct timeval denoise_timer = { 0 };
+			timer_start(&denoise_timer);
+			size_t samples = r->prefs.iterative ? r->state.finishedPasses : r->prefs.sampleCount;
+			denoise_atrous(pool, r->state.result_buf, &r->state.aovs, samples, denoise_passes);
+			printSmartTime(timer_get_ms(denoise_timer));
+			logr(plain, "\n");
+		}
 	}
 	struct callback stop = r->state.callbacks[cr_cb_on_stop];
 	if (stop.fn) {
@@ -308,9 +480,11 @@ void renderer_render(struct renderer *r) {
 void *render_thread_interactive(void *arg) {
 	block_signals();
 	struct worker *threadState = arg;
+	thread_pin_self(threadState->cpu);
 	threadState->in_pause_loop = false;
 	struct renderer *r = threadState->renderer;
 	struct texture **buf = threadState->buf;
+	struct aov_buffers *aovs = r->prefs.denoise ? &r->state.aovs : NULL;
 	sampler *sampler = newSampler();
 
 	struct camera *cam = threadState->cam;
@@ -335,9 +509,11 @@ void *render_thread_interactive(void *arg) {
 				initSampler(sampler, SAMPLING_STRATEGY, r->state.finishedPasses, r->prefs.sampleCount, pixIdx);
 				
 				struct color output = textureGetPixel(*buf, x, y, false);
-				struct color sample = path_trace(cam_get_ray(cam, x, y, sampler), r->scene, r->prefs.bounces, sampler);
+				struct path_aov aov = { 0 };
+				struct color sample = path_trace(cam_get_ray(cam, x, y, sampler), threadState->scene, r->prefs.bounces, sampler, aovs ? &aov : NULL);
 
 				nan_clamp(&sample, &output);
+				if (aovs) aov_accumulate(aovs, &aov, sample, r->state.finishedPasses, x, y);
 				
 				//And process the running average
 				output = colorCoef((float)(r->state.finishedPasses - 1), output);
@@ -355,7 +531,8 @@ void *render_thread_interactive(void *arg) {
 		threadState->avg_per_sample_us = total_us / r->state.finishedPasses;
 		
 		//Tile has finished rendering, get a new one and start rendering it.
-		tile->state = finished;
+		tile_finish(threadState->tiles, tile);
+		texture_cache_thread_flush(threadState->scene->texture_cache);
 		threadState->currentTile = NULL;
 		tile = tile_next_interactive(r, threadState->tiles);
 		//Pause rendering when bool is set
@@ -369,6 +546,7 @@ void *render_thread_interactive(void *arg) {
 		threadState->currentTile = tile;
 	}
 exit:
+	texture_cache_thread_flush(threadState->scene->texture_cache);
 	destroySampler(sampler);
 	//No more tiles to render, exit thread. (render done)
 	threadState->thread_complete = true;
@@ -385,66 +563,82 @@ exit:
 void *render_thread(void *arg) {
 	block_signals();
 	struct worker *threadState = arg;
+	thread_pin_self(threadState->cpu);
 	struct renderer *r = threadState->renderer;
 	struct texture **buf = threadState->buf;
-	sampler *sampler = newSampler();
+	struct aov_buffers *aovs = r->prefs.denoise ? &r->state.aovs : NULL;
+	struct tile_accum acc = { 0 };
+	// Camera rays are generated a tile row at a time, each pixel carries its own sampler into the integrator
+	struct camera_rays rays = { 0 };
+	struct sampler **samplers = NULL;
+	size_t sampler_count = 0;
 
 	struct camera *cam = threadState->cam;
 
 	//First time setup for each thread
-	struct render_tile *tile = tile_next(threadState->tiles);
+	struct render_tile *tile = tile_next_or_join(threadState->tiles);
 	threadState->currentTile = tile;
 	
 	struct timeval timer = { 0 };
-	size_t samples = 1;
+	long total_us = 0;
+	size_t samples = 0;
 	
 	while (tile && r->state.rendering) {
-		long total_us = 0;
-		
-		while (samples < r->prefs.sampleCount + 1 && r->state.rendering) {
-			timer_start(&timer);
-			for (int y = tile->end.y - 1; y > tile->begin.y - 1; --y) {
-				for (int x = tile->begin.x; x < tile->end.x; ++x) {
-					if (r->state.render_aborted) goto exit;
-					uint32_t pixIdx = (uint32_t)(y * (*buf)->width + x);
-					initSampler(sampler, SAMPLING_STRATEGY, samples - 1, r->prefs.sampleCount, pixIdx);
-					
-					struct color output = textureGetPixel(*buf, x, y, false);
-					struct color sample = path_trace(cam_get_ray(cam, x, y, sampler), r->scene, r->prefs.bounces, sampler);
-					
-					// Clamp out fireflies - This is probably not a good way to do that.
-					nan_clamp(&sample, &output);
-
-					//And process the running average
-					output = colorCoef((float)(samples - 1), output);
-					output = colorAdd(output, sample);
-					float t = 1.0f / samples;
-					output = colorCoef(t, output);
-					
-					//Store internal render buffer (float precision)
-					setPixel(*buf, output, x, y);
-				}
+		// Samples are claimed one at a time, so idle threads can join in on this tile towards the end.
+		size_t sample = 0;
+		if (!tile_claim_samples(tile, 1, &sample)) {
+			// All samples for this tile are handed out, hand in ours and let the other threads on it wrap it up.
+			if (accum_flush(&acc, *buf, aovs)) tile_finish(threadState->tiles, acc.tile);
+			// Let go of the texture levels this tile used
+			texture_cache_thread_flush(threadState->scene->texture_cache);
+			threadState->currentTile = NULL;
+			tile = tile_next_or_join(threadState->tiles);
+			threadState->currentTile = tile;
+			continue;
+		}
+		if (acc.tile != tile) accum_begin(&acc, tile, aovs);
+		if ((size_t)tile->width > sampler_count) {
+			samplers = realloc(samplers, tile->width * sizeof(*samplers));
+			for (size_t i = sampler_count; i < (size_t)tile->width; ++i) samplers[i] = newSampler();
+			sampler_count = tile->width;
+		}
+		timer_start(&timer);
+		for (int y = tile->end.y - 1; y > tile->begin.y - 1; --y) {
+			for (int x = tile->begin.x; x < tile->end.x; ++x) {
+				uint32_t pixIdx = (uint32_t)(y * (*buf)->width + x);
+				initSampler(samplers[x - tile->begin.x], SAMPLING_STRATEGY, sample, r->prefs.sampleCount, pixIdx);
 			}
-			//For performance metrics
-			total_us += timer_get_us(timer);
-			threadState->totalSamples++;
-			samples++;
-			tile->completed_samples++;
-			//Pause rendering when bool is set
-			while (threadState->paused && !r->state.render_aborted) {
-				timer_sleep_ms(100);
+			cam_get_rays(cam, tile->begin.x, y, tile->width, samplers, &rays);
+			for (unsigned i = 0; i < tile->width; ++i) {
+				if (r->state.render_aborted) goto exit;
+				struct path_aov aov = { 0 };
+				struct color c = path_trace(cam_rays_get(&rays, i), threadState->scene, r->prefs.bounces, samplers[i], aovs ? &aov : NULL);
+				accum_add(&acc, (y - tile->begin.y) * tile->width + i, c, &aov);
 			}
-			threadState->avg_per_sample_us = total_us / samples;
 		}
-		//Tile has finished rendering, get a new one and start rendering it.
-		tile->state = finished;
-		threadState->currentTile = NULL;
-		samples = 1;
-		tile = tile_next(threadState->tiles);
-		threadState->currentTile = tile;
+		acc.samples++;
+		if (r->prefs.flush_interval && acc.samples >= r->prefs.flush_interval) {
+			if (accum_flush(&acc, *buf, aovs)) tile_finish(threadState->tiles, acc.tile);
+		}
+		//For performance metrics
+		total_us += timer_get_us(timer);
+		threadState->totalSamples++;
+		samples++;
+		//Pause rendering when bool is set
+		if (threadState->paused && accum_flush(&acc, *buf, aovs)) tile_finish(threadState->tiles, acc.tile);
+		while (threadState->paused && !r->state.render_aborted) {
+			timer_sleep_ms(100);
+		}
+		threadState->avg_per_sample_us = total_us / samples;
 	}
+	// Partial samples are dropped if we were aborted mid-pass
+	if (accum_flush(&acc, *buf, aovs)) tile_finish(threadState->tiles, acc.tile);
 exit:
-	destroySampler(sampler);
+	texture_cache_thread_flush(threadState->scene->texture_cache);
+	accum_free(&acc);
+	cam_rays_free(&rays);
+	for (size_t i = 0; i < sampler_count; ++i) destroySampler(samplers[i]);
+	free(samplers);
 	//No more tiles to render, exit thread. (render done)
 	threadState->thread_complete = true;
 	threadState->currentTile = NULL;
@@ -454,18 +648,34 @@ exit:
 struct prefs default_prefs(void) {
 	return (struct prefs){
 			.tileOrder = ro_from_middle,
-			.threads = sys_get_cores() + 2,
+			.threads = sys_default_threads(pin_none),
+			.threads_default = true,
 			.sampleCount = 25,
 			.bounces = 20,
 			.tileWidth = 32,
 			.tileHeight = 32,
+			.flush_interval = 4,
 			.imgFilePath = stringCopy("./"),
 			.imgFileName = stringCopy("rendered"),
 			.imgCount = 0,
 	};
 }
 
+// The same binary runs on all sorts of machines, so hot kernels are picked based on what this one supports
+static void select_kernels(void) {
+	const unsigned features = sys_get_cpu_features();
+	tiled_texture_select_kernels(features);
+#ifdef CRAY_DISPATCH_AVX2
+	const char *path = features & sys_avx2 ? "AVX2" : CRAY_SIMD_NAME;
+#else
+	const char *path = CRAY_SIMD_NAME;
+#endif
+	char buf[64];
+	logr(info, "CPU supports %s, using %s kernels\n", sys_cpu_features_string(features, buf, sizeof(buf)), path);
+}
+
 struct renderer *renderer_new(void) {
+	select_kernels();
 	struct renderer *r = calloc(1, sizeof(*r));
 	r->prefs = default_prefs();
 	r->state.finishedPasses = 1;
@@ -474,8 +684,10 @@ struct renderer *renderer_new(void) {
 	r->scene = calloc(1, sizeof(*r->scene));
 	r->scene->instances_dirty = true;
 	r->scene->asset_path = stringCopy("./");
+	r->scene->cache = file_cache_new();
 	r->scene->storage.node_pool = newBlock(NULL, 1024);
 	r->scene->storage.node_table = newHashtable(compareNodes, &r->scene->storage.node_pool);
+	r->scene->storage.eliminated = &r->scene->eliminated_nodes;
 	return r;
 }
 
@@ -488,5 +700,7 @@ void renderer_destroy(struct renderer *r) {
 	free(r->prefs.imgFilePath);
 	if (r->prefs.node_list) free(r->prefs.node_list);
 	if (r->state.result_buf) destroyTexture(r->state.result_buf);
+	aov_buffers_free(&r->state.aovs);
+	thread_pool_destroy(r->state.pool);
 	free(r);
 }
@@ -12,7 +12,11 @@
 #include "../datatypes/tile.h"
 #include "../../common/timer.h"
 #include "../../common/platform/thread.h"
+#include "../../common/platform/capabilities.h"
 #include "../protocol/server.h"
+#include "denoise.h"
+
+struct cr_thread_pool;
 
 struct worker {
 	struct cr_thread thread;
@@ -29,6 +33,8 @@ struct worker {
 	long avg_per_sample_us; //Single tile pass
 
 	struct camera *cam;
+	const struct world *scene; // r->scene, or a copy local to our NUMA node
+	int cpu; // Logical CPU to pin to, -1 to float
 	struct renderer *renderer;
 	struct texture **buf;
 	struct render_client *client; // Optional
@@ -53,18 +59,29 @@ struct state {
 	struct callback callbacks[5];
 
 	struct texture *result_buf;
+	struct aov_buffers aovs; // Only allocated when denoising
 	struct tile_set *current_set;
+	unsigned tile_width, tile_height; // Of the current render, from prefs or tile_autotune()
+	struct cr_thread_pool *pool; // See renderer_pool()
+};
+
+enum integrator {
+	integrator_pathtrace = 0, // Depth-first, one path at a time
+	integrator_wavefront, // Breadth-first, see stream.h
 };
 
 /// Preferences data (Set by user)
 struct prefs {
 	enum render_order tileOrder;
+	enum integrator integrator;
 	
 	size_t threads; //Amount of threads to render with
+	bool threads_default; // threads wasn't set, so it follows pin_policy, see sys_default_threads()
 	size_t sampleCount;
 	size_t bounces;
 	unsigned tileWidth;
 	unsigned tileHeight;
+	size_t flush_interval; // Samples to accumulate locally before merging into result_buf, 0 = once per tile
 	
 	//Output prefs
 	unsigned override_width;
@@ -76,6 +93,13 @@ struct prefs {
 	char *node_list;
 	bool iterative;
 	bool blender_mode;
+	bool denoise;
+	bool tile_autotune; // Pick tileWidth/tileHeight with a quick pre-pass, see autotune.h
+	enum pin_policy pin_policy;
+	bool numa_replicate; // Copy acceleration structures to each NUMA node
+	bool half_textures; // Store float textures as half floats
+	size_t texture_cache_mb; // Build texture levels on demand, into a cache of this size. 0 = build them all up front
+
 };
 
 struct renderer {
@@ -85,6 +109,9 @@ struct renderer {
 };
 
 struct renderer *renderer_new(void);
+/// The long-lived thread pool for this renderer. BVH builds, the denoiser and local
+/// render threads all run on it. Created on first use, and sized for prefs.threads.
+struct cr_thread_pool *renderer_pool(struct renderer *r);
 void renderer_render(struct renderer *r);
 void renderer_start_interactive(struct renderer *r);
 void renderer_destroy(struct renderer *r);
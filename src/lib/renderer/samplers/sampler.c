@@ -11,6 +11,7 @@
 #include "halton.h"
 #include "hammersley.h"
 #include "random.h"
+#include "sobol.h"
 #include "sampler.h"
 #include "common.h"
 
@@ -20,6 +21,7 @@ struct sampler {
 		hammersleySampler hammersley;
 		haltonSampler halton;
 		randomSampler random;
+		sobolSampler sobol;
 	} sampler;
 };
 
@@ -41,6 +43,10 @@ void initSampler(sampler *sampler, enum samplerType type, int pass, int maxPasse
 			initRandom(&sampler->sampler.random, hash64(pixelIndex * maxPasses + pass));
 			sampler->type = Random;
 			break;
+		case Sobol:
+			initSobol(&sampler->sampler.sobol, pass, hash(pixelIndex));
+			sampler->type = Sobol;
+			break;
 	}
 }
 
@@ -52,10 +58,28 @@ float getDimension(struct sampler *sampler) {
 			return getHalton(&sampler->sampler.halton);
 		case Random:
 			return getRandom(&sampler->sampler.random);
+		case Sobol:
+			return getSobol(&sampler->sampler.sobol);
 	}
 	return 0;
 }
 
+static inline void getDimensions(struct sampler *sampler, float *out, unsigned count) {
+	if (sampler->type == Sobol) {
+		getSobolN(&sampler->sampler.sobol, out, count);
+		return;
+	}
+	for (unsigned i = 0; i < count; ++i) out[i] = getDimension(sampler);
+}
+
+void getDimensions2D(struct sampler *sampler, float out[2]) {
+	getDimensions(sampler, out, 2);
+}
+
+void getDimensions4D(struct sampler *sampler, float out[4]) {
+	getDimensions(sampler, out, 4);
+}
+
 void destroySampler(struct sampler *sampler) {
 	free(sampler);
 }
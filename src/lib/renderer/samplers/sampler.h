@@ -16,7 +16,8 @@ typedef struct sampler sampler;
 enum samplerType {
 	Halton = 0,
 	Hammersley,
-	Random
+	Random,
+	Sobol,
 };
 
 struct sampler *newSampler(void);
@@ -25,4 +26,9 @@ void initSampler(struct sampler *sampler, enum samplerType type, int pass, int m
 
 float getDimension(struct sampler *sampler);
 
+// Batched fetches. Samplers that support it return dimensions that are stratified
+// against each other, so prefer these over consecutive getDimension() calls.
+void getDimensions2D(struct sampler *sampler, float out[2]);
+void getDimensions4D(struct sampler *sampler, float out[4]);
+
 void destroySampler(struct sampler *sampler);
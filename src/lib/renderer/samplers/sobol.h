@@ -0,0 +1,28 @@
+//
+//  sobol.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#pragma once
+
+#include <stdint.h>
+
+// Owen-scrambled Sobol, padded with shuffled indices
+// See Burley 2020, "Practical Hash-based Owen Scrambling"
+struct sobolSampler {
+	uint32_t index;
+	uint32_t seed;
+	uint32_t dimension; // Next padding dimension to hand out
+};
+
+typedef struct sobolSampler sobolSampler;
+
+void initSobol(sobolSampler *s, int pass, uint32_t seed);
+
+float getSobol(sobolSampler *s);
+
+// Up to 4 dimensions from the same point, these are stratified against each other
+void getSobolN(sobolSampler *s, float *out, unsigned count);
@@ -14,17 +14,24 @@ static inline float rand_in_range(float min, float max, sampler *sampler) {
 	return ((getDimension(sampler)) * (max - min)) + min;
 }
 
-static inline struct coord coord_on_unit_disc(sampler *sampler) {
-	float r = sqrtf(getDimension(sampler));
-	float theta = rand_in_range(0.0f, 2.0f * PI, sampler);
+// Map a 2D sample in [0,1) to the unit disc
+static inline struct coord coord_on_unit_disc_2d(const float u[2]) {
+	float r = sqrtf(u[0]);
+	float theta = u[1] * 2.0f * PI;
 	return (struct coord){r * cosf(theta), r * sinf(theta)};
 }
 
+static inline struct coord coord_on_unit_disc(sampler *sampler) {
+	float u[2];
+	getDimensions2D(sampler, u);
+	return coord_on_unit_disc_2d(u);
+}
+
 static inline struct vector vec_on_unit_sphere(sampler *sampler) {
-	const float sample_x = getDimension(sampler);
-	const float sample_y = getDimension(sampler);
-	const float a = sample_x * (2.0f * PI);
-	const float s = 2.0f * sqrtf(max(0.0f, sample_y * (1.0f - sample_y)));
-	return (struct vector){ cosf(a) * s, sinf(a) * s, 1.0f - 2.0f * sample_y };
+	float u[2];
+	getDimensions2D(sampler, u);
+	const float a = u[0] * (2.0f * PI);
+	const float s = 2.0f * sqrtf(max(0.0f, u[1] * (1.0f - u[1])));
+	return (struct vector){ cosf(a) * s, sinf(a) * s, 1.0f - 2.0f * u[1] };
 }
 
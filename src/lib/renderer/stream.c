@@ -0,0 +1,226 @@
+//
+//  stream.c
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "../../includes.h"
+#include "stream.h"
+
+#include <float.h>
+#include "renderer.h"
+#include "pathtrace.h"
+#include "denoise.h"
+#include "accum.h"
+#include "../datatypes/scene.h"
+#include "../datatypes/camera.h"
+#include "../datatypes/tile.h"
+#include "../accelerators/bvh.h"
+#include "../nodes/bsdfnode.h"
+#include "../../common/texture.h"
+#include "../../common/texture_cache.h"
+#include "../../common/platform/signal.h"
+#include "samplers/sampler.h"
+
+struct path_state {
+	struct lightRay ray;
+	struct hitRecord isect;
+	struct color weight;
+	struct color radiance;
+	struct path_aov aov;
+	sampler *sampler;
+	int x;
+	int y;
+};
+
+// Sort key for the shading queue. Misses have a NULL bsdf and end up in front.
+struct shade_key {
+	uintptr_t bsdf;
+	uint32_t path;
+};
+
+struct wavefront {
+	struct path_state *paths;
+	struct shade_key *queue;
+	struct sampler **samplers; // Scratch for cam_get_rays()
+	struct camera_rays rays;
+	size_t capacity;
+	size_t count;
+};
+
+static void wavefront_reserve(struct wavefront *w, size_t count) {
+	if (count <= w->capacity) return;
+	w->paths = realloc(w->paths, count * sizeof(*w->paths));
+	w->queue = realloc(w->queue, count * sizeof(*w->queue));
+	w->samplers = realloc(w->samplers, count * sizeof(*w->samplers));
+	for (size_t i = w->capacity; i < count; ++i) {
+		w->paths[i].sampler = newSampler();
+	}
+	w->capacity = count;
+}
+
+static void wavefront_free(struct wavefront *w) {
+	for (size_t i = 0; i < w->capacity; ++i) {
+		destroySampler(w->paths[i].sampler);
+	}
+	free(w->paths);
+	free(w->queue);
+	free(w->samplers);
+	cam_rays_free(&w->rays);
+}
+
+static int compare_keys(const void *a, const void *b) {
+	const struct shade_key *lhs = a;
+	const struct shade_key *rhs = b;
+	if (lhs->bsdf != rhs->bsdf) return lhs->bsdf < rhs->bsdf ? -1 : 1;
+	return (lhs->path > rhs->path) - (lhs->path < rhs->path);
+}
+
+// Stage 1: Spawn camera rays for every pixel in the tile
+static size_t generate(struct wavefront *w, const struct render_tile *tile, const struct camera *cam, size_t width, int pass, int max_passes) {
+	w->count = 0;
+	for (int y = tile->end.y - 1; y > tile->begin.y - 1; --y) {
+		const size_t row = w->count;
+		for (int x = tile->begin.x; x < tile->end.x; ++x) {
+			struct path_state *p = &w->paths[row + (x - tile->begin.x)];
+			uint32_t pixIdx = (uint32_t)(y * width + x);
+			initSampler(p->sampler, SAMPLING_STRATEGY, pass, max_passes, pixIdx);
+			w->samplers[x - tile->begin.x] = p->sampler;
+		}
+		cam_get_rays(cam, tile->begin.x, y, tile->width, w->samplers, &w->rays);
+		for (int x = tile->begin.x; x < tile->end.x; ++x) {
+			struct path_state *p = &w->paths[w->count];
+			p->ray = cam_rays_get(&w->rays, x - tile->begin.x);
+			p->weight = g_white_color;
+			p->radiance = g_black_color;
+			p->aov = (struct path_aov){ 0 };
+			p->x = x;
+			p->y = y;
+			w->queue[w->count] = (struct shade_key){ .path = (uint32_t)w->count };
+			w->count++;
+		}
+	}
+	return w->count;
+}
+
+// Stage 2: Find closest hits for all live paths
+static void intersect(struct wavefront *w, size_t live, const struct world *scene) {
+	for (size_t i = 0; i < live; ++i) {
+		struct path_state *p = &w->paths[w->queue[i].path];
+		p->isect = (struct hitRecord){ .incident = &p->ray, .instIndex = -1, .distance = FLT_MAX, .polygon = NULL };
+		traverse_top_level_bvh(scene->instances.items, scene->topLevel, &p->ray, &p->isect, p->sampler);
+		w->queue[i].bsdf = p->isect.instIndex < 0 ? 0 : (uintptr_t)p->isect.bsdf;
+	}
+}
+
+// Stage 3: Run materials over batches of hits sharing the same bsdf node.
+// Returns the amount of paths that are still alive, compacted to the front of the queue.
+static size_t shade(struct wavefront *w, size_t live, const struct world *scene, int bounce, int max_bounces) {
+	qsort(w->queue, live, sizeof(*w->queue), compare_keys);
+	size_t survivors = 0;
+	for (size_t i = 0; i < live; ++i) {
+		struct path_state *p = &w->paths[w->queue[i].path];
+		if (!w->queue[i].bsdf) {
+			const struct color bg = scene->background->sample(scene->background, p->sampler, &p->isect).weight;
+			if (bounce == 0) p->aov.albedo = bg;
+			p->radiance = colorAdd(p->radiance, colorMul(p->weight, bg));
+			continue;
+		}
+		const struct bsdfNode *bsdf = p->isect.bsdf;
+		const struct bsdfSample sample = bsdf->sample(bsdf, p->sampler, &p->isect);
+		if (bounce == 0) {
+			p->aov = (struct path_aov){
+				.albedo = sample.weight,
+				.normal = p->isect.surfaceNormal,
+				.depth = p->isect.distance
+			};
+		}
+		p->radiance = colorAdd(p->radiance, colorMul(p->weight, sample.emitted));
+		if (bounce == max_bounces) continue;
+
+		const struct color attenuation = sample.weight;
+		// Russian Roulette, same as path_trace()
+		float rr_continue_probability = 1.0f;
+		if (bounce >= 4) {
+			rr_continue_probability = max(attenuation.red, max(attenuation.green, attenuation.blue));
+			if (getDimension(p->sampler) > rr_continue_probability)
+				continue;
+		}
+		p->ray = ray_cone_continue(sample.out, &p->ray, p->isect.distance);
+		p->weight = colorCoef(1.0f / rr_continue_probability, colorMul(attenuation, p->weight));
+		w->queue[survivors++].path = w->queue[i].path;
+	}
+	return survivors;
+}
+
+void *render_thread_wavefront(void *arg) {
+	block_signals();
+	struct worker *threadState = arg;
+	thread_pin_self(threadState->cpu);
+	struct renderer *r = threadState->renderer;
+	struct texture **buf = threadState->buf;
+	struct aov_buffers *aovs = r->prefs.denoise ? &r->state.aovs : NULL;
+	struct camera *cam = threadState->cam;
+	const int max_bounces = (int)r->prefs.bounces;
+
+	struct wavefront w = { 0 };
+	struct tile_accum acc = { 0 };
+	wavefront_reserve(&w, r->state.tile_width * r->state.tile_height);
+
+	struct render_tile *tile = tile_next_or_join(threadState->tiles);
+	threadState->currentTile = tile;
+
+	struct timeval timer = { 0 };
+	long total_us = 0;
+	size_t samples = 0;
+
+	while (tile && r->state.rendering) {
+		size_t sample = 0;
+		if (!tile_claim_samples(tile, 1, &sample)) {
+			if (accum_flush(&acc, *buf, aovs)) tile_finish(threadState->tiles, acc.tile);
+			// Let go of the texture levels this tile used
+			texture_cache_thread_flush(threadState->scene->texture_cache);
+			threadState->currentTile = NULL;
+			tile = tile_next_or_join(threadState->tiles);
+			threadState->currentTile = tile;
+			continue;
+		}
+		if (r->state.render_aborted) goto exit;
+		wavefront_reserve(&w, tile->width * tile->height);
+		if (acc.tile != tile) accum_begin(&acc, tile, aovs);
+		timer_start(&timer);
+		size_t live = generate(&w, tile, cam, (*buf)->width, sample, r->prefs.sampleCount);
+		for (int bounce = 0; bounce <= max_bounces && live; ++bounce) {
+			intersect(&w, live, threadState->scene);
+			live = shade(&w, live, threadState->scene, bounce, max_bounces);
+		}
+		for (size_t i = 0; i < w.count; ++i) {
+			const struct path_state *p = &w.paths[i];
+			accum_add(&acc, (p->y - tile->begin.y) * tile->width + (p->x - tile->begin.x), p->radiance, &p->aov);
+		}
+		acc.samples++;
+		if (r->prefs.flush_interval && acc.samples >= r->prefs.flush_interval) {
+			if (accum_flush(&acc, *buf, aovs)) tile_finish(threadState->tiles, acc.tile);
+		}
+		//For performance metrics
+		total_us += timer_get_us(timer);
+		threadState->totalSamples++;
+		samples++;
+		//Pause rendering when bool is set
+		if (threadState->paused && accum_flush(&acc, *buf, aovs)) tile_finish(threadState->tiles, acc.tile);
+		while (threadState->paused && !r->state.render_aborted) {
+			timer_sleep_ms(100);
+		}
+		threadState->avg_per_sample_us = total_us / samples;
+	}
+	if (accum_flush(&acc, *buf, aovs)) tile_finish(threadState->tiles, acc.tile);
+exit:
+	texture_cache_thread_flush(threadState->scene->texture_cache);
+	accum_free(&acc);
+	wavefront_free(&w);
+	threadState->thread_complete = true;
+	threadState->currentTile = NULL;
+	return 0;
+}
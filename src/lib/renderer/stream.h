@@ -0,0 +1,15 @@
+//
+//  stream.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#pragma once
+
+// Wavefront variant of render_thread. Instead of tracing each path depth-first,
+// a whole tile worth of paths is advanced one bounce at a time in three stages:
+// generate, intersect and shade. Before shading, hits are sorted by bsdf node,
+// so every material runs over a contiguous batch of hits.
+void *render_thread_wavefront(void *arg);
@@ -0,0 +1,159 @@
+//
+//  perf_bvh.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <float.h>
+
+#include "../../src/lib/accelerators/bvh.h"
+#include "../../src/lib/datatypes/mesh.h"
+#include "../../src/lib/datatypes/sphere_set.h"
+#include "../../src/lib/renderer/instance.h"
+#include "../../src/lib/datatypes/hitrecord.h"
+#include "../../src/lib/datatypes/lightray.h"
+#include "../../src/common/assert.h"
+
+#define BVH_TRIANGLES 100000
+#define BVH_RAYS 100000
+#define BVH_SPHERES 100000
+
+static float perf_bvh_random(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return (float)(*state >> 8) / (float)(1 << 24);
+}
+
+static struct vector perf_bvh_point(uint32_t *state) {
+	return (struct vector){ perf_bvh_random(state), perf_bvh_random(state), perf_bvh_random(state) };
+}
+
+// Rays from random points in a cube full of small triangles
+time_t bvh_traverse(void) {
+	uint32_t state = 1234;
+	struct vertex_buffer vbuf = { 0 };
+	struct mesh mesh = { .vbuf = &vbuf };
+	for (size_t i = 0; i < BVH_TRIANGLES; ++i) {
+		const struct vector center = perf_bvh_point(&state);
+		struct poly p = { .hasNormals = false };
+		for (int j = 0; j < 3; ++j) {
+			const struct vector offset = vec_scale(vec_sub(perf_bvh_point(&state), (struct vector){ 0.5f, 0.5f, 0.5f }), 0.02f);
+			p.vertexIndex[j] = vector_arr_add(&vbuf.vertices, vec_add(center, offset));
+		}
+		poly_arr_add(&mesh.polygons, p);
+	}
+	mesh.bvh = build_mesh_bvh(&mesh);
+
+	struct lightRay *rays = malloc(BVH_RAYS * sizeof(*rays));
+	for (size_t i = 0; i < BVH_RAYS; ++i) {
+		rays[i] = (struct lightRay){
+			.start = perf_bvh_point(&state),
+			.direction = vec_normalize(vec_sub(perf_bvh_point(&state), (struct vector){ 0.5f, 0.5f, 0.5f })),
+		};
+	}
+
+	struct timeval test;
+	timer_start(&test);
+	size_t hits = 0;
+	for (size_t i = 0; i < BVH_RAYS; ++i) {
+		struct hitRecord isect = { .distance = FLT_MAX, .instIndex = -1 };
+		hits += traverse_bottom_level_bvh(&mesh, &rays[i], &isect, NULL);
+	}
+	time_t us = timer_get_us(test);
+	ASSERT(hits > BVH_RAYS / 2);
+	(void)hits;
+
+	free(rays);
+	mesh_free(&mesh);
+	vertex_buf_free(&vbuf);
+	return us;
+}
+
+static struct lightRay *perf_bvh_rays(uint32_t *state) {
+	struct lightRay *rays = malloc(BVH_RAYS * sizeof(*rays));
+	for (size_t i = 0; i < BVH_RAYS; ++i) {
+		rays[i] = (struct lightRay){
+			.start = perf_bvh_point(state),
+			.direction = vec_normalize(vec_sub(perf_bvh_point(state), (struct vector){ 0.5f, 0.5f, 0.5f })),
+		};
+	}
+	return rays;
+}
+
+// Particles in a cube, each one its own instance of a sphere, like before sphere sets
+time_t bvh_spheres_instanced(void) {
+	uint32_t state = 1234;
+	struct sphere_arr spheres = { 0 };
+	struct instance_arr instances = { 0 };
+	struct bsdf_buffer bbuf = { 0 };
+	bsdf_node_ptr_arr_add(&bbuf.bsdfs, NULL);
+	for (size_t i = 0; i < BVH_SPHERES; ++i) {
+		const struct vector center = perf_bvh_point(&state);
+		const size_t idx = sphere_arr_add(&spheres, (struct sphere){ .radius = 0.002f + 0.004f * perf_bvh_random(&state) });
+		struct instance inst = new_sphere_instance(&spheres, idx, NULL, NULL);
+		inst.composite = tform_new_translate(center.x, center.y, center.z);
+		inst.bbuf = &bbuf;
+		instance_arr_add(&instances, inst);
+	}
+	struct bvh *top = build_top_level_bvh(instances);
+	struct lightRay *rays = perf_bvh_rays(&state);
+
+	struct timeval test;
+	timer_start(&test);
+	size_t hits = 0;
+	for (size_t i = 0; i < BVH_RAYS; ++i) {
+		struct hitRecord isect = { .distance = FLT_MAX, .instIndex = -1 };
+		hits += traverse_top_level_bvh(instances.items, top, &rays[i], &isect, NULL);
+	}
+	time_t us = timer_get_us(test);
+	ASSERT(hits > BVH_RAYS / 4);
+	(void)hits;
+
+	free(rays);
+	destroy_bvh(top);
+	instance_arr_free(&instances);
+	sphere_arr_free(&spheres);
+	bsdf_node_ptr_arr_free(&bbuf.bsdfs);
+	return us;
+}
+
+// The same particles as one sphere set instance
+time_t bvh_sphere_set(void) {
+	uint32_t state = 1234;
+	struct sphere_set_arr sets = { 0 };
+	struct sphere_set set = { 0 };
+	struct bsdf_buffer bbuf = { 0 };
+	bsdf_node_ptr_arr_add(&bbuf.bsdfs, NULL);
+	for (size_t i = 0; i < BVH_SPHERES; ++i) {
+		vector_arr_add(&set.centers, perf_bvh_point(&state));
+		float_arr_add(&set.radii, 0.002f + 0.004f * perf_bvh_random(&state));
+	}
+	set.bvh = build_sphere_set_bvh(&set);
+	sphere_set_arr_add(&sets, set);
+	struct instance_arr instances = { 0 };
+	struct instance inst = new_sphere_set_instance(&sets, 0);
+	inst.bbuf = &bbuf;
+	instance_arr_add(&instances, inst);
+	struct bvh *top = build_top_level_bvh(instances);
+	struct lightRay *rays = perf_bvh_rays(&state);
+
+	struct timeval test;
+	timer_start(&test);
+	size_t hits = 0;
+	for (size_t i = 0; i < BVH_RAYS; ++i) {
+		struct hitRecord isect = { .distance = FLT_MAX, .instIndex = -1 };
+		hits += traverse_top_level_bvh(instances.items, top, &rays[i], &isect, NULL);
+	}
+	time_t us = timer_get_us(test);
+	ASSERT(hits > BVH_RAYS / 4);
+	(void)hits;
+
+	free(rays);
+	destroy_bvh(top);
+	instance_arr_free(&instances);
+	sets.elem_free = sphere_set_free;
+	sphere_set_arr_free(&sets);
+	bsdf_node_ptr_arr_free(&bbuf.bsdfs);
+	return us;
+}
@@ -0,0 +1,67 @@
+//
+//  perf_hashtable.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "../../src/common/hashtable.h"
+#include "../../src/common/mempool.h"
+#include "../../src/common/assert.h"
+
+#define HASHTABLE_KEYS (1 << 20)
+
+static bool perf_compare_key(const void *A, const void *B) {
+	return *(const uint64_t *)A == *(const uint64_t *)B;
+}
+
+static uint32_t perf_hash_key(uint64_t key) {
+	return hashBytes(hashInit(), &key, sizeof(key));
+}
+
+// Keys spread out like pointers to nodes are
+static uint64_t perf_key(uint64_t i) {
+	return 0x7f0000000000 + i * 48;
+}
+
+time_t hashtable_insert(void) {
+	struct block *pool = newBlock(NULL, 1024);
+	struct hashtable *table = newHashtable(perf_compare_key, &pool);
+	struct timeval test;
+	timer_start(&test);
+	for (uint64_t i = 0; i < HASHTABLE_KEYS; ++i) {
+		const uint64_t key = perf_key(i);
+		insertInHashtable(table, &key, sizeof(key), perf_hash_key(key));
+	}
+	time_t us = timer_get_us(test);
+	ASSERT(table->elemCount == HASHTABLE_KEYS);
+	destroyHashtable(table);
+	destroyBlocks(pool);
+	return us;
+}
+
+// Half of the lookups hit, half miss
+time_t hashtable_find(void) {
+	struct block *pool = newBlock(NULL, 1024);
+	struct hashtable *table = newHashtable(perf_compare_key, &pool);
+	for (uint64_t i = 0; i < HASHTABLE_KEYS; i += 2) {
+		const uint64_t key = perf_key(i);
+		insertInHashtable(table, &key, sizeof(key), perf_hash_key(key));
+	}
+	struct timeval test;
+	timer_start(&test);
+	size_t found = 0;
+	for (int pass = 0; pass < 4; ++pass) {
+		for (uint64_t i = 0; i < HASHTABLE_KEYS; ++i) {
+			const uint64_t key = perf_key(i);
+			found += findInHashtable(table, &key, perf_hash_key(key)) != NULL;
+		}
+	}
+	time_t us = timer_get_us(test);
+	ASSERT(found == 4 * HASHTABLE_KEYS / 2);
+	(void)found;
+	destroyHashtable(table);
+	destroyBlocks(pool);
+	return us;
+}
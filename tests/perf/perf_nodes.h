@@ -0,0 +1,104 @@
+//
+//  perf_nodes.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "../test_nodes.h"
+#include "../../src/lib/nodes/compiler.h"
+
+#define NODE_EVALS (1 << 20)
+
+static time_t eval_graph(bool compile) {
+	struct node_storage *s = make_storage();
+	const struct colorNode *graph = stripes_graph(s);
+	if (compile) graph = compile_color_node(s, graph);
+	struct sampler *sampler = newSampler();
+
+	struct timeval test;
+	timer_start(&test);
+	float sum = 0.0f;
+	for (int i = 0; i < NODE_EVALS; ++i) {
+		const struct hitRecord record = {
+			.uv = { (float)(i & 1023) / 1024.0f, (float)(i >> 10) / 1024.0f },
+			.surfaceNormal = { 0.0f, 1.0f, 0.0f },
+		};
+		initSampler(sampler, Random, 0, 1, i);
+		sum += graph->eval(graph, sampler, &record).red;
+	}
+	time_t us = timer_get_us(test);
+	ASSERT(sum == sum);
+
+	destroySampler(sampler);
+	delete_storage(s);
+	return us;
+}
+
+time_t nodes_tree_walk(void) {
+	return eval_graph(false);
+}
+
+time_t nodes_compiled(void) {
+	return eval_graph(true);
+}
+
+// Eight layers, 30-odd nodes: about what a material converted from Blender ends up as
+#define BSDF_LAYERS 8
+
+static time_t sample_bsdf(bool compile) {
+	struct node_storage *s = make_storage();
+	const struct bsdfNode *bsdf = layered_bsdf(s, BSDF_LAYERS);
+	if (compile) bsdf = compile_bsdf_node(s, bsdf);
+	struct sampler *sampler = newSampler();
+	struct lightRay incident = { .direction = { 0.0f, -1.0f, 0.5f } };
+
+	struct timeval test;
+	timer_start(&test);
+	float sum = 0.0f;
+	for (int i = 0; i < NODE_EVALS; ++i) {
+		const struct hitRecord record = {
+			.incident = &incident,
+			.uv = { (float)(i & 1023) / 1024.0f, (float)(i >> 10) / 1024.0f },
+			.surfaceNormal = { 0.0f, 1.0f, 0.0f },
+		};
+		initSampler(sampler, Random, 0, 1, i);
+		sum += bsdf->sample(bsdf, sampler, &record).weight.red;
+	}
+	time_t us = timer_get_us(test);
+	ASSERT(sum == sum);
+
+	destroySampler(sampler);
+	delete_storage(s);
+	return us;
+}
+
+time_t nodes_bsdf_tree_walk(void) {
+	return sample_bsdf(false);
+}
+
+time_t nodes_bsdf_compiled(void) {
+	return sample_bsdf(true);
+}
+
+#define NODE_MATERIALS 100000
+
+// Like a scene with a material per instance, where only the colors differ.
+// Half of the graph is shared, so this measures hits and misses in the node table.
+time_t nodes_construct(void) {
+	struct node_storage *s = make_storage();
+	struct timeval test;
+	timer_start(&test);
+	for (int i = 0; i < NODE_MATERIALS; ++i) {
+		const struct color c = { (float)(i % 97) / 97.0f, (float)(i % 89) / 89.0f, (float)i / NODE_MATERIALS, 1.0f };
+		const struct colorNode *tex = new_color_mix(s, newConstantTexture(s, c), stripes_graph(s), newConstantValue(s, 0.5f));
+		const struct bsdfNode *bsdf = newMix(s, newDiffuse(s, tex), newPlastic(s, tex, newConstantValue(s, 0.1f), newConstantValue(s, 1.45f)), newConstantValue(s, 0.25f));
+		ASSERT(bsdf);
+		(void)bsdf;
+	}
+	time_t us = timer_get_us(test);
+	ASSERT(s->node_table->elemCount > NODE_MATERIALS);
+	delete_storage(s);
+	return us;
+}
@@ -0,0 +1,65 @@
+//
+//  perf_texture.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "../test_texture.h"
+
+#define TEXTURE_FETCHES (1 << 22)
+
+// Scattered fetches from a 1k texture, roughly what hits across a textured mesh look like
+static time_t fetch_texture(bool tiled, bool srgb, unsigned cpu_features) {
+	tiled_texture_select_kernels(cpu_features);
+	struct texture *flat = noise_texture(char_p, 1024, 1024, 3);
+	struct tiled_texture *tiles = tiled_texture_new(flat);
+	tiled_texture_build(NULL, tiles, false);
+	const tiled_fetch fetch = tiled_texture_fetcher(tiles, tiled_filtered | (srgb ? tiled_srgb : 0));
+
+	struct timeval test;
+	timer_start(&test);
+	float sum = 0.0f;
+	uint32_t state = 1;
+	for (int i = 0; i < TEXTURE_FETCHES; ++i) {
+		state = state * 1664525u + 1013904223u;
+		// Mostly coherent, with a jump every 16 fetches
+		const float u = (float)((state >> 12) & 1023) / 1024.0f + (float)(i & 15) * 0.0005f;
+		const float v = (float)((state >> 2) & 1023) / 1024.0f;
+		if (tiled) {
+			sum += fetch(tiles, u, v, 0.0f).red;
+		} else {
+			const struct color c = textureGetPixel(flat, u, v, true);
+			sum += srgb ? colorFromSRGB(c).red : c.red;
+		}
+	}
+	time_t us = timer_get_us(test);
+	ASSERT(sum == sum);
+
+	tiled_texture_destroy(tiles);
+	destroyTexture(flat);
+	tiled_texture_select_kernels(0);
+	return us;
+}
+
+time_t texture_fetch_flat(void) {
+	return fetch_texture(false, false, 0);
+}
+
+time_t texture_fetch_tiled(void) {
+	return fetch_texture(true, false, 0);
+}
+
+// The tiled fetch converts through a lookup table, the flat one calls colorFromSRGB() like image nodes used to
+time_t texture_fetch_flat_srgb(void) {
+	return fetch_texture(false, true, 0);
+}
+
+time_t texture_fetch_tiled_srgb(void) {
+	return fetch_texture(true, true, 0);
+}
+
+time_t texture_fetch_tiled_native(void) {
+	return fetch_texture(true, false, sys_get_cpu_features());
+}
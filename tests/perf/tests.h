@@ -11,6 +11,10 @@ static char *failed_expression;
 // Testable modules
 #include "perf_fileio.h"
 #include "perf_base64.h"
+#include "perf_nodes.h"
+#include "perf_texture.h"
+#include "perf_hashtable.h"
+#include "perf_bvh.h"
 
 typedef struct {
 	char *test_name;
@@ -21,6 +25,21 @@ static perf_test perf_tests[] = {
 	{"fileio::load", fileio_load},
 	{"base64::bigfile_encode", base64_bigfile_encode},
 	{"base64::bigfile_decode", base64_bigfile_decode},
+	{"nodes::tree_walk", nodes_tree_walk},
+	{"nodes::compiled", nodes_compiled},
+	{"nodes::bsdf_tree_walk", nodes_bsdf_tree_walk},
+	{"nodes::bsdf_compiled", nodes_bsdf_compiled},
+	{"nodes::construct", nodes_construct},
+	{"texture::fetch_flat", texture_fetch_flat},
+	{"texture::fetch_tiled", texture_fetch_tiled},
+	{"texture::fetch_flat_srgb", texture_fetch_flat_srgb},
+	{"texture::fetch_tiled_srgb", texture_fetch_tiled_srgb},
+	{"texture::fetch_tiled_native", texture_fetch_tiled_native},
+	{"hashtable::insert", hashtable_insert},
+	{"hashtable::find", hashtable_find},
+	{"bvh::traverse", bvh_traverse},
+	{"bvh::spheres_instanced", bvh_spheres_instanced},
+	{"bvh::sphere_set", bvh_sphere_set},
 };
 
 #define perf_test_count (sizeof(perf_tests) / sizeof(perf_test))
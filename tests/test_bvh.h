@@ -0,0 +1,173 @@
+//
+//  test_bvh.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <float.h>
+
+#include "../src/lib/accelerators/bvh.h"
+#include "../src/lib/datatypes/mesh.h"
+#include "../src/lib/datatypes/poly.h"
+#include "../src/lib/datatypes/sphere_set.h"
+#include "../src/lib/datatypes/hitrecord.h"
+#include "../src/lib/datatypes/lightray.h"
+
+static float bvh_test_random(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return (float)(*state >> 8) / (float)(1 << 24);
+}
+
+static struct vector bvh_test_point(uint32_t *state) {
+	return (struct vector){ bvh_test_random(state), bvh_test_random(state), bvh_test_random(state) };
+}
+
+// Small triangles scattered in a unit cube, every other one with vertex normals
+static struct mesh bvh_test_mesh(struct vertex_buffer *vbuf, size_t count) {
+	uint32_t state = 1234;
+	*vbuf = (struct vertex_buffer){ 0 };
+	struct mesh mesh = { .vbuf = vbuf };
+	for (size_t i = 0; i < count; ++i) {
+		const struct vector center = bvh_test_point(&state);
+		struct poly p = { .hasNormals = i % 2 };
+		for (int j = 0; j < 3; ++j) {
+			const struct vector offset = vec_scale(vec_sub(bvh_test_point(&state), (struct vector){ 0.5f, 0.5f, 0.5f }), 0.1f);
+			p.vertexIndex[j] = vector_arr_add(&vbuf->vertices, vec_add(center, offset));
+			p.normalIndex[j] = vector_arr_add(&vbuf->normals, vec_normalize(offset));
+		}
+		poly_arr_add(&mesh.polygons, p);
+	}
+	mesh.bvh = build_mesh_bvh(&mesh);
+	return mesh;
+}
+
+bool bvh_matches_brute_force(void) {
+	struct vertex_buffer vbuf;
+	struct mesh mesh = bvh_test_mesh(&vbuf, 2000);
+	test_assert(mesh.bvh);
+
+	uint32_t state = 5678;
+	size_t hits = 0;
+	for (size_t i = 0; i < 4000; ++i) {
+		struct lightRay ray = {
+			.start = bvh_test_point(&state),
+			.direction = vec_normalize(vec_sub(bvh_test_point(&state), (struct vector){ 0.5f, 0.5f, 0.5f })),
+		};
+		struct hitRecord expected = { .distance = FLT_MAX, .instIndex = -1 };
+		bool expect_hit = false;
+		for (size_t p = 0; p < mesh.polygons.count; ++p) {
+			if (rayIntersectsWithPolygon(&mesh, &ray, &mesh.polygons.items[p], &expected)) {
+				expected.polygon = &mesh.polygons.items[p];
+				expect_hit = true;
+			}
+		}
+		struct hitRecord isect = { .distance = FLT_MAX, .instIndex = -1 };
+		const bool hit = traverse_bottom_level_bvh(&mesh, &ray, &isect, NULL);
+		test_assert(hit == expect_hit);
+		if (!hit) continue;
+		hits++;
+		// Same math, so the results should be exactly the same
+		test_assert(isect.polygon == expected.polygon);
+		test_assert(isect.distance == expected.distance);
+		test_assert(isect.uv.x == expected.uv.x && isect.uv.y == expected.uv.y);
+		test_assert(vec_equals(isect.surfaceNormal, expected.surfaceNormal));
+		test_assert(vec_equals(isect.hitPoint, expected.hitPoint));
+	}
+	test_assert(hits > 1000);
+
+	// And the same for a copy
+	struct bvh *original = mesh.bvh;
+	mesh.bvh = bvh_clone(original);
+	destroy_bvh(original);
+	struct lightRay ray = { .start = { 0.5f, 0.5f, -1.0f }, .direction = { 0.0f, 0.0f, 1.0f } };
+	struct hitRecord isect = { .distance = FLT_MAX, .instIndex = -1 };
+	struct hitRecord expected = isect;
+	for (size_t p = 0; p < mesh.polygons.count; ++p) {
+		if (rayIntersectsWithPolygon(&mesh, &ray, &mesh.polygons.items[p], &expected)) expected.polygon = &mesh.polygons.items[p];
+	}
+	test_assert(traverse_bottom_level_bvh(&mesh, &ray, &isect, NULL) == (expected.polygon != NULL));
+	test_assert(isect.polygon == expected.polygon);
+
+	mesh_free(&mesh);
+	vertex_buf_free(&vbuf);
+	return true;
+}
+
+// Closest sphere in double precision, -1 if none
+static long sphere_set_reference(const struct sphere_set *set, const struct lightRay *ray, double *t_out) {
+	long best = -1;
+	double best_t = DBL_MAX;
+	for (size_t i = 0; i < set->centers.count; ++i) {
+		const struct vector c = set->centers.items[i];
+		const double oc[] = { (double)ray->start.x - c.x, (double)ray->start.y - c.y, (double)ray->start.z - c.z };
+		const double d[] = { ray->direction.x, ray->direction.y, ray->direction.z };
+		const double a = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+		const double b = oc[0] * d[0] + oc[1] * d[1] + oc[2] * d[2];
+		const double cc = oc[0] * oc[0] + oc[1] * oc[1] + oc[2] * oc[2] - (double)set->radii.items[i] * set->radii.items[i];
+		const double disc = b * b - a * cc;
+		if (disc < 0.0) continue;
+		const double near = (-b - sqrt(disc)) / a;
+		const double t = near > 0.0 ? near : (-b + sqrt(disc)) / a;
+		if (t < 0.00001 || t >= best_t) continue;
+		best_t = t;
+		best = i;
+	}
+	*t_out = best_t;
+	return best;
+}
+
+bool bvh_sphere_set_matches_brute_force(void) {
+	uint32_t state = 4321;
+	struct sphere_set set = { 0 };
+	for (size_t i = 0; i < 2000; ++i) {
+		vector_arr_add(&set.centers, bvh_test_point(&state));
+		float_arr_add(&set.radii, 0.005f + 0.02f * bvh_test_random(&state));
+	}
+	set.bvh = build_sphere_set_bvh(&set);
+	test_assert(set.bvh);
+
+	size_t hits = 0;
+	for (size_t i = 0; i < 4000; ++i) {
+		struct lightRay ray = {
+			.start = bvh_test_point(&state),
+			.direction = vec_normalize(vec_sub(bvh_test_point(&state), (struct vector){ 0.5f, 0.5f, 0.5f })),
+		};
+		double expected_t;
+		const long expected = sphere_set_reference(&set, &ray, &expected_t);
+		struct hitRecord isect = { .distance = FLT_MAX, .instIndex = -1 };
+		size_t idx = SIZE_MAX;
+		const bool hit = traverse_sphere_set_bvh(&set, &ray, &isect, &idx);
+		test_assert(hit == (expected >= 0));
+		if (!hit) continue;
+		hits++;
+		test_assert(idx == (size_t)expected);
+		test_assert(fabs(isect.distance - expected_t) < 1e-5 * (1.0 + expected_t));
+		// Normal points from the center to the hit point
+		const struct vector to_hit = vec_sub(isect.hitPoint, set.centers.items[idx]);
+		test_assert(fabsf(vec_length(to_hit) - set.radii.items[idx]) < 1e-4f);
+		test_assert(vec_dot(vec_normalize(to_hit), isect.surfaceNormal) > 0.999f);
+	}
+	test_assert(hits > 500);
+
+	// Rays starting inside a sphere hit the far side
+	struct lightRay inside = { .start = set.centers.items[0], .direction = { 0.0f, 0.0f, 1.0f } };
+	struct hitRecord isect = { .distance = FLT_MAX, .instIndex = -1 };
+	size_t idx = SIZE_MAX;
+	test_assert(traverse_sphere_set_bvh(&set, &inside, &isect, &idx));
+	double expected_t;
+	test_assert(idx == (size_t)sphere_set_reference(&set, &inside, &expected_t));
+	test_assert(fabs(isect.distance - expected_t) < 1e-5);
+
+	// And the same for a copy
+	struct bvh *original = set.bvh;
+	set.bvh = bvh_clone(original);
+	destroy_bvh(original);
+	isect = (struct hitRecord){ .distance = FLT_MAX, .instIndex = -1 };
+	test_assert(traverse_sphere_set_bvh(&set, &inside, &isect, &idx));
+	test_assert(fabs(isect.distance - expected_t) < 1e-5);
+
+	sphere_set_free(&set);
+	return true;
+}
@@ -0,0 +1,135 @@
+//
+//  test_camera.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#pragma once
+
+#include "../src/lib/datatypes/camera.h"
+#include "../src/lib/renderer/samplers/sampler.h"
+#include "../src/common/transforms.h"
+
+#define CAMERA_WIDTH 37 // Not a multiple of any vector width, so loop tails get tested too
+#define CAMERA_HEIGHT 5
+
+static struct camera test_camera(bool dof) {
+	struct camera cam = {
+		.FOV = 65.0f,
+		.focus_distance = dof ? 3.5f : 0.0f,
+		.fstops = dof ? 2.8f : 0.0f,
+		.width = CAMERA_WIDTH,
+		.height = CAMERA_HEIGHT,
+		.forward = { 0.0f, 0.0f, 1.0f },
+		.right = { 1.0f, 0.0f, 0.0f },
+		.up = { 0.0f, 1.0f, 0.0f },
+	};
+	cam_recompute_optics(&cam);
+	cam_update_pose(&cam, &(struct euler_angles){ 0.1f, 0.3f, -0.2f }, &(struct vector){ 1.0f, 2.0f, -3.0f });
+	return cam;
+}
+
+static bool rays_equal(struct lightRay a, struct lightRay b) {
+	return vec_equals(a.start, b.start) && vec_equals(a.direction, b.direction) && a.cone_spread == b.cone_spread && a.type == b.type;
+}
+
+static bool check_batch_matches_single(bool dof) {
+	const struct camera cam = test_camera(dof);
+	test_assert(dof ? cam.aperture > 0.0f : cam.aperture == 0.0f);
+	struct sampler *samplers[CAMERA_WIDTH];
+	for (size_t i = 0; i < CAMERA_WIDTH; ++i) samplers[i] = newSampler();
+	struct sampler *single = newSampler();
+	struct camera_rays rays = { 0 };
+	for (int y = 0; y < CAMERA_HEIGHT; ++y) {
+		for (int x = 0; x < CAMERA_WIDTH; ++x) {
+			initSampler(samplers[x], Sobol, 3, 16, (uint32_t)(y * CAMERA_WIDTH + x));
+		}
+		cam_get_rays(&cam, 0, y, CAMERA_WIDTH, samplers, &rays);
+		test_assert(rays.count == CAMERA_WIDTH);
+		for (int x = 0; x < CAMERA_WIDTH; ++x) {
+			initSampler(single, Sobol, 3, 16, (uint32_t)(y * CAMERA_WIDTH + x));
+			test_assert(rays_equal(cam_rays_get(&rays, x), cam_get_ray(&cam, x, y, single)));
+			// Both leave the sampler in the same spot for the integrator
+			test_assert(getDimension(single) == getDimension(samplers[x]));
+		}
+	}
+	// A batch from the middle of a row, like a tile that doesn't start at x = 0
+	for (int x = 0; x < CAMERA_WIDTH; ++x) initSampler(samplers[x], Sobol, 0, 16, (uint32_t)(x + 11));
+	cam_get_rays(&cam, 11, 2, CAMERA_WIDTH - 11, samplers, &rays);
+	for (int x = 11; x < CAMERA_WIDTH; ++x) {
+		initSampler(single, Sobol, 0, 16, (uint32_t)x);
+		test_assert(rays_equal(cam_rays_get(&rays, x - 11), cam_get_ray(&cam, x, 2, single)));
+	}
+	cam_rays_free(&rays);
+	destroySampler(single);
+	for (size_t i = 0; i < CAMERA_WIDTH; ++i) destroySampler(samplers[i]);
+	return true;
+}
+
+bool camera_batch_matches_single(void) {
+	return check_batch_matches_single(false);
+}
+
+bool camera_batch_matches_single_dof(void) {
+	return check_batch_matches_single(true);
+}
+
+// Copy of the one in camera.c, uniform to triangle-shaped distribution
+static float reference_triangle(float v) {
+	const float orig = v * 2.0f - 1.0f;
+	v = orig / sqrtf(fabsf(orig));
+	v = clamp(v, -1.0f, 1.0f);
+	return v - (orig >= 0.0f ? 1.0f : -1.0f);
+}
+
+// The ray for a pixel, written out the way it was before rays were batched
+static struct lightRay reference_ray(const struct camera *cam, int x, int y, const float u[4]) {
+	const struct vector pix_x = vec_scale(cam->is_blender ? cam->right : vec_negate(cam->right), (cam->sensor_size.x / cam->width));
+	const struct vector pix_y = vec_scale(cam->up, (cam->sensor_size.y / cam->height));
+	const float jitter_x = reference_triangle(u[0]);
+	const float jitter_y = reference_triangle(u[1]);
+	struct lightRay ray = {
+		.direction = vec_normalize(vec_add(cam->forward, vec_add(
+			vec_scale(pix_x, x - cam->width * 0.5f + jitter_x + 0.5f),
+			vec_scale(pix_y, y - cam->height * 0.5f + jitter_y + 0.5f)
+		)))
+	};
+	if (cam->aperture > 0.0f) {
+		const float ft = cam->focus_distance / vec_dot(ray.direction, cam->forward);
+		const struct vector focus_point = vec_scale(ray.direction, ft);
+		const struct coord lens_point = coord_scale(cam->aperture, coord_on_unit_disc_2d(&u[2]));
+		ray.start = vec_add(vec_scale(cam->right, lens_point.x), vec_scale(cam->up, lens_point.y));
+		ray.direction = vec_normalize(vec_sub(focus_point, ray.start));
+	}
+	tform_point(&ray.start, cam->composite.A);
+	tform_vector(&ray.direction, cam->composite.A);
+	return ray;
+}
+
+static bool vec_close(struct vector a, struct vector b) {
+	return fabsf(a.x - b.x) < 1e-5f && fabsf(a.y - b.y) < 1e-5f && fabsf(a.z - b.z) < 1e-5f;
+}
+
+bool camera_matches_reference(void) {
+	struct sampler *sampler = newSampler();
+	for (int dof = 0; dof < 2; ++dof) {
+		const struct camera cam = test_camera(dof);
+		for (int y = 0; y < CAMERA_HEIGHT; ++y) {
+			for (int x = 0; x < CAMERA_WIDTH; ++x) {
+				const uint32_t idx = (uint32_t)(y * CAMERA_WIDTH + x);
+				float u[4];
+				initSampler(sampler, Sobol, 1, 16, idx);
+				getDimensions4D(sampler, u);
+				const struct lightRay expected = reference_ray(&cam, x, y, u);
+				initSampler(sampler, Sobol, 1, 16, idx);
+				const struct lightRay ray = cam_get_ray(&cam, x, y, sampler);
+				test_assert(vec_close(ray.start, expected.start));
+				test_assert(vec_close(ray.direction, expected.direction));
+			}
+		}
+	}
+	destroySampler(sampler);
+	return true;
+}
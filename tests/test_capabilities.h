@@ -0,0 +1,66 @@
+//
+//  test_capabilities.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#pragma once
+
+#include "../src/common/platform/capabilities.h"
+
+// 2 nodes, 2 cores each, 2 SMT siblings per core. Siblings are numbered like Linux does, cpu n and n + 4.
+static struct sys_cpu fake_cpus[] = {
+	{ .id = 0, .core = 0, .node = 0 }, { .id = 4, .core = 0, .node = 0 },
+	{ .id = 1, .core = 1, .node = 0 }, { .id = 5, .core = 1, .node = 0 },
+	{ .id = 2, .core = 2, .node = 1, .package = 1 }, { .id = 6, .core = 2, .node = 1, .package = 1 },
+	{ .id = 3, .core = 3, .node = 1, .package = 1 }, { .id = 7, .core = 3, .node = 1, .package = 1 },
+};
+
+bool capabilities_pin_cores(void) {
+	const struct sys_topology topo = { .cpus = fake_cpus, .cpu_count = 8, .core_count = 4, .node_count = 2 };
+	size_t order[8];
+	sys_pin_order(&topo, pin_cores, order);
+	// One per core, alternating nodes, before any SMT siblings
+	const int expected[] = { 0, 2, 1, 3, 4, 6, 5, 7 };
+	for (size_t i = 0; i < 8; ++i) {
+		test_assert(topo.cpus[order[i]].id == expected[i]);
+	}
+	return true;
+}
+
+bool capabilities_pin_compact(void) {
+	const struct sys_topology topo = { .cpus = fake_cpus, .cpu_count = 8, .core_count = 4, .node_count = 2 };
+	size_t order[8];
+	sys_pin_order(&topo, pin_compact, order);
+	const int expected[] = { 0, 4, 1, 5, 2, 6, 3, 7 };
+	for (size_t i = 0; i < 8; ++i) {
+		test_assert(topo.cpus[order[i]].id == expected[i]);
+	}
+	return true;
+}
+
+bool capabilities_topology(void) {
+	struct sys_topology topo = sys_get_topology();
+	test_assert(topo.cpu_count == (size_t)sys_get_cores());
+	test_assert(topo.core_count >= 1 && topo.core_count <= topo.cpu_count);
+	test_assert(topo.node_count >= 1 && topo.node_count <= topo.core_count);
+	// SMT siblings only get their own threads when they're not kept free by pinning to cores
+	test_assert(sys_default_threads(pin_none) == topo.cpu_count);
+	test_assert(sys_default_threads(pin_compact) == topo.cpu_count);
+	test_assert(sys_default_threads(pin_cores) == topo.core_count);
+	sys_topology_free(&topo);
+	return true;
+}
+
+bool capabilities_cpu_features(void) {
+	const unsigned features = sys_get_cpu_features();
+	if (features & sys_avx512) test_assert(features & sys_avx2);
+	if (features & sys_avx2) test_assert(features & sys_sse41);
+	char buf[64];
+	test_assert(strlen(sys_cpu_features_string(features, buf, sizeof(buf))) > 0);
+	test_assert(!strcmp(sys_cpu_features_string(0, buf, sizeof(buf)), "none"));
+	test_assert(!strcmp(sys_cpu_features_string(sys_sse41 | sys_avx2, buf, sizeof(buf)), "SSE4.1 AVX2"));
+	return true;
+}
@@ -0,0 +1,98 @@
+//
+//  test_color.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#pragma once
+
+#include "../src/common/color.h"
+
+// colorMul() and friends go through simd.h, so check them against the plain formulas.
+// Build the tests with NO_SIMD=1 to check the plain C fallback in simd.h too.
+
+#define COLOR_ATTEMPTS 1024
+
+static float color_test_value(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	// Mostly around 0-1, with some large and negative values mixed in
+	const float unit = (float)(*state >> 8) / (float)(1u << 24);
+	switch (*state & 7) {
+		case 0: return unit * -4.0f;
+		case 1: return unit * 1000.0f;
+		default: return unit;
+	}
+}
+
+static struct color color_test_color(uint32_t *state) {
+	return (struct color){ color_test_value(state), color_test_value(state), color_test_value(state), color_test_value(state) };
+}
+
+static bool color_close(float a, float b) {
+	return fabsf(a - b) <= 1e-6f * fmaxf(1.0f, fabsf(b));
+}
+
+#define color_roughly_equals(cola, colb) \
+	do { \
+		struct color col_a = cola; \
+		struct color col_b = colb; \
+		test_assert(color_close(col_a.red, col_b.red)); \
+		test_assert(color_close(col_a.green, col_b.green)); \
+		test_assert(color_close(col_a.blue, col_b.blue)); \
+		test_assert(color_close(col_a.alpha, col_b.alpha)); \
+	} while (false)
+
+bool color_mul(void) {
+	uint32_t state = 1234;
+	for (size_t i = 0; i < COLOR_ATTEMPTS; ++i) {
+		const struct color a = color_test_color(&state);
+		const struct color b = color_test_color(&state);
+		const struct color expected = { a.red * b.red, a.green * b.green, a.blue * b.blue, a.alpha * b.alpha };
+		color_roughly_equals(colorMul(a, b), expected);
+	}
+	return true;
+}
+
+bool color_add(void) {
+	uint32_t state = 2345;
+	for (size_t i = 0; i < COLOR_ATTEMPTS; ++i) {
+		const struct color a = color_test_color(&state);
+		const struct color b = color_test_color(&state);
+		const struct color expected = { a.red + b.red, a.green + b.green, a.blue + b.blue, a.alpha + b.alpha };
+		color_roughly_equals(colorAdd(a, b), expected);
+	}
+	return true;
+}
+
+bool color_coef(void) {
+	uint32_t state = 3456;
+	for (size_t i = 0; i < COLOR_ATTEMPTS; ++i) {
+		const float coef = color_test_value(&state);
+		const struct color c = color_test_color(&state);
+		const struct color expected = { c.red * coef, c.green * coef, c.blue * coef, c.alpha * coef };
+		color_roughly_equals(colorCoef(coef, c), expected);
+	}
+	return true;
+}
+
+bool color_mix(void) {
+	uint32_t state = 4567;
+	for (size_t i = 0; i < COLOR_ATTEMPTS; ++i) {
+		const struct color a = color_test_color(&state);
+		const struct color b = color_test_color(&state);
+		const float t = (float)(state >> 8) / (float)(1u << 24);
+		const struct color expected = {
+			a.red * (1.0f - t) + b.red * t,
+			a.green * (1.0f - t) + b.green * t,
+			a.blue * (1.0f - t) + b.blue * t,
+			a.alpha * (1.0f - t) + b.alpha * t,
+		};
+		color_roughly_equals(colorMix(a, b, t), expected);
+		// A factor of 0 or 1 picks one side exactly
+		test_assert(colorEquals(colorMix(a, b, 0.0f), a));
+		test_assert(colorEquals(colorMix(a, b, 1.0f), b));
+	}
+	return true;
+}
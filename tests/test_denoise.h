@@ -0,0 +1,86 @@
+//
+//  test_denoise.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#pragma once
+
+#include "../src/lib/renderer/denoise.h"
+#include "../src/lib/renderer/pathtrace.h"
+#include "../src/common/texture.h"
+#include "../src/common/platform/thread_pool.h"
+
+static void fill_flat_scene(struct texture *color, struct aov_buffers *aovs, bool noisy) {
+	uint32_t state = 1234;
+	for (size_t y = 0; y < color->height; ++y) {
+		for (size_t x = 0; x < color->width; ++x) {
+			float noise = 0.0f;
+			if (noisy) {
+				state = state * 1664525u + 1013904223u;
+				noise = ((float)(state >> 8) / (float)(1u << 24)) - 0.5f;
+			}
+			struct color c = { 0.5f + noise, 0.5f + noise, 0.5f + noise, 1.0f };
+			setPixel(color, c, x, y);
+			struct path_aov aov = {
+				.albedo = { 1.0f, 1.0f, 1.0f, 1.0f },
+				.normal = { 0.0f, 1.0f, 0.0f },
+				.depth = 5.0f
+			};
+			aov_accumulate(aovs, &aov, c, 1, x, y);
+		}
+	}
+}
+
+bool denoise_flat_constant(void) {
+	struct texture *color = newTexture(float_p, 32, 32, 4);
+	struct aov_buffers aovs = { 0 };
+	aov_buffers_prepare(&aovs, 32, 32);
+	fill_flat_scene(color, &aovs, false);
+
+	struct cr_thread_pool *pool = thread_pool_create(2);
+	denoise_atrous(pool, color, &aovs, 1, 5);
+	thread_pool_destroy(pool);
+
+	for (size_t y = 0; y < color->height; ++y) {
+		for (size_t x = 0; x < color->width; ++x) {
+			struct color c = textureGetPixel(color, x, y, false);
+			roughly_equals(c.red, 0.5f);
+			roughly_equals(c.alpha, 1.0f);
+		}
+	}
+	aov_buffers_free(&aovs);
+	destroyTexture(color);
+	return true;
+}
+
+static float image_variance(const struct texture *t) {
+	float sum = 0.0f, sum_sq = 0.0f;
+	const size_t n = t->width * t->height;
+	for (size_t i = 0; i < n; ++i) {
+		sum += t->data.float_p[i * 4];
+		sum_sq += t->data.float_p[i * 4] * t->data.float_p[i * 4];
+	}
+	const float mean = sum / n;
+	return sum_sq / n - mean * mean;
+}
+
+bool denoise_flat_noisy(void) {
+	struct texture *color = newTexture(float_p, 64, 64, 4);
+	struct aov_buffers aovs = { 0 };
+	aov_buffers_prepare(&aovs, 64, 64);
+	fill_flat_scene(color, &aovs, true);
+
+	const float before = image_variance(color);
+	struct cr_thread_pool *pool = thread_pool_create(2);
+	denoise_atrous(pool, color, &aovs, 1, 5);
+	thread_pool_destroy(pool);
+	const float after = image_variance(color);
+
+	test_assert(after < before * 0.25f);
+	aov_buffers_free(&aovs);
+	destroyTexture(color);
+	return true;
+}
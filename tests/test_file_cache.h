@@ -0,0 +1,80 @@
+//
+//  test_file_cache.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <stdio.h>
+#include "../src/common/file_cache.h"
+
+static void write_test_file(const char *path, const char *contents) {
+	FILE *f = fopen(path, "wb");
+	fwrite(contents, 1, strlen(contents), f);
+	fclose(f);
+}
+
+static int freed_assets = 0;
+static void count_free(void *asset) {
+	(void)asset;
+	freed_assets++;
+}
+
+bool file_cache_dedupe(void) {
+	write_test_file("file_cache_a.txt", "same contents");
+	write_test_file("file_cache_b.txt", "same contents");
+	write_test_file("file_cache_c.txt", "different contents");
+	struct file_cache *cache = file_cache_new();
+
+	const file_data a = file_cache_load(cache, "file_cache_a.txt");
+	const file_data b = file_cache_load(cache, "file_cache_b.txt");
+	const file_data c = file_cache_load(cache, "file_cache_c.txt");
+	test_assert(a.count == 13 && !memcmp(a.items, "same contents", 13));
+	test_assert(a.items == b.items);
+	test_assert(a.items != c.items);
+	test_assert(file_cache_load(cache, "file_cache_a.txt").items == a.items);
+	test_assert(!file_cache_load(cache, "file_cache_missing.txt").items);
+
+	// Textures go by content, meshes by path
+	int texture = 1, mesh = 2;
+	file_cache_set_asset(cache, "file_cache_a.txt", file_cache_texture, &texture, NULL);
+	file_cache_set_asset(cache, "file_cache_a.txt", file_cache_mesh, &mesh, NULL);
+	test_assert(file_cache_asset(cache, "file_cache_b.txt", file_cache_texture) == &texture);
+	test_assert(!file_cache_asset(cache, "file_cache_b.txt", file_cache_mesh));
+	test_assert(file_cache_asset(cache, "file_cache_a.txt", file_cache_mesh) == &mesh);
+	test_assert(!file_cache_asset(cache, "file_cache_c.txt", file_cache_texture));
+
+	file_cache_destroy(cache);
+	remove("file_cache_a.txt");
+	remove("file_cache_b.txt");
+	remove("file_cache_c.txt");
+	return true;
+}
+
+bool file_cache_reload(void) {
+	write_test_file("file_cache_a.txt", "first version");
+	struct file_cache *cache = file_cache_new();
+	freed_assets = 0;
+	int mesh = 1;
+	file_cache_set_asset(cache, "file_cache_a.txt", file_cache_mesh, &mesh, count_free);
+	test_assert(file_cache_asset(cache, "file_cache_a.txt", file_cache_mesh) == &mesh);
+	test_assert(freed_assets == 0);
+
+	// Files are only checked for changes once per load
+	write_test_file("file_cache_a.txt", "second, longer version");
+	test_assert(file_cache_asset(cache, "file_cache_a.txt", file_cache_mesh) == &mesh);
+
+	// Size changed, so the file is loaded again and the old asset goes away
+	file_cache_revalidate(cache);
+	test_assert(!file_cache_asset(cache, "file_cache_a.txt", file_cache_mesh));
+	test_assert(freed_assets == 1);
+	const file_data a = file_cache_load(cache, "file_cache_a.txt");
+	test_assert(a.count == 22 && !memcmp(a.items, "second, longer version", 22));
+
+	file_cache_set_asset(cache, "file_cache_a.txt", file_cache_mesh, &mesh, count_free);
+	file_cache_destroy(cache);
+	test_assert(freed_assets == 2);
+	remove("file_cache_a.txt");
+	return true;
+}
@@ -68,3 +68,63 @@ bool hashtable_fill(void) {
 	freeConstantsDatabase(database);
 	return true;
 }
+
+static bool compare_int(const void *A, const void *B) {
+	return *(const int *)A == *(const int *)B;
+}
+
+static uint32_t hash_int(int i) {
+	return hashBytes(hashInit(), &i, sizeof(i));
+}
+
+bool hashtable_grow(void) {
+	struct hashtable *table = newHashtable(compare_int, NULL);
+	const int count = 5000;
+	int **got = calloc(count, sizeof(*got));
+	for (int i = 0; i < count; ++i) {
+		got[i] = internInHashtable(table, &i, sizeof(i), hash_int(i), NULL);
+		// Everything inserted so far is still there, even while it's being moved to bigger slots
+		for (int j = i; j >= 0 && j > i - 64; --j) {
+			test_assert(findInHashtable(table, &j, hash_int(j)) == got[j]);
+		}
+	}
+	// Pointers to elements don't change as the table grows
+	for (int i = 0; i < count; ++i) {
+		test_assert(findInHashtable(table, &i, hash_int(i)) == got[i]);
+		test_assert(*got[i] == i);
+	}
+	const int missing = count;
+	test_assert(!findInHashtable(table, &missing, hash_int(missing)));
+	test_assert(table->elemCount == (size_t)count);
+	free(got);
+	destroyHashtable(table);
+	return true;
+}
+
+bool hashtable_remove(void) {
+	struct hashtable *table = newHashtable(compare_int, NULL);
+	const int count = 2000;
+	for (int i = 0; i < count; ++i)
+		test_assert(insertInHashtable(table, &i, sizeof(i), hash_int(i)));
+	for (int i = 0; i < count; i += 2)
+		test_assert(removeFromHashtable(table, &i, hash_int(i)));
+	test_assert(table->elemCount == (size_t)count / 2);
+	for (int i = 0; i < count; ++i) {
+		const int *found = findInHashtable(table, &i, hash_int(i));
+		test_assert(i % 2 ? found && *found == i : !found);
+	}
+	const int even = 0;
+	test_assert(!removeFromHashtable(table, &even, hash_int(even)));
+
+	// Inserting and removing over and over doesn't fill the table up with deleted slots
+	for (int round = 0; round < 100; ++round) {
+		for (int i = 0; i < count; i += 2)
+			test_assert(insertInHashtable(table, &i, sizeof(i), hash_int(i)));
+		for (int i = 0; i < count; i += 2)
+			test_assert(removeFromHashtable(table, &i, hash_int(i)));
+	}
+	test_assert(table->elemCount == (size_t)count / 2);
+	test_assert(table->slots.groupCount <= 512);
+	destroyHashtable(table);
+	return true;
+}
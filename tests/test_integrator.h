@@ -0,0 +1,84 @@
+//
+//  test_integrator.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#pragma once
+
+#include <c-ray/c-ray.h>
+#include "../src/lib/renderer/renderer.h"
+#include "../src/common/texture.h"
+#include "../src/common/vendored/cJSON.h"
+#include "../src/common/json_loader.h"
+
+// Small enough to render in a blink, but with enough bounces for Russian Roulette to kick in,
+// and a material mix so paths on the same object end up in different shading batches.
+static const char *integrator_scene =
+	"{"
+	"\"version\": 1.0,"
+	"\"renderer\": { \"threads\": 1, \"samples\": 4, \"bounces\": 6, \"tileWidth\": 8, \"tileHeight\": 8,"
+	"	\"outputFilePath\": \"/tmp/\", \"outputFileName\": \"integrator\", \"fileType\": \"png\", \"count\": 0, \"width\": 32, \"height\": 24 },"
+	"\"display\": { \"enabled\": false },"
+	"\"camera\": [{ \"FOV\": 60.0, \"fstops\": 0.0, \"transforms\": [ { \"type\": \"translate\", \"x\": 0, \"y\": 1, \"z\": -6 } ] }],"
+	"\"scene\": {"
+	"	\"ambientColor\": { \"type\": \"background\", \"strength\": 1.0 },"
+	"	\"primitives\": ["
+	"		{ \"type\": \"sphere\", \"radius\": 1000, \"material\": { \"type\": \"diffuse\", \"color\": [0.6, 0.6, 0.6] },"
+	"			\"instances\": [ { \"transforms\": [ { \"type\": \"translate\", \"x\": 0, \"y\": -1000, \"z\": 0 } ] } ] },"
+	"		{ \"type\": \"sphere\", \"radius\": 0.8, \"material\": { \"type\": \"mix\", \"factor\": 0.3,"
+	"			\"A\": { \"type\": \"diffuse\", \"color\": [0.8, 0.2, 0.2] }, \"B\": { \"type\": \"metal\", \"color\": [0.9, 0.9, 0.9], \"roughness\": 0.2 } },"
+	"			\"instances\": [ { \"transforms\": [ { \"type\": \"translate\", \"x\": -1.0, \"y\": 0.8, \"z\": 0 } ] } ] },"
+	"		{ \"type\": \"sphere\", \"radius\": 0.8, \"material\": { \"type\": \"glass\", \"color\": [1.0, 1.0, 1.0], \"roughness\": 0.0, \"IOR\": 1.45 },"
+	"			\"instances\": [ { \"transforms\": [ { \"type\": \"translate\", \"x\": 1.0, \"y\": 0.8, \"z\": 0 } ] } ] }"
+	"	]"
+	"}"
+	"}";
+
+// Also used by the tile tests
+static struct cr_renderer *integrator_render(const char *integrator, bool autotune) {
+	struct cr_renderer *ext = cr_new_renderer();
+	cJSON *json = cJSON_Parse(integrator_scene);
+	int bak, new;
+	silence_stdout(&bak, &new);
+	const int ret = parse_json(ext, json, NULL);
+	cr_renderer_set_str_pref(ext, cr_renderer_integrator, integrator);
+	cr_renderer_set_num_pref(ext, cr_renderer_tile_autotune, autotune);
+	if (ret >= 0) cr_renderer_render(ext);
+	resume_stdout(&bak, &new);
+	cJSON_Delete(json);
+	if (ret < 0) {
+		cr_destroy_renderer(ext);
+		return NULL;
+	}
+	return ext;
+}
+
+// Every path has its own sampler, seeded by pixel and pass, so the order paths get shaded in
+// doesn't change what they draw. Both integrators should come up with the same image.
+bool integrator_wavefront_matches_pathtrace(void) {
+	struct cr_renderer *pt = integrator_render("pathtrace", false);
+	struct cr_renderer *wf = integrator_render("wavefront", false);
+	test_assert(pt && wf);
+	const struct texture *a = (const struct texture *)cr_renderer_get_result(pt);
+	const struct texture *b = (const struct texture *)cr_renderer_get_result(wf);
+	test_assert(a && b);
+	test_assert(a->width == 32 && a->height == 24);
+	test_assert(a->width == b->width && a->height == b->height && a->channels == b->channels);
+
+	float sum = 0.0f;
+	for (size_t i = 0; i < a->width * a->height * a->channels; ++i) {
+		const float lhs = a->data.float_p[i];
+		const float rhs = b->data.float_p[i];
+		test_assert(fabsf(lhs - rhs) <= 1e-4f * fmaxf(1.0f, fabsf(lhs)));
+		sum += lhs;
+	}
+	// Make sure there was something to compare
+	test_assert(sum > 0.0f);
+
+	cr_destroy_renderer(pt);
+	cr_destroy_renderer(wf);
+	return true;
+}
@@ -0,0 +1,54 @@
+//
+//  test_mempool.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include <string.h>
+#include <stdint.h>
+
+#include "../src/common/mempool.h"
+
+bool mempool_grow(void) {
+	struct block *pool = newBlock(NULL, 64);
+	const size_t count = 200000;
+	uint32_t **items = malloc(count * sizeof(*items));
+	for (size_t i = 0; i < count; ++i) {
+		// Odd sizes, so rounding for alignment matters
+		items[i] = allocBlock(&pool, 3 * sizeof(uint32_t));
+		test_assert(items[i]);
+		test_assert((uintptr_t)items[i] % sizeof(cray_max_align_t) == 0);
+		items[i][0] = items[i][1] = items[i][2] = (uint32_t)i;
+	}
+	// Nothing got overwritten by a later allocation
+	for (size_t i = 0; i < count; ++i) {
+		test_assert(items[i][0] == i && items[i][2] == i);
+	}
+	// Bigger than the block that would come next, and big enough to be mapped separately
+	const size_t big_size = 5 * 1024 * 1024;
+	char *big = allocBlock(&pool, big_size);
+	test_assert(big);
+	test_assert(big[0] == 0 && big[big_size - 1] == 0);
+	memset(big, 0xAB, big_size);
+	test_assert(items[count - 1][0] == count - 1);
+	free(items);
+	destroyBlocks(pool);
+	return true;
+}
+
+bool mempool_large(void) {
+	const size_t sizes[] = { 1, 1000, 3 * 1024 * 1024 };
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); ++i) {
+		unsigned char *ptr = allocLarge(sizes[i]);
+		test_assert(ptr);
+		test_assert((uintptr_t)ptr % 64 == 0);
+		memset(ptr, (int)i, sizes[i]);
+		test_assert(ptr[sizes[i] - 1] == i);
+		freeLarge(ptr);
+	}
+	test_assert(!allocLarge(0));
+	freeLarge(NULL);
+	return true;
+}
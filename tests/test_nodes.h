@@ -17,6 +17,9 @@
 #include "../src/lib/nodes/converter/math.h"
 #include "../src/lib/nodes/converter/map_range.h"
 #include "../src/lib/renderer/samplers/sampler.h"
+#include "../src/lib/nodes/colornode.h"
+#include "../src/lib/nodes/compiler.h"
+#include "../src/lib/datatypes/hitrecord.h"
 
 struct node_storage *make_storage() {
 	struct node_storage *storage = calloc(1, sizeof(*storage));
@@ -919,3 +922,166 @@ bool map_range(void) {
 	destroySampler(sampler);
 	return true;
 }
+
+// UV-driven stripes, shared between channels so the compiler has something to reuse
+static const struct colorNode *stripes_graph(const struct node_storage *s) {
+	const struct valueNode *u = newVecToValue(s, newUV(s), U);
+	const struct valueNode *v = newVecToValue(s, newUV(s), V);
+	const struct valueNode *stripes = newMath(s, newMath(s, newMath(s, u, newConstantValue(s, 40.0f), Multiply), NULL, Sine), NULL, Absolute);
+	const struct colorNode *a = newCombineRGB(s, stripes, newMath(s, v, newConstantValue(s, 0.5f), Multiply), stripes);
+	const struct colorNode *b = newVecToColor(s, newVecMath(s, newNormal(s), NULL, NULL, NULL, VecNormalize));
+	return new_color_mix(s, a, b, newMapRange(s, v, NULL, NULL, newConstantValue(s, 0.2f), newConstantValue(s, 0.8f)));
+}
+
+bool compiler_matches_tree(void) {
+	struct node_storage *s = make_storage();
+	const struct colorNode *tree = stripes_graph(s);
+	const struct colorNode *compiled = compile_color_node(s, tree);
+	test_assert(compiled != tree);
+	// Compiling the same graph again gives back the same program
+	test_assert(compile_color_node(s, tree) == compiled);
+
+	struct sampler *tree_sampler = newSampler();
+	struct sampler *compiled_sampler = newSampler();
+	for (int i = 0; i < 256; ++i) {
+		const struct hitRecord record = {
+			.uv = { (float)i / 256.0f, (float)(i * 7 % 256) / 256.0f },
+			.surfaceNormal = { 0.0f, 1.0f, (float)i },
+		};
+		initSampler(tree_sampler, Random, 0, 1, i);
+		initSampler(compiled_sampler, Random, 0, 1, i);
+		const struct color t = tree->eval(tree, tree_sampler, &record);
+		const struct color c = compiled->eval(compiled, compiled_sampler, &record);
+		test_assert(colorEquals(t, c));
+		// Both should have drawn the same amount of samples, too
+		test_assert(getDimension(tree_sampler) == getDimension(compiled_sampler));
+	}
+	destroySampler(tree_sampler);
+	destroySampler(compiled_sampler);
+	delete_storage(s);
+	return true;
+}
+
+// Layered material, each layer is blended in by a UV-driven mask, like a scanned material would be
+static const struct bsdfNode *layered_bsdf(const struct node_storage *s, int layers) {
+	const struct valueNode *u = newVecToValue(s, newUV(s), U);
+	const struct valueNode *v = newVecToValue(s, newUV(s), V);
+	const struct bsdfNode *bsdf = newDiffuse(s, stripes_graph(s));
+	for (int i = 0; i < layers; ++i) {
+		const struct valueNode *freq = newConstantValue(s, 3.0f + (float)i);
+		const struct valueNode *mask = newMath(s, newMath(s, newMath(s, i & 1 ? u : v, freq, Multiply), NULL, Sine), NULL, Absolute);
+		const struct colorNode *tint = newCombineRGB(s, mask, newConstantValue(s, (float)i / (float)layers), v);
+		const struct bsdfNode *layer = i & 1 ? newMetal(s, tint, newConstantValue(s, 0.1f * (float)i)) : newDiffuse(s, tint);
+		bsdf = newMix(s, bsdf, layer, newMapRange(s, mask, NULL, NULL, newConstantValue(s, 0.1f), newConstantValue(s, 0.9f)));
+	}
+	return bsdf;
+}
+
+bool compiler_bsdf_matches_tree(void) {
+	struct node_storage *s = make_storage();
+	const struct bsdfNode *tree = layered_bsdf(s, 4);
+	const struct bsdfNode *compiled = compile_bsdf_node(s, tree);
+	test_assert(compiled != tree);
+	test_assert(compile_bsdf_node(s, tree) == compiled);
+	// A single BSDF has nothing to pick
+	const struct bsdfNode *diffuse = newDiffuse(s, stripes_graph(s));
+	test_assert(compile_bsdf_node(s, diffuse) == diffuse);
+
+	struct sampler *tree_sampler = newSampler();
+	struct sampler *compiled_sampler = newSampler();
+	struct lightRay incident = { .direction = { 0.0f, -1.0f, 0.5f } };
+	for (int i = 0; i < 256; ++i) {
+		const struct hitRecord record = {
+			.incident = &incident,
+			.uv = { (float)i / 256.0f, (float)(i * 7 % 256) / 256.0f },
+			.surfaceNormal = { 0.0f, 1.0f, 0.0f },
+		};
+		initSampler(tree_sampler, Random, 0, 1, i);
+		initSampler(compiled_sampler, Random, 0, 1, i);
+		const struct bsdfSample t = tree->sample(tree, tree_sampler, &record);
+		const struct bsdfSample c = compiled->sample(compiled, compiled_sampler, &record);
+		test_assert(colorEquals(t.weight, c.weight));
+		test_assert(vec_equals(t.out.direction, c.out.direction));
+		test_assert(t.out.type == c.out.type);
+		test_assert(getDimension(tree_sampler) == getDimension(compiled_sampler));
+	}
+	destroySampler(tree_sampler);
+	destroySampler(compiled_sampler);
+	delete_storage(s);
+	return true;
+}
+
+bool compiler_register_limit(void) {
+	struct node_storage *s = make_storage();
+	// Too many registers to fit into NODE_MAX_REGISTERS, so these stay tree-walked
+	const struct bsdfNode *huge = layered_bsdf(s, NODE_MAX_REGISTERS);
+	test_assert(compile_bsdf_node(s, huge) == huge);
+	delete_storage(s);
+	return true;
+}
+
+bool compiler_skips_constants(void) {
+	struct node_storage *s = make_storage();
+	const struct valueNode *c = newConstantValue(s, 1.0f);
+	test_assert(compile_value_node(s, c) == c);
+	const struct colorNode *t = newConstantTexture(s, g_white_color);
+	test_assert(compile_color_node(s, t) == t);
+	test_assert(compile_value_node(s, NULL) == NULL);
+	delete_storage(s);
+	return true;
+}
+
+bool folding_constants(void) {
+	struct node_storage *s = make_storage();
+	size_t eliminated = 0;
+	s->eliminated = &eliminated;
+	const struct valueNode *sum = newMath(s, newConstantValue(s, 2.0f), newConstantValue(s, 3.0f), Add);
+	test_assert(sum == newConstantValue(s, 5.0f));
+	const struct colorNode *gray = newCombineRGB(s, sum, newMath(s, sum, newConstantValue(s, 2.0f), Multiply), NULL);
+	test_assert(gray->constant);
+	test_assert(colorEquals(gray->eval(gray, NULL, NULL), (struct color){ 5.0f, 10.0f, 0.0f, 1.0f }));
+	const struct valueNode *length = newVecToValue(s, newVecMath(s, newConstantVector(s, (struct vector){ 3.0f, 4.0f, 0.0f }), NULL, NULL, NULL, VecLength), F);
+	test_assert(length == newConstantValue(s, 5.0f));
+	test_assert(eliminated == 5);
+	// Anything that depends on the hit can't be folded
+	const struct valueNode *u = newVecToValue(s, newUV(s), U);
+	test_assert(!newMath(s, u, newConstantValue(s, 2.0f), Add)->constant);
+	test_assert(eliminated == 5);
+	delete_storage(s);
+	return true;
+}
+
+bool folding_identities(void) {
+	struct node_storage *s = make_storage();
+	size_t eliminated = 0;
+	s->eliminated = &eliminated;
+	const struct valueNode *u = newVecToValue(s, newUV(s), U);
+	test_assert(newMath(s, u, newConstantValue(s, 0.0f), Add) == u);
+	test_assert(newMath(s, newConstantValue(s, 1.0f), u, Multiply) == u);
+	test_assert(newMath(s, u, newConstantValue(s, 1.0f), Divide) == u);
+	test_assert(newMath(s, u, newConstantValue(s, 1.0f), Subtract) != u);
+	const struct vectorNode *n = newNormal(s);
+	test_assert(newVecMath(s, n, NULL, NULL, NULL, VecAdd) == n);
+	test_assert(newVecMath(s, n, NULL, NULL, newConstantValue(s, 1.0f), VecScale) == n);
+	test_assert(eliminated == 5);
+	delete_storage(s);
+	return true;
+}
+
+bool folding_dead_mix(void) {
+	struct node_storage *s = make_storage();
+	size_t eliminated = 0;
+	s->eliminated = &eliminated;
+	const struct colorNode *A = newVecToColor(s, newNormal(s));
+	const struct colorNode *B = newSplitValue(s, newVecToValue(s, newUV(s), U));
+	test_assert(new_color_mix(s, A, B, newConstantValue(s, 0.0f)) == A);
+	test_assert(new_color_mix(s, A, B, newConstantValue(s, 1.0f)) == B);
+	const struct colorNode *mix = new_color_mix(s, A, B, newConstantValue(s, 0.5f));
+	test_assert(mix != A && mix != B);
+	const struct bsdfNode *diffuse = newDiffuse(s, A);
+	const struct bsdfNode *metal = newMetal(s, B, NULL);
+	test_assert(newMix(s, diffuse, metal, newConstantValue(s, 1.0f)) == metal);
+	test_assert(eliminated == 3);
+	delete_storage(s);
+	return true;
+}
@@ -4,12 +4,12 @@
 
 #pragma once
 
-#include "../src/renderer/samplers/sampler.h"
+#include "../src/lib/renderer/samplers/sampler.h"
 
 bool test_halton(void) {
 	struct sampler *sampler = newSampler();
 	initSampler(sampler, Halton, 0, 1, 0);
-
+	destroySampler(sampler);
 	return true;
 }
 
@@ -39,4 +39,52 @@ bool test_pseudorandom(void) {
 		test_assert(first_run[i] == second_run[i]);
 	}
 	return true;
-}
\ No newline at end of file
+}
+
+// 16 samples of a 2D Sobol point set should land one per 1/16 strip along both axes,
+// and one per cell of a 4x4 grid. This holds for the padded dimensions as well.
+static bool sobol_check_strata(size_t skip) {
+	struct sampler *sampler = newSampler();
+	bool strip_x[16] = { 0 };
+	bool strip_y[16] = { 0 };
+	bool cell[4][4] = { { 0 } };
+	for (int pass = 0; pass < 16; ++pass) {
+		initSampler(sampler, Sobol, pass, 16, 1234);
+		float u[2];
+		for (size_t i = 0; i < skip; ++i) getDimensions2D(sampler, u);
+		getDimensions2D(sampler, u);
+		test_assert(u[0] >= 0.0f && u[0] < 1.0f);
+		test_assert(u[1] >= 0.0f && u[1] < 1.0f);
+		const int x = (int)(u[0] * 16.0f);
+		const int y = (int)(u[1] * 16.0f);
+		test_assert(!strip_x[x]);
+		test_assert(!strip_y[y]);
+		test_assert(!cell[x / 4][y / 4]);
+		strip_x[x] = strip_y[y] = cell[x / 4][y / 4] = true;
+	}
+	destroySampler(sampler);
+	return true;
+}
+
+bool sampler_sobol_stratified(void) {
+	for (size_t skip = 0; skip < 20; ++skip) {
+		test_assert(sobol_check_strata(skip));
+	}
+	return true;
+}
+
+// Different pixels should not see the same sequence
+bool sampler_sobol_decorrelated(void) {
+	struct sampler *a = newSampler();
+	struct sampler *b = newSampler();
+	initSampler(a, Sobol, 3, 16, 0);
+	initSampler(b, Sobol, 3, 16, 1);
+	size_t equal = 0;
+	for (int i = 0; i < 32; ++i) {
+		if (getDimension(a) == getDimension(b)) equal++;
+	}
+	test_assert(equal < 2);
+	destroySampler(a);
+	destroySampler(b);
+	return true;
+}
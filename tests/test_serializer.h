@@ -53,7 +53,7 @@ bool serializer_serialize(void) {
 	int bak, new;
 
 	silence_stdout(&bak, &new);
-	int ret = parse_json(ext, scene_json);
+	int ret = parse_json(ext, scene_json, NULL);
 	resume_stdout(&bak, &new);
 
 	test_assert(ret >= 0);
@@ -0,0 +1,333 @@
+//
+//  test_texture.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#pragma once
+
+#include "../src/common/texture.h"
+#include "../src/common/tiled_texture.h"
+#include "../src/common/texture_cache.h"
+#include "../src/common/loaders/textureloader.h"
+#include "../src/common/platform/thread_pool.h"
+#include "../src/common/platform/capabilities.h"
+
+static struct texture *noise_texture(enum precision p, size_t width, size_t height, size_t channels) {
+	struct texture *t = newTexture(p, width, height, channels);
+	uint32_t state = 4321;
+	for (size_t y = 0; y < height; ++y) {
+		for (size_t x = 0; x < width; ++x) {
+			float c[4];
+			for (int i = 0; i < 4; ++i) {
+				state = state * 1664525u + 1013904223u;
+				c[i] = (float)(state >> 8) / (float)(1u << 24);
+			}
+			setPixel(t, (struct color){ c[0], c[1], c[2], c[3] }, x, y);
+		}
+	}
+	return t;
+}
+
+// Tiled fetches should give exactly what textureGetPixel() does
+static bool tiled_matches(enum precision p, size_t width, size_t height, size_t channels) {
+	struct texture *flat = noise_texture(p, width, height, channels);
+	struct tiled_texture *tiled = tiled_texture_new(flat);
+	tiled_texture_build(NULL, tiled, false);
+	bool ok = tiled && tiled->level_count;
+	if (ok) {
+		const tiled_fetch filtered = tiled_texture_fetcher(tiled, tiled_filtered);
+		const tiled_fetch nearest = tiled_texture_fetcher(tiled, 0);
+		for (float v = -0.25f; v < 1.25f && ok; v += 0.0173f) {
+			for (float u = -0.25f; u < 1.25f && ok; u += 0.0191f) {
+				ok = colorEquals(filtered(tiled, u, v, 0.0f), textureGetPixel(flat, u, v, true));
+				if (ok && u >= 0.0f && v >= 0.0f) {
+					ok = colorEquals(nearest(tiled, u, v, 0.0f), textureGetPixel(flat, u * width, v * height, false));
+				}
+			}
+		}
+	}
+	tiled_texture_destroy(tiled);
+	destroyTexture(flat);
+	return ok;
+}
+
+bool texture_tiled_rgba8(void) {
+	test_assert(tiled_matches(char_p, 13, 7, 1));
+	test_assert(tiled_matches(char_p, 20, 17, 3));
+	test_assert(tiled_matches(char_p, 64, 8, 4));
+	return true;
+}
+
+// sRGB fetches should match converting the flat texel, for 8 bit textures via the lookup table
+static bool srgb_matches(enum precision p, bool half) {
+	struct texture *flat = noise_texture(p, 20, 17, 4);
+	struct tiled_texture *tiled = tiled_texture_new(flat);
+	tiled_texture_build(NULL, tiled, half);
+	const tiled_fetch nearest = tiled_texture_fetcher(tiled, tiled_srgb);
+	bool ok = true;
+	for (float v = 0.0f; v < 1.0f && ok; v += 0.0173f) {
+		for (float u = 0.0f; u < 1.0f && ok; u += 0.0191f) {
+			const struct color expected = colorFromSRGB(textureGetPixel(flat, u * 20, v * 17, false));
+			const struct color actual = nearest(tiled, u, v, 0.0f);
+			// Half floats have 11 bits of precision
+			const float tolerance = half ? 0.002f : 0.0f;
+			ok = fabsf(expected.red - actual.red) <= tolerance && fabsf(expected.green - actual.green) <= tolerance
+				&& fabsf(expected.blue - actual.blue) <= tolerance && fabsf(expected.alpha - actual.alpha) <= tolerance;
+		}
+	}
+	tiled_texture_destroy(tiled);
+	destroyTexture(flat);
+	return ok;
+}
+
+// The same, with fetchers for this CPU, if it has better ones
+bool texture_tiled_kernels(void) {
+	tiled_texture_select_kernels(sys_get_cpu_features());
+	const bool ok = tiled_matches(char_p, 20, 17, 3) && tiled_matches(float_p, 20, 17, 4);
+	tiled_texture_select_kernels(0);
+	test_assert(ok);
+	return true;
+}
+
+bool texture_tiled_rgba32f(void) {
+	test_assert(tiled_matches(float_p, 13, 7, 1));
+	test_assert(tiled_matches(float_p, 20, 17, 3));
+	test_assert(tiled_matches(float_p, 1, 1, 4));
+	return true;
+}
+
+// Two channel images are grayscale with alpha, unlike textureGetPixel(), which reads them as RGB
+bool texture_tiled_gray_alpha(void) {
+	struct texture *flat = newTexture(char_p, 3, 2, 2);
+	for (size_t i = 0; i < 3 * 2; ++i) {
+		flat->data.byte_p[i * 2 + 0] = (unsigned char)(40 * i);
+		flat->data.byte_p[i * 2 + 1] = (unsigned char)(255 - 30 * i);
+	}
+	struct tiled_texture *tiled = tiled_texture_new(flat);
+	tiled_texture_build(NULL, tiled, false);
+	const tiled_fetch nearest = tiled_texture_fetcher(tiled, 0);
+	for (size_t y = 0; y < 2; ++y) {
+		for (size_t x = 0; x < 3; ++x) {
+			// Rows are stored bottom up
+			const size_t i = x + (1 - y) * 3;
+			const struct color c = nearest(tiled, (x + 0.5f) / 3.0f, (y + 0.5f) / 2.0f, 0.0f);
+			test_assert(c.red == flat->data.byte_p[i * 2] / 255.0f);
+			test_assert(c.green == c.red && c.blue == c.red);
+			test_assert(c.alpha == flat->data.byte_p[i * 2 + 1] / 255.0f);
+		}
+	}
+	tiled_texture_destroy(tiled);
+	destroyTexture(flat);
+	return true;
+}
+
+bool texture_tiled_srgb(void) {
+	test_assert(srgb_matches(char_p, false));
+	test_assert(srgb_matches(float_p, false));
+	test_assert(srgb_matches(float_p, true));
+	return true;
+}
+
+bool texture_tiled_rgba16f(void) {
+	struct texture *flat = newTexture(float_p, 4, 1, 4);
+	const struct color values[] = {
+		{ 0.0f, 1.0f, -2.0f, 0.5f },
+		{ 65504.0f, 1e-7f, 0.333f, 1024.0f },
+		{ 1e6f, -1e6f, 6.0e-5f, 0.1f },
+		{ 3.14159f, 2.71828f, 1.0f / 3.0f, 0.0f },
+	};
+	for (size_t i = 0; i < 4; ++i) setPixel(flat, values[i], i, 0);
+	struct tiled_texture *tiled = tiled_texture_new(flat);
+	tiled_texture_build(NULL, tiled, true);
+	test_assert(tiled->format == tiled_rgba16f);
+	// Exactly representable values survive as-is
+	test_assert(colorEquals(tiled_texture_texel(tiled, 0, 0, 0), values[0]));
+	const struct color big = tiled_texture_texel(tiled, 0, 1, 0);
+	test_assert(big.red == 65504.0f);
+	test_assert(big.alpha == 1024.0f);
+	very_roughly_equals(big.blue, 0.333f);
+	// Out of range values become infinities, tiny ones stay tiny
+	const struct color huge = tiled_texture_texel(tiled, 0, 2, 0);
+	test_assert(isinf(huge.red) && huge.red > 0.0f);
+	test_assert(isinf(huge.green) && huge.green < 0.0f);
+	test_assert(fabsf(huge.blue - 6.0e-5f) < 1e-7f);
+	const struct color pi = tiled_texture_texel(tiled, 0, 3, 0);
+	test_assert(fabsf(pi.red - 3.14159f) < 0.002f);
+	test_assert(fabsf(pi.blue - 1.0f / 3.0f) < 0.0002f);
+	tiled_texture_destroy(tiled);
+	destroyTexture(flat);
+	return true;
+}
+
+// A checkerboard averages out to gray, so coarser levels converge on 0.5
+bool texture_mip_chain(void) {
+	struct texture *flat = newTexture(char_p, 64, 16, 3);
+	for (size_t y = 0; y < 16; ++y) {
+		for (size_t x = 0; x < 64; ++x) {
+			setPixel(flat, (x + y) & 1 ? g_white_color : g_black_color, x, y);
+		}
+	}
+	struct tiled_texture *tiled = tiled_texture_new(flat);
+	tiled_texture_build(NULL, tiled, false);
+	test_assert(tiled->level_count == 7);
+	test_assert(tiled->levels[2].width == 16 && tiled->levels[2].height == 4);
+	test_assert(tiled->levels[6].width == 1 && tiled->levels[6].height == 1);
+
+	const tiled_fetch fetch = tiled_texture_fetcher(tiled, tiled_filtered);
+	// A footprint of one level 0 texel picks level 0
+	const struct color fine = fetch(tiled, 0.5f / 64.0f, 0.5f / 16.0f, 0.0f);
+	test_assert(fine.red == 0.0f || fine.red == 1.0f);
+	const struct color coarse = fetch(tiled, 0.3f, 0.6f, 1.0f);
+	very_roughly_equals(coarse.red, 0.5f);
+	very_roughly_equals(coarse.green, 0.5f);
+	very_roughly_equals(coarse.blue, 0.5f);
+	const struct color texel = tiled_texture_texel(tiled, 1, 3, 2);
+	very_roughly_equals(texel.red, 0.5f);
+
+	tiled_texture_destroy(tiled);
+	destroyTexture(flat);
+	return true;
+}
+
+// Levels built on demand should look the same as ones built up front
+bool texture_cache_matches(void) {
+	struct texture *flat = noise_texture(char_p, 64, 48, 4);
+	struct tiled_texture *built = tiled_texture_new(flat);
+	tiled_texture_build(NULL, built, false);
+	struct tiled_texture *cached = tiled_texture_new(flat);
+	struct texture_cache *cache = texture_cache_new(1 << 20);
+	tiled_texture_use_cache(cached, cache, false);
+
+	const tiled_fetch a = tiled_texture_fetcher(built, tiled_filtered | tiled_srgb);
+	const tiled_fetch b = tiled_texture_fetcher(cached, tiled_filtered | tiled_srgb);
+	const float footprints[] = { 0.0f, 0.02f, 0.05f, 0.3f, 1.0f };
+	for (size_t f = 0; f < sizeof(footprints) / sizeof(*footprints); ++f) {
+		for (float v = 0.0f; v < 1.0f; v += 0.093f) {
+			for (float u = 0.0f; u < 1.0f; u += 0.071f) {
+				test_assert(colorEquals(a(built, u, v, footprints[f]), b(cached, u, v, footprints[f])));
+			}
+		}
+	}
+	texture_cache_thread_flush(cache);
+	const struct texture_cache_stats stats = texture_cache_stats(cache);
+	// The first miss builds every level, the rest are hits
+	test_assert(stats.misses == 1);
+	test_assert(stats.hits > 100);
+	test_assert(stats.evictions == 0);
+
+	texture_cache_destroy(cache);
+	tiled_texture_destroy(cached);
+	tiled_texture_destroy(built);
+	destroyTexture(flat);
+	return true;
+}
+
+bool texture_cache_evicts(void) {
+	struct texture *flat = noise_texture(char_p, 64, 64, 3);
+	struct tiled_texture *cached = tiled_texture_new(flat);
+	// Room for level 0, or level 1 and down, but not both
+	struct texture_cache *cache = texture_cache_new(tiled_level_bytes(cached, 0));
+	tiled_texture_use_cache(cached, cache, false);
+	const tiled_fetch fetch = tiled_texture_fetcher(cached, 0);
+
+	// Level 0 is pinned, so the coarser levels built along with it don't fit
+	const struct color first = fetch(cached, 0.25f, 0.25f, 0.0f);
+	texture_cache_thread_flush(cache);
+	struct texture_cache_stats stats = texture_cache_stats(cache);
+	test_assert(stats.misses == 1);
+	test_assert(stats.evictions == cached->level_count - 1);
+	test_assert(cached->cached[0] && !cached->cached[1]);
+	test_assert(stats.used_bytes <= stats.budget_bytes);
+	test_assert(stats.peak_bytes > stats.budget_bytes);
+
+	// Then level 1 pushes level 0 out once it's no longer pinned
+	fetch(cached, 0.25f, 0.25f, 2.0f / 64.0f);
+	texture_cache_thread_flush(cache);
+	stats = texture_cache_stats(cache);
+	test_assert(stats.misses == 2);
+	test_assert(!cached->cached[0] && cached->cached[1]);
+	test_assert(stats.used_bytes <= stats.budget_bytes);
+
+	// Evicted levels are built again when they're needed
+	test_assert(colorEquals(fetch(cached, 0.25f, 0.25f, 0.0f), first));
+	texture_cache_thread_flush(cache);
+	stats = texture_cache_stats(cache);
+	test_assert(stats.misses == 3);
+
+	texture_cache_destroy(cache);
+	tiled_texture_destroy(cached);
+	destroyTexture(flat);
+	return true;
+}
+
+// Minimal Radiance encoder, RLE scanlines with both runs and literals
+static file_data encode_hdr(size_t width, size_t height) {
+	char header[128];
+	const int header_len = snprintf(header, sizeof(header), "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y %zu +X %zu\n", height, width);
+	// Worst case, a count byte per 128 literals
+	const size_t capacity = header_len + height * (4 + 4 * (width + width / 128 + 1));
+	unsigned char *out = malloc(capacity);
+	memcpy(out, header, header_len);
+	size_t n = header_len;
+	unsigned char *scanline = malloc(width * 4);
+	uint32_t state = 1234;
+	for (size_t y = 0; y < height; ++y) {
+		for (size_t x = 0; x < width; ++x) {
+			state = state * 1664525u + 1013904223u;
+			// Flat stretches become runs, with some zero exponents in there
+			const bool flat = (x / 37 + y) % 3 == 0;
+			for (size_t k = 0; k < 4; ++k) scanline[x * 4 + k] = flat ? (unsigned char)(y + k * 50) : (unsigned char)(state >> (8 * k));
+		}
+		out[n++] = 2;
+		out[n++] = 2;
+		out[n++] = (unsigned char)(width >> 8);
+		out[n++] = (unsigned char)(width & 0xFF);
+		for (size_t k = 0; k < 4; ++k) {
+			for (size_t i = 0; i < width;) {
+				size_t run = 1;
+				while (i + run < width && run < 127 && scanline[(i + run) * 4 + k] == scanline[i * 4 + k]) run++;
+				if (run >= 3) {
+					out[n++] = (unsigned char)(128 + run);
+					out[n++] = scanline[i * 4 + k];
+					i += run;
+					continue;
+				}
+				size_t count = 0;
+				while (i + count < width && count < 128) {
+					if (i + count + 2 < width && scanline[(i + count) * 4 + k] == scanline[(i + count + 1) * 4 + k] && scanline[(i + count) * 4 + k] == scanline[(i + count + 2) * 4 + k]) break;
+					count++;
+				}
+				if (!count) count = 1;
+				out[n++] = (unsigned char)count;
+				for (size_t c = 0; c < count; ++c) out[n++] = scanline[(i + c) * 4 + k];
+				i += count;
+			}
+		}
+	}
+	free(scanline);
+	return (file_data){ .items = out, .count = n };
+}
+
+bool texture_hdr_parallel(void) {
+	file_data encoded = encode_hdr(640, 480);
+	struct cr_thread_pool *pool = thread_pool_create(4);
+	struct texture *serial = load_texture("test.hdr", encoded);
+	struct texture *parallel = load_texture_parallel(pool, "test.hdr", encoded);
+	test_assert(serial && parallel);
+	test_assert(parallel->width == 640 && parallel->height == 480);
+	test_assert(parallel->channels == serial->channels && parallel->precision == float_p);
+	test_assert(!memcmp(serial->data.float_p, parallel->data.float_p, 640 * 480 * 3 * sizeof(float)));
+
+	// Truncated files are refused up front
+	const file_data truncated = { .items = encoded.items, .count = encoded.count / 2 };
+	test_assert(!load_texture_parallel(pool, "test.hdr", truncated));
+
+	destroyTexture(parallel);
+	destroyTexture(serial);
+	thread_pool_destroy(pool);
+	free(encoded.items);
+	return true;
+}
@@ -7,6 +7,7 @@
 //
 
 #include "../src/common/platform/thread_pool.h"
+#include "../src/common/platform/atomics.h"
 #include "../src/common/timer.h"
 #include <pthread.h>
 #include <stdio.h>
@@ -47,3 +48,83 @@ bool test_thread_pool(void) {
 
 	return true;
 }
+
+struct fib_job {
+	struct cr_thread_pool *pool;
+	unsigned n;
+	size_t result;
+};
+
+// Every level waits on its children from inside a pool task, which only works if
+// waiting workers help out. Leaves end up spread across the pool by stealing.
+static void fib_task(void *arg) {
+	struct fib_job *job = arg;
+	if (job->n < 2) {
+		job->result = job->n;
+		return;
+	}
+	struct fib_job a = { job->pool, job->n - 1, 0 };
+	struct fib_job b = { job->pool, job->n - 2, 0 };
+	struct cr_task_group group = { 0 };
+	thread_pool_enqueue_group(job->pool, &group, fib_task, &a);
+	thread_pool_enqueue_group(job->pool, &group, fib_task, &b);
+	thread_pool_wait_group(job->pool, &group);
+	job->result = a.result + b.result;
+}
+
+bool test_thread_pool_nested_groups(void) {
+	struct cr_thread_pool *pool = thread_pool_create(4);
+	for (int i = 0; i < 10; ++i) {
+		struct fib_job job = { pool, 16, 0 };
+		struct cr_task_group group = { 0 };
+		thread_pool_enqueue_group(pool, &group, fib_task, &job);
+		thread_pool_wait_group(pool, &group);
+		test_assert(job.result == 987);
+	}
+	thread_pool_destroy(pool);
+	return true;
+}
+
+static void count_task(void *arg) {
+	atomic_add_size(arg, 1);
+}
+
+struct spawn_job {
+	struct cr_thread_pool *pool;
+	size_t count;
+	size_t tasks;
+};
+
+static void spawn_task(void *arg) {
+	struct spawn_job *job = arg;
+	struct cr_task_group group = { 0 };
+	// More than fits in a worker deque, the rest should spill over to the shared queue
+	for (size_t i = 0; i < job->tasks; ++i) {
+		thread_pool_enqueue_group(job->pool, &group, count_task, &job->count);
+	}
+	thread_pool_wait_group(job->pool, &group);
+}
+
+bool test_thread_pool_overflow(void) {
+	struct cr_thread_pool *pool = thread_pool_create(3);
+	test_assert(thread_pool_size(pool) == 3);
+	struct spawn_job jobs[4];
+	for (size_t i = 0; i < 4; ++i) {
+		jobs[i] = (struct spawn_job){ .pool = pool, .tasks = 1000 };
+		thread_pool_enqueue(pool, spawn_task, &jobs[i]);
+	}
+	// Separate groups can be waited on independently of the rest of the pool
+	size_t count = 0;
+	struct cr_task_group group = { 0 };
+	for (size_t i = 0; i < 5000; ++i) {
+		thread_pool_enqueue_group(pool, &group, count_task, &count);
+	}
+	thread_pool_wait_group(pool, &group);
+	test_assert(count == 5000);
+	thread_pool_wait(pool);
+	for (size_t i = 0; i < 4; ++i) {
+		test_assert(jobs[i].count == jobs[i].tasks);
+	}
+	thread_pool_destroy(pool);
+	return true;
+}
@@ -0,0 +1,174 @@
+//
+//  test_tile.h
+//  c-ray
+//
+//  Created by agent on 19/10/2026.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#pragma once
+
+#include "../src/lib/datatypes/tile.h"
+#include "../src/common/platform/thread_pool.h"
+#include "../src/common/platform/atomics.h"
+#include "../src/common/platform/mutex.h"
+#include "../src/lib/renderer/accum.h"
+#include "../src/common/texture.h"
+#include "../src/lib/renderer/autotune.h"
+#include "test_integrator.h"
+
+struct tile_claim_ctx {
+	struct tile_set *set;
+	size_t *claims;
+};
+
+static void claim_tiles(void *arg) {
+	struct tile_claim_ctx *ctx = arg;
+	struct render_tile *tile = NULL;
+	while ((tile = tile_next(ctx->set))) {
+		atomic_add_size(&ctx->claims[tile->index], 1);
+		tile_finish(ctx->set, tile);
+	}
+}
+
+bool tile_next_concurrent(void) {
+	struct tile_set set = tile_quantize(640, 480, 8, 8, ro_from_middle);
+	size_t *claims = calloc(set.tiles.count, sizeof(*claims));
+	struct tile_claim_ctx ctx = { .set = &set, .claims = claims };
+
+	struct cr_thread_pool *pool = thread_pool_create(8);
+	for (int i = 0; i < 8; ++i) {
+		thread_pool_enqueue(pool, claim_tiles, &ctx);
+	}
+	thread_pool_wait(pool);
+	thread_pool_destroy(pool);
+
+	for (size_t i = 0; i < set.tiles.count; ++i) {
+		test_assert(claims[i] == 1);
+		test_assert(set.tiles.items[i].state == finished);
+	}
+	test_assert(tile_set_claimed(&set) == set.tiles.count);
+	test_assert(set.completed == set.tiles.count);
+
+	free(claims);
+	tile_set_free(&set);
+	return true;
+}
+
+// Two threads splitting one tile's samples between them should merge into the plain average
+bool tile_accum_merge(void) {
+	struct render_tile tile = {
+		.width = 4, .height = 4,
+		.begin = { 2, 2 }, .end = { 6, 6 },
+		.total_samples = 6,
+		.merge_lock = mutex_create(),
+	};
+	struct texture *buf = newTexture(float_p, 8, 8, 4);
+	struct tile_accum a = { 0 };
+	struct tile_accum b = { 0 };
+	accum_begin(&a, &tile, false);
+	accum_begin(&b, &tile, false);
+	for (size_t s = 0; s < 2; ++s) {
+		for (size_t i = 0; i < a.pixels; ++i) accum_add(&a, i, (struct color){ 1.0f, 1.0f, 1.0f, 1.0f }, NULL);
+		a.samples++;
+	}
+	for (size_t s = 0; s < 4; ++s) {
+		for (size_t i = 0; i < b.pixels; ++i) accum_add(&b, i, (struct color){ 4.0f, 4.0f, 4.0f, 1.0f }, NULL);
+		b.samples++;
+	}
+	test_assert(!accum_flush(&a, buf, NULL));
+	test_assert(tile.completed_samples == 2);
+	test_assert(accum_flush(&b, buf, NULL));
+	test_assert(tile.completed_samples == 6);
+	// Nothing left to flush
+	test_assert(!accum_flush(&b, buf, NULL));
+
+	for (int y = 0; y < 8; ++y) {
+		for (int x = 0; x < 8; ++x) {
+			const struct color c = textureGetPixel(buf, x, y, false);
+			const bool inside = x >= 2 && x < 6 && y >= 2 && y < 6;
+			roughly_equals(c.red, inside ? 3.0f : 0.0f);
+		}
+	}
+
+	accum_free(&a);
+	accum_free(&b);
+	mutex_destroy(tile.merge_lock);
+	destroyTexture(buf);
+	return true;
+}
+
+bool tile_hilbert_order(void) {
+	// On a power of two grid, every tile should be right next to the previous one
+	struct tile_set set = tile_quantize(256, 256, 32, 32, ro_hilbert);
+	test_assert(set.tiles.count == 64);
+	for (size_t i = 1; i < set.tiles.count; ++i) {
+		const struct render_tile *a = &set.tiles.items[i - 1];
+		const struct render_tile *b = &set.tiles.items[i];
+		const int dist = abs(a->begin.x - b->begin.x) + abs(a->begin.y - b->begin.y);
+		test_assert(dist == 32);
+	}
+	tile_set_free(&set);
+
+	// Otherwise the curve is clipped, but all tiles still have to be there exactly once
+	set = tile_quantize(300, 100, 32, 32, ro_hilbert);
+	test_assert(set.tiles.count == 40);
+	bool seen[40] = { 0 };
+	for (size_t i = 0; i < set.tiles.count; ++i) {
+		const struct render_tile *t = &set.tiles.items[i];
+		const size_t idx = (t->begin.y / 32) * 10 + t->begin.x / 32;
+		test_assert(!seen[idx]);
+		seen[idx] = true;
+	}
+	tile_set_free(&set);
+	return true;
+}
+
+// Every pixel of the frame has to be in exactly one tile
+static bool tiles_cover(const struct tile_set *set, unsigned width, unsigned height) {
+	unsigned char *hits = calloc(width * height, 1);
+	for (size_t i = 0; i < set->tiles.count; ++i) {
+		const struct render_tile *t = &set->tiles.items[i];
+		for (int y = t->begin.y; y < t->end.y; ++y) {
+			for (int x = t->begin.x; x < t->end.x; ++x) {
+				if (x < 0 || y < 0 || x >= (int)width || y >= (int)height) {
+					free(hits);
+					return false;
+				}
+				hits[y * width + x]++;
+			}
+		}
+	}
+	bool covered = true;
+	for (size_t i = 0; i < width * height; ++i) covered &= hits[i] == 1;
+	free(hits);
+	return covered;
+}
+
+bool tile_autotune_candidates(void) {
+	// A frame that doesn't divide evenly into any of the sizes
+	for (size_t i = 0; i < tile_autotune_size_count; ++i) {
+		const unsigned size = tile_autotune_sizes[i];
+		test_assert(i == 0 || size > tile_autotune_sizes[i - 1]);
+		for (enum render_order order = ro_top_to_bottom; order <= ro_hilbert; ++order) {
+			struct tile_set set = tile_quantize(301, 97, size, size, order);
+			test_assert(tiles_cover(&set, 301, 97));
+			tile_set_free(&set);
+		}
+	}
+
+	struct cr_renderer *ext = integrator_render("pathtrace", true);
+	test_assert(ext);
+	const struct renderer *r = (const struct renderer *)ext;
+	const unsigned w = r->state.tile_width;
+	test_assert(w == r->state.tile_height);
+	bool candidate = false;
+	for (size_t i = 0; i < tile_autotune_size_count; ++i) candidate |= w == tile_autotune_sizes[i];
+	test_assert(candidate);
+	const struct camera *cam = &r->scene->cameras.items[r->prefs.selected_camera];
+	struct tile_set set = tile_quantize(cam->width, cam->height, w, w, r->prefs.tileOrder);
+	test_assert(tiles_cover(&set, cam->width, cam->height));
+	tile_set_free(&set);
+	cr_destroy_renderer(ext);
+	return true;
+}
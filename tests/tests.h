@@ -41,9 +41,13 @@ static char *failed_expression;
 #include "test_textbuffer.h"
 #include "test_transforms.h"
 #include "test_vector.h"
+#include "test_color.h"
 #include "test_fileio.h"
+#include "test_file_cache.h"
 #include "test_string.h"
 #include "test_hashtable.h"
+#include "test_mempool.h"
+#include "test_bvh.h"
 #include "test_base64.h"
 #include "test_nodes.h"
 #include "test_linked_list.h"
@@ -51,6 +55,13 @@ static char *failed_expression;
 #include "test_dyn_array.h"
 #include "test_serializer.h"
 #include "test_thread_pool.h"
+#include "test_denoise.h"
+#include "test_integrator.h"
+#include "test_camera.h"
+#include "test_tile.h"
+#include "test_sampler.h"
+#include "test_capabilities.h"
+#include "test_texture.h"
 
 typedef struct {
 	char *test_name;
@@ -77,6 +88,11 @@ static test tests[] = {
 	{"vector::randomOnUnitSphere", vector_random_on_sphere},
 	{"vector::reflect", vector_reflect},
 	
+	{"color::mul", color_mul},
+	{"color::add", color_add},
+	{"color::coef", color_coef},
+	{"color::mix", color_mix},
+	
 	{"transforms::transpose", transform_transpose},
 	{"transforms::multiply", transform_multiply},
 	{"transforms::determinant", transform_determinant},
@@ -112,6 +128,8 @@ static test tests[] = {
 	{"fileio::humanFileSize", fileio_humanFileSize},
 	{"fileio::getFileName", fileio_getFileName},
 	{"fileio::getFilePath", fileio_getFilePath},
+	{"file_cache::dedupe", file_cache_dedupe},
+	{"file_cache::reload", file_cache_reload},
 	
 	{"string::stringEquals", string_stringEquals},
 	{"string::stringContains", string_stringContains},
@@ -123,6 +141,14 @@ static test tests[] = {
 	
 	{"hashtable::mixed", hashtable_mixed},
 	{"hashtable::fill", hashtable_fill},
+	{"hashtable::grow", hashtable_grow},
+	{"hashtable::remove", hashtable_remove},
+	
+	{"mempool::grow", mempool_grow},
+	{"mempool::large", mempool_large},
+	
+	{"bvh::matches_brute_force", bvh_matches_brute_force},
+	{"bvh::sphere_set_matches_brute_force", bvh_sphere_set_matches_brute_force},
 	
 	{"base64::basic", base64_basic},
 	{"base64::padding_2", base64_padding_2},
@@ -156,6 +182,13 @@ static test tests[] = {
 	{"mathnode::tangent", mathnode_tangent},
 	{"mathnode::toradians", mathnode_toradians},
 	{"mathnode::todegrees", mathnode_todegrees},
+	{"compiler::matches_tree", compiler_matches_tree},
+	{"compiler::bsdf_matches_tree", compiler_bsdf_matches_tree},
+	{"compiler::register_limit", compiler_register_limit},
+	{"compiler::skips_constants", compiler_skips_constants},
+	{"folding::constants", folding_constants},
+	{"folding::identities", folding_identities},
+	{"folding::dead_mix", folding_dead_mix},
 	
 	{"vecmath::vecAdd", vecmath_vecAdd},
 	{"vecmath::vecSubtract", vecmath_vecSubtract},
@@ -189,6 +222,44 @@ static test tests[] = {
 	{"serializer::serialize", serializer_serialize},
 
 	{"threadpool::basic", test_thread_pool},
+	{"threadpool::nested_groups", test_thread_pool_nested_groups},
+	{"threadpool::overflow", test_thread_pool_overflow},
+
+	{"denoise::flat_constant", denoise_flat_constant},
+	{"denoise::flat_noisy", denoise_flat_noisy},
+
+	{"integrator::wavefront_matches_pathtrace", integrator_wavefront_matches_pathtrace},
+
+	{"camera::batch_matches_single", camera_batch_matches_single},
+	{"camera::batch_matches_single_dof", camera_batch_matches_single_dof},
+	{"camera::matches_reference", camera_matches_reference},
+
+	{"tile::next_concurrent", tile_next_concurrent},
+	{"tile::accum_merge", tile_accum_merge},
+	{"tile::hilbert_order", tile_hilbert_order},
+	{"tile::autotune_candidates", tile_autotune_candidates},
+
+	{"sampler::halton", test_halton},
+	{"sampler::hammersley", test_hammersley},
+	{"sampler::pseudorandom", test_pseudorandom},
+	{"sampler::sobol_stratified", sampler_sobol_stratified},
+	{"sampler::sobol_decorrelated", sampler_sobol_decorrelated},
+
+	{"capabilities::topology", capabilities_topology},
+	{"capabilities::pin_cores", capabilities_pin_cores},
+	{"capabilities::pin_compact", capabilities_pin_compact},
+	{"capabilities::cpu_features", capabilities_cpu_features},
+
+	{"texture::tiled_rgba8", texture_tiled_rgba8},
+	{"texture::tiled_rgba32f", texture_tiled_rgba32f},
+	{"texture::tiled_kernels", texture_tiled_kernels},
+	{"texture::mip_chain", texture_mip_chain},
+	{"texture::tiled_gray_alpha", texture_tiled_gray_alpha},
+	{"texture::tiled_srgb", texture_tiled_srgb},
+	{"texture::tiled_rgba16f", texture_tiled_rgba16f},
+	{"texture::cache_matches", texture_cache_matches},
+	{"texture::cache_evicts", texture_cache_evicts},
+	{"texture::hdr_parallel", texture_hdr_parallel},
 };
 
 #define testCount (sizeof(tests) / sizeof(test))